@@ -47,7 +47,8 @@ int main()
 	// The calibration object is now connected and ready to work. Lets get data:
 	
 	//Assignment object holds all information about data obtained
-	auto_ptr<Assignment> a(calib->GetAssignment("/test/test_vars/test_table"));
+	//(!) the assignment may be shared with the cache of the calibration, so it is never deleted by user
+	shared_ptr<Assignment> a = calib->GetAssignmentShared("/test/test_vars/test_table");
 	
 	//type table class holds information about table
 	cout<<"A full path requested: "<< a->GetTypeTable()->GetFullPath() <<endl;
@@ -10,6 +10,14 @@
 #define TESTS_CONENCTION_STRING "mysql://ccdb_user@127.0.0.1:3306 ccdb"
 #endif
 
+#ifndef WIN32
+#define BENCHMARKS_SQLITE_STRING ( "sqlite://" + string(getenv("CCDB_HOME")) + "/sql/ccdb.sqlite")
+#else
+#define BENCHMARKS_SQLITE_STRING "sqlite://..\\..\\..\\sql\\ccdb.sqlite"
+#endif
+
+#include <stdlib.h>
+#include <string>
 #include "CCDB/Console.h"
 #include "CCDB/Helpers/StopWatch.h"
 
@@ -24,9 +32,9 @@ extern std::string gConnectionString;
 #define BENCHMARK_INIT() StopWatch stopwatch; 
 
 //must be called once per function that performs tests
-#define BENCHMARK_START(title) gConsole.WriteLine(Console::cBrightBlue,"\n[ %s ]", (title)); stopwatch.Start();
+#define BENCHMARK_START(title) gConsole.WriteLine(Console::cBrightBlue,"\n[ %s ]", (title)); stopwatch.Restart();
 
 //must be called once per function that performs tests
-#define BENCHMARK_FINISH(title) stopwatch.Stop(); gConsole.WriteLine(Console::cGreen, " %s %f", (title), stopwatch.GetDuration());
+#define BENCHMARK_FINISH(title) gConsole.WriteLine(Console::cGreen, " %s %f", (title), stopwatch.ElapsedUs()/1000000.0);
 
 #endif // bencjmarks_h__
\ No newline at end of file
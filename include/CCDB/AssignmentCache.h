@@ -0,0 +1,251 @@
+#ifndef CCDB_ASSIGNMENT_CACHE_H
+#define CCDB_ASSIGNMENT_CACHE_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <stdint.h>
+#include <time.h>
+
+#include "CCDB/Globals.h"
+#include "CCDB/Model/Assignment.h"
+#include "CCDB/ConstantsView.h"
+#include "CCDB/ReadWriteLock.h"
+
+namespace ccdb
+{
+
+/** @brief Memory bounded two level cache of assignments
+ *
+ * Each DataProvider (i.e. each connection) owns one AssignmentCache so Calibrations
+ * that share a connection share the cached data, and different connections never mix.
+ *
+ * Level 1 is the index of requests: (path, run, variation, time) => assignment id.
+ * Level 2 is the store of assignments by assignment id. Many runs of the same run range
+ * resolve to one assignment id and so share one fetched and decoded copy of data.
+ *
+ * The store has a byte budget. Each entry is weighted by the size of its data blob
+ * and when the budget is exceeded the least recently used entries are evicted.
+ * Entries of pinned paths (hot tables that are requested for every event) are never evicted.
+ * The index is bounded by number of entries and is also LRU.
+ *
+ * Assignments are returned as shared_ptr so an evicted assignment stays
+ * alive while somebody still reads it.
+ *
+ * Hits don't serialize: the store and the index are split to shards with readers-writer locks
+ * and a hit only takes the shared lock of one shard. Instead of moving entries in a LRU list
+ * a hit marks the entry with the current value of a clock that ticks on each insert,
+ * and eviction (which is rare) sorts entries by the marks. Bytes of not pinned entries are counted,
+ * so if pinned entries alone exceed the budget, inserts don't scan the store for nothing.
+ *
+ * @remark the class is thread safe
+ */
+class AssignmentCache
+{
+public:
+    explicit AssignmentCache(size_t maxBytes = CCDB_CACHE_DEFAULT_MAX_BYTES, size_t maxIndexEntries = CCDB_CACHE_DEFAULT_MAX_INDEX_ENTRIES);
+    virtual ~AssignmentCache();
+
+    /** @brief Makes normalized request key for the index
+     *
+     * @param [in] path       - absolute path of the type table
+     * @param [in] run        - run number
+     * @param [in] variation  - variation name
+     * @param [in] time       - time or 0 if no time is given
+     * @return key for GetAssignmentId and PutAssignmentId
+     */
+    static std::string MakeRequestKey(const std::string& path, int run, const std::string& variation, time_t time);
+
+    /** @brief Resolves request to assignment id using the index
+     *
+     * @param [in]  requestKey - @see MakeRequestKey
+     * @param [out] id         - assignment id
+     * @return true if the request is in the index
+     */
+    bool GetAssignmentId(const std::string& requestKey, dbkey_t& id);
+
+    /** @brief Adds request => assignment id pair to the index */
+    void PutAssignmentId(const std::string& requestKey, dbkey_t id);
+
+    /** @brief Gets cached assignment by its database id
+     *
+     * @param [in] id           - assignment id
+     * @param [in] needColumns  - if true, entries that were loaded without columns are not returned
+     * @return assignment or empty pointer if there is no such (suitable) entry
+     */
+    std::shared_ptr<Assignment> Get(dbkey_t id, bool needColumns=false);
+
+    /** @brief Adds assignment to cache. The cache takes ownership of the assignment
+     *
+     * Assignment is stored by its database id (Assignment::GetId()).
+     *
+     * @param [in] path         - absolute path of the type table. It is used for pinning
+     * @param [in] assignment   - assignment to add. NULL is ignored
+     * @param [in] hasColumns   - true if assignment type table has loaded columns
+     * @return shared pointer to the added assignment
+     */
+    std::shared_ptr<Assignment> Put(const std::string& path, Assignment* assignment, bool hasColumns);
+
+    /** @brief Gets cells of cached assignment converted to numbers
+     *
+     * Typed values live in the entry of the assignment, so they are evicted together with it.
+     * Cells are in blob order (row by row)
+     *
+     * @param [in]  id     - assignment id
+     * @param [out] values - converted cells
+     * @return true if the assignment is cached and its cells were converted to this type
+     */
+    bool GetValues(dbkey_t id, std::shared_ptr<const std::vector<double> >& values);
+    bool GetValues(dbkey_t id, std::shared_ptr<const std::vector<int> >& values);
+
+    /** @brief Adds converted cells to the entry of cached assignment
+     *
+     * The size of values is added to the entry size. Ignored if the assignment is not cached
+     *
+     * @param [in] id     - assignment id
+     * @param [in] values - converted cells
+     */
+    void PutValues(dbkey_t id, const std::shared_ptr<const std::vector<double> >& values);
+    void PutValues(dbkey_t id, const std::shared_ptr<const std::vector<int> >& values);
+
+    /** @brief Gets view of cached assignment values
+     *
+     * @param [in]  id   - assignment id
+     * @param [out] view - the view
+     * @return true if the assignment is cached and its view was made
+     */
+    bool GetView(dbkey_t id, ConstantsView& view);
+
+    /** @brief Adds view to the entry of cached assignment. @see PutValues */
+    void PutView(dbkey_t id, const ConstantsView& view);
+
+    /** @brief Runs one load for all threads that miss the same request at the same time
+     *
+     * The first thread that misses the key runs the loader. Other threads that come
+     * with the same key while it runs wait on a shared future and get the same result
+     * (or the same exception). Loads of different keys don't wait for each other.
+     * So at a run change each request is queried once whatever the number of threads.
+     *
+     * The loader runs in the calling thread, it should put the result to cache,
+     * so threads that come after the load find it in cache.
+     *
+     * @param [in] loadKey - key of the load. Usually @see MakeRequestKey
+     * @param [in] loader  - loads the assignment
+     * @return the assignment that the loader returned
+     */
+    std::shared_ptr<Assignment> Load(const std::string& loadKey, const std::function<std::shared_ptr<Assignment>()>& loader);
+
+    /** @brief Number of loads that waited for the result of another thread instead of running the loader */
+    size_t GetCoalescedLoadsCount();
+
+    /** @brief Pins the type table path. Entries of pinned path are never evicted */
+    void Pin(const std::string& path);
+
+    /** @brief Removes path from pinned paths */
+    void Unpin(const std::string& path);
+
+    /** @brief true if path is pinned */
+    bool IsPinned(const std::string& path);
+
+    /** @brief Sets memory budget in bytes. Evicts entries if needed */
+    void SetMaxBytes(size_t maxBytes);
+
+    /** @brief Memory budget in bytes */
+    size_t GetMaxBytes();
+
+    /** @brief Estimated size of all cached assignments in bytes */
+    size_t GetUsedBytes();
+
+    /** @brief Number of cached assignments */
+    size_t GetCount();
+
+    /** @brief Sets maximum number of requests in the index */
+    void SetMaxIndexEntries(size_t maxEntries);
+
+    /** @brief Number of requests in the index */
+    size_t GetIndexCount();
+
+    /** @brief Removes all entries. Pinned paths are kept */
+    void Clear();
+
+    /** @brief Estimated memory that the assignment takes in cache */
+    static size_t EstimateSize(Assignment* assignment);
+
+private:
+
+    static const size_t cShardsCount = 16;   /// Number of independently locked parts of the store and of the index
+
+    struct Entry
+    {
+        std::string Path;
+        std::shared_ptr<Assignment> Data;
+        size_t Size;
+        bool HasColumns;
+        bool IsPinned;                                         /// path of the entry is pinned
+        std::shared_ptr<const std::vector<double> > Doubles;   /// cells converted to doubles or empty
+        std::shared_ptr<const std::vector<int> > Ints;         /// cells converted to ints or empty
+        ConstantsView View;                                    /// view of values or empty
+        std::atomic<uint64_t> LastUsed;                        /// clock value of the last use
+    };
+
+    struct Request
+    {
+        dbkey_t Id;
+        std::atomic<uint64_t> LastUsed;                        /// clock value of the last use
+    };
+
+    struct Shard
+    {
+        ReadWriteLock Lock;
+        std::unordered_map<dbkey_t, Entry> Entries;            /// assignment id => entry
+    };
+
+    struct IndexShard
+    {
+        ReadWriteLock Lock;
+        std::unordered_map<std::string, Request> Requests;     /// request key => assignment id
+    };
+
+    Shard& GetShard(dbkey_t id) { return mShards[(size_t)id % cShardsCount]; }
+    IndexShard& GetIndexShard(const std::string& requestKey) { return mIndexShards[std::hash<std::string>()(requestKey) % cShardsCount]; }
+
+    void Touch(std::atomic<uint64_t>& lastUsed);  /// Marks entry as used now. Doesn't write if it is already marked
+    void Evict();                                 /// Evicts LRU entries until cache fits the budget. mMutex must be locked
+    void EvictIndex();                            /// Evicts LRU requests from index. mMutex must be locked
+    void SetPinned(const std::string& path, bool isPinned);  /// Marks entries of the path. mMutex must be locked
+    void AddBytes(Entry& entry, size_t size);     /// Counts memory of the entry. Its shard must be write locked
+    void RemoveBytes(Entry& entry, size_t size);  /// Uncounts memory of the entry. Its shard must be write locked
+
+    template<typename T>
+    bool GetTypedValues(dbkey_t id, std::shared_ptr<const std::vector<T> > Entry::*member, std::shared_ptr<const std::vector<T> >& values);
+
+    template<typename T>
+    void PutTypedValues(dbkey_t id, std::shared_ptr<const std::vector<T> > Entry::*member, const std::shared_ptr<const std::vector<T> >& values);
+
+    Shard mShards[cShardsCount];                                      /// assignments by id
+    IndexShard mIndexShards[cShardsCount];                            /// requests by key
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<Assignment> > > mLoads; /// load key => result of the running load
+    std::mutex mLoadsMutex;                                           /// guards mLoads
+    std::atomic<size_t> mCoalescedLoadsCount;                         /// @see GetCoalescedLoadsCount
+    std::set<std::string> mPinnedPaths;                               /// paths that are never evicted
+    std::atomic<uint64_t> mClock;                                     /// ticks on each insert
+    std::atomic<size_t> mMaxBytes;                                    /// memory budget
+    std::atomic<size_t> mUsedBytes;                                   /// memory used by entries
+    std::atomic<size_t> mUnpinnedBytes;                               /// memory used by entries that may be evicted
+    std::atomic<size_t> mMaxIndexEntries;                             /// maximum requests in the index
+    std::atomic<size_t> mIndexCount;                                  /// requests in the index
+    std::mutex mMutex;                                                /// guards pinned paths, serializes inserts of entries and eviction
+
+    AssignmentCache(const AssignmentCache& rhs);
+    AssignmentCache& operator=(const AssignmentCache& rhs);
+};
+
+}
+
+#endif //CCDB_ASSIGNMENT_CACHE_H
@@ -0,0 +1,172 @@
+#ifndef CCDB_CALIB_REQUEST_H
+#define CCDB_CALIB_REQUEST_H
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <stdexcept>
+
+namespace ccdb
+{
+
+/** @brief Is thrown by @see CalibRequest::Get if the request was cancelled before it started */
+class CalibRequestCancelled: public std::runtime_error
+{
+public:
+    explicit CalibRequestCancelled(const std::string& message): std::runtime_error(message) {}
+};
+
+
+/** @brief Is thrown by @see CalibRequest::Get if the request was not done in its time */
+class CalibRequestTimeout: public CalibRequestCancelled
+{
+public:
+    explicit CalibRequestTimeout(const std::string& message): CalibRequestCancelled(message) {}
+};
+
+
+/** @brief State of @see CalibRequest. It is shared by the request handle and the worker that reads the constants */
+template<typename T>
+class CalibRequestState
+{
+public:
+    enum Statuses
+    {
+        Queued,
+        Running,
+        Done,
+        Cancelled
+    };
+
+    CalibRequestState(const std::string& namepath, std::chrono::milliseconds timeout)
+        :Namepath(namepath),
+        HasDeadline(timeout.count() > 0),
+        Deadline(std::chrono::steady_clock::now() + timeout),
+        mStatus(Queued)
+    {
+    }
+
+    /** @brief Marks the request running. False if it was cancelled or its time is out, then it shouldn't run */
+    bool Start()
+    {
+        if(HasDeadline && std::chrono::steady_clock::now() >= Deadline)
+        {
+            Cancel(true);
+            return false;
+        }
+        int status = Queued;
+        return mStatus.compare_exchange_strong(status, Running);
+    }
+
+    /** @brief Cancels the request if it hasn't started. True if it is cancelled */
+    bool Cancel(bool isTimeout = false)
+    {
+        int status = Queued;
+        if(!mStatus.compare_exchange_strong(status, Cancelled)) return false;
+
+        if(isTimeout) Promise.set_exception(std::make_exception_ptr(CalibRequestTimeout("Request '" + Namepath + "' timed out in queue")));
+        else Promise.set_exception(std::make_exception_ptr(CalibRequestCancelled("Request '" + Namepath + "' was cancelled")));
+        return true;
+    }
+
+    /** @brief Sets result of GetCalib */
+    void Finish(bool isFound)
+    {
+        mStatus = Done;
+        Promise.set_value(isFound);
+    }
+
+    /** @brief Sets exception of GetCalib */
+    void Fail(std::exception_ptr error)
+    {
+        mStatus = Done;
+        Promise.set_exception(error);
+    }
+
+    Statuses GetStatus() const { return (Statuses)mStatus.load(); }
+
+    const std::string Namepath;
+    const bool HasDeadline;
+    const std::chrono::steady_clock::time_point Deadline;
+    T Values;                       ///Result. It is written by the worker before the promise is set
+    std::promise<bool> Promise;     ///true if constants were found
+
+private:
+    std::atomic<int> mStatus;
+};
+
+
+/** @brief Handle of the constants that are being read by @see Calibration::GetCalibAsync
+ *
+ * The request goes to the worker pool of the Calibration. It may be cancelled while it waits there,
+ * a request that has started runs to its end. A request with timeout that didn't start in its time
+ * is cancelled, and Get stops waiting at the deadline even if the request has started.
+ *
+ * @code
+ *      auto request = calib->GetCalibAsync<vector<vector<double> > >("/path/to/data");
+ *      ... other work
+ *      vector<vector<double> > values;
+ *      if(request.Get(values)) ...
+ * @endcode
+ */
+template<typename T>
+class CalibRequest
+{
+public:
+    explicit CalibRequest(const std::shared_ptr<CalibRequestState<T> >& state)
+        :mState(state),
+        mFuture(state->Promise.get_future())
+    {
+    }
+
+    /** @brief Waits for the constants
+     *
+     * @parameter [out] values
+     * @return true if constants were found and filled. false if namepath was not found.
+     * @throw CalibRequestCancelled if the request was cancelled, CalibRequestTimeout if its time is out,
+     *        the exception of GetCalib if reading failed
+     */
+    bool Get(T& values)
+    {
+        if(mState->HasDeadline && mFuture.wait_until(mState->Deadline) != std::future_status::ready)
+        {
+            mState->Cancel(true);
+            if(mFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                throw CalibRequestTimeout("Request '" + mState->Namepath + "' timed out");
+            }
+        }
+
+        bool isFound = mFuture.get();
+        values = std::move(mState->Values);
+        return isFound;
+    }
+
+    /** @brief Waits for the request up to timeout. True if it is done (or cancelled) */
+    bool WaitFor(std::chrono::milliseconds timeout) const
+    {
+        return mFuture.wait_for(timeout) == std::future_status::ready;
+    }
+
+    /** @brief True if the request is done or cancelled, so Get doesn't wait */
+    bool IsReady() const { return WaitFor(std::chrono::milliseconds(0)); }
+
+    /** @brief Cancels the request if it hasn't started yet
+     *
+     * @return true if the request is cancelled. false if it is running or done
+     */
+    bool Cancel() { return mState->Cancel(); }
+
+    /** @brief Namepath of the request */
+    const std::string& GetNamepath() const { return mState->Namepath; }
+
+private:
+    std::shared_ptr<CalibRequestState<T> > mState;
+    std::future<bool> mFuture;
+};
+
+}
+
+#endif // CCDB_CALIB_REQUEST_H
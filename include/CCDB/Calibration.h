@@ -3,13 +3,20 @@
 
 #include <string>
 #include <map>
+#include <list>
 #include <vector>
 #include <time.h>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <chrono>
 
 #include "CCDB/Globals.h"
 #include "CCDB/Providers/DataProvider.h"
+#include "CCDB/AssignmentCache.h"
+#include "CCDB/ConstantsView.h"
+#include "CCDB/CalibRequest.h"
+#include "CCDB/CalibrationWorkerPool.h"
 #include "CCDB/PthreadMutex.h"
 #include "CCDB/PthreadSyncObject.h"
 
@@ -182,6 +189,97 @@ public:
     virtual bool GetCalib(double &value, const string & namepath);
     virtual bool GetCalib(int &value, const string & namepath);
 
+    /** @brief Get constants by namepath as read only view of cached data
+     *
+     * The view references values that are converted to doubles once and are shared with the cache,
+     * so getting the view does not copy the table and reading the view does not allocate.
+     * The view keeps the data alive while it exists. @see ConstantsView
+     *
+     * @parameter [out] view
+     * @parameter [in]  namepath - data path
+     * @return true if constants were found and filled. false if namepath was not found. raises std::exception if any other error acured.
+     */
+    virtual bool GetCalib(ConstantsView &view, const string & namepath);
+
+    /** @brief Get constants of many namepaths as read only views. Cache misses are read at once
+     *
+     * Namepaths that are not in the cache are grouped by run, variation and time. Each group is read
+     * by one provider call (@see DataProvider::GetAssignmentsShortBatch), that is one query instead of one per namepath.
+     * The data is put to the cache, so GetCalib of any type for these namepaths are cache hits after the batch.
+     *
+     * @code
+     *      vector<ConstantsView> views;
+     *      calib->GetCalibBatch(views, namepaths);    //one round trip for all tables
+     *      calib->GetCalib(gains, "/path/to/gains");  //cache hit
+     * @endcode
+     *
+     * @parameter [out] views - views in the order of namepaths. Empty view (@see ConstantsView::IsEmpty) if namepath was not found
+     * @parameter [in]  namepaths - data paths
+     * @return true if all namepaths were found. raises std::exception if any other error acured.
+     */
+    virtual bool GetCalibBatch(vector<ConstantsView> &views, const vector<string> & namepaths);
+
+    /** @brief Starts reading of constants by namepath and returns at once
+     *
+     * The request is run by the worker pool of this Calibration (@see SetAsyncWorkersCount)
+     * with the same GetCalib overload as for T, so it uses the same cache and connection.
+     * Many requests may be in flight at once. A request may be cancelled while it waits for a worker
+     * (@see CalibRequest::Cancel). With timeout the request is cancelled if it doesn't start
+     * in time and CalibRequest::Get waits no longer than the timeout.
+     *
+     * @code
+     *      auto gains = calib->GetCalibAsync<vector<vector<double> > >("/path/to/gains");
+     *      auto view = calib->GetCalibAsync<ConstantsView>("/path/to/table", std::chrono::milliseconds(500));
+     *      ... other work
+     *      vector<vector<double> > values;
+     *      if(gains.Get(values)) ...
+     * @endcode
+     *
+     * @parameter [in] namepath - data path. Short /path/to/data .Full format is /path/to/data:run:variation:time
+     * @parameter [in] timeout - time for the request. 0 - no timeout
+     * @return handle of the request
+     */
+    template<typename T>
+    CalibRequest<T> GetCalibAsync(const string& namepath, std::chrono::milliseconds timeout = std::chrono::milliseconds(0))
+    {
+        std::shared_ptr<CalibRequestState<T> > state = std::make_shared<CalibRequestState<T> >(namepath, timeout);
+        CalibRequest<T> request(state);
+        GetAsyncWorkers()->Submit([this, state](bool isRun)
+        {
+            if(!isRun)
+            {
+                state->Cancel();
+                return;
+            }
+            if(!state->Start()) return;
+
+            try
+            {
+                bool isFound = GetCalib(state->Values, state->Namepath);
+                state->Finish(isFound);
+            }
+            catch(...)
+            {
+                state->Fail(std::current_exception());
+            }
+        });
+        return request;
+    }
+
+    /** @brief Sets number of threads that run @see GetCalibAsync requests. 4 by default
+     *
+     * The threads are started by the first request, so the number is set before it
+     * or after @see StopAsyncWorkers
+     */
+    void SetAsyncWorkersCount(size_t count);
+    size_t GetAsyncWorkersCount();
+
+    /** @brief Cancels queued @see GetCalibAsync requests, waits for running ones and stops the threads
+     *
+     * Is called by destructors. The next request starts the threads again
+     */
+    void StopAsyncWorkers();
+
     /** @brief gets connection string which is used for current provider
     *@return mConnectionString
     */
@@ -254,11 +352,35 @@ public:
 	*
 	* @remark the function is thread safe
 	*
+	* @warning if cache is enabled, the assignment is owned by this Calibration and user should not delete it.
+	*          The Calibration keeps alive the last CCDB_CACHE_MAX_ISSUED_ASSIGNMENTS assignments that it gave,
+	*          even if the cache evicts them. Use @see GetAssignmentShared to keep the data longer.
+	*          If cache is disabled, user owns the assignment
+	*
 	* @parameter [in] namepath -  full namepath is /path/to/data:run:variation:time but usually it is only /path/to/data
 	* @return   DAssignment *
 	*/
 	virtual Assignment* GetAssignment(const string& namepath, bool loadColumns = true);
 
+	/** @brief Gets the assignment from provider or from the connection cache using namepath
+	* namepath is the common ccdb request; @see GetCalib
+	*
+	* @remark the function is thread safe
+	*
+	* @parameter [in] namepath -  full namepath is /path/to/data:run:variation:time but usually it is only /path/to/data
+	* @return   assignment or empty pointer if no assignment found
+	*/
+	virtual std::shared_ptr<Assignment> GetAssignmentShared(const string& namepath, bool loadColumns = true);
+
+	/** @brief Gets assignments of many namepaths from the connection cache or from provider. @see GetCalibBatch
+	*
+	* @remark the function is thread safe
+	*
+	* @parameter [out] assignments - assignments in the order of namepaths, empty pointer if no assignment found
+	* @parameter [in] namepaths - full namepath is /path/to/data:run:variation:time but usually it is only /path/to/data
+	*/
+	virtual void GetAssignmentsSharedBatch(vector<std::shared_ptr<Assignment> >& assignments, const vector<string>& namepaths, bool loadColumns = true);
+
     /** @brief if true the data will be cached
      *
      * @param value true - enable cache, false - disable
@@ -271,6 +393,28 @@ public:
     /** @brief if true the caching is using */
     bool IsCacheEnabled();
 
+    /** @brief Sets memory budget (in bytes) of the assignments cache
+     *
+     * The cache belongs to connection (@see DataProvider::GetAssignmentCache)
+     * so the budget is shared by all Calibrations that use the same connection.
+     * Least recently used data is evicted when cache grows over the budget
+     *
+     * @param maxBytes memory budget in bytes
+     */
+    void SetCacheMaxBytes(size_t maxBytes);
+
+    /** @brief Cached data of the namepath is never evicted from cache
+     *
+     * Pinning is done by type table path, run, variation and time in namepath are ignored.
+     * It is for hot tables that are requested for every event
+     *
+     * @param namepath   /path/to/data
+     */
+    void PinNamepath(const string& namepath);
+
+    /** @brief Allows eviction of the namepath that was pinned by @see PinNamepath */
+    void UnpinNamepath(const string& namepath);
+
 protected:
 
 
@@ -303,15 +447,45 @@ protected:
     int mDefaultRun;                 /// Default run number
     string mDefaultVariation;        /// Default variation
     time_t mDefaultTime;             /// Set default time
-    time_t mLastActivityTime;        /// Time of the last request
+    std::atomic<time_t> mLastActivityTime; /// Time of the last request. Is updated by many threads
     bool mIsAutoReconnect;           /// Try to auto-reconnect if possible
     bool mIsCacheEnabled;            /// If true the data is cached
 
-    std::mutex mReadMutex;
 private:
     Calibration(const Calibration& rhs);
     Calibration& operator=(const Calibration& rhs);
     void CheckConnection(); /// Check if is connected and reconnect if needed (and allowed)
+    Assignment* ReadAssignment(const string& namepath, bool loadColumns, string& path); /// Reads assignment from provider skipping cache
+    void MakeView(const std::shared_ptr<Assignment>& assignment, const string& namepath, ConstantsView& view); /// View of the assignment, it is kept in cache
+
+    /** @brief Lock of @see LockQuery
+     *
+     * When it goes out of scope the connection borrowed by the query is given back
+     * (@see DataProvider::ReleaseConnection), then the query mutex is unlocked
+     */
+    class QueryLock
+    {
+    public:
+        QueryLock(DataProvider *provider, std::unique_lock<std::mutex>&& lock): mProvider(provider), mLock(std::move(lock)) {}
+        QueryLock(QueryLock&& other): mProvider(other.mProvider), mLock(std::move(other.mLock)) { other.mProvider = NULL; }
+        ~QueryLock() { if(mProvider) mProvider->ReleaseConnection(); }
+    private:
+        DataProvider *mProvider;
+        std::unique_lock<std::mutex> mLock;
+    };
+
+    QueryLock LockQuery(bool isConstantsRead = true);  /// Locks the connection for a read if the provider is not reentrant or it is not a read of constants
+    CalibrationWorkerPool* GetAsyncWorkers();   /// Worker pool of GetCalibAsync. It is started on the first call
+
+    typedef std::list<std::shared_ptr<Assignment> > IssuedAssignmentList;
+    std::mutex mIssuedAssignmentsMutex;                                 /// Guards mIssuedAssignments and mIssuedAssignmentsIndex
+    IssuedAssignmentList mIssuedAssignments;                            /// Cached assignments that GetAssignment returned as raw pointers. The last given first
+    std::map<Assignment*, IssuedAssignmentList::iterator> mIssuedAssignmentsIndex; /// Assignment => its place in mIssuedAssignments
+
+    std::mutex mAsyncWorkersMutex;                          /// Guards mAsyncWorkers
+    std::unique_ptr<CalibrationWorkerPool> mAsyncWorkers;   /// Threads of GetCalibAsync
+    size_t mAsyncWorkersCount;                              /// Number of threads for the next start of mAsyncWorkers
+    void ResolveRequest(const string& namepath, string& path, int& run, string& variation, time_t& time); /// Parses namepath applying defaults
 };
 
 }
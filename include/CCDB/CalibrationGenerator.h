@@ -100,7 +100,7 @@ public:
 private:	
 
     //@parameter [in] connectionString - Connection string to the data source
-    static Calibration* CreateCalibration(bool isMySQL, int run, const std::string& variation, const time_t time);
+    static Calibration* CreateCalibrationOfType(const std::string & connectionString, int run, const std::string& variation, const time_t time);
 
     CalibrationGenerator(const CalibrationGenerator& rhs);
     CalibrationGenerator& operator=(const CalibrationGenerator& rhs);
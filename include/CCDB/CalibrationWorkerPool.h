@@ -0,0 +1,58 @@
+#ifndef CCDB_CALIBRATION_WORKER_POOL_H
+#define CCDB_CALIBRATION_WORKER_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace ccdb
+{
+
+/** @brief Fixed number of threads that run tasks of a Calibration in the order they come
+ *
+ * It runs @see Calibration::GetCalibAsync requests. Tasks are called with true to run them.
+ * Tasks that are still queued when the pool stops are called with false, so they can cancel
+ * their requests and no one waits for them forever
+ */
+class CalibrationWorkerPool
+{
+public:
+    typedef std::function<void(bool isRun)> Task;
+
+    /** @brief Starts the threads
+     *
+     * @parameter [in] threadsCount - number of threads, at least 1
+     */
+    explicit CalibrationWorkerPool(size_t threadsCount);
+
+    /** @brief Stops the pool. @see Stop */
+    ~CalibrationWorkerPool();
+
+    /** @brief Puts the task to the queue. If the pool is stopped the task is called with false at once */
+    void Submit(const Task& task);
+
+    /** @brief Cancels queued tasks and waits for running ones */
+    void Stop();
+
+    size_t GetThreadsCount() const { return mThreads.size(); }
+    size_t GetQueuedCount();    ///Tasks that wait for a thread
+
+private:
+    CalibrationWorkerPool(const CalibrationWorkerPool& rhs);
+    CalibrationWorkerPool& operator=(const CalibrationWorkerPool& rhs);
+
+    void Run();     ///Loop of a thread
+
+    std::mutex mMutex;
+    std::condition_variable mHasTask;
+    std::deque<Task> mTasks;
+    std::vector<std::thread> mThreads;
+    bool mIsStopped;
+};
+
+}
+
+#endif // CCDB_CALIBRATION_WORKER_POOL_H
@@ -0,0 +1,121 @@
+#ifndef CCDB_CONSTANTS_VIEW_H
+#define CCDB_CONSTANTS_VIEW_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+
+#include "CCDB/Model/Assignment.h"
+#include "CCDB/Model/ConstantsTypeColumn.h"
+
+namespace ccdb
+{
+
+/** @brief Non owning view of contiguous doubles (like C++20 span<const double>)
+ *
+ * The view is valid while the ConstantsView it was taken from (or any its copy) is alive
+ */
+struct DoubleSpan
+{
+    const double *Data;
+    size_t Size;
+
+    const double& operator[](size_t index) const { return Data[index]; }
+    const double* begin() const { return Data; }
+    const double* end() const { return Data + Size; }
+    size_t size() const { return Size; }
+};
+
+
+/** @brief Read only table of constants that references cached data
+ *
+ * ConstantsView is a cheap handle: copying it copies a reference counted pointer,
+ * no values are copied. The data is immutable and is shared by all copies of the view
+ * and by the assignments cache, so views can be read from many threads.
+ * The data stays alive while there is a view that references it, even if
+ * the assignment was evicted from cache.
+ *
+ * Values are stored as doubles in two contiguous buffers:
+ * row-major (row by row, like the data blob) and column-major (one column after another).
+ * So a row and a column are both available as DoubleSpan without copying
+ *
+ * @code
+ *      ConstantsView view;
+ *      calib->GetCalib(view, "/path/to/data");
+ *      double x = view(0, "x");
+ *      DoubleSpan gains = view.GetColumn("gain");
+ * @endcode
+ */
+class ConstantsView
+{
+public:
+
+    /** @brief Empty view. @see IsEmpty */
+    ConstantsView();
+
+    /** @brief Builds view of assignment values
+     *
+     * @param [in] assignment - assignment with loaded type table columns
+     * @param [in] rowMajor   - cells of the assignment converted to doubles (row by row)
+     */
+    ConstantsView(const std::shared_ptr<Assignment>& assignment, const std::shared_ptr<const std::vector<double> >& rowMajor);
+
+    /** @brief true if the view has no data */
+    bool IsEmpty() const { return !mData; }
+
+    size_t GetRowsCount() const { return mData ? mData->RowsCount : 0; }        ///Number of rows
+    size_t GetColumnsCount() const { return mData ? mData->ColumnsCount : 0; }  ///Number of columns
+
+    /** @brief Value by row and column index. Indexes are not checked */
+    double operator()(size_t row, size_t column) const { return (*mData->RowMajor)[row * mData->ColumnsCount + column]; }
+
+    /** @brief Value by row and column name. Throws std::out_of_range if there is no such column */
+    double operator()(size_t row, const std::string& columnName) const { return operator()(row, GetColumnIndexChecked(columnName)); }
+
+    /** @brief Values of one row */
+    DoubleSpan GetRow(size_t row) const;
+
+    /** @brief Values of one column. Column is contiguous in memory */
+    DoubleSpan GetColumn(size_t column) const;
+
+    /** @brief Values of one column. Throws std::out_of_range if there is no such column */
+    DoubleSpan GetColumn(const std::string& columnName) const { return GetColumn(GetColumnIndexChecked(columnName)); }
+
+    /** @brief Index of the column or -1 if there is no such column */
+    int GetColumnIndex(const std::string& columnName) const;
+
+    const std::vector<std::string>& GetColumnNames() const;                      ///Names of columns
+    ConstantsTypeColumn::ColumnTypes GetColumnType(size_t column) const;         ///Type of column as it is declared in the type table (cDoubleColumn if out of range)
+
+    const double* GetRowMajorData() const { return mData ? mData->RowMajor->data() : NULL; }      ///All values row by row
+    const double* GetColumnMajorData() const { return mData ? mData->ColumnMajor.data() : NULL; } ///All values column by column
+
+    /** @brief Assignment the values were taken from */
+    std::shared_ptr<Assignment> GetAssignment() const { return mData ? mData->Source : std::shared_ptr<Assignment>(); }
+
+    /** @brief Memory in bytes that the view adds to row-major values and the assignment */
+    size_t GetStorageSize() const;
+
+private:
+
+    struct Data
+    {
+        size_t RowsCount;
+        size_t ColumnsCount;
+        std::shared_ptr<const std::vector<double> > RowMajor;       /// shared with the assignments cache
+        std::vector<double> ColumnMajor;
+        std::vector<std::string> ColumnNames;
+        std::vector<ConstantsTypeColumn::ColumnTypes> ColumnTypes;
+        std::unordered_map<std::string, size_t> ColumnIndexes;      /// column name => column index
+        std::shared_ptr<Assignment> Source;
+    };
+
+    size_t GetColumnIndexChecked(const std::string& columnName) const;
+
+    std::shared_ptr<const Data> mData;
+};
+
+}
+
+#endif //CCDB_CONSTANTS_VIEW_H
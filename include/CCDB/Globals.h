@@ -19,6 +19,26 @@ typedef int dbkey_t;
 //name of run range that holds all pssible ranges [0,INFINITE_RUN]
 #define CCDB_ALL_RUNRANGE_NAME "all"
 
+//schema version since which assignments keep constantTypeId of their constant set
+//and have (constantTypeId, variationId, runRangeId, id) index. See sql/update_1.00_1.01.*.sql
+#define CCDB_SCHEMA_ASSIGNMENT_TYPE_IDS 5
+
+//default memory budget (in bytes) of per connection assignments cache. May be changed in runtime
+//by AssignmentCache::SetMaxBytes or at compile time by defining it with -DCCDB_CACHE_DEFAULT_MAX_BYTES=...
+#ifndef CCDB_CACHE_DEFAULT_MAX_BYTES
+#define CCDB_CACHE_DEFAULT_MAX_BYTES (128*1024*1024)
+#endif
+
+//default maximum number of requests in the index of assignments cache (request => assignment id)
+#ifndef CCDB_CACHE_DEFAULT_MAX_INDEX_ENTRIES
+#define CCDB_CACHE_DEFAULT_MAX_INDEX_ENTRIES 100000
+#endif
+
+//number of the last cached assignments that Calibration::GetAssignment keeps alive for its raw pointers
+#ifndef CCDB_CACHE_MAX_ISSUED_ASSIGNMENTS
+#define CCDB_CACHE_MAX_ISSUED_ASSIGNMENTS 256
+#endif
+
 /*----------------------------------------------------------------------------------------------------
  *  E R R O R   C O D E S 
  * -------------------------------------------------------------------------------------------------*/
@@ -82,6 +102,12 @@ typedef int dbkey_t;
 //My sql result was not cleaned after last query
 #define CCDB_WARNING_RESULT_NOT_CLEANED 5020
 
+//Data cell is not a number
+#define CCDB_WARNING_PARSE_VALUE 5030
+
+//Data blob is a binary vault of unknown version or is truncated. Such assignment has no cells
+#define CCDB_WARNING_VAULT_INVALID 5040
+
 //Object name format is invalid. Only English letters, numbers and '_' are allowed.
 #define CCDB_ERROR_INVALID_OBJECT_NAME 1110
 
@@ -140,6 +166,12 @@ typedef int dbkey_t;
 //ASSIGMEN is NULL or has improper ID so update operations cant be done
 #define CCDB_ERROR_DATA_INCONSISTANT 1280
 
+//Snapshot file has wrong format, version or checksum or can't be written
+#define CCDB_ERROR_SNAPSHOT_INVALID 1290
+
+//Compressed data blob is broken or is compressed by codec that is not registered (see VaultCodec)
+#define CCDB_ERROR_VAULT_DECOMPRESS 1300
+
 /*----------------------------------------------------------------------------------------------------
  *  SYSTEM DEFINE
  * -------------------------------------------------------------------------------------------------*/
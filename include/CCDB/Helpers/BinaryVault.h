@@ -0,0 +1,131 @@
+#ifndef _BinaryVault_
+#define _BinaryVault_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "CCDB/Model/ConstantsTypeColumn.h"
+#include "CCDB/Helpers/NumberParsers.h"
+#include "CCDB/Helpers/VaultCodec.h"
+
+namespace ccdb
+{
+
+/** @brief Binary encoding of constantSets.vault
+ *
+ * Text vault is cells separated by '|'. Binary vault keeps numbers as they are in memory,
+ * so a double takes 8 bytes and is read without parsing. All numbers are little endian:
+ *
+ *   magic    4 bytes   0x1B 'C' 'V' 'B'  (text vault never starts with 0x1B)
+ *   version  1 byte    1
+ *   flags    1 byte    0 or FlagCompressed
+ *   rows     uint32
+ *   columns  uint32
+ *   types    1 byte per column, ConstantsTypeColumn::ColumnTypes value the column is stored as
+ *   then arrays of columns one after another (rows values each):
+ *     int - int32, uint - uint32, long - int64, ulong - uint64, double - IEEE 754 float64,
+ *     bool - uint8, string - uint32 length and characters for each row
+ *
+ * A column is stored as its declared type only if all its cells are values of the type.
+ * Otherwise (old data with not numbers in numeric column) it is stored as string column,
+ * so the text of cells is kept as is. Numbers are written back to text in canonical form
+ * (i.e. double "1.50" is read as "1.5")
+ *
+ * Any vault (text or binary) may be compressed. Compressed vault has FlagCompressed and a different header:
+ *
+ *   magic, version, flags   as above
+ *   codec    1 byte    VaultCodec id
+ *   size     uint32    size of the vault before compression
+ *   then the vault compressed by the codec
+ *
+ * Providers decompress vaults when they are read, so Assignment gets not compressed data
+ */
+class BinaryVault
+{
+public:
+    static const unsigned char Version = 1;
+    static const size_t MagicSize = 4;
+    static const size_t HeaderSize = 14;        ///Header without column types
+    static const size_t CompressedHeaderSize = 11;
+    static const unsigned char FlagCompressed = 1;
+
+    /** @brief Positions of decoded blob parts. @see Decode */
+    struct Layout
+    {
+        struct StringCell
+        {
+            size_t Offset;
+            size_t Length;
+        };
+
+        size_t RowsCount;
+        std::vector<ConstantsTypeColumn::ColumnTypes> Types;    ///Types the columns are stored as
+        std::vector<size_t> ColumnOffsets;                      ///Offsets of column arrays in the blob
+        std::vector<std::vector<StringCell> > Strings;          ///Cells of string columns by row. Empty for other columns
+
+        size_t GetColumnsCount() const { return Types.size(); }
+        size_t GetCellsCount() const { return RowsCount * Types.size(); }
+        size_t GetStorageSize() const;                          ///Memory in bytes that the layout takes
+    };
+
+    /** @brief true if the blob starts with the binary vault magic */
+    static bool IsBinary(const char *data, size_t size);
+    static bool IsBinary(const std::string &blob) { return IsBinary(blob.data(), blob.size()); }
+
+    /** @brief true if the blob is a compressed vault */
+    static bool IsCompressed(const char *data, size_t size);
+    static bool IsCompressed(const std::string &blob) { return IsCompressed(blob.data(), blob.size()); }
+
+    /** @brief Compresses text or binary vault
+     *
+     * @param [in]  blob       - vault to compress
+     * @param [in]  codec      - codec to compress by, it must be registered to be decompressed (@see VaultCodec::Register)
+     * @param [out] compressed - compressed vault
+     * @return false if the blob is already compressed, is too big or the codec fails
+     */
+    static bool Compress(const std::string &blob, const VaultCodec &codec, std::string &compressed);
+
+    /** @brief Decompresses compressed vault
+     *
+     * @param [in]  data, size - compressed vault
+     * @param [out] blob       - vault as it was before compression
+     * @return false if the vault is not compressed, codec is unknown or data is broken
+     */
+    static bool Decompress(const char *data, size_t size, std::string &blob);
+
+    /** @brief Encodes cells to binary vault
+     *
+     * @param [in]  cells - cells row by row, as in text vault
+     * @param [in]  types - declared types of columns
+     * @param [out] blob  - binary vault
+     * @return false if number of cells is not a multiple of number of columns
+     */
+    static bool Encode(const std::vector<std::string> &cells, const std::vector<ConstantsTypeColumn::ColumnTypes> &types, std::string &blob);
+
+    /** @brief Checks the blob and finds its columns
+     *
+     * @return false if the blob is not a binary vault of known version or is truncated
+     */
+    static bool Decode(const char *data, size_t size, Layout &layout);
+
+    /** @brief Reads numeric cell
+     *
+     * @param [out] integer - value of integer and bool columns (ulong is cast)
+     * @param [out] real    - value of any numeric column as double
+     * @return false if the column is a string column
+     */
+    static bool ReadNumber(const char *data, const Layout &layout, size_t row, size_t column, long long &integer, double &real);
+
+    /** @brief Characters of cell of string column */
+    static CharSpan ReadString(const char *data, const Layout &layout, size_t row, size_t column);
+
+    /** @brief Appends text of any cell as it would be in text vault (not encoded) */
+    static void AppendCellText(const char *data, const Layout &layout, size_t row, size_t column, std::string &text);
+
+    /** @brief Shortest text that is parsed back to the same double */
+    static void AppendDouble(double value, std::string &text);
+};
+
+}
+#endif // _BinaryVault_
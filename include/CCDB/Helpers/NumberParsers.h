@@ -0,0 +1,68 @@
+#ifndef _NumberParsers_
+#define _NumberParsers_
+
+#include <stddef.h>
+#include <vector>
+
+namespace ccdb
+{
+
+/** @brief Non owning reference to characters of one cell (like C++17 string_view)
+ *
+ * The characters are not null terminated
+ */
+struct CharSpan
+{
+    const char *Data;
+    size_t Length;
+};
+
+
+/** @brief Locale independent numbers conversion with error detection
+ *
+ * The functions parse the whole cell. Leading and trailing blank characters are allowed,
+ * any other not number characters make the cell invalid (i.e. "12abc" is an error, not 12)
+ *
+ * Double parsing has a fast path for short fixed point decimals like "-12.345" or "30e-2"
+ * (up to 19 digits in mantissa and power of 10 in [-22, 22]) which gives correctly
+ * rounded result without strtod. Runs of 8 digits are converted at once (SWAR).
+ * Other numbers ("nan", "inf", long mantissas, big exponents) go through strtod
+ * with "C" locale.
+ *
+ * Bulk functions convert array of cells into contiguous array of values and report
+ * which cells failed. Failed cells get 0 in the output.
+ */
+class NumberParsers
+{
+public:
+
+    /** @brief Parses double
+     * @param [in]  data   - characters of the number
+     * @param [in]  length - number of characters
+     * @param [out] value  - parsed value or 0 if the string is not a number
+     * @return true if the whole string is a number
+     */
+    static bool ParseDouble(const char *data, size_t length, double &value);
+
+    /** @brief Parses int. @see ParseDouble. Values out of int range are errors */
+    static bool ParseInt(const char *data, size_t length, int &value);
+
+    /** @brief Parses long. @see ParseDouble. Values out of long range are errors */
+    static bool ParseLong(const char *data, size_t length, long &value);
+
+    /** @brief Parses cells into contiguous array of doubles
+     *
+     * @param [in]  cells       - cells to parse
+     * @param [in]  count       - number of cells
+     * @param [out] output      - array of at least count values
+     * @param [out] failedCells - optional, indexes of cells that are not numbers are added here
+     * @return number of cells that are not numbers
+     */
+    static size_t ParseDoubles(const CharSpan *cells, size_t count, double *output, std::vector<size_t> *failedCells = NULL);
+
+    /** @brief Parses cells into contiguous array of ints. @see ParseDoubles */
+    static size_t ParseInts(const CharSpan *cells, size_t count, int *output, std::vector<size_t> *failedCells = NULL);
+};
+
+}
+#endif // _NumberParsers_
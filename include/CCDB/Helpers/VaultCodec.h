@@ -0,0 +1,73 @@
+#ifndef _VaultCodec_
+#define _VaultCodec_
+
+#include <stddef.h>
+#include <string>
+
+namespace ccdb
+{
+
+/** @brief Compression of data blobs. @see BinaryVault::Compress
+ *
+ * Codec is found by the id that is written to the header of compressed vault.
+ * zlib codec (id 1) is registered by default, other codecs may be added by Register
+ */
+class VaultCodec
+{
+public:
+    virtual ~VaultCodec() {}
+
+    virtual unsigned char GetId() const = 0;        ///Id in the vault header. 0 is not used
+    virtual std::string GetName() const = 0;        ///Name of the codec like "zlib"
+
+    /** @brief Compresses data
+     *
+     * @param [in]  data, size - data to compress
+     * @param [out] output     - compressed data
+     * @return false on error
+     */
+    virtual bool Compress(const char *data, size_t size, std::string &output) const = 0;
+
+    /** @brief Decompresses data
+     *
+     * @param [in]  data, size   - compressed data
+     * @param [in]  originalSize - size of data before compression, from the vault header
+     * @param [out] output       - decompressed data
+     * @return false if data is broken or is not originalSize after decompression
+     */
+    virtual bool Decompress(const char *data, size_t size, size_t originalSize, std::string &output) const = 0;
+
+    /** @brief Adds codec to the codecs that vaults are decompressed by
+     *
+     * Codecs live till the end of the program, the registry takes ownership of the codec
+     * @return false if there is a codec with the same id (then the codec is deleted)
+     */
+    static bool Register(VaultCodec *codec);
+
+    /** @brief Registered codec by id or NULL */
+    static const VaultCodec *Find(unsigned char id);
+
+    /** @brief Registered codec by name or NULL */
+    static const VaultCodec *Find(const std::string &name);
+};
+
+
+/** @brief zlib deflate codec */
+class ZlibVaultCodec: public VaultCodec
+{
+public:
+    static const unsigned char Id = 1;
+
+    explicit ZlibVaultCodec(int level = 6): mLevel(level) {}
+
+    unsigned char GetId() const { return Id; }
+    std::string GetName() const { return "zlib"; }
+    bool Compress(const char *data, size_t size, std::string &output) const;
+    bool Decompress(const char *data, size_t size, size_t originalSize, std::string &output) const;
+
+private:
+    int mLevel;     //compression level 1-9
+};
+
+}
+#endif // _VaultCodec_
@@ -7,12 +7,16 @@
 
 #include <vector>
 #include <map>
+#include <mutex>
+#include <atomic>
 
 #include "CCDB/Model/StoredObject.h"
 #include "CCDB/Model/ObjectsOwner.h"
 #include "CCDB/Model/ConstantsTypeTable.h"
 #include "CCDB/Model/ConstantsTypeColumn.h"
 #include "CCDB/Helpers/StringUtils.h"
+#include "CCDB/Helpers/NumberParsers.h"
+#include "CCDB/Helpers/BinaryVault.h"
 
 using namespace std;
 
@@ -51,6 +55,14 @@ public:
 	 */
 	static string VectorToBlob(const vector<string>& values);
 
+	/** @brief makes a binary blob from tokens. @see BinaryVault
+	 *
+	 * @param [in] values - cells row by row
+	 * @param [in] types  - declared types of columns
+	 * @return binary blob or empty string if number of values is not a multiple of number of columns
+	 */
+	static string VectorToBinaryBlob(const vector<string>& values, const vector<ConstantsTypeColumn::ColumnTypes>& types);
+
 	/** @brief Encodes blob separator
 	 *
 	 * if str contains '|' it will be replaced by '&pipe;'
@@ -102,7 +114,32 @@ public:
     void	SetModifiedTime(time_t val) {mModifiedTime = val;} ///Time of last modification
 
 	string	GetRawData() const { return mRawData; }            ///Raw data blob
-	void	SetRawData(std::string val);					   ///Raw data blob
+	void	SetRawData(std::string val);					   ///Raw data blob, text blob is tokenized to cells at once, binary is decoded
+
+	bool	IsBinaryData() const { return mIsBinary; }         ///Data blob is a binary vault. @see BinaryVault
+
+	size_t	GetCellsCount() const { return mIsBinary ? mBinaryLayout.GetCellsCount() : mCells.size(); }    ///Number of cells in data blob
+	size_t	GetStorageSize() const;                            ///Memory in bytes that is used to store data blob and its cells
+
+	/** @brief Numbers of all cells of binary data blob row by row, read without parsing
+	 *
+	 * Cells of string columns are parsed as text cells are by GetCalib:
+	 * the cells that are not numbers get StringUtils::ParseDouble (ParseInt) value and are added to notNumberCells.
+	 * Double cells are truncated to int
+	 *
+	 * @param [out] values - values of cells
+	 * @param [out] notNumberCells - indexes of cells that are not numbers
+	 * @return false if the data blob is text, then nothing is filled
+	 */
+	bool GetBinaryValues(vector<double> &values, vector<size_t> &notNumberCells) const;
+	bool GetBinaryValues(vector<int> &values, vector<size_t> &notNumberCells) const;
+
+	/** @brief Views of all cells in blob order (row by row)
+	 *
+	 * Spans point to the assignment data and are valid while the assignment is alive and not changed.
+	 * It allows to convert cells to numbers without creating strings (@see NumberParsers)
+	 */
+	void GetCellSpans(vector<CharSpan> &spans) const;
 
 	
 	/** @brief GetMappedData returns rows vector of maps of column_name => data_value
@@ -171,8 +208,34 @@ public:
 	size_t GetColumnsCount() const { return mTypeTable->GetColumnsCount(); }
 private:
 
-	vector<map<string,string> > mRows;	// cache for blob data by rows
+	/** @brief Position of one cell in the cells buffer [Begin, End) */
+	struct CellSpan
+	{
+		size_t Begin;
+		size_t End;
+	};
+
+	/** @brief Characters of cells. Cells of blob without '&delimiter;' are taken from mRawData as is */
+	const string& GetCellsBuffer() const { return mDecodedData.empty() ? mRawData : mDecodedData; }
+
+	/** @brief Makes text cells of binary data blob on the first request of text
+	 *
+	 * Assignments are shared by threads through the cache, so it is done under mCellsMutex once
+	 */
+	void PrepareCells() const;
+
+	template<typename T> bool GetBinaryValuesT(vector<T> &values, vector<size_t> &notNumberCells) const;
+
+	string GetCell(size_t index) const;         ///Decoded cell by index in blob. Empty string if index is out of range
+	int GetColumnIndex(const string& columnName) const; ///Index of the column or -1 if no such column
+
 	string mRawData;					// data blob
+	mutable string mDecodedData;		// data blob with '&delimiter;' decoded or text of binary blob. Empty if the blob has no '&delimiter;'
+	mutable vector<CellSpan> mCells;	// cells of data blob in GetCellsBuffer()
+	bool mIsBinary;						// data blob is a binary vault
+	BinaryVault::Layout mBinaryLayout;	// columns of binary data blob
+	mutable std::atomic<bool> mHasCells;// mCells are filled. Binary blob cells are made by PrepareCells
+	mutable std::mutex mCellsMutex;		// guards PrepareCells
 	int mId;							// id in database
 	int mDataBlobId;					// blob id in database
 	unsigned int mVariationId;			// database ID of variation
@@ -190,8 +253,6 @@ private:
 	time_t mModifiedTime;				// time of last modification
 	string mComment;					// Comment of assignment
 
-	vector<string> mVectorData;         // Vectorized blob
-
 	Assignment(const Assignment& rhs);	
 	Assignment& operator=(const Assignment& rhs);
 };
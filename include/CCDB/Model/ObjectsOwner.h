@@ -2,6 +2,7 @@
 #define _DObjectsOwner_
 #include "CCDB/Model/StoredObject.h"
 #include <map>
+#include <mutex>
 using namespace std;
 
 namespace ccdb
@@ -36,6 +37,7 @@ public:
 private:
 	
 	std::map<unsigned long, StoredObject *> mOwnedObjects; //stored objects by id
+	std::mutex mOwnedObjectsMutex;	//objects may be given and released by query threads of the provider
 };
 
 }
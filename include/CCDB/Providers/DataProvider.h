@@ -4,6 +4,10 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
+#include <atomic>
 
 #include "CCDB/Providers/IAuthentication.h"
 #include "CCDB/Model/ObjectsOwner.h"
@@ -13,6 +17,8 @@
 #include "CCDB/Model/RunRange.h"
 #include "CCDB/Model/Variation.h"
 #include "CCDB/CCDBError.h"
+#include "CCDB/AssignmentCache.h"
+#include "CCDB/RunRangeIndex.h"
 
 
 
@@ -97,6 +103,12 @@ public:
      */
     virtual std::string GetConnectionString();
 
+    /** @brief Schema version of the connected database (schemaVersions table). 0 if it is unknown */
+    int GetSchemaVersion() const { return mSchemaVersion; }
+
+    /** @brief Assignments keep constantTypeId, so lookups don't join constantSets. @see CCDB_SCHEMA_ASSIGNMENT_TYPE_IDS */
+    bool HasAssignmentTypeIds() const { return mSchemaVersion >= CCDB_SCHEMA_ASSIGNMENT_TYPE_IDS; }
+
     //----------------------------------------------------------------------------------------
     //  D I R E C T O R Y   M A N G E M E N T
     //----------------------------------------------------------------------------------------
@@ -419,7 +431,50 @@ public:
      * @return DAssignment object or NULL if no assignment is found or error
      */
     virtual Assignment* GetAssignmentShort(int run, const string& path, time_t time, const string& variation="default", bool loadColumns=false)=0;
-       
+
+
+    /** @brief Resolves request to assignment id without reading data blob
+     *
+     * The same logic as in @see GetAssignmentShort is used (including fallback to parent variations)
+     * but only id of the assignment is selected. It is used by cache to find out
+     * that different requests (i.e. runs of the same run range) resolve to the same data
+     *
+     * @param [in] run - run number
+     * @param [in] path - object path
+     * @param [in] time - timestamp, data that is equal or earlier in time than that timestamp is returned. 0 - no time limit
+     * @param [in] variation - variation name
+     * @return assignment id or 0 if no assignment is found or error
+     */
+    virtual dbkey_t GetAssignmentIdShort(int run, const string& path, time_t time, const string& variation="default")=0;
+
+
+    /** @brief Get Assignment with data blob only by assignment id
+     *
+     * @see GetAssignmentIdShort
+     * @param [in] id - assignment id
+     * @param [in] path - object path
+     * @param [in] loadColumns - optional, do we need to load table columns information (for column names and types) or not
+     * @return DAssignment object or NULL if no assignment is found or error
+     */
+    virtual Assignment* GetAssignmentShortById(dbkey_t id, const string& path, bool loadColumns=false)=0;
+
+
+    /** @brief Get Assignments with data blob only for many type tables of the same run, variation and time
+     *
+     * The same logic as in @see GetAssignmentShort is used for each path. Providers with SQL
+     * resolve all paths by one query (per up to cMaxBatchQuerySize paths), so it is one round trip
+     * instead of one per path. By default GetAssignmentShort is called for each path
+     *
+     * @param [out] assignments - assignments in the order of paths. NULL if path has no assignment.
+     *                            Assignments are owned by caller
+     * @param [in] run - run number
+     * @param [in] paths - object paths
+     * @param [in] time - timestamp, data that is equal or earlier in time than that timestamp is returned. 0 - no time limit
+     * @param [in] variation - variation name
+     * @return false if error (then all assignments are NULL). Not found type tables are reported but are not errors of the batch
+     */
+    virtual bool GetAssignmentsShortBatch(vector<Assignment *>& assignments, int run, const vector<string>& paths, time_t time, const string& variation="default");
+
 
     /** @brief Get last Assignment with all related objects
      *
@@ -673,6 +728,137 @@ public:
 
 
 
+    //----------------------------------------------------------------------------------------
+    //  C A C H E
+    //----------------------------------------------------------------------------------------
+
+    /** @brief Cache of assignments that are read through this connection
+     *
+     * The cache is used by Calibration::GetAssignment. Calibrations that share
+     * the provider share the cache. Use it to set memory budget or to pin paths
+     *
+     * @warning User should not delete this object
+     */
+    AssignmentCache * GetAssignmentCache() { return &mAssignmentCache; }
+
+    /** @brief Mutex that serializes queries through this connection
+     *
+     * Providers are not reentrant. Calibrations that share the provider lock it
+     * only around the query itself, cache hits don't take it
+     * (and reads of reentrant providers don't take it, @see IsReentrant)
+     */
+    std::mutex& GetQueryMutex() { return mQueryMutex; }
+
+    /** @brief true if GetAssignmentShort, GetAssignmentIdShort and GetAssignmentShortById
+     * may be called from many threads at the same time without locking GetQueryMutex()
+     *
+     * Other functions are not reentrant in any case
+     */
+    virtual bool IsReentrant() { return false; }
+
+    /** @brief Cells of the assignment converted to numbers by the provider (row by row)
+     *
+     * Providers that keep typed values (@see SnapshotDataProvider) give them without parsing
+     * the data blob. It is called without locking GetQueryMutex(), so it must not change the provider
+     *
+     * @param [in] assignment - assignment that was read by this provider
+     * @param [out] values - cells of the assignment
+     * @return false if the provider has no typed values of the assignment, then the data blob is parsed
+     */
+    virtual bool GetAssignmentValues(const Assignment& assignment, vector<double>& values) { return false; }
+    virtual bool GetAssignmentValues(const Assignment& assignment, vector<int>& values) { return false; }
+
+    /** @brief Resolve assignments of runs by in memory run range index instead of SQL. Off by default
+     *
+     * On the first lookup of a type table all its assignments (run range, id, variation and creation time)
+     * are read by one query. Then GetAssignmentIdShort resolves runs without SQL and GetAssignmentShort
+     * reads only the data blob by id. It is for long running services that sweep many runs.
+     * Assignments that are added to the database after the load are not seen until the index
+     * is older than @see SetRunRangeIndexMaxAge or @see ClearRunRangeIndex is called
+     */
+    void EnableRunRangeIndex(bool value);
+    bool IsRunRangeIndexEnabled() const { return mIsRunRangeIndexEnabled; }
+
+    /** @brief Seconds after which the index of a type table is read again. 0 (default) - never */
+    void SetRunRangeIndexMaxAge(time_t seconds);
+    time_t GetRunRangeIndexMaxAge();
+
+    /** @brief Drops loaded indexes. They are read again on the next lookup */
+    void ClearRunRangeIndex();
+
+    /** @brief Gives the connection that was borrowed for the last queries back to the connection pool
+     *
+     * Calibration calls it after each request. Providers without a pool of shared connections do nothing
+     */
+    virtual void ReleaseConnection() {}
+
+    //----------------------------------------------------------------------------------------
+    //  M E T A D A T A   C A T A L O G
+    //----------------------------------------------------------------------------------------
+
+    /** @brief Type table with loaded columns from the metadata catalog
+     *
+     * The table is read from the database (by GetConstantsTypeTable(path, true)) on the first
+     * request of the path and then is served from the catalog by hash lookup.
+     * The table is owned by the provider and is shared by all assignments that are read by
+     * GetAssignmentShort and GetAssignmentShortById.
+     *
+     * @warning User should not change or delete this object
+     * @param [in] path - absolute path of the type table
+     * @return type table or NULL if no such table
+     */
+    virtual ConstantsTypeTable * GetCatalogTypeTable(const string& path);
+
+    /** @brief Looks up the assignment in the run range index of the type table. @see EnableRunRangeIndex
+     *
+     * The index of the table is read by @see LoadRunRangeIndex on the first lookup
+     *
+     * @param [in] table - type table from the catalog
+     * @param [in] variations - variation chain from the catalog
+     * @param [in] run - run number
+     * @param [in] time - time limit or 0
+     * @param [out] assignmentId - found assignment or 0 if no assignment covers the run
+     * @return false if the index is off or can't be read, then the assignment is looked up by SQL
+     */
+    bool FindInRunRangeIndex(ConstantsTypeTable *table, const vector<Variation *>& variations, int run, time_t time, dbkey_t& assignmentId);
+
+    /** @brief Reads assignments of all variations of the type table for the run range index
+     *
+     * @return false if the provider has no index or error
+     */
+    virtual bool LoadRunRangeIndex(ConstantsTypeTable *table, vector<RunRangeIndexEntry>& entries) { return false; }
+
+    /** @brief Time limit of a request in the units of RunRangeIndexEntry::Created. Unix time by default */
+    virtual long long GetRunRangeIndexTimeKey(time_t time) { return (long long)time; }
+
+    /** @brief Variation and its ancestors from the metadata catalog
+     *
+     * The chain starts with the variation itself and ends with the root variation (i.e. "default"):
+     * [variation, parent, parent of parent, ..., default]. It is the order in which
+     * assignments are looked for. The chain is built on the first request of the variation
+     *
+     * @warning User should not change or delete the variations
+     * @param [in] name - name of the variation
+     * @return variation chain or NULL if no such variation
+     */
+    virtual const vector<Variation *> * GetCatalogVariationChain(const string& name);
+
+    /** @brief Clears the catalog. The next requests read metadata from the database again
+     *
+     * Type tables that were given to assignments are not deleted, assignments may still reference them.
+     * They are kept by path and are put back to the catalog when the table is read again
+     * and is not changed in the database. @see AddCatalogTypeTable
+     */
+    virtual void ClearCatalog();
+
+    /** @brief Clears the catalog, run range indexes and assignments cache
+     *
+     * Providers call it on disconnect, so data of the database that was read before is not
+     * served after reconnect. The database may be changed by other processes (i.e. ccdb tools),
+     * long running jobs may call it to see the changes without reconnect
+     */
+    void ClearCaches();
+
     //----------------------------------------------------------------------------------------
     //  L O G G I N G
     //----------------------------------------------------------------------------------------
@@ -682,6 +868,31 @@ public:
     
     
 protected:
+    /** @brief Decompresses vault if it is compressed, it is done before Assignment::SetRawData */
+    string DecompressVault(string blob);
+
+    /** @brief Maximum number of type tables that GetAssignmentsShortBatch resolves by one query */
+    static const size_t cMaxBatchQuerySize = 128;
+
+    /** @brief Number of type table ids to put in a batch query of count tables
+     *
+     * It is count rounded up to a power of two, the rest is filled by the last id.
+     * So only a few different statements are prepared for batches of any size
+     */
+    static size_t GetBatchQuerySize(size_t count);
+
+    /** @brief Puts the table that is read from the database to the catalog
+     *
+     * If the catalog had the table of the same path before ClearCatalog and the table is not changed
+     * in the database, the previous table is put back and the read one is deleted.
+     * So tables are not piled up by reconnects
+     *
+     * @param [in] path - absolute path of the type table
+     * @param [in] table - table with columns owned by the provider
+     * @return table that is in the catalog now
+     */
+    ConstantsTypeTable * AddCatalogTypeTable(const string& path, ConstantsTypeTable *table);
+
     /** @brief Sets IsLoaded() and  resets IsChanged()Yt
      *
      * @param     obj
@@ -705,6 +916,8 @@ protected:
     
     vector<int> mErrorCodes;            ///vector of last errors
 
+    std::mutex mErrorsMutex;            ///guards error state, reentrant functions report errors from many threads
+
     vector<CCDBError *> mErrors;        ///errors 
     
     int mLastError;                     ///last error
@@ -715,9 +928,25 @@ protected:
 
     std::string mConnectionString;      ///Connection string that was used on last successfully connect.
 
+    int mSchemaVersion;                 ///Schema version that is read on connect, @see GetSchemaVersion
+
     IAuthentication * mAuthentication;
 
     map<dbkey_t, Variation *> mVariationsById;
+
+    /******* M E T A D A T A   C A T A L O G *******/
+    std::unordered_map<string, ConstantsTypeTable *> mCatalogTypeTables;          ///full path => type table with columns
+    std::unordered_map<string, vector<Variation *> > mCatalogVariationChains;     ///variation name => [variation, parent, ..., default]
+    std::unordered_map<string, ConstantsTypeTable *> mRetiredTypeTables;          ///full path => type table of the cleared catalog
+
+    AssignmentCache mAssignmentCache;   ///Assignments read through this connection
+
+    /******* R U N   R A N G E   I N D E X *******/
+    std::atomic<bool> mIsRunRangeIndexEnabled;                                      ///@see EnableRunRangeIndex
+    time_t mRunRangeIndexMaxAge;                                                    ///@see SetRunRangeIndexMaxAge
+    std::unordered_map<dbkey_t, std::shared_ptr<RunRangeIndex> > mRunRangeIndexes; ///type table id => index
+    std::mutex mRunRangeIndexMutex;                                                 ///guards the indexes, lookups of reentrant providers run in many threads
+    std::mutex mQueryMutex;             ///Serializes queries of Calibrations, @see GetQueryMutex
 };
 }
 #endif // _DDataProvider_
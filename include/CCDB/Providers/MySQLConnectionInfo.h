@@ -15,7 +15,11 @@ class MySQLConnectionInfo
 	Password(""),
 	HostName(""),
 	Database(""),
-	Port(0)
+	Port(0),
+	ConnectTimeout(0),
+	ConnectRetries(0),
+	RetryDelayMs(100),
+	RetryMaxDelayMs(10000)
 	{
 	}
 	~MySQLConnectionInfo(){}
@@ -24,7 +28,13 @@ class MySQLConnectionInfo
 	string 	Database;
 	string	HostName;
 	int		Port;
-	
+
+	//options of the connection string, @see MySQLDataProvider::Connect
+	unsigned int ConnectTimeout;	///Seconds to wait for the server to answer. 0 - default of the client library
+	int		ConnectRetries;			///Attempts to connect again after a failed one
+	int		RetryDelayMs;			///Backoff after the first failure. It doubles after each next failure
+	int		RetryMaxDelayMs;		///Backoff limit
+
 };
 
 }
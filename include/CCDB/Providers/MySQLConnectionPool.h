@@ -0,0 +1,179 @@
+#ifndef _MySQLConnectionPool_
+#define _MySQLConnectionPool_
+
+#ifdef WIN32
+#include <winsock.h>
+#endif
+#include <mysql.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#include "CCDB/Providers/MySQLConnectionInfo.h"
+#include "CCDB/Providers/MySQLStatement.h"
+
+#define CCDB_ENV_MYSQL_POOL_SIZE "CCDB_MYSQL_POOL_SIZE"
+#define CCDB_ENV_MYSQL_MAX_CONNECTING "CCDB_MYSQL_MAX_CONNECTING"
+#define CCDB_ENV_MYSQL_MAX_STATEMENTS "CCDB_MYSQL_MAX_STATEMENTS"
+
+using namespace std;
+
+namespace ccdb
+{
+
+/** @brief Server connection of the pool with its prepared statements
+ *
+ * Statements are cached by query text. The server limits prepared statements of all its sessions
+ * (max_prepared_stmt_count), so each connection keeps no more than
+ * MySQLConnectionPool::GetMaxStatementsPerConnection of them and closes the least recently used one
+ */
+class MySQLPooledConnection
+{
+public:
+	explicit MySQLPooledConnection(MYSQL *handle): Handle(handle), LastUsedTime(0) {}
+	~MySQLPooledConnection();
+
+	MYSQL *Handle;								///Connection handle
+	time_t LastUsedTime;						///Monotonic time when the connection was given back to the pool
+
+	/** @brief Prepared statement of the query or NULL. The statement becomes the most recently used */
+	MySQLStatement* FindStatement(const string& query);
+
+	/** @brief Takes ownership of the prepared statement. Closes the least recently used ones over the limit */
+	void AddStatement(MySQLStatement *statement);
+
+	size_t GetStatementsCount() const { return mStatements.size(); }	///Number of cached statements
+
+private:
+	typedef list<MySQLStatement *> StatementList;
+	StatementList mStatements;								///The most recently used first
+	map<string, StatementList::iterator> mStatementsByQuery;	///Query text => position in mStatements
+
+	MySQLPooledConnection(const MySQLPooledConnection& rhs);
+	MySQLPooledConnection& operator=(const MySQLPooledConnection& rhs);
+};
+
+
+/** @brief Connections to one MySQL server shared by all providers of the process that connect to it
+ *
+ * Each MySQLDataProvider used to open its own connection, and CalibrationGenerator makes a provider
+ * for each run and variation. Now providers borrow a connection for a query and give it back,
+ * so a process holds a small and bounded number of server sessions:
+ *  - connections are opened only when there is no idle one (lazy open) and no more than GetMaxConnections
+ *  - if all connections are busy, Acquire waits for one up to GetAcquireTimeout
+ *  - a connection that was idle longer than GetHealthCheckInterval is pinged before it is given out
+ *  - connections that were idle longer than GetIdleTimeout are closed
+ *
+ * When many jobs start at once the server may refuse or drop connections. Then:
+ *  - a failed connection is tried again up to MySQLConnectionInfo::ConnectRetries times
+ *  - attempts to a server are spaced by exponential backoff with random jitter. Backoff is
+ *    kept for the server until a connection succeeds, so reconnections of other providers wait too
+ *  - no more than GetMaxConcurrentConnects connections of the process are being opened at once
+ *
+ * The pool lives while providers use it. @see GetPool
+ */
+class MySQLConnectionPool
+{
+public:
+
+	/** @brief Pool of the server and user. Providers with the same connection info get the same pool
+	 *
+	 * The pool is created on the first request. Its size is CCDB_MYSQL_POOL_SIZE environment variable
+	 * or @see SetDefaultMaxConnections
+	 *
+	 * @param [in] connection - connection info
+	 * @return the pool
+	 */
+	static std::shared_ptr<MySQLConnectionPool> GetPool(const MySQLConnectionInfo& connection);
+
+	/** @brief Default size of new pools. 4 if it is not set */
+	static void SetDefaultMaxConnections(size_t count);
+	static size_t GetDefaultMaxConnections();
+
+	/** @brief Limit of connections that the process opens at the same time. 0 - no limit
+	 *
+	 * Other connections wait until one of these is opened or fails. The initial value
+	 * is CCDB_MYSQL_MAX_CONNECTING environment variable or 0
+	 */
+	static void SetMaxConcurrentConnects(size_t count);
+	static size_t GetMaxConcurrentConnects();
+
+	/** @brief Limit of prepared statements that each connection keeps. 64 by default
+	 *
+	 * The initial value is CCDB_MYSQL_MAX_STATEMENTS environment variable. It is no less than 8,
+	 * so statements that are used by one provider call are not closed during the call
+	 */
+	static void SetMaxStatementsPerConnection(size_t count);
+	static size_t GetMaxStatementsPerConnection();
+
+	/** @brief Random backoff before the next attempt after the failure number failuresCount. @see Open
+	 *
+	 * @return milliseconds between delay/2 and delay, where delay is base*2^(failuresCount-1) limited by maxDelayMs
+	 */
+	static int GetBackoffDelayMs(unsigned int failuresCount, int baseDelayMs, int maxDelayMs);
+
+	explicit MySQLConnectionPool(const MySQLConnectionInfo& connection);
+	~MySQLConnectionPool();
+
+	/** @brief Borrows a connection. It should be given back by Release or Discard
+	 *
+	 * @param [out] error - description of the error if no connection is given
+	 * @return connection or NULL if the server can't be connected or wait time is out
+	 */
+	MySQLPooledConnection* Acquire(string& error);
+
+	/** @brief Gives the connection back to the pool */
+	void Release(MySQLPooledConnection* connection);
+
+	/** @brief Closes the broken connection instead of giving it back */
+	void Discard(MySQLPooledConnection* connection);
+
+	/** @brief Closes connections that are idle longer than GetIdleTimeout */
+	void ReapIdleConnections();
+
+	size_t GetOpenConnectionsCount();	///Idle and borrowed connections
+	size_t GetIdleConnectionsCount();	///Connections that wait in the pool
+	size_t GetIdleStatementsCount();	///Prepared statements of connections that wait in the pool
+
+	size_t GetMaxConnections();
+	void SetMaxConnections(size_t count);
+	time_t GetIdleTimeout();				///Seconds. 0 - idle connections are not closed
+	void SetIdleTimeout(time_t seconds);
+	time_t GetHealthCheckInterval();		///Seconds. Connections idle longer than it are pinged before use
+	void SetHealthCheckInterval(time_t seconds);
+	time_t GetAcquireTimeout();			///Seconds to wait for a connection when all are busy
+	void SetAcquireTimeout(time_t seconds);
+
+private:
+
+	/** @brief Opens a new server connection
+	 *
+	 * Waits for the backoff of the server and for a place among connections being opened,
+	 * then tries to connect. It is repeated up to MySQLConnectionInfo::ConnectRetries times
+	 */
+	MySQLPooledConnection* Open(string& error);
+	MYSQL* ConnectToServer(string& error);		///One attempt to connect
+	void TakeIdleToClose(time_t now, vector<MySQLPooledConnection *>& toClose);	///Under mMutex
+
+	MySQLConnectionInfo mConnectionInfo;
+	std::mutex mMutex;
+	std::condition_variable mReleased;			///Notified when a connection is given back or closed
+	vector<MySQLPooledConnection *> mIdle;		///The last given back is the first given out
+	size_t mOpenCount;
+	size_t mMaxConnections;
+	time_t mIdleTimeout;
+	time_t mHealthCheckInterval;
+	time_t mAcquireTimeout;
+
+	MySQLConnectionPool(const MySQLConnectionPool& rhs);
+	MySQLConnectionPool& operator=(const MySQLConnectionPool& rhs);
+};
+
+}
+
+#endif //_MySQLConnectionPool_
@@ -10,6 +10,8 @@
 
 #include "CCDB/Providers/DataProvider.h"
 #include "CCDB/Providers/MySQLConnectionInfo.h"
+#include "CCDB/Providers/MySQLStatement.h"
+#include "CCDB/Providers/MySQLConnectionPool.h"
 #include "CCDB/Model/ConstantsTypeTable.h"
 
 #define CCDB_DEFAULT_MYSQL_USERNAME  "ccdbuser"
@@ -46,6 +48,15 @@ public:
 	 * Connects to database using connection string
 	 * connection string might be in form: 
 	 * mysql://<username>:<password>@<mysql.address>:<port> <database>
+	 * mysql://<username>:<password>@<mysql.address>:<port>/<database>?<option>=<value>&<option>=<value>...
+	 *
+	 * Options set how the server is connected when it is slow or overloaded:
+	 * connect_timeout=<s>        - seconds to wait for the server to answer (MYSQL_OPT_CONNECT_TIMEOUT)
+	 * connect_retries=<N>        - attempts to connect again after a failed one (0 by default)
+	 * retry_delay_ms=<ms>        - backoff after the first failure, it doubles after each next failure (100 by default)
+	 * retry_max_delay_ms=<ms>    - backoff limit (10000 by default)
+	 * Backoff is randomized and is kept for the server between Connect calls,
+	 * so auto-reconnection after a failure waits too. @see MySQLConnectionPool::Open
 	 * 
 	 * @param connectionString "mysql://<username>:<password>@<mysql.address>:<port> <database>"
 	 * @return true if connected
@@ -80,6 +91,14 @@ public:
 	 */
 	static bool ParseConnectionString(std::string conStr, MySQLConnectionInfo &connection);
 
+	/** @brief Parses options of the connection string (the part after '?')
+	 *
+	 * @param   [in]  options - like "connect_timeout=5&connect_retries=3"
+	 * @param   [out] connection - options are set to it
+	 * @return  false if an option is unknown or its value is invalid
+	 */
+	static bool ParseConnectOptions(const string& options, MySQLConnectionInfo &connection);
+
 	/** @brief Checks Connection and report error if not connected
 	 *
 	 * This function checks if the provider is connected now and return true if it is
@@ -93,6 +112,19 @@ public:
 	 */
 	virtual bool CheckConnection(const string& errorSource="");
 
+	/** @brief Gives the borrowed connection back to the pool. @see DataProvider::ReleaseConnection
+	 *
+	 * The next query borrows a connection again. Public functions of the provider call it
+	 * when they return (@see ConnectionScope), so it is needed only after protected queries
+	 */
+	virtual void ReleaseConnection();
+
+	/** @brief Pool of connections to the server. NULL if not connected */
+	MySQLConnectionPool* GetConnectionPool() const { return mPool.get(); }
+
+	/** @brief Number of prepared statements of the borrowed connection or, between calls, of idle connections of the pool. @see PrepareStatement */
+	size_t GetPreparedStatementsCount() const;
+
 	//----------------------------------------------------------------------------------------
 	//	D I R E C T O R Y   M A N G E M E N T
 	//----------------------------------------------------------------------------------------    
@@ -378,9 +410,18 @@ private:
 	virtual Variation* GetVariationById(int id);
 
     /**
-     * Get variation by database request
+     * Get variation by executed variation statement
      */
-    virtual Variation* SelectVariation(const string& query);
+    virtual Variation* SelectVariation(MySQLStatement* statement);
+
+    /** @brief New variation from the fetched row of variation statement */
+    Variation* FetchVariation(MySQLStatement* statement);
+
+    /** @brief Reads all variations by one query. @see GetVariation
+     *
+     * @return true if no errors
+     */
+    bool LoadVariations();
     
 	#pragma endregion Variation
 
@@ -418,6 +459,33 @@ public:
      */
     virtual Assignment* GetAssignmentShort(int run, const string& path, time_t time, const string& variation="default", bool loadColumns=false);
 
+    /** @brief Resolves request to assignment id without reading data blob
+     *
+     * @see DataProvider::GetAssignmentIdShort
+     * @param [in] run - run number
+     * @param [in] path - object path
+     * @param [in] time - timestamp, data that is equal or earlier in time than that timestamp is returned. 0 - no time limit
+     * @param [in] variation - variation name
+     * @return assignment id or 0 if no assignment is found or error
+     */
+    virtual dbkey_t GetAssignmentIdShort(int run, const string& path, time_t time, const string& variation="default");
+
+    /** @brief Get Assignment with data blob only by assignment id
+     *
+     * @param [in] id - assignment id
+     * @param [in] path - object path
+     * @param [in] loadColumns - optional, do we need to load table columns information (for column names and types) or not
+     * @return DAssignment object or NULL if no assignment is found or error
+     */
+    virtual Assignment* GetAssignmentShortById(dbkey_t id, const string& path, bool loadColumns=false);
+
+    /** @brief Get Assignments with data blob only for many type tables by one statement
+     *
+     * @see DataProvider::GetAssignmentsShortBatch
+     * @return false if error (then all assignments are NULL)
+     */
+    virtual bool GetAssignmentsShortBatch(vector<Assignment *>& assignments, int run, const vector<string>& paths, time_t time, const string& variation="default");
+
 
     
 	/** @brief Get last Assignment with all related objects
@@ -606,6 +674,48 @@ public:
 	 */
 	virtual bool FillAssignment(Assignment* assignment);
 
+protected:
+	/** @brief Result of ExecuteAssignmentLookup */
+	struct AssignmentLookup
+	{
+		ConstantsTypeTable *Table;	///Type table from the catalog
+		dbkey_t AssignmentId;		///0 if no assignment is found
+		dbkey_t VariationId;		///Variation of the found assignment
+		string Blob;				///Data blob if it was requested
+	};
+
+	/** @brief Resolves assignment and (if it is not in the catalog yet) type table with columns by one statement
+	 *
+	 * @param [out] lookup - type table and assignment
+	 * @param [in] path - object path
+	 * @param [in] withBlob - read data blob
+	 * @param [in] id - assignment id or 0 to look up by run, time and variation chain
+	 * @param [in] run - run number
+	 * @param [in] time - timestamp, 0 - no time limit
+	 * @param [in] variations - variation chain (@see GetCatalogVariationChain), not used if id is given
+	 * @param [in] functionName - function name to report error
+	 * @return false if error. No assignment is not an error
+	 */
+	bool ExecuteAssignmentLookup(AssignmentLookup& lookup, const string& path, bool withBlob, dbkey_t id, int run, time_t time, const vector<Variation *> *variations, const char* functionName);
+
+	/** @brief Reads type tables with columns of the paths that are not in the catalog yet by one statement
+	 *
+	 * The tables are added to the catalog. Paths without type tables are not an error
+	 *
+	 * @param [in] paths - object paths
+	 * @param [in] functionName - function name to report error
+	 * @return false if error
+	 */
+	bool LoadCatalogTypeTables(const vector<string>& paths, const char* functionName);
+
+	/** @brief Run range index lookup of the type table that is in the catalog. False if the index is off or the table is not read yet */
+	bool FindInRunRangeIndex(const string& path, const vector<Variation *>& variations, int run, time_t time, dbkey_t& assignmentId);
+
+	/** @brief Reads assignments of the type table by one query. @see DataProvider::LoadRunRangeIndex */
+	virtual bool LoadRunRangeIndex(ConstantsTypeTable *table, vector<RunRangeIndexEntry>& entries);
+
+	void ReadSchemaVersion();	///Reads schema version of the database on connect. @see GetSchemaVersion
+public:
 
 	#pragma endregion Assignments
         
@@ -648,9 +758,47 @@ protected:
 	 */
 	bool FetchRow();
 
-    /** prepares preparedStatemets for use
-     */
-    bool InitializePreparedStatements(){ return false;} //TODO implement PreparedStatements for GetAssignmentShort funcitons
+	/** @brief Prepared statement of the query
+	 *
+	 * Statements are prepared once per connection and are cached by query text.
+	 * Then each execution sends only parameters, and results come in binary form.
+	 * If the server can't prepare the query, the statement sends it as text. @see MySQLStatement::PrepareText
+	 *
+	 * @param [in] query - SQL with '?' parameters
+	 * @param [in] functionName - function name to report error
+	 * @return statement or NULL if error (error is reported)
+	 */
+	MySQLStatement* PrepareStatement(const string& query, const char* functionName);
+
+	/** @brief Executes statement with bound parameters and reports error if any
+	 *
+	 * @param [in] statement - prepared statement
+	 * @param [in] functionName - function name to report error
+	 * @return true if executed
+	 */
+	bool ExecuteStatement(MySQLStatement* statement, const char* functionName);
+
+	/** @brief Borrows a connection from the pool if none is borrowed
+	 *
+	 * @param [in] functionName - function name to report error
+	 * @return true if the provider has a connection
+	 */
+	bool AcquireConnection(const char* functionName);
+
+	/** @brief Gives the borrowed connection back to the pool when the outermost public call returns
+	 *
+	 * Public functions that query the server start with it, so a provider that is used directly
+	 * (not by Calibration) doesn't hold a connection of the pool between its calls.
+	 * Nested calls keep the connection and its prepared statements until the outer call returns
+	 */
+	class ConnectionScope
+	{
+	public:
+		explicit ConnectionScope(MySQLDataProvider *provider): mProvider(provider) { mProvider->mCallDepth++; }
+		~ConnectionScope() { if(--mProvider->mCallDepth == 0) mProvider->ReleaseConnection(); }
+	private:
+		MySQLDataProvider *mProvider;
+	};
 
 	//read of row fields
 	bool IsNullOrUnreadable(int fieldNum);		///Check if the field is NULL or is unreadable. If it is Unreadable
@@ -662,6 +810,7 @@ protected:
 	bool			ReadBool(int fieldNum);		///Reads bool from the last query row
 	double			ReadDouble(int fieldNum);	///Reads double from the last query row
 	string			ReadString(int fieldNum);	///Reads string from the last query row
+	string			ReadBlob(int fieldNum);		///Reads string that may have zero bytes from the last query row
 	time_t			ReadUnixTime(int fieldNum); ///Reads string from the last query row
 	
 	
@@ -682,6 +831,21 @@ protected:
 	virtual string WilcardsToLike(const string& str); ///Prepares search pattern for MySQL
 		
 	virtual string PrepareLimitInsertion(int take=0, int startWith=0);
+
+	/** @brief Condition and ordering that select assignments of the nearest variation of a chain
+	 *
+	 * @param [in] chainSize - number of variations in chain (@see GetCatalogVariationChain)
+	 * @return "AND variationId IN (?, ...) ORDER BY <chain depth>, id DESC "
+	 */
+	virtual string PrepareVariationChainInsertion(size_t chainSize);
+
+	/** @brief Binds variation ids of a chain to parameters of PrepareVariationChainInsertion
+	 *
+	 * @param [in] statement - prepared statement
+	 * @param [in] chain - variation chain (@see GetCatalogVariationChain)
+	 * @param [in] firstParameter - index of the first parameter of the insertion
+	 */
+	void BindVariationChain(MySQLStatement* statement, const vector<Variation *>& chain, size_t firstParameter);
     
     #pragma endregion MySQL specific
 
@@ -702,7 +866,9 @@ protected:
 private:
 	
 	
-	MYSQL *mMySQLHnd;			//Handler to mysql object
+	std::shared_ptr<MySQLConnectionPool> mPool;	//Connections to the server shared with other providers
+	MySQLPooledConnection *mConnection;			//Borrowed connection or NULL
+	int mCallDepth;								//Public calls in progress, @see ConnectionScope
 	bool mIsStoredObjectOwner;
 	Assignment* FetchAssignment(ConstantsTypeTable *table);
 	virtual void FetchAssignment(Assignment* assignment, ConstantsTypeTable *table);
@@ -724,6 +890,7 @@ private:
 	
     //VARIATIONs WORK
     Variation* mLastVariation;                     ///Last requested variation ID. Used for caching
+    bool mVariationsAreLoaded;                     ///All variations are read by LoadVariations
 	
 
 #pragma endregion Private
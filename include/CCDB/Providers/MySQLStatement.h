@@ -0,0 +1,140 @@
+#ifndef _MySQLStatement_
+#define _MySQLStatement_
+
+#ifdef WIN32
+#include <winsock.h>
+#endif
+#include <mysql.h>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+using namespace std;
+
+namespace ccdb
+{
+
+/** @brief Server side prepared statement with binary parameters and results
+ *
+ * The statement is parsed by the server once and then is executed with new parameters.
+ * Integer results come in binary form, other columns come as strings (blobs, dates, decimals).
+ * Parameters are bound by index from 0 before each Execute:
+ *
+ *    statement->BindInt(0, run);
+ *    statement->BindString(1, name);
+ *    if(statement->Execute()) while(statement->Fetch()) id = statement->ReadInt(0);
+ *    statement->FreeResult();
+ *
+ * The statement belongs to one connection (@see MySQLDataProvider::PrepareStatement)
+ *
+ * If the server can't prepare the query (i.e. max_prepared_stmt_count of the server is reached)
+ * the statement may be made a text one by PrepareText. Then Execute sends the query as text with
+ * escaped parameters in place of '?' and the same Fetch and Read functions read the text result
+ */
+class MySQLStatement
+{
+public:
+	MySQLStatement();
+	~MySQLStatement();
+
+	/** @brief Prepares the query on the server
+	 *
+	 * @param [in] connection - connection the statement belongs to
+	 * @param [in] query - SQL with '?' parameters
+	 * @return true if prepared. @see ComposeError otherwise
+	 */
+	bool Prepare(MYSQL *connection, const string& query);
+
+	/** @brief Makes the statement a text one. The query is not sent to the server until Execute
+	 *
+	 * @param [in] connection - connection the statement belongs to
+	 * @param [in] query - SQL with '?' parameters
+	 */
+	void PrepareText(MYSQL *connection, const string& query);
+
+	bool IsText() const { return mIsText; }	///true if the query is sent as text. @see PrepareText
+
+	/** @brief Closes the statement on the server */
+	void Close();
+
+	void BindInt(size_t index, long long value);			///Binds integer parameter
+	void BindString(size_t index, const string& value);	///Binds string parameter
+
+	/** @brief Executes the statement with bound parameters and reads the whole result to the client
+	 *
+	 * @return true if executed. @see ComposeError otherwise
+	 */
+	bool Execute();
+
+	/** @brief Fetches next row of the result
+	 *
+	 * @return true if row was read, false if no more rows or error
+	 */
+	bool Fetch();
+
+	/** @brief Frees the result on the client. The statement may be executed again */
+	void FreeResult();
+
+	bool IsNull(size_t column) const;			///true if the field of the last fetched row is NULL
+	long long ReadInt(size_t column) const;		///Reads integer field of the last fetched row. 0 if NULL
+	string ReadString(size_t column) const;		///Reads field of the last fetched row as string. "" if NULL
+
+	size_t GetRowsCount() const;				///Number of rows of the last execution
+	const string& GetQuery() const { return mQuery; }
+
+	/** @brief gets last error and description and composes it as a string
+	 * @return string with composed error
+	 */
+	string ComposeError(const string& mySqlFunctionName) const;
+
+private:
+
+	//MySQL 8 uses bool for MYSQL_BIND flags, older versions and MariaDB have my_bool
+	typedef remove_pointer<decltype(MYSQL_BIND::is_null)>::type BindFlag;
+
+	struct Parameter
+	{
+		bool IsInt;
+		long long Int;
+		string String;
+		unsigned long Length;
+	};
+
+	struct Column
+	{
+		bool IsInt;
+		long long Int;
+		vector<char> Buffer;	//string columns. It grows to the longest value
+		unsigned long Length;
+		BindFlag IsNull;
+		BindFlag Error;
+	};
+
+	bool BindResult();			//binds result columns to mResultBinds
+	bool FetchLongColumns();	//reads columns that didn't fit to the buffers
+	bool ExecuteText();			//executes the query with parameters as escaped literals
+	string ComposeTextQuery();	//the query with parameters in place of '?'
+
+	MYSQL_STMT *mStatement;
+	string mQuery;
+	vector<Parameter> mParameters;
+	vector<MYSQL_BIND> mParameterBinds;
+	vector<Column> mColumns;
+	vector<MYSQL_BIND> mResultBinds;
+	bool mHasResult;
+
+	//text statement. @see PrepareText
+	MYSQL *mConnection;
+	bool mIsText;
+	MYSQL_RES *mTextResult;
+	MYSQL_ROW mTextRow;
+	unsigned long *mTextLengths;
+	unsigned int mTextFieldsCount;
+
+	MySQLStatement(const MySQLStatement& rhs);
+	MySQLStatement& operator=(const MySQLStatement& rhs);
+};
+
+}
+
+#endif //_MySQLStatement_
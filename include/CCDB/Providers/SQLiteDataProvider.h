@@ -7,6 +7,7 @@
 #include <sqlite3.h>
 #include <vector>
 #include <map>
+#include <mutex>
 
 #include "CCDB/Providers/DataProvider.h"
 #include "CCDB/Model/ConstantsTypeTable.h"
@@ -20,6 +21,13 @@ using namespace std;
 namespace ccdb
 {
 
+/** @brief Provider of SQLite database
+ *
+ * Reads of constants (GetAssignmentShort, GetAssignmentIdShort, GetAssignmentShortById) are reentrant.
+ * Each call takes a read only connection (opened with SQLITE_OPEN_NOMUTEX) from the pool
+ * and uses prepared statements of that connection, so threads read the database in parallel.
+ * Other functions use the main connection and are not reentrant
+ */
 class SQLiteDataProvider: public DataProvider
 {
 	
@@ -39,9 +47,21 @@ public:
 	 * 
 	 * Connects to database using connection string
 	 * connection string might be in form: 
-	 * mysql://<username>:<password>@<mysql.address>:<port> <database>
-	 * 
-	 * @param connectionString "mysql://<username>:<password>@<mysql.address>:<port> <database>"
+	 * sqlite://<path to file>
+	 * sqlite://<path to file>?<option>=<value>&<option>=<value>...
+	 *
+	 * Options tune reading of the file for the place where it lives:
+	 * immutable=1       - the file never changes, SQLite doesn't lock it and doesn't check for changes (CVMFS, Lustre)
+	 * nolock=1          - SQLite doesn't lock the file (file systems where locks are slow or broken)
+	 * mmap_size=<bytes> - the file is read through memory map of this size (PRAGMA mmap_size)
+	 * cache_size=<N>    - page cache size, N pages or -N KiB (PRAGMA cache_size)
+	 * inmemory=1        - the whole file is read to memory on connect, then queries don't touch the file.
+	 *                     It is for short jobs with the file on network file system. @see IsInMemoryShared
+	 * inmemory_max_bytes=<bytes> - with inmemory=1, files that are bigger are not loaded (connect fails). 0 - no limit
+	 * If immutable or nolock is given the file is opened as URI (SQLITE_OPEN_URI).
+	 * The options are applied to all connections of the provider
+	 * 
+	 * @param connectionString "sqlite://<path to file>[?options]"
 	 * @return true if connected
 	 */
 	virtual bool Connect(string connectionString);
@@ -74,6 +94,29 @@ public:
 	 */
 	virtual bool CheckConnection(const string& errorSource="");
 
+	/** @brief Reads of constants are reentrant. @see DataProvider::IsReentrant */
+	virtual bool IsReentrant() { return true; }
+
+	/** @brief Number of opened connections of the pool (the main connection is not counted) */
+	size_t GetPooledConnectionsCount();
+
+	/** @brief Number of prepared statements that are cached by the main connection. @see PrepareCachedStatement */
+	size_t GetCachedStatementsCount() { return mCachedStatements.size(); }
+
+	/** @brief true if inmemory=1 option can be used. It is supported by all SQLite versions
+	 *
+	 * @see IsInMemoryShared
+	 */
+	static bool IsInMemorySupported();
+
+	/** @brief true if with inmemory=1 connections read the file image by sqlite3_deserialize
+	 *
+	 * It is SQLite 3.36+ or SQLite 3.23+ that is built with SQLITE_ENABLE_DESERIALIZE.
+	 * Older SQLite (i.e. the bundled one) copies the file to a shared cache in memory database
+	 * by the backup API (sqlite3_backup_*). The file is read once in both cases
+	 */
+	static bool IsInMemoryShared();
+
 	//----------------------------------------------------------------------------------------
 	//	D I R E C T O R Y   M A N G E M E N T
 	//----------------------------------------------------------------------------------------
@@ -397,6 +440,33 @@ public:
      * @return new DAssignment object or 
      */
     virtual Assignment* GetAssignmentShort(int run, const string& path, time_t time, const string& variation="default", bool loadColumns =false);
+
+    /** @brief Resolves request to assignment id without reading data blob
+     *
+     * @see DataProvider::GetAssignmentIdShort
+     * @param [in] run - run number
+     * @param [in] path - object path
+     * @param [in] time - timestamp, data that is equal or earlier in time than that timestamp is returned. 0 - no time limit
+     * @param [in] variation - variation name
+     * @return assignment id or 0 if no assignment is found or error
+     */
+    virtual dbkey_t GetAssignmentIdShort(int run, const string& path, time_t time, const string& variation="default");
+
+    /** @brief Get Assignment with data blob only by assignment id
+     *
+     * @param [in] id - assignment id
+     * @param [in] path - object path
+     * @param [in] loadColumns - optional, do we need to load table columns information (for column names and types) or not
+     * @return DAssignment object or NULL if no assignment is found or error
+     */
+    virtual Assignment* GetAssignmentShortById(dbkey_t id, const string& path, bool loadColumns=false);
+
+    /** @brief Get Assignments with data blob only for many type tables by one query
+     *
+     * @see DataProvider::GetAssignmentsShortBatch
+     * @return false if error (then all assignments are NULL)
+     */
+    virtual bool GetAssignmentsShortBatch(vector<Assignment *>& assignments, int run, const vector<string>& paths, time_t time, const string& variation="default");
      
     
 	/** @brief Get last Assignment with all related objects
@@ -622,9 +692,10 @@ protected:
 	virtual void FreeSQLiteResult();	///Frees my sql result manually
 	
 	/** @brief gets last error and description and composes it as a string
+	 * @param database - connection to take the error from. NULL - the main connection
 	 * @return string with composed error
 	 */
-	std::string ComposeSQLiteError(const std::string& SQLiteFunctionName);
+	std::string ComposeSQLiteError(const std::string& SQLiteFunctionName, sqlite3 *database=NULL);
 	
 	/** @brief Fetches next Row
 	 *
@@ -632,9 +703,100 @@ protected:
 	 */
 	bool FetchRow();
 
-    /** prepares preparedStatemets for use
-     */
-    bool InitializePreparedStatements(){ return false;} //TODO implement PreparedStatements for GetAssignmentShort functions
+	/** @brief Sets mStatement to the cached (persistent) prepared statement of the query
+	 *
+	 * Statements are prepared once per connection and are reused with sqlite3_reset.
+	 * The caller should call sqlite3_reset (not sqlite3_finalize) when the statement is done
+	 *
+	 * @return true if mStatement is ready to bind and step
+	 */
+	bool PrepareCachedStatement(const string& query, const char *functionName);
+
+	void FinalizeCachedStatements();	///Finalizes all cached statements. Is called on Disconnect
+
+	/** @brief Read only connection of the pool with its own prepared statements */
+	struct PooledConnection
+	{
+		sqlite3 *Database;
+		map<string, sqlite3_stmt*> Statements;	//Prepared statements by query
+	};
+
+	/** @brief Holds connection of the pool while in scope */
+	class ConnectionLease
+	{
+	public:
+		ConnectionLease(SQLiteDataProvider *provider, const char *functionName): mProvider(provider), mConnection(provider->AcquireConnection(functionName)) {}
+		~ConnectionLease() { if(mConnection) mProvider->ReleaseConnection(mConnection); }
+		PooledConnection* Get() const { return mConnection; }
+	private:
+		SQLiteDataProvider *mProvider;
+		PooledConnection *mConnection;
+		ConnectionLease(const ConnectionLease& rhs);
+		ConnectionLease& operator=(const ConnectionLease& rhs);
+	};
+
+	/** @brief Parses options of the connection string and sets mOpenName, mOpenFlags and mOpenPragmas
+	 *
+	 * @param [in] path - database file
+	 * @param [in] options - options of the connection string (the part after '?') or empty string
+	 * @return true if options are valid. Reports error otherwise
+	 */
+	bool ParseOpenOptions(const string& path, const string& options);
+
+	/** @brief Opens the database with the options of the connection string
+	 *
+	 * @param [out] database - opened connection
+	 * @param [in] flags - SQLITE_OPEN_* flags of the connection
+	 * @return true if the database is opened. Reports error otherwise
+	 */
+	bool OpenDatabase(sqlite3 **database, int flags, const char *functionName);
+
+	/** @brief Reads the whole database file to mInMemoryImage. @see Connect inmemory option
+	 *
+	 * @param [in] path - database file
+	 * @return true if the file is read. Reports error otherwise
+	 */
+	bool LoadInMemoryImage(const string& path, const char *functionName);
+
+	/** @brief Copies the database file to mInMemoryDatabase by the backup API if there is no sqlite3_deserialize
+	 *
+	 * @param [in] path - database file
+	 * @return true if the file is copied. Reports error otherwise
+	 */
+	bool LoadInMemoryDatabase(const string& path, const char *functionName);
+
+	void ReadSchemaVersion();	///Reads schema version of the opened database. @see GetSchemaVersion
+
+	PooledConnection* AcquireConnection(const char *functionName);	///Takes idle connection of the pool or opens a new one. NULL (with error) if it can't be opened
+	void ReleaseConnection(PooledConnection *connection);				///Returns connection to the pool
+	void ClosePooledConnections();										///Closes connections of the pool. Is called on Disconnect
+
+	/** @brief Prepared statement of the query on the pooled connection
+	 *
+	 * Statements are prepared once per connection and are reused. Call sqlite3_reset when the statement is done
+	 * @return statement ready to bind and step or NULL (with error)
+	 */
+	sqlite3_stmt* PreparePooledStatement(PooledConnection *connection, const string& query, const char *functionName);
+
+	/** @brief Prepares and binds the query that resolves assignment of run, type table, time and variation chain
+	 *
+	 * @param [in] connection - pooled connection
+	 * @param [in] withBlob - select data blob (column 1) or only assignment id (column 0)
+	 * @return statement ready to step or NULL (with error)
+	 */
+	sqlite3_stmt* PrepareAssignmentQuery(PooledConnection *connection, bool withBlob, int run, ConstantsTypeTable *table, time_t time, const vector<Variation *>& variations, const char *functionName);
+
+	/** @brief Query that selects assignment of run, type table (typeId SQL expression), time and variation chain */
+	string ComposeAssignmentQuery(bool withBlob, const string& typeId, time_t time, size_t chainSize);
+
+	/** @brief Reads assignments of the type table by one query. @see DataProvider::LoadRunRangeIndex */
+	virtual bool LoadRunRangeIndex(ConstantsTypeTable *table, vector<RunRangeIndexEntry>& entries);
+
+	/** @brief `created` is local time text, so the key is the local time of the limit as YYYYMMDDhhmmss number
+	 *
+	 * It is how the assignment query compares `created` with datetime(?, 'unixepoch', 'localtime')
+	 */
+	virtual long long GetRunRangeIndexTimeKey(time_t time);
 
 	//read of row fields
 	bool IsNullOrUnreadable(int fieldNum);		///Check if the field is NULL or is unreadable. If it is Unreadable
@@ -646,6 +808,7 @@ protected:
 	bool			ReadBool(int fieldNum);		///Reads bool from the last query row
 	double			ReadDouble(int fieldNum);	///Reads double from the last query row
 	string			ReadString(int fieldNum);	///Reads string from the last query row
+	string			ReadBlob(int fieldNum);		///Reads string that may have zero bytes from the last query row
 	time_t			ReadUnixTime(int fieldNum); ///Reads string from the last query row
 	void BuildDirectoryDependencies(){DataProvider::BuildDirectoryDependencies();}			///Builds directory relational structure. Used right at the end of RetriveDirectories().
 	bool CheckDirectoryListActual(){return DataProvider::CheckDirectoryListActual();}			///Checks if directory list is actual i.e. nobody changed directories in database
@@ -668,6 +831,14 @@ protected:
 	virtual string WilcardsToLike(const string& str); ///Prepares search pattern for SQLite
 		
 	virtual string PrepareLimitInsertion(int take=0, int startWith=0);
+
+	/** @brief Condition and ordering that select assignments of the nearest variation of a chain
+	 *
+	 * @param [in] chainSize - number of variations in chain (@see GetCatalogVariationChain)
+	 * @param [in] firstParameter - number of SQL parameter of the first variation
+	 * @return "AND variationId IN (?N, ...) ORDER BY <chain depth>, id DESC "
+	 */
+	virtual string PrepareVariationChainInsertion(size_t chainSize, int firstParameter);
 //---------------------------------------------------------------
 //  DEBBUGING AND OPTIMIZATION
 //----------------------------------------------------------------
@@ -688,6 +859,18 @@ private:
 	bool mHaveUnfreeResults; 			//indicates that we have some unfree results from mysql, that must be freed
 	sqlite3 *		mDatabase;			//Handler to sqlite object
 	sqlite3_stmt *	mStatement;
+	map<string, sqlite3_stmt*> mCachedStatements;	//Prepared statements by query. Are reused through connection
+
+	string mOpenName;								//File name or URI that is given to sqlite3_open_v2 for each connection
+	int mOpenFlags;									//SQLITE_OPEN_URI if the file is opened as URI
+	string mOpenPragmas;							//PRAGMAs of the connection string options, are run on each connection
+	bool mInMemory;									//Database is read to memory on connect (inmemory=1)
+	size_t mInMemoryMaxBytes;						//Files bigger than it are not read to memory. 0 - no limit
+	vector<unsigned char> mInMemoryImage;			//Database file contents. All connections read it
+	sqlite3 *mInMemoryDatabase;						//Writable connection to the in memory copy. It keeps the copy while the provider is connected
+	vector<PooledConnection *> mIdleConnections;	//Pooled connections that are not used now
+	size_t mPooledConnectionsCount;					//All opened pooled connections
+	std::mutex mPoolMutex;							//Guards the pool
 
 	vector<vector<string> > mRow;
 	
@@ -0,0 +1,163 @@
+#ifndef _SnapshotDataProvider_
+#define _SnapshotDataProvider_
+
+#include <string>
+#include <vector>
+
+#include "CCDB/Providers/DataProvider.h"
+#include "CCDB/Providers/SnapshotFile.h"
+
+using namespace std;
+
+namespace ccdb
+{
+
+/** @brief Read only provider that serves constants from a snapshot file
+ *
+ * The connection string is snapshot://<path to snapshot file>
+ * The file checksum is verified on connect. It can be skipped for big files by
+ * snapshot://<path>?verify=0
+ *
+ * The snapshot is written by SnapshotWriter (or ccdb_snapshot tool) for one variation
+ * and one time, so requests of other variation or time give an error.
+ * Lookups don't run any queries: the type table is found by hash, the run by binary search,
+ * and the data blob is copied from the mapped file.
+ * Typed column arrays are available through GetSnapshotFile().
+ *
+ * Only the functions that are needed to read constants are implemented,
+ * others return error CCDB_ERROR_NOT_IMPLEMENTED
+ */
+class SnapshotDataProvider: public DataProvider
+{
+public:
+	SnapshotDataProvider(void);
+	virtual ~SnapshotDataProvider(void);
+
+	//----------------------------------------------------------------------------------------
+	//	C O N N E C T I O N
+	//----------------------------------------------------------------------------------------
+
+	/** @brief Maps snapshot file
+	 *
+	 * @param connectionString "snapshot://<path to file>" or "snapshot://<path to file>?verify=0"
+	 * @return true if the file is mapped and is valid
+	 */
+	virtual bool Connect(std::string connectionString);
+	virtual bool IsConnected();     ///true if the file is mapped
+	virtual void Disconnect();      ///unmaps the file
+
+	/** @brief Checks connection and reports error if not connected */
+	virtual bool CheckConnection(const string& errorSource="");
+
+	/** @brief Mapped snapshot file. Use it to read typed column arrays */
+	const SnapshotFile& GetSnapshotFile() const { return mFile; }
+
+	//----------------------------------------------------------------------------------------
+	//	D I R E C T O R I E S   A N D   T Y P E   T A B L E S
+	//----------------------------------------------------------------------------------------
+
+	virtual Directory* GetDirectory(const string& path);   ///Only root directory is available
+	virtual bool SearchDirectories(vector<Directory *>& resultDirectories, const string& searchPattern, const string& parentPath="", int take=0, int startWith=0);
+	virtual bool LoadDirectories();
+
+	/** @brief Type table from the snapshot. The table always has columns
+	 *
+	 * @param  [in] path absolute path of the type table
+	 * @return new object of ConstantsTypeTable or NULL if the table is not in the snapshot
+	 */
+	virtual ConstantsTypeTable * GetConstantsTypeTable(const string& path, bool loadColumns=false);
+	virtual ConstantsTypeTable * GetConstantsTypeTable(const string& name, Directory *parentDir, bool loadColumns=false);
+	virtual bool GetConstantsTypeTables(vector<ConstantsTypeTable *>& typeTables, const string& parentDirPath, bool loadColumns=false);
+	virtual vector<ConstantsTypeTable *> GetConstantsTypeTables(Directory *parentDir, bool loadColumns=false);
+	virtual bool GetConstantsTypeTables(vector<ConstantsTypeTable *>& typeTables, Directory *parentDir, bool loadColumns=false);
+
+	/** @brief Searches type tables of the snapshot by name pattern with '*' and '?' */
+	virtual bool SearchConstantsTypeTables(vector<ConstantsTypeTable *>& typeTables, const string& pattern, const string& parentPath = "", bool loadColumns=false, int take=0, int startWith=0 );
+	virtual vector<ConstantsTypeTable *> SearchConstantsTypeTables(const string& pattern, const string& parentPath = "", bool loadColumns=false, int take=0, int startWith=0 );
+	virtual int CountConstantsTypeTables(Directory *dir);
+	virtual bool LoadColumns(ConstantsTypeTable* table);
+
+	//----------------------------------------------------------------------------------------
+	//	R U N   R A N G E S   A N D   V A R I A T I O N S
+	//----------------------------------------------------------------------------------------
+
+	virtual RunRange* GetRunRange(int min, int max, const string& name = "");
+	virtual RunRange* GetRunRange(const string& name);
+	virtual bool GetRunRanges(vector<RunRange *>& resultRunRanges, ConstantsTypeTable *table, const string& variation="", int take=0, int startWith=0 );
+
+	/** @brief Variation of the snapshot. Other variations are not in the snapshot */
+	virtual Variation* GetVariation(const string& name);
+	virtual bool GetVariations(vector<Variation *>& resultVariations, ConstantsTypeTable *table, int run=0, int take=0, int startWith=0 );
+	virtual vector<Variation *> GetVariations(ConstantsTypeTable *table, int run=0, int take=0, int startWith=0 );
+
+	//----------------------------------------------------------------------------------------
+	//	A S S I G N M E N T S
+	//----------------------------------------------------------------------------------------
+
+	/** @brief Assignment with data blob from the snapshot
+	 *
+	 * @param [in] run - run number
+	 * @param [in] path - object path
+	 * @param [in] variation - variation name, must be the snapshot variation
+	 * @param [in] loadColumns - ignored, catalog type tables always have columns
+	 * @return new Assignment object or NULL if no assignment is found or error
+	 */
+	virtual Assignment* GetAssignmentShort(int run, const string& path, const string& variation="default", bool loadColumns=false);
+
+	/** @brief Assignment with data blob from the snapshot
+	 *
+	 * @param [in] time - 0 or the time the snapshot was written for
+	 * @see GetAssignmentShort(int run, const string& path, const string& variation, bool loadColumns)
+	 */
+	virtual Assignment* GetAssignmentShort(int run, const string& path, time_t time, const string& variation="default", bool loadColumns=false);
+
+	/** @brief Resolves request to assignment id by the snapshot run index
+	 *
+	 * @return assignment id or 0 if no assignment is found or error
+	 */
+	virtual dbkey_t GetAssignmentIdShort(int run, const string& path, time_t time, const string& variation="default");
+
+	/** @brief Assignment with data blob from the snapshot by assignment id */
+	virtual Assignment* GetAssignmentShortById(dbkey_t id, const string& path, bool loadColumns=false);
+
+	virtual Assignment* GetAssignmentFull(int run, const string& path, const string& variation="default");
+	virtual Assignment* GetAssignmentFull(int run, const string& path, int version, const string& variation="default");
+	virtual bool GetAssignments(vector<Assignment *> &assingments,const string& path, int runMin, int runMax, const string& runRangeName, const string& variation, time_t beginTime, time_t endTime, int sortBy=0, int take=0, int startWith=0);
+	virtual bool GetAssignments(vector<Assignment *> &assingments,const string& path, int run, const string& variation="", time_t date=0, int take=0, int startWith=0);
+	virtual vector<Assignment *> GetAssignments(const string& path, int run, const string& variation="", time_t date=0, int take=0, int startWith=0);
+	virtual bool GetAssignments(vector<Assignment *> &assingments,const string& path, const string& runName, const string& variation="", time_t date=0, int take=0, int startWith=0);
+	virtual vector<Assignment *> GetAssignments(const string& path, const string& runName, const string& variation="", time_t date=0, int take=0, int startWith=0);
+	virtual bool FillAssignment(Assignment* assignment);
+
+	/** @brief Cells of the assignment from the typed column arrays of the snapshot, the data blob is not parsed
+	 *
+	 * Tables with string or bool columns are not served, their cells are parsed from the blob as before
+	 */
+	virtual bool GetAssignmentValues(const Assignment& assignment, vector<double>& values);
+	virtual bool GetAssignmentValues(const Assignment& assignment, vector<int>& values);
+
+private:
+
+	/** @brief Snapshot table for the request or NULL (with error) if the request can't be served by the snapshot */
+	const SnapshotTable* FindRequestTable(const string& path, time_t time, const string& variation, const char* errorSource);
+
+	/** @brief Creates assignment from the snapshot record */
+	Assignment* MakeAssignment(const SnapshotAssignment* record, const string& path);
+
+	/** @brief Fills values of the assignment from the typed column arrays. @see GetAssignmentValues */
+	template<typename T> bool GetTypedValues(const Assignment& assignment, vector<T>& values);
+
+	/** @brief Reports that function is not available for snapshots */
+	void NotImplemented(const char* errorSource);
+
+	SnapshotFile mFile;             ///mapped snapshot
+	bool mIsConnected;
+	Variation *mVariation;          ///variation of the snapshot, owned by provider
+
+	SnapshotDataProvider(const SnapshotDataProvider& rhs);
+	SnapshotDataProvider& operator=(const SnapshotDataProvider& rhs);
+};
+
+}
+
+#endif //_SnapshotDataProvider_
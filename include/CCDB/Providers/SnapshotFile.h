@@ -0,0 +1,190 @@
+#ifndef _SnapshotFile_
+#define _SnapshotFile_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+namespace ccdb
+{
+
+/** @brief Snapshot file format version that is written and read by this library */
+#define CCDB_SNAPSHOT_VERSION 1
+
+/** @brief Snapshot file signature */
+#define CCDB_SNAPSHOT_MAGIC "CCDBSNAP"
+
+/*
+ * Snapshot is a read only binary file with constants that are already resolved for
+ * a set of runs, one variation and one time. The file is mapped into memory and records
+ * are read in place, no parsing is done on open.
+ *
+ * All records are 8 byte aligned, numbers are little endian, offsets are from the file begin.
+ *
+ * Layout:
+ *      SnapshotHeader
+ *      SnapshotTable[TablesCount]           - sorted by path
+ *      uint32_t[BucketsCount]              - path hash index: open addressing with linear probing,
+ *                                            value is table index + 1, 0 is an empty bucket
+ *      SnapshotColumn[ColumnsCount]         - columns of all tables
+ *      SnapshotRange[RangesCount]           - run intervals of all tables, sorted by RunMin within a table
+ *      SnapshotAssignment[AssignmentsCount]
+ *      strings and data blobs
+ *      typed values: for each assignment ColumnsCount arrays of RowsCount 8 byte values
+ *                    (int64 for integer and bool columns, double for double columns, zeros for strings)
+ *
+ * Hash of path is FNV-1a 64 of path characters.
+ * Checksum is FNV-1a 64 of all bytes after the header taken by 8 byte little endian words
+ * (the tail that is shorter than 8 bytes is taken byte by byte)
+ */
+
+struct SnapshotHeader
+{
+    char     Magic[8];              /// CCDB_SNAPSHOT_MAGIC
+    uint32_t Version;               /// CCDB_SNAPSHOT_VERSION
+    uint32_t ByteOrderMark;         /// 0x01020304 as written by little endian machine
+    uint64_t FileSize;              /// size of the whole file
+    uint64_t Checksum;              /// checksum of everything after the header
+    int64_t  Time;                  /// assignments are resolved for this time. 0 - the latest
+    int64_t  CreatedTime;           /// when the snapshot was written
+    uint64_t VariationOffset;       /// variation name the assignments are resolved for
+    uint32_t VariationLength;
+    uint32_t TablesCount;
+    uint64_t TablesOffset;
+    uint64_t BucketsOffset;
+    uint32_t BucketsCount;          /// power of 2
+    uint32_t ColumnsCount;
+    uint64_t ColumnsOffset;
+    uint64_t RangesOffset;
+    uint32_t RangesCount;
+    uint32_t AssignmentsCount;
+    uint64_t AssignmentsOffset;
+    uint64_t Reserved[4];
+};
+
+
+struct SnapshotTable
+{
+    uint64_t PathHash;              /// FNV-1a 64 of the path
+    uint64_t PathOffset;            /// absolute path of the type table
+    uint32_t PathLength;
+    int32_t  Id;                    /// type table id in source database
+    uint32_t FirstColumn;
+    uint32_t ColumnsCount;
+    uint32_t FirstRange;
+    uint32_t RangesCount;
+    uint32_t RowsCount;             /// number of rows declared by the type table
+    uint32_t Reserved;
+};
+
+
+struct SnapshotColumn
+{
+    uint64_t NameOffset;
+    uint32_t NameLength;
+    uint32_t Type;                  /// ConstantsTypeColumn::ColumnTypes
+};
+
+
+struct SnapshotRange
+{
+    int32_t  RunMin;                /// runs RunMin..RunMax (inclusive) resolve to the assignment
+    int32_t  RunMax;
+    uint32_t Assignment;            /// index of the assignment record
+    uint32_t Reserved;
+};
+
+
+struct SnapshotAssignment
+{
+    int64_t  Id;                    /// assignment id in source database
+    int64_t  CreatedTime;
+    uint64_t BlobOffset;            /// data blob as it is in the database
+    uint64_t BlobLength;
+    uint64_t ValuesOffset;          /// typed values of columns
+    uint32_t RowsCount;
+    int32_t  VariationId;           /// variation of the assignment (might be a parent of the snapshot variation)
+    int32_t  RunRangeMin;           /// run range of the assignment in the database
+    int32_t  RunRangeMax;
+    uint64_t Reserved;
+};
+
+
+/** @brief Read only memory mapped snapshot file
+ *
+ * Open maps the file and checks the header (and optionally the checksum).
+ * Lookups are a hash probe for the path and a binary search of the run.
+ * All returned pointers point into the mapped file and are valid until Close()
+ *
+ * @see SnapshotWriter @see SnapshotDataProvider
+ */
+class SnapshotFile
+{
+public:
+    SnapshotFile();
+    virtual ~SnapshotFile();
+
+    /** @brief Maps the snapshot file
+     *
+     * @param [in]  fileName       - path to the file
+     * @param [in]  verifyChecksum - if true, the whole file is read once to check the checksum
+     * @param [out] error          - the reason if the file can't be opened
+     * @return true if the file is mapped and is a valid snapshot
+     */
+    bool Open(const std::string& fileName, bool verifyChecksum, std::string& error);
+
+    /** @brief Unmaps the file */
+    void Close();
+
+    /** @brief true if a file is mapped */
+    bool IsOpen() const { return mData != NULL; }
+
+    /** @brief Finds type table by its absolute path. NULL if there is no such table */
+    const SnapshotTable* FindTable(const std::string& path) const;
+
+    /** @brief Finds assignment of the table for the run. NULL if the run is not in the snapshot */
+    const SnapshotAssignment* FindAssignment(const SnapshotTable* table, int run) const;
+
+    /** @brief Finds assignment of the table by assignment database id. NULL if there is no such */
+    const SnapshotAssignment* FindAssignmentById(const SnapshotTable* table, int64_t id) const;
+
+    const SnapshotHeader* GetHeader() const { return mHeader; }                        ///File header
+    const SnapshotTable* GetTable(size_t index) const;                                 ///Table by index in [0, GetTablesCount())
+    size_t GetTablesCount() const { return mHeader ? mHeader->TablesCount : 0; }       ///Number of type tables
+    const SnapshotColumn* GetColumn(const SnapshotTable* table, size_t column) const;  ///Column of the table
+    const SnapshotRange* GetRange(const SnapshotTable* table, size_t range) const;     ///Run interval of the table
+
+    std::string GetPath(const SnapshotTable* table) const;                             ///Path of the table
+    std::string GetName(const SnapshotColumn* column) const;                           ///Name of the column
+    std::string GetVariation() const;                                                  ///Variation of the snapshot
+    const char* GetBlob(const SnapshotAssignment* assignment) const;                   ///Data blob, not null terminated
+
+    /** @brief Values of double column or NULL if the column is not double */
+    const double* GetDoubleColumn(const SnapshotTable* table, const SnapshotAssignment* assignment, size_t column) const;
+
+    /** @brief Values of int, uint, long, ulong or bool column or NULL if the column has other type */
+    const int64_t* GetIntColumn(const SnapshotTable* table, const SnapshotAssignment* assignment, size_t column) const;
+
+    /** @brief FNV-1a 64 hash that is used for paths */
+    static uint64_t Hash(const char* data, size_t length);
+
+    /** @brief Checksum of the snapshot data @see SnapshotHeader */
+    static uint64_t Checksum(const char* data, size_t length);
+
+private:
+
+    const char* mData;                  /// mapped file
+    size_t mSize;                       /// mapped size
+    const SnapshotHeader* mHeader;
+    bool mIsMapped;                     /// true if mData is mapped, false if it is read to memory
+
+    const char* GetString(uint64_t offset) const { return mData + offset; }
+    bool CheckLayout(std::string& error) const;   /// Checks that all sections are inside the file
+
+    SnapshotFile(const SnapshotFile& rhs);
+    SnapshotFile& operator=(const SnapshotFile& rhs);
+};
+
+}
+
+#endif //_SnapshotFile_
@@ -0,0 +1,77 @@
+#ifndef _SnapshotWriter_
+#define _SnapshotWriter_
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <time.h>
+
+#include "CCDB/Providers/SnapshotFile.h"
+
+namespace ccdb
+{
+
+class DataProvider;
+
+/** @brief Writes snapshot file with constants resolved by a data provider
+ *
+ * For each type table the writer finds run intervals where the resolved assignment
+ * doesn't change (assignment run ranges are the only places it can change) and
+ * resolves one run of each interval with DataProvider::GetAssignmentIdShort.
+ * So the snapshot gives exactly the same assignments as the database for the runs,
+ * variation and time it was written for.
+ *
+ * @code
+ *      SnapshotWriter writer(provider);
+ *      writer.SetVariation("mc");
+ *      writer.AddRuns(1000, 2000);
+ *      writer.Write("constants.snapshot");
+ * @endcode
+ *
+ * @see SnapshotFile @see SnapshotDataProvider
+ */
+class SnapshotWriter
+{
+public:
+    /** @brief Writer that reads data through connected provider. Provider is not owned */
+    SnapshotWriter(DataProvider* provider);
+    virtual ~SnapshotWriter();
+
+    void SetVariation(const std::string& variation) { mVariation = variation; }  ///Variation to resolve. "default" by default
+    std::string GetVariation() const { return mVariation; }                       ///Variation to resolve
+    void SetTime(time_t time) { mTime = time; }                                   ///Time to resolve. 0 - the latest data
+    time_t GetTime() const { return mTime; }                                      ///Time to resolve
+
+    /** @brief Adds runs min..max (inclusive). If no runs are added, all runs are written */
+    void AddRuns(int min, int max);
+
+    /** @brief Adds type table path. If no tables are added, all type tables are written */
+    void AddTable(const std::string& path);
+
+    /** @brief Resolves all tables and writes the snapshot
+     *
+     * @param [in] fileName - file to write. The file is overwritten
+     * @return true if the file is written. Errors are logged
+     */
+    bool Write(const std::string& fileName);
+
+    size_t GetWrittenTablesCount() const { return mWrittenTables; }              ///Tables in the last written file
+    size_t GetWrittenAssignmentsCount() const { return mWrittenAssignments; }    ///Assignments in the last written file
+
+private:
+
+    DataProvider *mProvider;
+    std::string mVariation;
+    time_t mTime;
+    std::vector<std::pair<int, int> > mRuns;
+    std::vector<std::string> mTables;
+    size_t mWrittenTables;
+    size_t mWrittenAssignments;
+
+    SnapshotWriter(const SnapshotWriter& rhs);
+    SnapshotWriter& operator=(const SnapshotWriter& rhs);
+};
+
+}
+
+#endif //_SnapshotWriter_
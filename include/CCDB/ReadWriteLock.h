@@ -0,0 +1,68 @@
+#ifndef CCDB_READ_WRITE_LOCK_H
+#define CCDB_READ_WRITE_LOCK_H
+
+#ifdef _MSC_VER
+#include "winpthreads.h"
+#else   // GCC?
+#include <pthread.h>
+#endif
+
+namespace ccdb
+{
+
+/** @brief Readers-writer lock. Many readers may hold the lock at the same time
+ *
+ * C++11 has no std::shared_mutex, so it is a thin wrapper of pthread rwlock.
+ * Readers don't wait for each other, they only wait for a writer.
+ * Use ReadLockGuard and WriteLockGuard to lock it
+ */
+class ReadWriteLock
+{
+public:
+    ReadWriteLock() { pthread_rwlock_init(&mLock, NULL); }
+    ~ReadWriteLock() { pthread_rwlock_destroy(&mLock); }
+
+    void ReadLock() { pthread_rwlock_rdlock(&mLock); }    /// Shared lock for readers
+    void WriteLock() { pthread_rwlock_wrlock(&mLock); }   /// Exclusive lock for writers
+    void Unlock() { pthread_rwlock_unlock(&mLock); }      /// Releases shared or exclusive lock
+
+private:
+    pthread_rwlock_t mLock;
+
+    ReadWriteLock(const ReadWriteLock& rhs);
+    ReadWriteLock& operator=(const ReadWriteLock& rhs);
+};
+
+
+/** @brief Holds shared lock of ReadWriteLock while in scope */
+class ReadLockGuard
+{
+public:
+    explicit ReadLockGuard(ReadWriteLock& lock): mLock(lock) { mLock.ReadLock(); }
+    ~ReadLockGuard() { mLock.Unlock(); }
+
+private:
+    ReadWriteLock& mLock;
+
+    ReadLockGuard(const ReadLockGuard& rhs);
+    ReadLockGuard& operator=(const ReadLockGuard& rhs);
+};
+
+
+/** @brief Holds exclusive lock of ReadWriteLock while in scope */
+class WriteLockGuard
+{
+public:
+    explicit WriteLockGuard(ReadWriteLock& lock): mLock(lock) { mLock.WriteLock(); }
+    ~WriteLockGuard() { mLock.Unlock(); }
+
+private:
+    ReadWriteLock& mLock;
+
+    WriteLockGuard(const WriteLockGuard& rhs);
+    WriteLockGuard& operator=(const WriteLockGuard& rhs);
+};
+
+}
+
+#endif //CCDB_READ_WRITE_LOCK_H
@@ -0,0 +1,91 @@
+#ifndef CCDB_RUN_RANGE_INDEX_H
+#define CCDB_RUN_RANGE_INDEX_H
+
+#include <vector>
+#include <map>
+#include <time.h>
+
+#include "CCDB/Globals.h"
+#include "CCDB/Model/Variation.h"
+
+namespace ccdb
+{
+
+/** @brief Assignment of a type table as it is seen by the run range lookup */
+struct RunRangeIndexEntry
+{
+    int RunMin;
+    int RunMax;
+    dbkey_t AssignmentId;
+    dbkey_t VariationId;
+    long long Created;      ///Creation time in the units of the provider. @see DataProvider::GetRunRangeIndexTimeKey
+};
+
+
+/** @brief In memory index of run ranges of one type table
+ *
+ * The index answers the same question as the assignment query:
+ * the newest (the biggest id) assignment of a variation that covers the run and
+ * was created not later than the time limit. Variations of the chain are looked in their order.
+ *
+ * For each variation the run axis is split by the bounds of all ranges to elementary intervals.
+ * Assignments are put to a segment tree over them, so each assignment is in O(log n) nodes.
+ * A node keeps its assignments sorted by creation time with the running maximum of id.
+ * The lookup walks from the leaf of the run to the root: O(log n) nodes, and
+ * with time limit a binary search in each node.
+ *
+ * The index is immutable after it is built, so it is read from many threads without locks
+ */
+class RunRangeIndex
+{
+public:
+
+    /** @brief Builds index of the assignments of the type table
+     *
+     * @param [in] entries - assignments of all variations of the type table
+     */
+    explicit RunRangeIndex(const std::vector<RunRangeIndexEntry>& entries);
+
+    /** @brief Finds the newest assignment of the run
+     *
+     * @param [in] run - run number
+     * @param [in] variations - variation chain [variation, parent, ..., default]
+     * @param [in] hasCreatedLimit - false - no time limit
+     * @param [in] createdLimit - assignments created later than it are skipped
+     * @return assignment id or 0 if no assignment covers the run
+     */
+    dbkey_t Find(int run, const std::vector<Variation *>& variations, bool hasCreatedLimit, long long createdLimit) const;
+
+    size_t GetEntriesCount() const { return mEntriesCount; }
+
+    time_t GetLoadTime() const { return mLoadTime; }
+    void SetLoadTime(time_t time) { mLoadTime = time; }
+
+private:
+
+    /** @brief Segment tree of the run ranges of one variation */
+    class VariationTree
+    {
+    public:
+        void Build(const std::vector<const RunRangeIndexEntry *>& entries);
+        dbkey_t Find(int run, bool hasCreatedLimit, long long createdLimit) const;
+
+    private:
+        struct Node
+        {
+            std::vector<long long> Created;     //creation times in ascending order
+            std::vector<dbkey_t> MaxId;         //MaxId[i] - the biggest id of the assignments up to Created[i]
+        };
+
+        std::vector<long long> mBounds;     //elementary interval i is [mBounds[i], mBounds[i+1])
+        std::vector<Node> mNodes;           //the tree in array, leaves start at mBounds.size() - 1
+    };
+
+    std::map<dbkey_t, VariationTree> mTrees;    //by variation id
+    size_t mEntriesCount;
+    time_t mLoadTime;
+};
+
+}
+
+#endif // CCDB_RUN_RANGE_INDEX_H
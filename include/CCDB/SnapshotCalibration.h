@@ -0,0 +1,86 @@
+#ifndef DSnapshotCalibration_h
+#define DSnapshotCalibration_h
+
+#include <string>
+#include "CCDB/Calibration.h"
+
+using namespace std;
+
+namespace ccdb
+{
+
+/** @brief Calibration that reads constants from snapshot file @see SnapshotDataProvider
+ *
+ * Snapshot has constants for one variation and one time, so the default variation
+ * of the calibration should be the snapshot variation
+ */
+class SnapshotCalibration: public Calibration
+{
+    
+public:
+    /** @brief Ctor takes default run number and default variation
+	 *
+	 *  The default run number and default variation are used when no run or variation
+	 *  is explicitly defined in user request. 
+	 *
+	 * @param defaultRun       [in] Sets default run number
+	 * @param defaultVariation [in] Sets default variation
+	 */
+    SnapshotCalibration(int defaultRun, string defaultVariation="default", time_t defaultTime=0);
+
+	/** @brief Just a default ctor 
+	 */
+	SnapshotCalibration();
+
+	/** @brief    ~DSnapshotCalibration
+	 *
+	 * @return   
+	 */
+	virtual ~SnapshotCalibration();
+
+	/**
+     * @brief Connects to database using connection string
+     *
+     * Connects to database using connection string
+     * the Connection String generally has form:
+     * <type>://<needed information to access data>
+     *
+     * The examples of the Connection Strings are:
+     *
+     * @see MySQLCalibration
+     * mysql://<username>:<password>@<mysql.address>:<port>/<database>
+     *
+     * @see SQLiteCalibration
+     * sqlite://<path to sqlite file>
+     *
+     * @see SnapshotCalibration
+     * snapshot://<path to snapshot file>
+     *
+     * @param connectionString the Connection String
+     * @return true if connected
+     */
+	virtual bool Connect(std::string connectionString);
+
+	/**
+	 * @brief closes connection to data
+	 * Closes connection to data. 
+	 * If underlayed @see DProvider* object is "locked"
+	 * (user could check this by 
+	 * 
+	 */
+	virtual void Disconnect();
+
+	/** @brief indicates ether the connection is open or not
+	 * 
+	 * @return true if  connection is open
+	 */
+	virtual bool IsConnected();
+
+private:
+    SnapshotCalibration(const SnapshotCalibration& rhs);
+    SnapshotCalibration& operator=(const SnapshotCalibration& rhs);
+};
+
+}
+
+#endif // DSnapshotCalibration_h
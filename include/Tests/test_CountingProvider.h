@@ -0,0 +1,92 @@
+// Provider that counts assignment lookups for the tests of Calibration round trips
+#ifndef test_CountingProvider_h__
+#define test_CountingProvider_h__
+
+#include <string>
+#include <vector>
+
+#include "Tests/catch.hpp"
+#include "CCDB/Calibration.h"
+#include "CCDB/AssignmentCache.h"
+#include "CCDB/ConstantsView.h"
+
+namespace ccdb
+{
+
+//provider that counts assignment lookups. Each lookup is one query to the database
+template<class TProvider>
+class test_CountingProvider: public TProvider
+{
+public:
+    int Lookups;
+    int IdLookups;
+    int LookupsById;
+
+    test_CountingProvider(): Lookups(0), IdLookups(0), LookupsById(0) {}
+
+    virtual Assignment* GetAssignmentShort(int run, const string& path, time_t time, const string& variation="default", bool loadColumns=false)
+    {
+        Lookups++;
+        return TProvider::GetAssignmentShort(run, path, time, variation, loadColumns);
+    }
+
+    virtual dbkey_t GetAssignmentIdShort(int run, const string& path, time_t time, const string& variation="default")
+    {
+        IdLookups++;
+        return TProvider::GetAssignmentIdShort(run, path, time, variation);
+    }
+
+    virtual Assignment* GetAssignmentShortById(dbkey_t id, const string& path, bool loadColumns=false)
+    {
+        LookupsById++;
+        return TProvider::GetAssignmentShortById(id, path, loadColumns);
+    }
+
+    int GetQueriesCount() const { return Lookups + IdLookups + LookupsById; }
+};
+
+
+//cold request is one query, runs of the same run range share the data, evicted data is read by id
+template<class TProvider>
+inline void test_CheckCalibrationRoundTrips(Calibration& calib, test_CountingProvider<TProvider>* provider)
+{
+    AssignmentCache *cache = provider->GetAssignmentCache();
+    cache->Clear();
+
+    vector<vector<double> > values;
+    REQUIRE(calib.GetCalib(values, "/test/test_vars/test_table"));
+    REQUIRE(provider->GetQueriesCount() == 1);
+    REQUIRE(provider->Lookups == 1);
+
+    //warm
+    values.clear();
+    REQUIRE(calib.GetCalib(values, "/test/test_vars/test_table"));
+    ConstantsView view;
+    REQUIRE(calib.GetCalib(view, "/test/test_vars/test_table"));
+    REQUIRE(provider->GetQueriesCount() == 1);
+
+    //the other run is resolved by one query and shares the cached data
+    values.clear();
+    REQUIRE(calib.GetCalib(values, "/test/test_vars/test_table:101"));
+    REQUIRE(provider->GetQueriesCount() == 2);
+    REQUIRE(cache->GetCount() == 1);
+
+    //not found is one query too
+    values.clear();
+    REQUIRE_FALSE(calib.GetCalib(values, "/test/test_vars/no_such_table"));
+    REQUIRE(provider->GetQueriesCount() == 3);
+
+    //the index still knows the request, only the data is read
+    calib.SetCacheMaxBytes(0);
+    REQUIRE(cache->GetCount() == 0);
+    values.clear();
+    REQUIRE(calib.GetCalib(values, "/test/test_vars/test_table"));
+    REQUIRE(provider->GetQueriesCount() == 4);
+    REQUIRE(provider->LookupsById == 1);
+    REQUIRE(provider->IdLookups == 0);
+    calib.SetCacheMaxBytes(CCDB_CACHE_DEFAULT_MAX_BYTES);
+}
+
+}
+
+#endif // test_CountingProvider_h__
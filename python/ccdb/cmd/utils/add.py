@@ -63,6 +63,8 @@ class AddData(ConsoleUtilBase):
         self.is_namevalue_format = False
         self.no_comments = False
         self.c_comments = False  # file has '//'-style comments
+        self.binary_vault = False  # store data as binary vault
+        self.vault_codec = None  # compress data by the codec
         self.raw_entry = "/"  # object path with possible pattern, like /mole/*
         self.path = "/"  # parent path
 
@@ -135,7 +137,9 @@ class AddData(ConsoleUtilBase):
                                                 self.run_min,
                                                 self.run_max,
                                                 self.variation,
-                                                self.comment)
+                                                self.comment,
+                                                binary_vault=self.binary_vault,
+                                                vault_codec=self.vault_codec)
         log.info(assignment.request)
         return 0
 
@@ -195,6 +199,14 @@ class AddData(ConsoleUtilBase):
                 if token == "--c-comments":
                     self.c_comments = True
 
+                # binary vault
+                if token == "--binary":
+                    self.binary_vault = True
+
+                # compressed vault
+                if token == "--compress":
+                    self.vault_codec = "zlib"
+
             else:
                 if token.startswith("#"):
                     # everething next are comments
@@ -263,5 +275,7 @@ Additional flags:
           --name-value  - indicates that the input file is in name-value format (column of names and column of values)
     -n or --no-comments - do not add all "#..." comments that is found in file to ccdb database
           --c-comments  - for files that contains '//' - C style comments. The add replaces simply // to #. 
+          --binary      - store numbers in binary form. It is smaller and faster to read, but needs CCDB 1.01+ to read it
+          --compress    - compress data by zlib. Good for big tables, needs CCDB 1.01+ to read it
     
     """)
@@ -3,10 +3,14 @@ from __future__ import print_function
 import collections
 import datetime
 import posixpath
+import re
+import struct
+import sys
+import zlib
 
 from sqlalchemy.ext.declarative import declarative_base
 from sqlalchemy.schema import Column, ForeignKey
-from sqlalchemy.types import Integer, String, Text, DateTime, Enum, Boolean
+from sqlalchemy.types import Integer, String, Text, DateTime, Enum, Boolean, TypeDecorator
 from sqlalchemy.orm import reconstructor, relation
 from sqlalchemy.orm import relationship, backref
 
@@ -19,6 +23,23 @@ blob_delimiter = "|"
 # we have to encode blob_delimiter to blob_delimiter_replace on data write and decode it bach on data read
 blob_delimiter_replacement = "&delimiter;"
 
+# Binary vault keeps columns as typed little endian arrays (see include/CCDB/Helpers/BinaryVault.h)
+# magic, version, flags, rows (uint32), columns (uint32), type code of each column, column arrays
+binary_vault_magic = b"\x1bCVB"
+binary_vault_version = 1
+binary_vault_header_size = 14
+
+# index in the list is the type code that is written to the vault (ConstantsTypeColumn::ColumnTypes)
+binary_vault_column_types = ['int', 'uint', 'long', 'ulong', 'double', 'bool', 'string']
+
+# Any vault may be compressed. Compressed vault has flag 1 and the header:
+# magic, version, flags, codec id (byte), size before compression (uint32), compressed vault
+binary_vault_flag_compressed = 1
+compressed_vault_header_size = 11
+
+# codecs by id: (name, compress function, decompress function). See register_vault_codec
+vault_codecs = {1: ('zlib', zlib.compress, zlib.decompress)}
+
 
 #--------------------------------------------
 # class CcdbSchemaVersion
@@ -131,13 +152,45 @@ class TypeTableColumn(Base):
         return "<TypeTableColumn '{0}'>".format(self.name)
 
 
+# --------------------------------------------
+# class VaultType
+# --------------------------------------------
+class VaultType(TypeDecorator):
+    """
+    Text column of data blob that may also keep binary vaults.
+
+    Binary vaults are bytes (str in python 2). SQLite keeps them as BLOB,
+    MySQL keeps them in latin1 LONGTEXT as they are
+    """
+    impl = Text
+
+    def process_bind_param(self, value, dialect):
+        if dialect.name == 'sqlite' and sys.version_info[0] < 3 and is_binary_blob(value):
+            return buffer(value)
+        return value
+
+    def process_result_value(self, value, dialect):
+        if isinstance(value, (bytearray, memoryview)) or (sys.version_info[0] < 3 and isinstance(value, buffer)):
+            return bytes(value)
+        if sys.version_info[0] >= 3 and isinstance(value, str) and value.startswith(binary_vault_magic.decode('latin1')):
+            return value.encode('latin1')
+        return value
+
+    def compare_values(self, x, y):
+        # text and binary (or compressed) vaults are never equal.
+        # Python 2 warns if unicode text is compared to not decodable bytes
+        if is_binary_blob(x) != is_binary_blob(y):
+            return False
+        return x == y
+
+
 # --------------------------------------------
 # class ConstantSet
 # --------------------------------------------
 class ConstantSet(Base):
     __tablename__ = 'constantSets'
     id = Column(Integer, primary_key=True)
-    _vault = Column('vault', Text)
+    _vault = Column('vault', VaultType)
     created = Column(DateTime, default=datetime.datetime.now)
     modified = Column(DateTime, default=datetime.datetime.now, onupdate=datetime.datetime.now)
     assignment = relationship("Assignment", uselist=False, back_populates="constant_set")
@@ -146,12 +199,29 @@ class ConstantSet(Base):
     @property
     def vault(self):
         """
-        Text-blob with data as it is presented in database
-        :return: string with text-blob from db
+        Text-blob or binary vault with data as it is presented in database
+        :return: string with text-blob from db (bytes if the vault is binary)
         :rtype:  string
         """
         return self._vault
 
+    @property
+    def is_binary(self):
+        """
+        :return: True if the vault is binary (compressed or not)
+        :rtype: bool
+        """
+        vault = decompress_blob(self._vault) if is_compressed_blob(self._vault) else self._vault
+        return is_binary_blob(vault)
+
+    @property
+    def is_compressed(self):
+        """
+        :return: True if the vault is compressed
+        :rtype: bool
+        """
+        return is_compressed_blob(self._vault)
+
     @property
     def data_list(self):
         return blob_to_list(self._vault)
@@ -168,6 +238,21 @@ class ConstantSet(Base):
     def data_table(self, data):
         self.data_list = list(gen_flatten_data(data))
 
+    def encode_vault(self, binary, codec_name=None):
+        """
+        Rewrites the vault as binary vault or as text-blob. The data is not changed
+
+        :param binary: True - encode to binary vault by types of the table columns, False - encode to text-blob
+        :type binary: bool
+        :param codec_name: name of codec to compress the vault by (like 'zlib') or None to keep it not compressed
+        :type codec_name: str
+        """
+        if binary:
+            vault = list_to_binary_blob(self.data_list, [column.type for column in self.type_table.columns])
+        else:
+            vault = list_to_blob(self.data_list)
+        self._vault = compress_blob(vault, codec_name) if codec_name else vault
+
     def __repr__(self):
         return "<ConstantSet '{0}'>".format(self.id)
 
@@ -526,6 +611,12 @@ def blob_to_list(blob):
     >>>blob_to_list("strings|with&delimiter;surprise")
     ["strings", "with|surprise"]
     """
+    if is_compressed_blob(blob):
+        blob = decompress_blob(blob)
+
+    if is_binary_blob(blob):
+        return binary_blob_to_list(blob)
+
     splits = blob.split(blob_delimiter)
     items = []
     for item in splits:
@@ -533,6 +624,257 @@ def blob_to_list(blob):
     return items
 
 
+#--------------------------------------------
+# Checks if blob is a binary vault
+#--------------------------------------------
+def is_binary_blob(blob):
+    """
+    Checks if blob is a binary vault. Compressed vaults are binary too
+
+    :param blob: blob as it is read from database
+    :return: True if blob starts with binary_vault_magic
+    :rtype: bool
+    """
+    return isinstance(blob, bytes) and blob[:len(binary_vault_magic)] == binary_vault_magic
+
+
+#--------------------------------------------
+# Checks if blob is a compressed vault
+#--------------------------------------------
+def is_compressed_blob(blob):
+    """
+    Checks if blob is a compressed vault
+
+    :param blob: blob as it is read from database
+    :return: True if blob is a binary vault with compressed flag
+    :rtype: bool
+    """
+    return is_binary_blob(blob) and len(blob) >= compressed_vault_header_size \
+        and bytearray(blob)[len(binary_vault_magic) + 1] & binary_vault_flag_compressed != 0
+
+
+#--------------------------------------------
+# Adds codec to compress vaults by
+#--------------------------------------------
+def register_vault_codec(codec_id, name, compress, decompress):
+    """
+    Adds codec to compress vaults by. C++ library must have the codec with the same id to read such vaults
+
+    :param codec_id: id that is written to the vault header, 2-255
+    :param name: name of the codec
+    :param compress: function(bytes) -> compressed bytes
+    :param decompress: function(compressed bytes) -> bytes
+    """
+    if codec_id in vault_codecs or not 0 < codec_id < 256:
+        raise ValueError("Vault codec id {0} is taken or is out of range".format(codec_id))
+    vault_codecs[codec_id] = (name, compress, decompress)
+
+
+#--------------------------------------------
+# Compresses text or binary vault
+#--------------------------------------------
+def compress_blob(blob, codec_name="zlib"):
+    """
+    Compresses text-blob or binary vault
+
+    :param blob: text-blob or binary vault
+    :param codec_name: name of registered codec
+    :return: compressed vault
+    :rtype: bytes
+    """
+    codec_ids = [codec_id for codec_id, codec in vault_codecs.items() if codec[0] == codec_name]
+    if not codec_ids:
+        raise ValueError("No vault codec with name '{0}'".format(codec_name))
+    if is_compressed_blob(blob):
+        raise ValueError("Vault is already compressed")
+
+    if not isinstance(blob, bytes):
+        blob = blob.encode('utf-8')
+    compressed = vault_codecs[codec_ids[0]][1](blob)
+    return binary_vault_magic \
+        + struct.pack('<BBBI', binary_vault_version, binary_vault_flag_compressed, codec_ids[0], len(blob)) \
+        + compressed
+
+
+#--------------------------------------------
+# Decompresses compressed vault
+#--------------------------------------------
+def decompress_blob(blob):
+    """
+    Decompresses compressed vault
+
+    :param blob: compressed vault
+    :return: vault as it was before compression. Binary vault is bytes, text-blob is str
+    """
+    if not is_compressed_blob(blob):
+        raise ValueError("Data blob is not a compressed vault")
+    version, flags, codec_id, size = struct.unpack_from('<BBBI', blob, len(binary_vault_magic))
+    if version != binary_vault_version or codec_id not in vault_codecs:
+        raise ValueError("Compressed vault has unknown version {0} or codec id {1}".format(version, codec_id))
+
+    try:
+        result = vault_codecs[codec_id][2](blob[compressed_vault_header_size:])
+    except Exception as ex:
+        raise ValueError("Compressed vault can't be decompressed: {0}".format(ex))
+    if len(result) != size:
+        raise ValueError("Compressed vault has size {0} after decompression but {1} is expected".format(len(result), size))
+
+    if not is_binary_blob(result) and sys.version_info[0] >= 3:
+        result = result.decode('utf-8')
+    return result
+
+
+_binary_vault_formats = {'int': '<i', 'uint': '<I', 'long': '<q', 'ulong': '<Q', 'double': '<d', 'bool': '<B'}
+_binary_vault_int_ranges = {'int': (-2 ** 31, 2 ** 31 - 1), 'uint': (0, 2 ** 32 - 1),
+                            'long': (-2 ** 63, 2 ** 63 - 1), 'ulong': (0, 2 ** 64 - 1)}
+_binary_vault_double_regex = re.compile(r"^[+-]?(\d+\.?\d*|\.\d+)([eE][+-]?\d+)?$")
+
+
+def _binary_vault_cell_bytes(item):
+    """The same text of cell as list_to_blob writes, as bytes"""
+    if not isinstance(item, (bytes, type(u""))):
+        item = repr(item)
+    if not isinstance(item, bytes):
+        item = item.encode('utf-8')
+    return item
+
+
+def _binary_vault_cell_value(cell, column_type):
+    """Value of the cell as column_type or None if the cell is not a canonical value of the type"""
+    text = cell.decode('latin1')
+    if column_type in _binary_vault_int_ranges:
+        try:
+            value = int(text)
+        except ValueError:
+            return None
+        range_min, range_max = _binary_vault_int_ranges[column_type]
+        # not canonical number like '007' is kept as string to be read back as it is
+        return value if str(value) == text and range_min <= value <= range_max else None
+    if column_type == 'double':
+        return float(text) if _binary_vault_double_regex.match(text) else None
+    if column_type == 'bool':
+        return int(text) if text in ('0', '1') else None
+    return None
+
+
+def _binary_vault_double_text(value):
+    """Shortest of %.15g, %.16g, %.17g that is parsed back to the same double (the same as C++ reader)"""
+    for precision in (15, 16):
+        text = "%.*g" % (precision, value)
+        if float(text) == value:
+            return text
+    return "%.17g" % value
+
+
+#--------------------------------------------
+# Get flat data, convert it to binary vault for db insertion
+#--------------------------------------------
+def list_to_binary_blob(data, column_types):
+    """
+    Get flat data, convert it to binary vault for db insertion
+
+    A column is written as its type only if all its cells are values of the type,
+    otherwise it is written as string column, so the text of cells is kept
+
+    :param data: FLATTENED list of values
+    :type data: []
+    :param column_types: types of table columns: 'int', 'uint', 'long', 'ulong', 'double', 'bool' or 'string'
+    :type column_types: []
+    :return: binary vault
+    :rtype: bytes
+
+    >>>blob_to_list(list_to_binary_blob([1, "2.50", "str", 4, 5.0, "x"], ['int', 'double', 'string']))
+    ["1", "2.5", "str", "4", "5", "x"]
+    """
+    col_count = len(column_types)
+    if col_count == 0 or len(data) % col_count != 0:
+        message = "Cannot convert list to binary vault. " \
+                  "The total number of cells ({0}) is not compatible with the number of columns ({1})"\
+            .format(len(data), col_count)
+        raise ValueError(message)
+
+    row_count = len(data) // col_count
+    cells = [_binary_vault_cell_bytes(item) for item in data]
+
+    header = binary_vault_magic + struct.pack('<BBII', binary_vault_version, 0, row_count, col_count)
+    stored_types = []
+    arrays = []
+    for col_index, column_type in enumerate(column_types):
+        column_cells = cells[col_index::col_count]
+        values = None
+        if column_type in _binary_vault_formats:
+            values = [_binary_vault_cell_value(cell, column_type) for cell in column_cells]
+            if None in values:
+                values = None
+
+        if values is None:
+            stored_types.append(binary_vault_column_types.index('string'))
+            arrays.extend(struct.pack('<I', len(cell)) + cell for cell in column_cells)
+        else:
+            stored_types.append(binary_vault_column_types.index(column_type))
+            arrays.append(struct.pack('<' + _binary_vault_formats[column_type][1] * row_count, *values))
+
+    return header + struct.pack('<' + 'B' * col_count, *stored_types) + b"".join(arrays)
+
+
+#--------------------------------------------
+# Get binary vault and convert it to list
+#--------------------------------------------
+def binary_blob_to_list(blob):
+    """
+    Get binary vault and convert it to list of cells as they would be in text-blob.
+    Numbers are written in canonical form (double '1.50' is read as '1.5')
+
+    :param blob: binary vault
+    :type blob: bytes
+    :return: flat list of cells
+    :rtype: []
+    """
+    def fail():
+        raise ValueError("Data blob is not a valid binary vault of version {0}".format(binary_vault_version))
+
+    if len(blob) < binary_vault_header_size or not is_binary_blob(blob):
+        fail()
+    version, flags, row_count, col_count = struct.unpack_from('<BBII', blob, len(binary_vault_magic))
+    if version != binary_vault_version or flags != 0 or col_count > len(blob) - binary_vault_header_size:
+        fail()
+
+    type_codes = struct.unpack_from('<' + 'B' * col_count, blob, binary_vault_header_size)
+    offset = binary_vault_header_size + col_count
+    columns = []
+    for type_code in type_codes:
+        if type_code >= len(binary_vault_column_types):
+            fail()
+        column_type = binary_vault_column_types[type_code]
+
+        if column_type == 'string':
+            column = []
+            for _ in range(row_count):
+                if len(blob) - offset < 4:
+                    fail()
+                length, = struct.unpack_from('<I', blob, offset)
+                offset += 4
+                if length > len(blob) - offset:
+                    fail()
+                cell = blob[offset:offset + length]
+                column.append(cell if sys.version_info[0] < 3 else cell.decode('utf-8', 'replace'))
+                offset += length
+        else:
+            fmt = '<' + _binary_vault_formats[column_type][1] * row_count
+            if struct.calcsize(fmt) > len(blob) - offset:
+                fail()
+            values = struct.unpack_from(fmt, blob, offset)
+            offset += struct.calcsize(fmt)
+            to_text = _binary_vault_double_text if column_type == 'double' else str
+            column = [to_text(value) for value in values]
+        columns.append(column)
+
+    if offset != len(blob):
+        fail()
+
+    return [columns[col_index][row_index] for row_index in range(row_count) for col_index in range(col_count)]
+
+
 #--------------------------------------------
 # Converts flat array to tabled array
 #--------------------------------------------
@@ -1165,7 +1165,8 @@ class AlchemyProvider(object):
     # ------------------------------------------------
     # Creates Assignment
     # ------------------------------------------------
-    def create_assignment(self, data, path, min_run, max_run, variation_name, comment):
+    def create_assignment(self, data, path, min_run, max_run, variation_name, comment, binary_vault=False,
+                          vault_codec=None):
         """
         Validation:
         If no such run range found, the new will be created (with no name)
@@ -1180,6 +1181,8 @@ class AlchemyProvider(object):
         @param max_run:
         @param variation_name:
         @param comment:
+        @param binary_vault: store data as binary vault (see model.list_to_binary_blob)
+        @param vault_codec: name of codec to compress the data by, like 'zlib' (see model.compress_blob)
         @return: created assignment
         @rtype: Assignment
         """
@@ -1239,6 +1242,8 @@ class AlchemyProvider(object):
             assignment.variation = variation
             assignment.variation_id = variation.id
             assignment.constant_set.data_table = rows
+            if binary_vault or vault_codec:
+                assignment.constant_set.encode_vault(binary=binary_vault, codec_name=vault_codec)
             assignment.comment = comment
             assignment.author_id = user.id
             self.session.add(assignment)
@@ -0,0 +1,114 @@
+# script rewrites data of all constant sets in place as binary vaults or back as text-blobs
+#
+# Binary vault (CCDB 1.01) keeps numbers of columns as typed arrays. Numeric tables are several times smaller
+# and are read without parsing. Any vault may also be compressed by zlib. Old CCDB versions can't read binary
+# or compressed vaults, convert them back with --text
+#
+# usage: python convert_vaults.py <connection string> [--text] [--compress] [--min-size=N] [--dry-run]
+#     --text       - convert binary vaults back to text-blobs
+#     --compress   - compress vaults that are N bytes or bigger. Without the flag compressed vaults are decompressed
+#     --min-size=N - size of the smallest vault to compress, 4096 by default
+#     --dry-run    - only print how much would be converted
+#
+# A constant set is converted to binary or compressed only if it becomes smaller
+
+
+#DEFAULT connection string
+connection_string = "mysql://ccdb_user@localhost/ccdb"
+
+#-----------------------------------------------------------------------------------------------------------------------
+#Next is the script
+
+import sys
+import ccdb.provider
+from ccdb.model import ConstantSet, is_binary_blob, list_to_binary_blob, list_to_blob, compress_blob
+
+if __name__ == "__main__":
+
+    args = sys.argv[1:]
+    to_binary = "--text" not in args
+    codec_name = "zlib" if "--compress" in args else None
+    dry_run = "--dry-run" in args
+    min_size = 4096
+    for arg in args:
+        if arg.startswith("--min-size="):
+            min_size = int(arg[len("--min-size="):])
+    args = [arg for arg in args if not arg.startswith("--")]
+    if args:
+        connection_string = args[0]
+
+    #create ccdb provider
+    provider = ccdb.provider.AlchemyProvider()
+
+    #connecting
+    try:
+        provider.connect(connection_string)
+        print("Connected to database")
+    except Exception as ex:
+        print("ERROR> CCDB provider unable to connect to {0}. Aborting. Exception details: {1}"
+              "".format(connection_string, ex))
+        exit()
+
+    converted_count = 0
+    kept_count = 0
+    failed_count = 0
+    size_before = 0
+    size_after = 0
+
+    #constant sets are changed in batches, so the whole database is not kept in memory
+    batch_size = 1000
+    last_id = 0
+    while True:
+        constant_sets = provider.session.query(ConstantSet)\
+            .filter(ConstantSet.id > last_id)\
+            .order_by(ConstantSet.id)\
+            .limit(batch_size).all()
+        if not constant_sets:
+            break
+        last_id = constant_sets[-1].id
+
+        for constant_set in constant_sets:
+            vault = constant_set.vault
+            if vault is None:
+                continue
+
+            try:
+                new_vault = list_to_blob(constant_set.data_list) if is_binary_blob(vault) else vault
+                if to_binary:
+                    column_types = [column.type for column in constant_set.type_table.columns]
+                    binary_vault = list_to_binary_blob(constant_set.data_list, column_types)
+
+                    #binary vault of mostly string data may be bigger than the text
+                    if len(binary_vault) < len(new_vault):
+                        new_vault = binary_vault
+
+                if codec_name and len(new_vault) >= min_size:
+                    compressed_vault = compress_blob(new_vault, codec_name)
+                    if len(compressed_vault) < len(new_vault):
+                        new_vault = compressed_vault
+            except ValueError as ex:
+                print("Constant set {0} is not converted: {1}".format(constant_set.id, ex))
+                failed_count += 1
+                continue
+
+            #text and binary vaults are compared only to the same kind (python 2 warns about unicode vs bytes)
+            if is_binary_blob(new_vault) == is_binary_blob(vault) and new_vault == vault:
+                kept_count += 1
+                continue
+
+            constant_set._vault = new_vault
+            converted_count += 1
+            size_before += len(vault)
+            size_after += len(new_vault)
+
+        if dry_run:
+            provider.session.rollback()
+        else:
+            provider.session.commit()
+        provider.session.expunge_all()
+
+    print("{0} {1} constant sets to {2}{3}, {4} are kept as they are, {5} failed. "
+          "Size of converted data: {6} -> {7} bytes"
+          "".format("Would convert" if dry_run else "Converted", converted_count,
+                    "binary" if to_binary else "text", " compressed" if codec_name else "",
+                    kept_count, failed_count, size_before, size_after))
@@ -347,6 +347,41 @@ class AlchemyProviderTest(unittest.TestCase):
 
         self.provider.delete_assignment(assignment)
 
+    def test_create_binary_assignment(self):
+        """Test of assignment that is stored as binary vault"""
+        self.provider.connect(self.connection_str)   # this test requires the connection
+
+        assignment = self.provider.create_assignment([[0, 1.5, "2"], [3, 4, 5e-10]], "/test/test_vars/test_table", 0, 1000,
+                                                     "default", "Test binary assignment", binary_vault=True)
+        self.assertTrue(assignment.constant_set.is_binary)
+        assignment_id = assignment.id
+
+        # read it back from the database
+        self.provider.session.expire_all()
+        assignment = self.provider.get_assignment_by_id(assignment_id)
+        self.assertTrue(assignment.constant_set.is_binary)
+        self.assertEqual(assignment.constant_set.data_table, [["0", "1.5", "2"], ["3", "4", "5e-10"]])
+
+        self.provider.delete_assignment(assignment)
+
+    def test_create_compressed_assignment(self):
+        """Test of assignment that is stored compressed"""
+        self.provider.connect(self.connection_str)   # this test requires the connection
+
+        assignment = self.provider.create_assignment([[0, 1.5, "2"], [3, 4, 5e-10]], "/test/test_vars/test_table", 0, 1000,
+                                                     "default", "Test compressed assignment", vault_codec="zlib")
+        self.assertTrue(assignment.constant_set.is_compressed)
+        self.assertFalse(assignment.constant_set.is_binary)
+        assignment_id = assignment.id
+
+        # read it back from the database
+        self.provider.session.expire_all()
+        assignment = self.provider.get_assignment_by_id(assignment_id)
+        self.assertTrue(assignment.constant_set.is_compressed)
+        self.assertEqual(assignment.constant_set.data_table, [["0", "1.5", "2"], ["3", "4", "5e-10"]])
+
+        self.provider.delete_assignment(assignment)
+
     def test_users(self):
         """Test users"""
         self.provider.connect(self.connection_str)   # this test requires the connection
@@ -0,0 +1,83 @@
+import struct
+import unittest
+
+from ccdb.model import list_to_blob, blob_to_list, list_to_binary_blob, binary_blob_to_list, is_binary_blob, \
+    is_compressed_blob, compress_blob, decompress_blob
+
+
+class BinaryVaultTest(unittest.TestCase):
+
+    def test_round_trip(self):
+        """Cells are read back as they are written"""
+        data = ["1.5", "-7", "4294967295", "-9000000000", "18446744073709551615", "1", "text",
+                "0.1", "0", "0", "9000000000", "0", "0", "with|pipe"]
+        types = ['double', 'int', 'uint', 'long', 'ulong', 'bool', 'string']
+
+        blob = list_to_binary_blob(data, types)
+        self.assertTrue(is_binary_blob(blob))
+        self.assertFalse(is_binary_blob(list_to_blob(data)))
+        self.assertEqual(binary_blob_to_list(blob), data)
+        self.assertEqual(blob_to_list(blob), data)
+
+        # numeric columns are stored as their types
+        type_codes = struct.unpack_from('<7B', blob, 14)
+        self.assertEqual(list(type_codes), [4, 0, 1, 2, 3, 5, 6])
+
+    def test_numbers_shrink(self):
+        """Doubles take 8 bytes"""
+        data = [repr(1.0 / (i + 3)) for i in range(300)]
+        blob = list_to_binary_blob(data, ['double'] * 3)
+        self.assertEqual(len(blob), 14 + 3 + 300 * 8)
+        self.assertTrue(len(blob) * 2 < len(list_to_blob(data)))
+        self.assertEqual(blob_to_list(blob), data)
+
+    def test_fallback_to_string(self):
+        """Column with not canonical values is stored as string column"""
+        data = [1, "007", "1.50", 2, "8", "nan?"]
+        blob = list_to_binary_blob(data, ['int', 'int', 'double'])
+        type_codes = struct.unpack_from('<3B', blob, 14)
+        self.assertEqual(list(type_codes), [0, 6, 6])
+        self.assertEqual(blob_to_list(blob), ["1", "007", "1.50", "2", "8", "nan?"])
+
+        # doubles are read back in canonical form, as C++ reads them
+        blob = list_to_binary_blob(["1.50", "1e-5", 2.0], ['double'])
+        self.assertEqual(blob_to_list(blob), ["1.5", "1e-05", "2"])
+
+    def test_broken_vault(self):
+        """Truncated vault is not read"""
+        blob = list_to_binary_blob(["1", "2"], ['int', 'int'])
+        for size in range(len(blob)):
+            if is_binary_blob(blob[:size]):
+                self.assertRaises(ValueError, binary_blob_to_list, blob[:size])
+        self.assertRaises(ValueError, binary_blob_to_list, blob + b"x")
+        self.assertRaises(ValueError, list_to_binary_blob, ["1", "2", "3"], ['int', 'int'])
+
+    def test_compression(self):
+        """Text and binary vaults are read back after compression"""
+        data = [repr(0.5 + (i % 10)) for i in range(3000)]
+        text_blob = list_to_blob(data)
+        binary_blob = list_to_binary_blob(data, ['double'] * 3)
+
+        for blob in [text_blob, binary_blob]:
+            compressed = compress_blob(blob)
+            self.assertTrue(is_compressed_blob(compressed))
+            self.assertFalse(is_compressed_blob(blob))
+            self.assertTrue(len(compressed) * 5 < len(blob))
+            self.assertEqual(decompress_blob(compressed), blob)
+            self.assertEqual(blob_to_list(compressed), data)
+            self.assertRaises(ValueError, compress_blob, compressed)
+
+        # header: magic, version, flags, codec id, size before compression
+        compressed = compress_blob(text_blob)
+        self.assertEqual(struct.unpack_from('<BBBI', compressed, 4), (1, 1, 1, len(text_blob)))
+
+        self.assertEqual(blob_to_list(compress_blob("")), [""])
+        self.assertRaises(ValueError, compress_blob, text_blob, "no_such_codec")
+
+    def test_broken_compressed_vault(self):
+        """Broken or unknown compressed vault is not read"""
+        compressed = compress_blob(list_to_blob(["1", "2", "3"]))
+        self.assertRaises(ValueError, decompress_blob, compressed[:-2])
+        self.assertRaises(ValueError, decompress_blob, compressed[:7] + b"\x07" + compressed[8:])
+        self.assertRaises(ValueError, decompress_blob, compressed[:8] + struct.pack('<I', 100) + compressed[12:])
+        self.assertRaises(ValueError, binary_blob_to_list, compressed)
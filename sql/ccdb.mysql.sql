@@ -135,6 +135,7 @@ CREATE TABLE IF NOT EXISTS `ccdb`.`assignments` (
   `runRangeId` INT NULL,
   `eventRangeId` INT NULL,
   `constantSetId` INT NOT NULL,
+  `constantTypeId` INT NULL,
   `authorId` INT NOT NULL DEFAULT 1,
   `comment` TEXT NULL,
   PRIMARY KEY (`id`),
@@ -143,9 +144,19 @@ CREATE TABLE IF NOT EXISTS `ccdb`.`assignments` (
   INDEX `fk_assignments_constantSets1_idx` (`constantSetId` ASC),
   INDEX `fk_assignments_eventRanges1_idx` (`eventRangeId` ASC),
   UNIQUE INDEX `id_UNIQUE` (`id` ASC),
-  INDEX `date_sort_index` USING BTREE (`created` DESC))
+  INDEX `date_sort_index` USING BTREE (`created` DESC),
+  INDEX `type_variation_runrange_idx` (`constantTypeId` ASC, `variationId` ASC, `runRangeId` ASC, `id` ASC))
 ENGINE = MyISAM;
 
+-- constantTypeId is a copy of constantSets.constantTypeId, it is kept by the triggers
+DROP TRIGGER IF EXISTS `ccdb`.`assignments_type_on_insert`;
+CREATE TRIGGER `ccdb`.`assignments_type_on_insert` BEFORE INSERT ON `ccdb`.`assignments` FOR EACH ROW
+  SET NEW.`constantTypeId` = (SELECT `constantTypeId` FROM `ccdb`.`constantSets` WHERE `id` = NEW.`constantSetId`);
+
+DROP TRIGGER IF EXISTS `ccdb`.`assignments_type_on_update`;
+CREATE TRIGGER `ccdb`.`assignments_type_on_update` BEFORE UPDATE ON `ccdb`.`assignments` FOR EACH ROW
+  SET NEW.`constantTypeId` = (SELECT `constantTypeId` FROM `ccdb`.`constantSets` WHERE `id` = NEW.`constantSetId`);
+
 
 -- -----------------------------------------------------
 -- Table `ccdb`.`columns`
@@ -374,7 +385,7 @@ COMMIT;
 -- -----------------------------------------------------
 START TRANSACTION;
 USE `ccdb`;
-INSERT INTO `ccdb`.`schemaVersions` (`id`, `schemaVersion`) VALUES (1, 4);
+INSERT INTO `ccdb`.`schemaVersions` (`id`, `schemaVersion`) VALUES (1, 5);
 
 COMMIT;
 
@@ -0,0 +1,43 @@
+-- Assignment lookup of a type table, variation chain and run before and after
+-- update_1.00_1.01 (schema version 5). Run with EXPLAIN to compare the plans
+
+-- schema version 4: the type table filter is on constantSets, so constantSets is scanned first
+EXPLAIN
+SELECT  `assignments`.`id` AS `asId`,
+        `constantSets`.`vault` AS `blob`
+        FROM  `assignments`
+        INNER JOIN `runRanges` ON `assignments`.`runRangeId`= `runRanges`.`id`
+        INNER JOIN `constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id`
+        WHERE  `constantSets`.`constantTypeId` = 1
+        AND `runRanges`.`runMin` <= 100
+        AND `runRanges`.`runMax` >= 100
+        AND `assignments`.`variationId` IN (4, 3, 1)
+        ORDER BY CASE `assignments`.`variationId` WHEN 4 THEN 0 WHEN 3 THEN 1 WHEN 1 THEN 2 END, `assignments`.`id` DESC
+        LIMIT 1 ;
+
+-- schema version 5: candidates come from type_variation_runrange_idx,
+-- constantSets is read only for the selected blob
+EXPLAIN
+SELECT  `assignments`.`id` AS `asId`,
+        `constantSets`.`vault` AS `blob`
+        FROM  `assignments`
+        INNER JOIN `runRanges` ON `assignments`.`runRangeId`= `runRanges`.`id`
+        INNER JOIN `constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id`
+        WHERE  `assignments`.`constantTypeId` = 1
+        AND `runRanges`.`runMin` <= 100
+        AND `runRanges`.`runMax` >= 100
+        AND `assignments`.`variationId` IN (4, 3, 1)
+        ORDER BY CASE `assignments`.`variationId` WHEN 4 THEN 0 WHEN 3 THEN 1 WHEN 1 THEN 2 END, `assignments`.`id` DESC
+        LIMIT 1 ;
+
+-- schema version 5, id only (GetAssignmentIdShort): the index covers the assignments part
+EXPLAIN
+SELECT  `assignments`.`id` AS `asId`
+        FROM  `assignments`
+        INNER JOIN `runRanges` ON `assignments`.`runRangeId`= `runRanges`.`id`
+        WHERE  `assignments`.`constantTypeId` = 1
+        AND `runRanges`.`runMin` <= 100
+        AND `runRanges`.`runMax` >= 100
+        AND `assignments`.`variationId` IN (4, 3, 1)
+        ORDER BY CASE `assignments`.`variationId` WHEN 4 THEN 0 WHEN 3 THEN 1 WHEN 1 THEN 2 END, `assignments`.`id` DESC
+        LIMIT 1 ;
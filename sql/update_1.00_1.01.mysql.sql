@@ -0,0 +1,14 @@
+-- Assignments keep constantTypeId of their constant set, so the lookup by type table, variation
+-- and run doesn't join constantSets to filter. The column is kept by the triggers
+ALTER TABLE `ccdb`.`assignments` ADD COLUMN `constantTypeId` INT NULL  AFTER `constantSetId`;
+UPDATE `ccdb`.`assignments` INNER JOIN `ccdb`.`constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id` SET `assignments`.`constantTypeId` = `constantSets`.`constantTypeId`;
+ALTER TABLE `ccdb`.`assignments` ADD INDEX `type_variation_runrange_idx` (`constantTypeId` ASC, `variationId` ASC, `runRangeId` ASC, `id` ASC);
+
+DROP TRIGGER IF EXISTS `ccdb`.`assignments_type_on_insert`;
+CREATE TRIGGER `ccdb`.`assignments_type_on_insert` BEFORE INSERT ON `ccdb`.`assignments` FOR EACH ROW
+  SET NEW.`constantTypeId` = (SELECT `constantTypeId` FROM `ccdb`.`constantSets` WHERE `id` = NEW.`constantSetId`);
+DROP TRIGGER IF EXISTS `ccdb`.`assignments_type_on_update`;
+CREATE TRIGGER `ccdb`.`assignments_type_on_update` BEFORE UPDATE ON `ccdb`.`assignments` FOR EACH ROW
+  SET NEW.`constantTypeId` = (SELECT `constantTypeId` FROM `ccdb`.`constantSets` WHERE `id` = NEW.`constantSetId`);
+
+UPDATE schemaVersions SET schemaVersion=5 WHERE id=1;
@@ -0,0 +1,18 @@
+-- Assignments keep constantTypeId of their constant set, so the lookup by type table, variation
+-- and run doesn't join constantSets to filter. The column is kept by the triggers
+ALTER TABLE assignments ADD COLUMN constantTypeId integer DEFAULT NULL;
+UPDATE assignments SET constantTypeId = (SELECT constantTypeId FROM constantSets WHERE constantSets.id = assignments.constantSetId);
+CREATE INDEX assignments_type_variation_runrange_idx ON assignments (constantTypeId, variationId, runRangeId, id);
+
+DROP TRIGGER IF EXISTS assignments_type_on_insert;
+CREATE TRIGGER assignments_type_on_insert AFTER INSERT ON assignments FOR EACH ROW
+BEGIN
+  UPDATE assignments SET constantTypeId = (SELECT constantTypeId FROM constantSets WHERE id = NEW.constantSetId) WHERE id = NEW.id;
+END;
+DROP TRIGGER IF EXISTS assignments_type_on_update;
+CREATE TRIGGER assignments_type_on_update AFTER UPDATE OF constantSetId ON assignments FOR EACH ROW
+BEGIN
+  UPDATE assignments SET constantTypeId = (SELECT constantTypeId FROM constantSets WHERE id = NEW.constantSetId) WHERE id = NEW.id;
+END;
+
+UPDATE schemaVersions SET schemaVersion=5 WHERE id=1;
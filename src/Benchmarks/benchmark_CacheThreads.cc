@@ -0,0 +1,112 @@
+#include "Benchmarks/benchmarks.h"
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <vector>
+
+#include "CCDB/Console.h"
+#include "CCDB/SQLiteCalibration.h"
+#include "CCDB/Helpers/StopWatch.h"
+
+using namespace std;
+using namespace ccdb;
+
+static const char * benchmark_CacheThreads_Paths[] = {"/test/test_vars/test_table", "/test/test_vars/test_table2::test"};
+
+//______________________________________________________________________________
+static void benchmark_CacheThreads_Hits(Calibration *calib, int iterations, mutex *serializeMutex, atomic<size_t> *failed)
+{
+    for(int i = 0; i < iterations; i++)
+    {
+        const char *path = benchmark_CacheThreads_Paths[i % 2];
+        shared_ptr<Assignment> assignment;
+        if(serializeMutex)
+        {
+            lock_guard<mutex> lock(*serializeMutex);
+            assignment = calib->GetAssignmentShared(path, false);
+        }
+        else
+        {
+            assignment = calib->GetAssignmentShared(path, false);
+        }
+        if(!assignment) (*failed)++;
+    }
+}
+
+
+//______________________________________________________________________________
+static void benchmark_CacheThreads_Misses(Calibration *calib, atomic<bool> *stop, atomic<int> *run, atomic<size_t> *misses)
+{
+    //each new run is a new request, so it is resolved by a query
+    while(!*stop)
+    {
+        calib->GetAssignmentShared(string(benchmark_CacheThreads_Paths[0]) + ":" + to_string((long long)(*run)++), false);
+        (*misses)++;
+    }
+}
+
+
+//______________________________________________________________________________
+static double benchmark_CacheThreads_Run(Calibration *calib, int threadsCount, int iterations, mutex *serializeMutex, bool withMisses, atomic<size_t> *failed)
+{
+    static atomic<int> run(100000);
+    atomic<bool> stop(false);
+    atomic<size_t> misses(0);
+    thread missThread;
+    if(withMisses) missThread = thread(benchmark_CacheThreads_Misses, calib, &stop, &run, &misses);
+
+    StopWatch stopwatch;
+    vector<thread> threads;
+    for(int i = 0; i < threadsCount; i++)
+    {
+        threads.push_back(thread(benchmark_CacheThreads_Hits, calib, iterations, serializeMutex, failed));
+    }
+    for(size_t i = 0; i < threads.size(); i++) threads[i].join();
+    double seconds = stopwatch.ElapsedUs() / 1000000.0;
+
+    stop = true;
+    if(withMisses) missThread.join();
+
+    return seconds > 0 ? (double)threadsCount * iterations / seconds : 0;
+}
+
+
+/** *********************************************************************
+ * @brief Benchmark of cache hits from many threads
+ *
+ * Threads share one Calibration and request the same cached tables, as event processing threads do.
+ * The number of hits per second is measured from 1 to 64 threads:
+ *  - with each request serialized by one mutex (as it was when the cache had one mutex)
+ *  - with the sharded cache
+ *  - with the sharded cache while one more thread runs cache misses (queries) all the time
+ *
+ * @return true if benchmark passed
+ */
+bool benchmark_CacheThreads()
+{
+    const int iterations = 100000;
+
+    SQLiteCalibration calib(100);
+    calib.EnableCache(true);
+    if(!calib.Connect(BENCHMARKS_SQLITE_STRING)) return false;
+
+    //warm the cache
+    atomic<size_t> failed(0);
+    benchmark_CacheThreads_Hits(&calib, 2, NULL, &failed);
+
+    gConsole.WriteLine(Console::cBrightBlue, "\n[ Cache hits per second from many threads ]");
+    gConsole.WriteLine(" %8s %16s %16s %16s", "threads", "one mutex", "sharded", "with misses");
+
+    mutex serializeMutex;
+    for(int threadsCount = 1; threadsCount <= 64; threadsCount *= 2)
+    {
+        int threadIterations = iterations / threadsCount;
+        double serialized = benchmark_CacheThreads_Run(&calib, threadsCount, threadIterations, &serializeMutex, false, &failed);
+        double sharded = benchmark_CacheThreads_Run(&calib, threadsCount, threadIterations, NULL, false, &failed);
+        double withMisses = benchmark_CacheThreads_Run(&calib, threadsCount, threadIterations, NULL, true, &failed);
+        gConsole.WriteLine(Console::cGreen, " %8d %16.0f %16.0f %16.0f", threadsCount, serialized, sharded, withMisses);
+    }
+
+    return failed == 0;
+}
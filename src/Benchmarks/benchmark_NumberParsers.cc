@@ -0,0 +1,77 @@
+#include "Benchmarks/benchmarks.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "CCDB/Console.h"
+#include "CCDB/Model/Assignment.h"
+#include "CCDB/Helpers/NumberParsers.h"
+#include "CCDB/Helpers/StringUtils.h"
+#include "CCDB/Helpers/StopWatch.h"
+
+using namespace std;
+using namespace ccdb;
+
+/** *********************************************************************
+ * @brief Benchmark of numbers conversion of calibration cells
+ *
+ * Compares the path GetCalib(vector<vector<double> >) had before: cells are copied to strings
+ * and each string is converted with atof, to the bulk NumberParsers::ParseDoubles
+ * that converts cell views of the assignment into a contiguous array
+ *
+ * @return true if benchmark passed
+ */
+bool benchmark_NumberParsers()
+{
+    const int iterations = 200;
+    const int cellsCount = 10000;
+
+    //typical calibration values: short fixed point decimals, some with exponent
+    string blob;
+    char cell[64];
+    for (int i=0; i<cellsCount; i++)
+    {
+        if(i % 10 == 0) sprintf(cell, "%.4e|", (i + 1) * 0.001234);
+        else            sprintf(cell, "%.6f|", (i - cellsCount / 2) * 0.0137);
+        blob += cell;
+    }
+    blob.erase(blob.size() - 1);
+
+    Assignment assignment(NULL, NULL);
+    assignment.SetRawData(blob);
+
+    BENCHMARK_INIT();
+
+    //strings + atof
+    double atofSum = 0;
+    BENCHMARK_START("Cells to strings and atof (StringUtils::ParseDouble before)");
+    for (int i=0; i<iterations; i++)
+    {
+        vector<string> cells = assignment.GetVectorData();
+        vector<double> values(cells.size());
+        for (size_t cellIter=0; cellIter<cells.size(); cellIter++) values[cellIter] = atof(cells[cellIter].c_str());
+        atofSum += values[i % values.size()];
+    }
+    double atofTime = stopwatch.ElapsedUs();
+    BENCHMARK_FINISH("200 x 10000 cells in ");
+
+    //bulk conversion
+    double bulkSum = 0;
+    size_t failedCount = 0;
+    BENCHMARK_START("Cell views and NumberParsers::ParseDoubles");
+    for (int i=0; i<iterations; i++)
+    {
+        vector<CharSpan> spans;
+        assignment.GetCellSpans(spans);
+        vector<double> values(spans.size());
+        failedCount += NumberParsers::ParseDoubles(&spans[0], spans.size(), &values[0]);
+        bulkSum += values[i % values.size()];
+    }
+    double bulkTime = stopwatch.ElapsedUs();
+    BENCHMARK_FINISH("200 x 10000 cells in ");
+
+    gConsole.WriteLine(Console::cBrightWhite, " Bulk conversion speed-up: %.2fx", bulkTime > 0 ? atofTime/bulkTime : 0.0);
+
+    return failedCount == 0 && atofSum == bulkSum;
+}
@@ -0,0 +1,116 @@
+#include "Benchmarks/benchmarks.h"
+
+#include <sqlite3.h>
+
+#include "CCDB/Console.h"
+#include "CCDB/Providers/SQLiteDataProvider.h"
+#include "CCDB/Model/Assignment.h"
+#include "CCDB/Model/ConstantsTypeTable.h"
+#include "CCDB/Model/Variation.h"
+#include "CCDB/Helpers/StopWatch.h"
+
+using namespace std;
+using namespace ccdb;
+
+static const char * benchmark_SQLiteStatements_Query =
+    "SELECT `assignments`.`id` AS `asId`, "
+    "`constantSets`.`vault` AS `blob` "
+    "FROM  `assignments` "
+    "INNER JOIN `runRanges` ON `assignments`.`runRangeId`= `runRanges`.`id` "
+    "INNER JOIN `constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id` "
+    "INNER JOIN `typeTables` ON `constantSets`.`constantTypeId` = `typeTables`.`id` "
+    "WHERE  `runRanges`.`runMin` <= ?1 "
+    "AND `runRanges`.`runMax` >= ?1 "
+    "AND `assignments`.`variationId`= ?2 "
+    "AND  `constantSets`.`constantTypeId` =?3 "
+    "ORDER BY `assignments`.`id` DESC "
+    "LIMIT 1 ";
+
+//______________________________________________________________________________
+static void benchmark_SQLiteStatements_Step(sqlite3_stmt *stmt, int run, int variationId, int tableId)
+{
+    sqlite3_bind_int(stmt, 1, run);
+    sqlite3_bind_int(stmt, 2, variationId);
+    sqlite3_bind_int(stmt, 3, tableId);
+    while(sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        sqlite3_column_text(stmt, 1);
+    }
+}
+
+
+/** *********************************************************************
+ * @brief Benchmark of SQLite prepared statements cache
+ *
+ * Compares the assignment query executed with sqlite3_prepare_v2 + sqlite3_finalize on each call
+ * (as SQLiteDataProvider did before) to the same query executed through one cached statement
+ * with sqlite3_reset + sqlite3_clear_bindings. Then measures SQLiteDataProvider::GetAssignmentShort
+ *
+ * @return true if benchmark passed
+ */
+bool benchmark_SQLiteStatements()
+{
+    const int iterations = 20000;
+    const string path = "/test/test_vars/test_table";
+    string connectionString = BENCHMARKS_SQLITE_STRING;
+
+    SQLiteDataProvider provider;
+    if(!provider.Connect(connectionString)) return false;
+
+    ConstantsTypeTable *table = provider.GetConstantsTypeTable(path);
+    Variation *variation = provider.GetVariation("default");
+    if(!table || !variation) return false;
+    int tableId = table->GetId();
+    int variationId = variation->GetId();
+    delete table;
+
+    sqlite3 *db = NULL;
+    if(sqlite3_open_v2(connectionString.substr(9).c_str(), &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) return false;
+
+    BENCHMARK_INIT();
+
+    //prepare and finalize each time
+    BENCHMARK_START("Assignment query. prepare, step and finalize on each call");
+    for (int i=0; i<iterations; i++)
+    {
+        sqlite3_stmt *stmt = NULL;
+        sqlite3_prepare_v2(db, benchmark_SQLiteStatements_Query, -1, &stmt, 0);
+        benchmark_SQLiteStatements_Step(stmt, 100, variationId, tableId);
+        sqlite3_finalize(stmt);
+    }
+    double uncachedTime = stopwatch.ElapsedUs();
+    BENCHMARK_FINISH("20000 queries in ");
+
+    //one cached statement
+    BENCHMARK_START("Assignment query. cached statement, reset and step on each call");
+    sqlite3_stmt *cachedStmt = NULL;
+#if SQLITE_VERSION_NUMBER >= 3020000
+    sqlite3_prepare_v3(db, benchmark_SQLiteStatements_Query, -1, SQLITE_PREPARE_PERSISTENT, &cachedStmt, 0);
+#else
+    sqlite3_prepare_v2(db, benchmark_SQLiteStatements_Query, -1, &cachedStmt, 0);
+#endif
+    for (int i=0; i<iterations; i++)
+    {
+        sqlite3_reset(cachedStmt);
+        sqlite3_clear_bindings(cachedStmt);
+        benchmark_SQLiteStatements_Step(cachedStmt, 100, variationId, tableId);
+    }
+    sqlite3_reset(cachedStmt);
+    sqlite3_finalize(cachedStmt);
+    double cachedTime = stopwatch.ElapsedUs();
+    BENCHMARK_FINISH("20000 queries in ");
+
+    gConsole.WriteLine(Console::cBrightWhite, " Statement cache speed-up: %.2fx", cachedTime > 0 ? uncachedTime/cachedTime : 0.0);
+    sqlite3_close(db);
+
+    //The provider uses cached statements for type table, variation and assignment queries
+    BENCHMARK_START("SQLiteDataProvider::GetAssignmentShort without assignments cache");
+    for (int i=0; i<iterations; i++)
+    {
+        Assignment *assignment = provider.GetAssignmentShort(100, path, "default", false);
+        delete assignment;
+    }
+    BENCHMARK_FINISH("20000 reads in ");
+
+    return true;
+}
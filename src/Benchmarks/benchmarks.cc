@@ -52,6 +52,9 @@ bool benchmark_PreparedStatements();    //prepared statements benchmark
 bool banchmark_UserAPIMultithread();
 bool benchmark_String();
 bool benchmark_AllHallDConstants();
+bool benchmark_SQLiteStatements();      //SQLite prepared statements cache benchmark
+bool benchmark_NumberParsers();          //bulk numbers conversion benchmark
+bool benchmark_CacheThreads();           //cache hits from many threads benchmark
 /**
  * Run various benchmarks
  */
@@ -60,6 +63,9 @@ bool RunBenchmarks()
     bool result = true;
     //result = result && benchmark_UserAPI();       //providers benchmark
     banchmark_UserAPIMultithread();
+    benchmark_SQLiteStatements();
+    benchmark_NumberParsers();
+    benchmark_CacheThreads();
     //benchmark_AllHallDConstants();
     //benchmark_String();
   //  result = result && benchmark_Providers();       //providers benchmark
@@ -0,0 +1,523 @@
+#include "CCDB/AssignmentCache.h"
+
+#include <algorithm>
+#include <tuple>
+
+using namespace std;
+
+namespace ccdb
+{
+
+//______________________________________________________________________________
+AssignmentCache::AssignmentCache(size_t maxBytes, size_t maxIndexEntries)
+{
+    mMaxBytes = maxBytes;
+    mUsedBytes = 0;
+    mUnpinnedBytes = 0;
+    mMaxIndexEntries = maxIndexEntries;
+    mIndexCount = 0;
+    mClock = 0;
+    mCoalescedLoadsCount = 0;
+}
+
+
+//______________________________________________________________________________
+AssignmentCache::~AssignmentCache()
+{
+    Clear();
+}
+
+
+//______________________________________________________________________________
+string AssignmentCache::MakeRequestKey(const string& path, int run, const string& variation, time_t time)
+{
+    /** @brief Makes normalized request key for the index
+     *
+     * The key is built from already resolved values (absolute path, run, variation, time)
+     * so 'a/b', '/a/b' and '/a/b:100' (if 100 is the default run) give the same key
+     */
+    return path + ":" + to_string(run) + ":" + variation + ":" + to_string((long long)time);
+}
+
+
+//______________________________________________________________________________
+bool AssignmentCache::GetAssignmentId(const string& requestKey, dbkey_t& id)
+{
+    IndexShard& shard = GetIndexShard(requestKey);
+    ReadLockGuard lock(shard.Lock);
+
+    auto found = shard.Requests.find(requestKey);
+    if(found == shard.Requests.end()) return false;
+
+    Touch(found->second.LastUsed);
+    id = found->second.Id;
+    return true;
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::PutAssignmentId(const string& requestKey, dbkey_t id)
+{
+    {
+        IndexShard& shard = GetIndexShard(requestKey);
+        WriteLockGuard lock(shard.Lock);
+
+        auto found = shard.Requests.find(requestKey);
+        if(found == shard.Requests.end())
+        {
+            found = shard.Requests.emplace(piecewise_construct, forward_as_tuple(requestKey), forward_as_tuple()).first;
+            mIndexCount++;
+        }
+        found->second.Id = id;
+        found->second.LastUsed = mClock++;
+    }
+
+    if(mIndexCount > mMaxIndexEntries)
+    {
+        lock_guard<mutex> lock(mMutex);
+        EvictIndex();
+    }
+}
+
+
+//______________________________________________________________________________
+shared_ptr<Assignment> AssignmentCache::Get(dbkey_t id, bool needColumns/*=false*/)
+{
+    Shard& shard = GetShard(id);
+    ReadLockGuard lock(shard.Lock);
+
+    auto found = shard.Entries.find(id);
+    if(found == shard.Entries.end()) return shared_ptr<Assignment>();
+
+    Entry& entry = found->second;
+    if(needColumns && !entry.HasColumns) return shared_ptr<Assignment>();
+
+    Touch(entry.LastUsed);
+    return entry.Data;
+}
+
+
+//______________________________________________________________________________
+shared_ptr<Assignment> AssignmentCache::Put(const string& path, Assignment* assignment, bool hasColumns)
+{
+    if(!assignment) return shared_ptr<Assignment>();
+
+    dbkey_t id = assignment->GetId();
+    shared_ptr<Assignment> data(assignment);
+    size_t size = EstimateSize(assignment);
+
+    //pinned paths don't change while the entry is put. Puts follow database reads, so they are rare
+    lock_guard<mutex> pinLock(mMutex);
+    bool isPinned = mPinnedPaths.find(path) != mPinnedPaths.end();
+    {
+        Shard& shard = GetShard(id);
+        WriteLockGuard lock(shard.Lock);
+
+        //replace the old entry if any (it might be the one without columns)
+        Entry& entry = shard.Entries[id];
+        if(entry.Data) RemoveBytes(entry, entry.Size);
+
+        entry.Path = path;
+        entry.Data = data;
+        entry.Size = 0;
+        entry.IsPinned = isPinned;
+        entry.HasColumns = hasColumns;
+        entry.Doubles.reset();
+        entry.Ints.reset();
+        entry.View = ConstantsView();
+        entry.LastUsed = mClock++;
+        AddBytes(entry, size);
+    }
+
+    Evict();
+    return data;
+}
+
+
+//______________________________________________________________________________
+template<typename T>
+bool AssignmentCache::GetTypedValues(dbkey_t id, shared_ptr<const vector<T> > Entry::*member, shared_ptr<const vector<T> >& values)
+{
+    Shard& shard = GetShard(id);
+    ReadLockGuard lock(shard.Lock);
+
+    auto found = shard.Entries.find(id);
+    if(found == shard.Entries.end()) return false;
+
+    Entry& entry = found->second;
+    if(!(entry.*member)) return false;
+
+    Touch(entry.LastUsed);
+    values = entry.*member;
+    return true;
+}
+
+
+//______________________________________________________________________________
+template<typename T>
+void AssignmentCache::PutTypedValues(dbkey_t id, shared_ptr<const vector<T> > Entry::*member, const shared_ptr<const vector<T> >& values)
+{
+    if(!values) return;
+
+    {
+        Shard& shard = GetShard(id);
+        WriteLockGuard lock(shard.Lock);
+
+        //the assignment might be evicted while its cells were converted
+        auto found = shard.Entries.find(id);
+        if(found == shard.Entries.end()) return;
+
+        Entry& entry = found->second;
+        if(entry.*member) return;    //another thread was first
+
+        entry.*member = values;
+        AddBytes(entry, sizeof(vector<T>) + values->capacity() * sizeof(T));
+    }
+
+    if(mUsedBytes > mMaxBytes && mUnpinnedBytes > 0)
+    {
+        lock_guard<mutex> lock(mMutex);
+        Evict();
+    }
+}
+
+
+//______________________________________________________________________________
+bool AssignmentCache::GetValues(dbkey_t id, shared_ptr<const vector<double> >& values)
+{
+    return GetTypedValues(id, &Entry::Doubles, values);
+}
+
+
+//______________________________________________________________________________
+bool AssignmentCache::GetValues(dbkey_t id, shared_ptr<const vector<int> >& values)
+{
+    return GetTypedValues(id, &Entry::Ints, values);
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::PutValues(dbkey_t id, const shared_ptr<const vector<double> >& values)
+{
+    PutTypedValues(id, &Entry::Doubles, values);
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::PutValues(dbkey_t id, const shared_ptr<const vector<int> >& values)
+{
+    PutTypedValues(id, &Entry::Ints, values);
+}
+
+
+//______________________________________________________________________________
+bool AssignmentCache::GetView(dbkey_t id, ConstantsView& view)
+{
+    Shard& shard = GetShard(id);
+    ReadLockGuard lock(shard.Lock);
+
+    auto found = shard.Entries.find(id);
+    if(found == shard.Entries.end()) return false;
+
+    Entry& entry = found->second;
+    if(entry.View.IsEmpty()) return false;
+
+    Touch(entry.LastUsed);
+    view = entry.View;
+    return true;
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::PutView(dbkey_t id, const ConstantsView& view)
+{
+    if(view.IsEmpty()) return;
+
+    {
+        Shard& shard = GetShard(id);
+        WriteLockGuard lock(shard.Lock);
+
+        auto found = shard.Entries.find(id);
+        if(found == shard.Entries.end()) return;
+
+        Entry& entry = found->second;
+        if(!entry.View.IsEmpty()) return;    //another thread was first
+
+        //row-major values of the view are the doubles of the entry, they are counted by PutValues
+        entry.View = view;
+        AddBytes(entry, view.GetStorageSize());
+    }
+
+    if(mUsedBytes > mMaxBytes && mUnpinnedBytes > 0)
+    {
+        lock_guard<mutex> lock(mMutex);
+        Evict();
+    }
+}
+
+
+//______________________________________________________________________________
+shared_ptr<Assignment> AssignmentCache::Load(const string& loadKey, const function<shared_ptr<Assignment>()>& loader)
+{
+    promise<shared_ptr<Assignment> > load;
+    {
+        unique_lock<mutex> lock(mLoadsMutex);
+        auto found = mLoads.find(loadKey);
+        if(found != mLoads.end())
+        {
+            //somebody is loading it already
+            shared_future<shared_ptr<Assignment> > result = found->second;
+            lock.unlock();
+            mCoalescedLoadsCount++;
+            return result.get();
+        }
+        mLoads[loadKey] = load.get_future().share();
+    }
+
+    shared_ptr<Assignment> result;
+    try
+    {
+        result = loader();
+        load.set_value(result);
+    }
+    catch(...)
+    {
+        load.set_exception(current_exception());
+        lock_guard<mutex> lock(mLoadsMutex);
+        mLoads.erase(loadKey);
+        throw;
+    }
+
+    lock_guard<mutex> lock(mLoadsMutex);
+    mLoads.erase(loadKey);
+    return result;
+}
+
+
+//______________________________________________________________________________
+size_t AssignmentCache::GetCoalescedLoadsCount()
+{
+    return mCoalescedLoadsCount;
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::Pin(const string& path)
+{
+    lock_guard<mutex> lock(mMutex);
+    mPinnedPaths.insert(path);
+    SetPinned(path, true);
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::Unpin(const string& path)
+{
+    lock_guard<mutex> lock(mMutex);
+    mPinnedPaths.erase(path);
+    SetPinned(path, false);
+    Evict();
+}
+
+
+//______________________________________________________________________________
+bool AssignmentCache::IsPinned(const string& path)
+{
+    lock_guard<mutex> lock(mMutex);
+    return mPinnedPaths.find(path) != mPinnedPaths.end();
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::SetMaxBytes(size_t maxBytes)
+{
+    lock_guard<mutex> lock(mMutex);
+    mMaxBytes = maxBytes;
+    Evict();
+}
+
+
+//______________________________________________________________________________
+size_t AssignmentCache::GetMaxBytes()
+{
+    return mMaxBytes;
+}
+
+
+//______________________________________________________________________________
+size_t AssignmentCache::GetUsedBytes()
+{
+    return mUsedBytes;
+}
+
+
+//______________________________________________________________________________
+size_t AssignmentCache::GetCount()
+{
+    size_t count = 0;
+    for(size_t i = 0; i < cShardsCount; i++)
+    {
+        ReadLockGuard lock(mShards[i].Lock);
+        count += mShards[i].Entries.size();
+    }
+    return count;
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::SetMaxIndexEntries(size_t maxEntries)
+{
+    lock_guard<mutex> lock(mMutex);
+    mMaxIndexEntries = maxEntries;
+    EvictIndex();
+}
+
+
+//______________________________________________________________________________
+size_t AssignmentCache::GetIndexCount()
+{
+    return mIndexCount;
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::Clear()
+{
+    lock_guard<mutex> lock(mMutex);
+    for(size_t i = 0; i < cShardsCount; i++)
+    {
+        WriteLockGuard shardLock(mShards[i].Lock);
+        for(auto& item : mShards[i].Entries) RemoveBytes(item.second, item.second.Size);
+        mShards[i].Entries.clear();
+    }
+
+    for(size_t i = 0; i < cShardsCount; i++)
+    {
+        WriteLockGuard shardLock(mIndexShards[i].Lock);
+        mIndexCount -= mIndexShards[i].Requests.size();
+        mIndexShards[i].Requests.clear();
+    }
+}
+
+
+//______________________________________________________________________________
+size_t AssignmentCache::EstimateSize(Assignment* assignment)
+{
+    /** @brief Estimated memory that the assignment takes in cache
+     *
+     * The raw blob, decoded cells buffer (if any) and the table of cells
+     */
+    return sizeof(Assignment) + assignment->GetStorageSize();
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::Touch(atomic<uint64_t>& lastUsed)
+{
+    //Hot entries are already marked, so hits of them only read the memory
+    uint64_t now = mClock.load(memory_order_relaxed);
+    if(lastUsed.load(memory_order_relaxed) != now) lastUsed.store(now, memory_order_relaxed);
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::Evict()
+{
+    //only pinned entries are left, nothing can be freed
+    if(mUsedBytes <= mMaxBytes || mUnpinnedBytes == 0) return;
+
+    //collect not pinned entries and go from the least recently used ones
+    vector<pair<uint64_t, dbkey_t> > candidates;
+    for(size_t i = 0; i < cShardsCount; i++)
+    {
+        ReadLockGuard lock(mShards[i].Lock);
+        for(auto& item : mShards[i].Entries)
+        {
+            if(item.second.IsPinned) continue;
+            candidates.push_back(make_pair(item.second.LastUsed.load(), item.first));
+        }
+    }
+    sort(candidates.begin(), candidates.end());
+
+    for(size_t i = 0; i < candidates.size() && mUsedBytes > mMaxBytes && mUnpinnedBytes > 0; i++)
+    {
+        Shard& shard = GetShard(candidates[i].second);
+        WriteLockGuard lock(shard.Lock);
+
+        //the entry might be used or replaced after it was collected
+        auto found = shard.Entries.find(candidates[i].second);
+        if(found == shard.Entries.end() || found->second.LastUsed != candidates[i].first || found->second.IsPinned) continue;
+
+        RemoveBytes(found->second, found->second.Size);
+        shard.Entries.erase(found);
+    }
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::SetPinned(const string& path, bool isPinned)
+{
+    //bytes of the path entries move between pinned and not pinned ones
+    for(size_t i = 0; i < cShardsCount; i++)
+    {
+        WriteLockGuard lock(mShards[i].Lock);
+        for(auto& item : mShards[i].Entries)
+        {
+            Entry& entry = item.second;
+            if(entry.Path != path || entry.IsPinned == isPinned) continue;
+
+            if(isPinned) mUnpinnedBytes -= entry.Size;
+            else mUnpinnedBytes += entry.Size;
+            entry.IsPinned = isPinned;
+        }
+    }
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::AddBytes(Entry& entry, size_t size)
+{
+    entry.Size += size;
+    mUsedBytes += size;
+    if(!entry.IsPinned) mUnpinnedBytes += size;
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::RemoveBytes(Entry& entry, size_t size)
+{
+    entry.Size -= size;
+    mUsedBytes -= size;
+    if(!entry.IsPinned) mUnpinnedBytes -= size;
+}
+
+
+//______________________________________________________________________________
+void AssignmentCache::EvictIndex()
+{
+    //Evicted requests just resolve assignment id once more.
+    //Evict 1/8 of the index at once, so the index is not sorted on each insert when it is full
+    size_t maxEntries = mMaxIndexEntries;
+    if(mIndexCount <= maxEntries) return;
+    size_t targetCount = maxEntries - maxEntries / 8;
+
+    vector<pair<uint64_t, string> > candidates;
+    for(size_t i = 0; i < cShardsCount; i++)
+    {
+        ReadLockGuard lock(mIndexShards[i].Lock);
+        for(auto& item : mIndexShards[i].Requests)
+        {
+            candidates.push_back(make_pair(item.second.LastUsed.load(), item.first));
+        }
+    }
+    sort(candidates.begin(), candidates.end());
+
+    for(size_t i = 0; i < candidates.size() && mIndexCount > targetCount; i++)
+    {
+        IndexShard& shard = GetIndexShard(candidates[i].second);
+        WriteLockGuard lock(shard.Lock);
+        if(shard.Requests.erase(candidates[i].second)) mIndexCount--;
+    }
+}
+
+}
@@ -112,6 +112,12 @@ mKeys[5010] = "CCDB_WARNING_MYSQL_FIELD_NUM";
 mDescriptions[5020] = "My sql result was not cleaned after last query"; 
 mKeys[5020] = "CCDB_WARNING_RESULT_NOT_CLEANED"; 
 
+mDescriptions[5030] = "Data cell is not a number"; 
+mKeys[5030] = "CCDB_WARNING_PARSE_VALUE"; 
+
+mDescriptions[5040] = "Data blob is a binary vault of unknown version or is truncated. Such assignment has no cells"; 
+mKeys[5040] = "CCDB_WARNING_VAULT_INVALID"; 
+
 mDescriptions[1110] = "Object name format is invalid. Only English letters, numbers and '_' are allowed."; 
 mKeys[1110] = "CCDB_ERROR_INVALID_OBJECT_NAME"; 
 
@@ -168,5 +174,11 @@ mKeys[1270] = "CCDB_ERROR_NO_ASSIGMENT";
 
 mDescriptions[1280] = "ASSIGMEN is NULL or has improper ID so update operations can't be done";
 mKeys[1280] = "CCDB_ERROR_DATA_INCONSISTANT"; 
+
+mDescriptions[1290] = "Snapshot file is not valid, is corrupted or can't be written"; 
+mKeys[1290] = "CCDB_ERROR_SNAPSHOT_INVALID"; 
+
+mDescriptions[1300] = "Compressed data blob is broken or is compressed by codec that is not registered"; 
+mKeys[1300] = "CCDB_ERROR_VAULT_DECOMPRESS"; 
 }
 
@@ -2,6 +2,7 @@
 #include <assert.h>
 #include <iostream>
 #include <memory>
+#include <tuple>
 
 #include "CCDB/Calibration.h"
 #include "CCDB/GlobalMutex.h"
@@ -9,6 +10,8 @@
 #include "CCDB/Helpers/PathUtils.h"
 #include "CCDB/Helpers/TimeProvider.h"
 #include "CCDB/Helpers/PerfLog.h"
+#include "CCDB/Helpers/NumberParsers.h"
+#include "CCDB/Log.h"
 
 using namespace std;
 
@@ -27,6 +30,7 @@ Calibration::Calibration()
     mDefaultVariation = "default";
     mIsAutoReconnect = true;
     mLastActivityTime=0;
+    mAsyncWorkersCount = 4;
 
 #ifdef CCDB_CACHE_ON
     mIsCacheEnabled = true;
@@ -51,6 +55,7 @@ Calibration::Calibration(int defaultRun, string defaultVariation/*="default"*/,
     x = new PthreadSyncObject();
     mIsAutoReconnect = true;
     mLastActivityTime=0;
+    mAsyncWorkersCount = 4;
 
 #ifdef CCDB_CACHE_ON
     mIsCacheEnabled = true;
@@ -64,6 +69,9 @@ Calibration::Calibration(int defaultRun, string defaultVariation/*="default"*/,
 Calibration::~Calibration()
 {
     //Destructor
+    StopAsyncWorkers();     //derived classes stop them too, as requests call their functions
+    mIssuedAssignmentsIndex.clear();
+    mIssuedAssignments.clear();  //assignments refer to type tables of the provider catalog
     if(!mProviderIsLocked && mProvider!=NULL) delete mProvider;
 }
 
@@ -81,6 +89,158 @@ void Calibration::UseProvider( DataProvider * provider, bool lockProvider/*=true
 }
 
 
+//______________________________________________________________________________
+static void Calibration_WarnNotNumbers(const string& namepath, const vector<size_t>& failedCells)
+{
+    /** @brief Logs cells that are not numbers */
+    string message = StringUtils::Format("%lu cell(s) of '%s' are not numbers. First such cell index is %lu",
+            (unsigned long)failedCells.size(), namepath.c_str(), (unsigned long)failedCells[0]);
+    Log::Warning(CCDB_WARNING_PARSE_VALUE, "Calibration::GetCalib", message);
+}
+
+
+//______________________________________________________________________________
+static void Calibration_ParseCells(const Assignment& assignment, vector<double>& values, const string& namepath)
+{
+    /** @brief Converts all cells of assignment to contiguous array of doubles
+     *
+     * Cells that are not numbers are reported to log and get the value
+     * StringUtils::ParseDouble gives (like atof did before).
+     * Binary data blobs are read without parsing
+     */
+    vector<size_t> notNumberCells;
+    if(assignment.GetBinaryValues(values, notNumberCells))
+    {
+        if(!notNumberCells.empty()) Calibration_WarnNotNumbers(namepath, notNumberCells);
+        return;
+    }
+
+    vector<CharSpan> spans;
+    assignment.GetCellSpans(spans);
+    values.resize(spans.size());
+    if(spans.empty()) return;
+
+    vector<size_t> failedCells;
+    if(NumberParsers::ParseDoubles(&spans[0], spans.size(), &values[0], &failedCells))
+    {
+        for(size_t i = 0; i < failedCells.size(); i++)
+        {
+            const CharSpan& span = spans[failedCells[i]];
+            values[failedCells[i]] = StringUtils::ParseDouble(string(span.Data, span.Length));
+        }
+        Calibration_WarnNotNumbers(namepath, failedCells);
+    }
+}
+
+
+//______________________________________________________________________________
+static void Calibration_ParseCells(const Assignment& assignment, vector<int>& values, const string& namepath)
+{
+    /** @brief Converts all cells of assignment to contiguous array of ints. @see Calibration_ParseCells
+     *
+     * Floating point cells are truncated (as atoi did) without warnings
+     */
+    vector<size_t> notNumberCells;
+    if(assignment.GetBinaryValues(values, notNumberCells))
+    {
+        if(!notNumberCells.empty()) Calibration_WarnNotNumbers(namepath, notNumberCells);
+        return;
+    }
+
+    vector<CharSpan> spans;
+    assignment.GetCellSpans(spans);
+    values.resize(spans.size());
+    if(spans.empty()) return;
+
+    vector<size_t> failedCells;
+    if(NumberParsers::ParseInts(&spans[0], spans.size(), &values[0], &failedCells))
+    {
+        for(size_t i = 0; i < failedCells.size(); i++)
+        {
+            const CharSpan& span = spans[failedCells[i]];
+            values[failedCells[i]] = StringUtils::ParseInt(string(span.Data, span.Length));
+
+            double doubleValue;
+            if(!NumberParsers::ParseDouble(span.Data, span.Length, doubleValue)) notNumberCells.push_back(failedCells[i]);
+        }
+        if(!notNumberCells.empty()) Calibration_WarnNotNumbers(namepath, notNumberCells);
+    }
+}
+
+
+//______________________________________________________________________________
+template<typename T>
+static shared_ptr<const vector<T> > Calibration_GetCells(Calibration& calibration, const Assignment& assignment, const string& namepath)
+{
+    /** @brief Cells of the assignment converted to numbers
+     *
+     * If cache is enabled, converted cells are kept in the cache entry of the assignment,
+     * so the cells are parsed once and warm requests just copy the numbers
+     */
+    AssignmentCache *cache = calibration.IsCacheEnabled() ? calibration.GetProvider()->GetAssignmentCache() : NULL;
+
+    shared_ptr<const vector<T> > cells;
+    if(cache && cache->GetValues(assignment.GetId(), cells)) return cells;
+
+    //providers with typed values give them without parsing the data blob
+    shared_ptr<vector<T> > parsedCells = make_shared<vector<T> >();
+    if(!calibration.GetProvider()->GetAssignmentValues(assignment, *parsedCells))
+    {
+        Calibration_ParseCells(assignment, *parsedCells, namepath);
+    }
+    cells = parsedCells;
+
+    if(cache) cache->PutValues(assignment.GetId(), cells);
+    return cells;
+}
+
+
+//______________________________________________________________________________
+template<typename T>
+static bool Calibration_GetTable(Calibration& calibration, vector< vector<T> > &values, const string & namepath)
+{
+    /** @brief Fills table of numbers from converted assignment cells. @see Calibration_GetCells */
+    auto assignment = calibration.GetAssignmentShared(namepath, false);
+    if(!assignment) return false;
+
+    assert(values.empty());
+
+    shared_ptr<const vector<T> > cells = Calibration_GetCells<T>(calibration, *assignment, namepath);
+
+    size_t columnsNum = assignment->GetTypeTable()->GetColumnsCount();
+    if(cells->empty() || columnsNum == 0) return true;
+
+    size_t rowsNum = cells->size() / columnsNum;
+    values.resize(rowsNum);
+    for (size_t rowIter = 0; rowIter < rowsNum; rowIter++)
+    {
+        values[rowIter].assign(cells->begin() + rowIter * columnsNum, cells->begin() + (rowIter + 1) * columnsNum);
+    }
+    return true;
+}
+
+
+//______________________________________________________________________________
+template<typename T>
+static bool Calibration_GetRow(Calibration& calibration, vector<T> &values, const string & namepath)
+{
+    /** @brief Fills one row of numbers right from assignment cells. @see GetCalib(vector<string> &, const string &) */
+    auto assignment = calibration.GetAssignmentShared(namepath, false);
+    if(!assignment) return false;
+
+    size_t cellsCount = assignment->GetCellsCount();
+    if(cellsCount == 0)
+        throw std::logic_error("Calibration::GetCalib(vector<dataType> &, const string &). Data has no rows. Zero rows are not supposed to be.");
+
+    if(cellsCount != (size_t)assignment->GetTypeTable()->GetColumnsCount())
+        throw std::logic_error("Calibration::GetCalib(vector<dataType> &, const string &). logic_error: Calling of single row vector<dataType> version of GetCalib method on dataset that has more than one rows. Use GetCalib vector<vector<dataType> > instead.");
+
+    shared_ptr<const vector<T> > cells = Calibration_GetCells<T>(calibration, *assignment, namepath);
+    values.assign(cells->begin(), cells->end());
+    return true;
+}
+
+
 //______________________________________________________________________________
 bool Calibration::GetCalib( vector< map<string, string> > &values, const string & namepath )
 {
@@ -104,7 +264,7 @@ bool Calibration::GetCalib( vector< map<string, string> > &values, const string
 	 * @return true if constants were found and filled. false if namepath was not found. raises std::logic_error if any other error acured.
 	 */  
 
-    auto assignment = GetAssignment(namepath, true);
+    auto assignment = GetAssignmentShared(namepath, true);
         
     if(!assignment)
     {       
@@ -216,7 +376,7 @@ bool Calibration::GetCalib( vector< vector<string> > &values, const string & nam
      * @return true if constants were found and filled. false if namepath was not found. raises std::logic_error if any other error acured.
      */
     
-    auto assignment = GetAssignment(namepath, false);
+    auto assignment = GetAssignmentShared(namepath, false);
     
     if(!assignment)
     {
@@ -232,70 +392,20 @@ bool Calibration::GetCalib( vector< vector<string> > &values, const string & nam
 //______________________________________________________________________________
 bool Calibration::GetCalib( vector< vector<double> > &values, const string & namepath )
 {
-    //TODO right now the function works through copy. One has to check, maybe it needs to be reimplemented
-
-    vector< vector<string> > rawValues;
-    try
-    {
-        if(!GetCalib(rawValues, namepath)) return false;
-    }
-    catch (std::exception &)
-    {
-        throw;
-    }
-
-    assert(values.empty());
-
-    int rowsNum = rawValues.size();
-    int columnsNum = rawValues[0].size(); //rawTableValues[0] - size was checked in GetCalib
-
-    values.resize(rawValues.size());
-
-    //compose values
-    for (int rowIter = 0; rowIter < rowsNum; rowIter++)
-    {   
-        for (int columnsIter = 0; columnsIter < columnsNum; columnsIter++)
-        {
-            double tmpVal = StringUtils::ParseDouble(rawValues[rowIter][columnsIter]);
-            values[rowIter].push_back(tmpVal);
-        }
-    }
-
-    return true;
+    /** @brief Get constants by namepath as table of doubles
+     *
+     * Cells are converted in one pass by NumberParsers right from the assignment data,
+     * no intermediate table of strings is created
+     */
+    return Calibration_GetTable(*this, values, namepath);
 }
 
 
 //______________________________________________________________________________
 bool Calibration::GetCalib( vector< vector<int> > &values, const string & namepath )
 {
-    vector< vector<string> > rawValues;
-    try
-    {
-        if(!GetCalib(rawValues, namepath)) return false;
-    }
-    catch (std::exception &)
-    {
-        throw;
-    }
-
-    assert(values.empty());
-
-    int rowsNum = rawValues.size();
-    int columnsNum = rawValues[0].size(); //rawTableValues[0] - size was checked in GetCalib
-
-    values.resize(rawValues.size());
-
-    //compose values
-    for (int rowIter = 0; rowIter < rowsNum; rowIter++)
-    {   
-        for (int columnsIter = 0; columnsIter < columnsNum; columnsIter++)
-        {
-            int tmpVal = StringUtils::ParseInt(rawValues[rowIter][columnsIter]);
-            values[rowIter].push_back(tmpVal);
-        }
-    }
-
-    return true;
+    /** @brief Get constants by namepath as table of ints. @see GetCalib( vector< vector<double> > &, const string &) */
+    return Calibration_GetTable(*this, values, namepath);
 }
 
 
@@ -313,9 +423,9 @@ bool Calibration::GetCalib( map<string, string> &values, const string & namepath
      */
 
 
-    auto assignment = GetAssignment(namepath, true);
+    auto assignment = GetAssignmentShared(namepath, true);
     
-    if(assignment == NULL)
+    if(!assignment)
     {
         //TODO possibly exception throwing?
         return false;
@@ -451,9 +561,9 @@ bool Calibration::GetCalib( vector<string> &values, const string & namepath )
 
 	
     
-	auto assignment = GetAssignment(namepath, true);
+	auto assignment = GetAssignmentShared(namepath, true);
     
-    if(assignment == NULL) return false; //TODO possibly exception throwing?
+    if(!assignment) return false; //TODO possibly exception throwing?
 
     //Get data
     values.clear();
@@ -473,54 +583,16 @@ bool Calibration::GetCalib( vector<string> &values, const string & namepath )
 //______________________________________________________________________________
 bool Calibration::GetCalib( vector<double> &values, const string & namepath )
 {
-    vector<string> rawValues;
-    try
-    {
-        if(!GetCalib(rawValues, namepath)) return false;
-    }
-    catch (std::exception &)
-    {
-        throw;
-    }
-    
-    int columnsNum = rawValues.size(); //rawTableValues[0] - size was checked in GetCalib    
-
-    values.resize(rawValues.size());
-
-    //compose values
-    for (int columnsIter = 0; columnsIter < columnsNum; columnsIter++)
-    {
-        double tmpVal = StringUtils::ParseDouble(rawValues[columnsIter]);
-        values[columnsIter] = tmpVal;
-    }
-    return true;
+    /** @brief Get constants by namepath as one row of doubles. @see GetCalib( vector< vector<double> > &, const string &) */
+    return Calibration_GetRow(*this, values, namepath);
 }
 
 
 //______________________________________________________________________________
 bool Calibration::GetCalib( vector<int> &values, const string & namepath )
 {
-    vector<string> rawValues;
-    try
-    {
-        if(!GetCalib(rawValues, namepath)) return false;
-    }
-    catch (std::exception &)
-    {
-        throw;
-    }
-
-    int columnsNum = rawValues.size(); //rawTableValues[0] - size was checked in GetCalib
-
-    values.resize(rawValues.size());
-
-    //compose values
-    for (int columnsIter = 0; columnsIter < columnsNum; columnsIter++)
-    {
-        int tmpVal = StringUtils::ParseInt(rawValues[columnsIter]);
-        values[columnsIter] = tmpVal;
-    }
-    return true;
+    /** @brief Get constants by namepath as one row of ints. @see GetCalib( vector< vector<double> > &, const string &) */
+    return Calibration_GetRow(*this, values, namepath);
 }
 
 //______________________________________________________________________________
@@ -571,6 +643,65 @@ bool Calibration::GetCalib(int &value, const string & namepath)
 	return false;
 }
 
+//______________________________________________________________________________
+bool Calibration::GetCalib(ConstantsView &view, const string & namepath)
+{
+    /** @brief Get constants by namepath as read only view of cached data
+     *
+     * If cache is enabled, the view is made once and is kept next to the cached assignment,
+     * so warm requests just return the same view
+     *
+     * @parameter [out] view
+     * @parameter [in]  namepath - data path
+     * @return true if constants were found and filled. false if namepath was not found. raises std::logic_error if any other error acured.
+     */
+    auto assignment = GetAssignmentShared(namepath, true);
+    if(!assignment) return false;
+
+    MakeView(assignment, namepath, view);
+    return true;
+}
+
+
+//______________________________________________________________________________
+bool Calibration::GetCalibBatch(vector<ConstantsView> &views, const vector<string> & namepaths)
+{
+    /** @brief Get constants of many namepaths as read only views. Cache misses are read at once
+     *
+     * @parameter [out] views - views in the order of namepaths. Empty view if namepath was not found
+     * @parameter [in]  namepaths - data paths
+     * @return true if all namepaths were found. raises std::logic_error if any other error acured.
+     */
+    vector<shared_ptr<Assignment> > assignments;
+    GetAssignmentsSharedBatch(assignments, namepaths, true);
+
+    bool isAllFound = true;
+    views.assign(namepaths.size(), ConstantsView());
+    for(size_t i=0; i<namepaths.size(); i++)
+    {
+        if(assignments[i]) MakeView(assignments[i], namepaths[i], views[i]);
+        else isAllFound = false;
+    }
+    return isAllFound;
+}
+
+
+//______________________________________________________________________________
+void Calibration::MakeView(const shared_ptr<Assignment>& assignment, const string& namepath, ConstantsView& view)
+{
+    /** @brief View of the assignment. If cache is enabled the view is made once and is kept next to the cached assignment */
+    AssignmentCache *cache = mIsCacheEnabled ? mProvider->GetAssignmentCache() : NULL;
+    if(cache && cache->GetView(assignment->GetId(), view)) return;
+
+    shared_ptr<const vector<double> > cells = Calibration_GetCells<double>(*this, *assignment, namepath);
+    if(cells->empty())
+        throw std::logic_error("Calibration::GetCalib(ConstantsView &, const string &). Data has no rows. Zero rows are not supposed to be.");
+
+    view = ConstantsView(assignment, cells);
+    if(cache) cache->PutView(assignment->GetId(), view);
+}
+
+
 //______________________________________________________________________________
 string Calibration::GetConnectionString() const
 {
@@ -582,62 +713,372 @@ string Calibration::GetConnectionString() const
 
 
 //______________________________________________________________________________
-    Assignment* Calibration::GetAssignment(const string& namepath, bool loadColumns /*=true*/)
+static bool Calibration_HasColumns(Assignment* assignment, bool loadColumns)
+{
+    /** @brief true if assignment read with given loadColumns has columns
+     *
+     * Providers with metadata catalog ignore loadColumns and give type tables with columns.
+     * Such assignments are cached as having columns, so requests that need columns are hits too
+     */
+    if(loadColumns) return true;
+    ConstantsTypeTable* table = assignment->GetTypeTable();
+    return table && !table->GetColumns().empty();
+}
+
+
+//______________________________________________________________________________
+Assignment* Calibration::GetAssignment(const string& namepath, bool loadColumns /*=true*/)
 {
     /** @brief Gets the assignment from provider using namepath
      * namepath is the common ccdb request; @see GetCalib
      *
      * @remark the function is thread safe
-     * 
+     *
+     * @warning if cache is enabled, the assignment is owned by this Calibration and user should not delete it.
+     *          The last CCDB_CACHE_MAX_ISSUED_ASSIGNMENTS given assignments are kept alive, eviction from cache doesn't free them.
+     *          If cache is disabled, user owns the assignment
+     *
      * @parameter [in] namepath - full namepath is /path/to/data:run:variation:time but usually it is only /path/to/data
      * @return   DAssignment *
      */
 
-    auto pl = PerfLog("Calibration::GetAssignment=>" + namepath );
-    static std::map<std::string, Assignment*> cache;
+    if(mIsCacheEnabled)
+    {
+        // the cache may evict the assignment, the raw pointer must stay valid
+        std::shared_ptr<Assignment> assignment = GetAssignmentShared(namepath, loadColumns);
+        if(!assignment) return NULL;
+
+        // the set is bounded, so it doesn't keep all data that the cache has already let go
+        std::lock_guard<std::mutex> lock(mIssuedAssignmentsMutex);
+        auto found = mIssuedAssignmentsIndex.find(assignment.get());
+        if(found != mIssuedAssignmentsIndex.end()) mIssuedAssignments.erase(found->second);
+        mIssuedAssignments.push_front(assignment);
+        mIssuedAssignmentsIndex[assignment.get()] = mIssuedAssignments.begin();
+        while(mIssuedAssignments.size() > CCDB_CACHE_MAX_ISSUED_ASSIGNMENTS)
+        {
+            mIssuedAssignmentsIndex.erase(mIssuedAssignments.back().get());
+            mIssuedAssignments.pop_back();
+        }
+        return assignment.get();
+    }
+
+    string path;
+    return ReadAssignment(namepath, loadColumns, path);
+}
+
+
+//______________________________________________________________________________
+std::shared_ptr<Assignment> Calibration::GetAssignmentShared(const string& namepath, bool loadColumns /*=true*/)
+{
+    /** @brief Gets the assignment from provider (or from cache) using namepath
+     * namepath is the common ccdb request; @see GetCalib
+     *
+     * The cache has two levels: the request is resolved to assignment id by the index,
+     * then the data is taken by assignment id. So runs that resolve to the same assignment share one copy of the data.
+     * A request that is not in the index is read by one GetAssignmentShort query and the index is filled
+     * with the id of the read assignment. If the request is in the index but its data was evicted,
+     * the data is read by assignment id
+     *
+     * Cache hits take no exclusive locks. Threads that miss the same request at the same time
+     * share one load of it (@see AssignmentCache::Load). The connection is locked only for the query itself
+     * and only if the provider is not reentrant
+     *
+     * @remark the function is thread safe
+     *
+     * @parameter [in] namepath - full namepath is /path/to/data:run:variation:time but usually it is only /path/to/data
+     * @return   assignment or empty pointer if no assignment found
+     */
+
+    if(!mIsCacheEnabled)
+    {
+        string path;
+        return std::shared_ptr<Assignment>(ReadAssignment(namepath, loadColumns, path));
+    }
+
+    auto pl = PerfLog("Calibration::GetAssignmentShared=>" + namepath );
 
 	UpdateActivityTime();
 
-    RequestParseResult result = PathUtils::ParseRequest(namepath);
-    string variation = (result.WasParsedVariation ? result.Variation : mDefaultVariation);
-    int run  = (result.WasParsedRunNumber ? result.RunNumber : mDefaultRun);
+    string path;
+    string variation;
+    int run;
+    time_t time;
+    ResolveRequest(namepath, path, run, variation, time);
 
+    CheckConnection();  // Check if is connected and reconnect if needed (and allowed)
+    AssignmentCache *cache = mProvider->GetAssignmentCache();
 
+    // Hit
+    string requestKey = AssignmentCache::MakeRequestKey(path, run, variation, time);
+    dbkey_t assignmentId = 0;
+    if(cache->GetAssignmentId(requestKey, assignmentId))
+    {
+        auto cached = cache->Get(assignmentId, loadColumns);
+        if(cached) return cached;
+    }
+
+    // Miss. The first thread runs the load, others that miss the same request wait for its result
+    string loadKey = loadColumns ? requestKey + ":columns" : requestKey;
+    return cache->Load(loadKey, [&]() -> std::shared_ptr<Assignment>
+    {
+        Assignment* assignment;
+        dbkey_t id = 0;
+        if(cache->GetAssignmentId(requestKey, id))
+        {
+            // The request is in the index, only the data was evicted. Data by assignment id
+            auto cached = cache->Get(id, loadColumns);
+            if(cached) return cached;
 
-    auto time = result.WasParsedTime ? result.Time: mDefaultTime;
+            auto queryLock = LockQuery();
+            assignment = mProvider->GetAssignmentShortById(id, path, loadColumns);
+        }
+        else
+        {
+            // Unknown request. One query resolves it and reads the data
+            auto queryLock = LockQuery();
+            assignment = mProvider->GetAssignmentShort(run, path, time, variation, loadColumns);
+        }
+        if(!assignment) return std::shared_ptr<Assignment>();
 
+        // runs of the same run range share one copy of data
+        assignment->SetRequestedRun(run);
+        cache->PutAssignmentId(requestKey, assignment->GetId());
+        auto cached = cache->Get(assignment->GetId(), loadColumns);
+        if(cached)
+        {
+            delete assignment;
+            return cached;
+        }
+        return cache->Put(path, assignment, Calibration_HasColumns(assignment, loadColumns));
+    });
+}
+
+
+//______________________________________________________________________________
+void Calibration::GetAssignmentsSharedBatch(vector<shared_ptr<Assignment> >& assignments, const vector<string>& namepaths, bool loadColumns /*=true*/)
+{
+    /** @brief Gets assignments of many namepaths from the connection cache or from provider
+     *
+     * Cache hits are taken as in GetAssignmentShared. Misses are grouped by run, variation and time,
+     * each group is read by one DataProvider::GetAssignmentsShortBatch call and is put to the cache.
+     * Unlike GetAssignmentShared, threads that miss the same namepaths at the same time may read them twice
+     *
+     * @remark the function is thread safe
+     *
+     * @parameter [out] assignments - assignments in the order of namepaths, empty pointer if no assignment found
+     * @parameter [in] namepaths - full namepath is /path/to/data:run:variation:time but usually it is only /path/to/data
+     */
+
+    auto pl = PerfLog(StringUtils::Format("Calibration::GetAssignmentsSharedBatch=>%i namepaths", (int)namepaths.size()));
+
+	UpdateActivityTime();
+
+    assignments.assign(namepaths.size(), shared_ptr<Assignment>());
     CheckConnection();  // Check if is connected and reconnect if needed (and allowed)
-	
-    //Lock();Unlock();
-    std::lock_guard<std::mutex> lock(mReadMutex);
+    AssignmentCache *cache = mIsCacheEnabled ? mProvider->GetAssignmentCache() : NULL;
 
-    // Check if we have this value in the cache
-    string cache_key = namepath + ":" + to_string(run) + ":" + variation + ":" + to_string(time);
-    if(mIsCacheEnabled)
+    // (run, variation, time) => paths and indexes of namepaths that are not in cache
+    typedef std::tuple<int, string, time_t> BatchKey;
+    map<BatchKey, pair<vector<string>, vector<size_t> > > misses;
+    vector<string> requestKeys(namepaths.size());
+
+    for(size_t i=0; i<namepaths.size(); i++)
     {
-        if (  cache.find(cache_key) != cache.end() ) {
-            return cache[cache_key];
+        string path;
+        string variation;
+        int run;
+        time_t time;
+        ResolveRequest(namepaths[i], path, run, variation, time);
+
+        // Hit
+        if(cache)
+        {
+            requestKeys[i] = AssignmentCache::MakeRequestKey(path, run, variation, time);
+            dbkey_t assignmentId = 0;
+            if(cache->GetAssignmentId(requestKeys[i], assignmentId))
+            {
+                assignments[i] = cache->Get(assignmentId, loadColumns);
+                if(assignments[i]) continue;
+            }
         }
+
+        pair<vector<string>, vector<size_t> >& miss = misses[BatchKey(run, variation, time)];
+        miss.first.push_back(path);
+        miss.second.push_back(i);
     }
 
-    Assignment* assigment;
+    // Misses. One provider call for each run, variation and time
+    for(auto it = misses.begin(); it != misses.end(); ++it)
+    {
+        int run = std::get<0>(it->first);
+        const vector<string>& paths = it->second.first;
+        const vector<size_t>& indexes = it->second.second;
+
+        vector<Assignment *> read;
+        {
+            auto queryLock = LockQuery();
+            mProvider->GetAssignmentsShortBatch(read, run, paths, std::get<2>(it->first), std::get<1>(it->first));
+        }
+
+        for(size_t j=0; j<read.size(); j++)
+        {
+            if(!read[j]) continue;
+            read[j]->SetRequestedRun(run);
+            size_t index = indexes[j];
+
+            if(!cache)
+            {
+                assignments[index].reset(read[j]);
+                continue;
+            }
+
+            // runs of the same run range share one copy of data
+            cache->PutAssignmentId(requestKeys[index], read[j]->GetId());
+            assignments[index] = cache->Get(read[j]->GetId(), loadColumns);
+            if(assignments[index]) delete read[j];
+            else assignments[index] = cache->Put(paths[j], read[j], Calibration_HasColumns(read[j], loadColumns));
+        }
+    }
+}
+
+
+//______________________________________________________________________________
+Assignment* Calibration::ReadAssignment(const string& namepath, bool loadColumns, string& path)
+{
+    /** @brief Reads the assignment from provider. Cache is not used
+     *
+     * @parameter [in]  namepath - full namepath is /path/to/data:run:variation:time
+     * @parameter [out] path     - absolute path of the type table
+     * @return   Assignment * that is owned by caller or NULL
+     */
+
+    auto pl = PerfLog("Calibration::GetAssignment=>" + namepath );
+
+	UpdateActivityTime();
+
+    string variation;
+    int run;
+    time_t time;
+    ResolveRequest(namepath, path, run, variation, time);
+
+    CheckConnection();  // Check if is connected and reconnect if needed (and allowed)
+
+    auto queryLock = LockQuery();
 
     if(time > 0)
     {
-		assigment = (mProvider->GetAssignmentShort(run, PathUtils::MakeAbsolute(result.Path), time, variation,loadColumns));
-	}
-    else
-	{
-		assigment = (mProvider->GetAssignmentShort(run, PathUtils::MakeAbsolute(result.Path), variation,loadColumns));
+		return mProvider->GetAssignmentShort(run, path, time, variation, loadColumns);
 	}
 
-    if(mIsCacheEnabled)
-    {
+    return mProvider->GetAssignmentShort(run, path, variation, loadColumns);
+}
+
+
+//______________________________________________________________________________
+Calibration::QueryLock Calibration::LockQuery(bool isConstantsRead /*=true*/)
+{
+    /** @brief Locks the connection for a read of constants, if the provider is not reentrant
+     *
+     * Only reads of constants are reentrant, other queries (i.e. of directories and type tables) are always locked
+     *
+     * @see DataProvider::IsReentrant
+     * @return the lock, it is released and the borrowed connection is given back when it goes out of scope
+     */
+    std::unique_lock<std::mutex> lock(mProvider->GetQueryMutex(), std::defer_lock);
+    if(!isConstantsRead || !mProvider->IsReentrant()) lock.lock();
+    return QueryLock(mProvider, std::move(lock));
+}
+
+
+//______________________________________________________________________________
+CalibrationWorkerPool* Calibration::GetAsyncWorkers()
+{
+    /** @brief Worker pool of GetCalibAsync. It is started on the first call */
+    std::lock_guard<std::mutex> lock(mAsyncWorkersMutex);
+    if(!mAsyncWorkers) mAsyncWorkers.reset(new CalibrationWorkerPool(mAsyncWorkersCount));
+    return mAsyncWorkers.get();
+}
 
-        cache[cache_key] = assigment;
+
+//______________________________________________________________________________
+void Calibration::SetAsyncWorkersCount(size_t count)
+{
+    /** @brief Sets number of threads that run GetCalibAsync requests. Is used on the next start of the threads */
+    std::lock_guard<std::mutex> lock(mAsyncWorkersMutex);
+    mAsyncWorkersCount = count > 0 ? count : 1;
+}
+
+
+//______________________________________________________________________________
+size_t Calibration::GetAsyncWorkersCount()
+{
+    std::lock_guard<std::mutex> lock(mAsyncWorkersMutex);
+    return mAsyncWorkersCount;
+}
+
+
+//______________________________________________________________________________
+void Calibration::StopAsyncWorkers()
+{
+    /** @brief Cancels queued GetCalibAsync requests, waits for running ones and stops the threads
+     *
+     * The pool is taken out under the lock and is stopped without it,
+     * so running requests that start a new pool don't dead lock
+     */
+    std::unique_ptr<CalibrationWorkerPool> workers;
+    {
+        std::lock_guard<std::mutex> lock(mAsyncWorkersMutex);
+        workers.swap(mAsyncWorkers);
     }
+    if(workers) workers->Stop();
+}
+
+
+//______________________________________________________________________________
+void Calibration::ResolveRequest(const string& namepath, string& path, int& run, string& variation, time_t& time)
+{
+    /** @brief Parses namepath and applies default run, variation and time of this calibration
+     *
+     * @parameter [in]  namepath  - full namepath is /path/to/data:run:variation:time
+     * @parameter [out] path      - absolute path of the type table
+     * @parameter [out] run       - run number
+     * @parameter [out] variation - variation name
+     * @parameter [out] time      - time or 0
+     */
+    RequestParseResult result = PathUtils::ParseRequest(namepath);
+    variation = (result.WasParsedVariation ? result.Variation : mDefaultVariation);
+    run  = (result.WasParsedRunNumber ? result.RunNumber : mDefaultRun);
+    time = result.WasParsedTime ? result.Time: mDefaultTime;
+    path = PathUtils::MakeAbsolute(result.Path);
+}
+
+
+//______________________________________________________________________________
+void Calibration::SetCacheMaxBytes(size_t maxBytes)
+{
+    /** @brief Sets memory budget of the assignments cache of the connection */
+    CheckConnection();
+    mProvider->GetAssignmentCache()->SetMaxBytes(maxBytes);
+}
 
-    return assigment;
+
+//______________________________________________________________________________
+void Calibration::PinNamepath(const string& namepath)
+{
+    /** @brief Cached data of the namepath is never evicted from cache */
+    CheckConnection();
+    string path = PathUtils::ParseRequest(namepath).Path;
+    mProvider->GetAssignmentCache()->Pin(PathUtils::MakeAbsolute(path));
+}
+
+
+//______________________________________________________________________________
+void Calibration::UnpinNamepath(const string& namepath)
+{
+    /** @brief Cancels @see PinNamepath */
+    CheckConnection();
+    string path = PathUtils::ParseRequest(namepath).Path;
+    mProvider->GetAssignmentCache()->Unpin(PathUtils::MakeAbsolute(path));
 }
 
 
@@ -669,8 +1110,11 @@ void Calibration::GetListOfNamepaths( vector<string> &namepaths )
     UpdateActivityTime();
 
     vector<ConstantsTypeTable*> tables;
-    std::lock_guard<std::mutex> lock(mReadMutex);
-	 bool ok = mProvider->SearchConstantsTypeTables(tables, "*");
+    bool ok;
+    {
+        auto queryLock = LockQuery(false);
+        ok = mProvider->SearchConstantsTypeTables(tables, "*");
+    }
 
     if(!ok)
     {
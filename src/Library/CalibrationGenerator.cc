@@ -4,6 +4,7 @@
 #include "CCDB/CalibrationGenerator.h"
 #include "CCDB/SQLiteCalibration.h"
 #include "CCDB/Providers/SQLiteDataProvider.h"
+#include "CCDB/SnapshotCalibration.h"
 #include "CCDB/Helpers/TimeProvider.h"
 #ifdef CCDB_MYSQL
 #include "CCDB/MySQLCalibration.h"
@@ -29,28 +30,8 @@ Calibration* CalibrationGenerator::CreateCalibration(const std::string & connect
 	 */
 
 
-	//is it sqlite or mysql
-	bool isMySql = false; //if false SQlite provider is used		
-	if(connectionString.find("mysql://")==0)
-	{		
-		isMySql = true;  //It is mysql
-		
-		#ifndef CCDB_MYSQL
-		throw std::logic_error("Cannot be used with MySQL database. CCDB was compiled without MySQL support! Recompile CCDB using with-mysql=true flag. The connection string: " + connectionString);
-		#endif //CCDB_MYSQL
-	}
-	else
-	{
-		//It should be sqlite, but lets check then...
-		if(connectionString.find("sqlite://")!=0)
-		{	
-			//something wrong here!!!
-			throw std::logic_error("Unknown connection string type. mysql:// and sqlite:// are only known types now. The connection string: " + connectionString);
-		}
-	}
-	
-	//now we create calibration
-	Calibration * calib = CreateCalibration(isMySql, run, variation, time);    
+	//now we create calibration of the connection string type
+	Calibration * calib = CreateCalibrationOfType(connectionString, run, variation, time);    
 
     //Connect!
     if(!calib->Connect(connectionString))
@@ -71,6 +52,7 @@ bool CalibrationGenerator::CheckOpenable( const std::string & str)
 	#endif
 
 	if(str.find("sqlite://")== 0) return true;
+	if(str.find("snapshot://")== 0) return true;
     return false;
 }
 
@@ -112,28 +94,8 @@ Calibration* CalibrationGenerator::MakeCalibration( const std::string & connecti
 		return mCalibrationsByHash[calibHash];
 	}
 
-	//is it sqlite or mysql
-	bool isMySql = false; //if false SQlite provider is used		
-	if(connectionString.find("mysql://")==0)
-	{		
-		isMySql = true;  //It is mysql
-		
-		#ifndef CCDB_MYSQL
-		throw std::logic_error("Cannot be used with MySQL database. CCDB was compiled without MySQL support! Recompile CCDB using with-mysql=true flag. The connection string: " + connectionString);
-		#endif //CCDB_MYSQL
-	}
-	else
-	{
-		//It should be sqlite, but lets check then...
-		if(connectionString.find("sqlite://")!=0)
-		{	
-			//something wrong here!!!
-			throw std::logic_error("Unknown connection string type. mysql:// and sqlite:// are only known types now. The connection string: " + connectionString);
-		}
-	}
-	
-	//now we create calibration
-	Calibration * calib = CreateCalibration(isMySql, run, variation, time);
+	//now we create calibration of the connection string type
+	Calibration * calib = CreateCalibrationOfType(connectionString, run, variation, time);
 
     //Connect!
     if(!calib->Connect(connectionString))
@@ -151,21 +113,34 @@ Calibration* CalibrationGenerator::MakeCalibration( const std::string & connecti
 
 
 //______________________________________________________________________________
-Calibration* CalibrationGenerator::CreateCalibration( bool isMySQL, int run, const std::string& variation, const time_t time )
-{	
-	
-	if (isMySQL)
+Calibration* CalibrationGenerator::CreateCalibrationOfType( const std::string & connectionString, int run, const std::string& variation, const time_t time )
+{
+	/** @brief Creates not connected calibration that works with the connection string type
+	 *
+	 * mysql://, sqlite:// and snapshot:// are known types
+	 * @throw std::logic_error if the type is unknown or CCDB was compiled without its support
+	 */
+	if(connectionString.find("mysql://")==0)
 	{
-        #ifdef CCDB_MYSQL
+		#ifdef CCDB_MYSQL
 			return new MySQLCalibration(run, variation, time);
 		#else
-			return NULL;
+			throw std::logic_error("Cannot be used with MySQL database. CCDB was compiled without MySQL support! Recompile CCDB using with-mysql=true flag. The connection string: " + connectionString);
 		#endif //CCDB_MYSQL
 	}
-	else
+
+	if(connectionString.find("sqlite://")==0)
 	{
 		return new SQLiteCalibration(run, variation, time);
 	}
+
+	if(connectionString.find("snapshot://")==0)
+	{
+		return new SnapshotCalibration(run, variation, time);
+	}
+
+	//something wrong here!!!
+	throw std::logic_error("Unknown connection string type. mysql://, sqlite:// and snapshot:// are only known types now. The connection string: " + connectionString);
 }
 
 
@@ -0,0 +1,88 @@
+#include "CCDB/CalibrationWorkerPool.h"
+
+namespace ccdb
+{
+
+//______________________________________________________________________________
+CalibrationWorkerPool::CalibrationWorkerPool(size_t threadsCount)
+{
+    mIsStopped = false;
+    if(threadsCount == 0) threadsCount = 1;
+    for(size_t i = 0; i < threadsCount; i++)
+    {
+        mThreads.push_back(std::thread([this]() { Run(); }));
+    }
+}
+
+
+//______________________________________________________________________________
+CalibrationWorkerPool::~CalibrationWorkerPool()
+{
+    Stop();
+}
+
+
+//______________________________________________________________________________
+void CalibrationWorkerPool::Submit(const Task& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(!mIsStopped)
+        {
+            mTasks.push_back(task);
+            mHasTask.notify_one();
+            return;
+        }
+    }
+    task(false);
+}
+
+
+//______________________________________________________________________________
+void CalibrationWorkerPool::Stop()
+{
+    /** @brief Cancels queued tasks and waits for running ones
+     *
+     * Queued tasks are called with false by this thread after the workers are joined
+     */
+    std::deque<Task> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(mIsStopped) return;
+        mIsStopped = true;
+        cancelled.swap(mTasks);
+    }
+    mHasTask.notify_all();
+
+    for(size_t i = 0; i < mThreads.size(); i++) mThreads[i].join();
+
+    for(size_t i = 0; i < cancelled.size(); i++) cancelled[i](false);
+}
+
+
+//______________________________________________________________________________
+size_t CalibrationWorkerPool::GetQueuedCount()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mTasks.size();
+}
+
+
+//______________________________________________________________________________
+void CalibrationWorkerPool::Run()
+{
+    for(;;)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mHasTask.wait(lock, [this]() { return mIsStopped || !mTasks.empty(); });
+            if(mIsStopped) return;
+            task = mTasks.front();
+            mTasks.pop_front();
+        }
+        task(true);
+    }
+}
+
+}
@@ -0,0 +1,132 @@
+#include <stdexcept>
+
+#include "CCDB/ConstantsView.h"
+
+using namespace std;
+
+namespace ccdb
+{
+
+//______________________________________________________________________________
+ConstantsView::ConstantsView()
+{
+}
+
+
+//______________________________________________________________________________
+ConstantsView::ConstantsView(const shared_ptr<Assignment>& assignment, const shared_ptr<const vector<double> >& rowMajor)
+{
+    /** @brief Builds view of assignment values
+     *
+     * Row-major values are referenced, column-major values are made here once
+     */
+    if(!assignment || !rowMajor || !assignment->GetTypeTable()) return;
+
+    shared_ptr<Data> data = make_shared<Data>();
+    data->Source = assignment;
+    data->RowMajor = rowMajor;
+
+    const vector<ConstantsTypeColumn *>& columns = assignment->GetTypeTable()->GetColumns();
+    data->ColumnsCount = assignment->GetTypeTable()->GetColumnsCount();
+    data->RowsCount = data->ColumnsCount ? rowMajor->size() / data->ColumnsCount : 0;
+
+    for(size_t i = 0; i < columns.size(); i++)
+    {
+        data->ColumnNames.push_back(columns[i]->GetName());
+        data->ColumnTypes.push_back(columns[i]->GetType());
+        data->ColumnIndexes[columns[i]->GetName()] = i;
+    }
+
+    //transpose
+    data->ColumnMajor.resize(data->RowsCount * data->ColumnsCount);
+    for(size_t row = 0; row < data->RowsCount; row++)
+    {
+        for(size_t column = 0; column < data->ColumnsCount; column++)
+        {
+            data->ColumnMajor[column * data->RowsCount + row] = (*rowMajor)[row * data->ColumnsCount + column];
+        }
+    }
+
+    mData = data;
+}
+
+
+//______________________________________________________________________________
+DoubleSpan ConstantsView::GetRow(size_t row) const
+{
+    DoubleSpan span = {NULL, 0};
+    if(!mData || row >= mData->RowsCount) return span;
+
+    span.Data = mData->RowMajor->data() + row * mData->ColumnsCount;
+    span.Size = mData->ColumnsCount;
+    return span;
+}
+
+
+//______________________________________________________________________________
+DoubleSpan ConstantsView::GetColumn(size_t column) const
+{
+    DoubleSpan span = {NULL, 0};
+    if(!mData || column >= mData->ColumnsCount) return span;
+
+    span.Data = mData->ColumnMajor.data() + column * mData->RowsCount;
+    span.Size = mData->RowsCount;
+    return span;
+}
+
+
+//______________________________________________________________________________
+int ConstantsView::GetColumnIndex(const string& columnName) const
+{
+    if(!mData) return -1;
+
+    auto found = mData->ColumnIndexes.find(columnName);
+    if(found == mData->ColumnIndexes.end()) return -1;
+    return (int)found->second;
+}
+
+
+//______________________________________________________________________________
+size_t ConstantsView::GetColumnIndexChecked(const string& columnName) const
+{
+    int index = GetColumnIndex(columnName);
+    if(index < 0) throw std::out_of_range("ConstantsView. There is no column '" + columnName + "'");
+    return (size_t)index;
+}
+
+
+//______________________________________________________________________________
+const vector<string>& ConstantsView::GetColumnNames() const
+{
+    static const vector<string> noNames;
+    return mData ? mData->ColumnNames : noNames;
+}
+
+
+//______________________________________________________________________________
+ConstantsTypeColumn::ColumnTypes ConstantsView::GetColumnType(size_t column) const
+{
+    if(!mData || column >= mData->ColumnTypes.size()) return ConstantsTypeColumn::cDoubleColumn;
+    return mData->ColumnTypes[column];
+}
+
+
+//______________________________________________________________________________
+size_t ConstantsView::GetStorageSize() const
+{
+    /** @brief Memory in bytes that the view adds to row-major values and the assignment
+     *
+     * Row-major values are shared with the assignments cache and are not counted
+     */
+    if(!mData) return 0;
+
+    size_t size = sizeof(Data) + mData->ColumnMajor.capacity() * sizeof(double);
+    for(size_t i = 0; i < mData->ColumnNames.size(); i++)
+    {
+        //name in the names vector and in the index
+        size += 2 * (sizeof(string) + mData->ColumnNames[i].capacity()) + sizeof(size_t) + sizeof(ConstantsTypeColumn::ColumnTypes);
+    }
+    return size;
+}
+
+}
@@ -0,0 +1,377 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+
+#include "CCDB/Helpers/BinaryVault.h"
+
+using namespace std;
+
+namespace ccdb
+{
+
+static const char gBinaryVaultMagic[BinaryVault::MagicSize] = { 0x1B, 'C', 'V', 'B' };
+
+//______________________________________________________________________________
+static size_t BinaryVault_ValueSize(ConstantsTypeColumn::ColumnTypes type)
+{
+    /** @brief Bytes of one value of the column type. 0 for string columns */
+    switch(type)
+    {
+    case ConstantsTypeColumn::cIntColumn:
+    case ConstantsTypeColumn::cUIntColumn:   return 4;
+    case ConstantsTypeColumn::cLongColumn:
+    case ConstantsTypeColumn::cULongColumn:
+    case ConstantsTypeColumn::cDoubleColumn: return 8;
+    case ConstantsTypeColumn::cBoolColumn:   return 1;
+    default:                                 return 0;
+    }
+}
+
+
+//______________________________________________________________________________
+static void BinaryVault_Write(string &blob, uint64_t value, size_t bytes)
+{
+    for(size_t i = 0; i < bytes; i++) blob.push_back((char)((value >> (8 * i)) & 0xFF));
+}
+
+
+//______________________________________________________________________________
+static uint64_t BinaryVault_Read(const char *data, size_t bytes)
+{
+    const unsigned char *bytesData = reinterpret_cast<const unsigned char *>(data);
+    uint64_t value = 0;
+    for(size_t i = 0; i < bytes; i++) value |= (uint64_t)bytesData[i] << (8 * i);
+    return value;
+}
+
+
+//______________________________________________________________________________
+static bool BinaryVault_ParseULong(const string &cell, unsigned long long &value)
+{
+    /** @brief Parses cell of ulong column. Only digits are allowed */
+    if(cell.empty() || cell.size() > 20) return false;
+    for(size_t i = 0; i < cell.size(); i++)
+    {
+        if(cell[i] < '0' || cell[i] > '9') return false;
+    }
+    char *end = NULL;
+    value = strtoull(cell.c_str(), &end, 10);
+    return end == cell.c_str() + cell.size() && !(value == ULLONG_MAX && cell != "18446744073709551615");
+}
+
+
+//______________________________________________________________________________
+static bool BinaryVault_EncodeCell(const string &cell, ConstantsTypeColumn::ColumnTypes type, uint64_t &bits)
+{
+    /** @brief Converts cell to bits of the column type
+     *
+     * Integer cells must be in canonical form, so they are read back as the same text
+     */
+    switch(type)
+    {
+    case ConstantsTypeColumn::cIntColumn:
+    case ConstantsTypeColumn::cLongColumn:
+    {
+        long value;
+        if(!NumberParsers::ParseLong(cell.data(), cell.size(), value)) return false;
+        if(type == ConstantsTypeColumn::cIntColumn && (value < INT_MIN || value > INT_MAX)) return false;
+        char text[32];
+        sprintf(text, "%ld", value);
+        if(cell != text) return false;
+        bits = (uint64_t)(long long)value;
+        return true;
+    }
+    case ConstantsTypeColumn::cUIntColumn:
+    case ConstantsTypeColumn::cULongColumn:
+    {
+        unsigned long long value;
+        if(!BinaryVault_ParseULong(cell, value)) return false;
+        if(type == ConstantsTypeColumn::cUIntColumn && value > UINT_MAX) return false;
+        char text[32];
+        sprintf(text, "%llu", value);
+        if(cell != text) return false;
+        bits = value;
+        return true;
+    }
+    case ConstantsTypeColumn::cDoubleColumn:
+    {
+        double value;
+        if(!NumberParsers::ParseDouble(cell.data(), cell.size(), value)) return false;
+        memcpy(&bits, &value, sizeof(value));
+        return true;
+    }
+    case ConstantsTypeColumn::cBoolColumn:
+        if(cell != "0" && cell != "1") return false;
+        bits = (cell == "1");
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+//______________________________________________________________________________
+size_t BinaryVault::Layout::GetStorageSize() const
+{
+    size_t size = Types.capacity() * sizeof(ConstantsTypeColumn::ColumnTypes) + ColumnOffsets.capacity() * sizeof(size_t);
+    for(size_t i = 0; i < Strings.size(); i++) size += Strings[i].capacity() * sizeof(StringCell);
+    return size + Strings.capacity() * sizeof(vector<StringCell>);
+}
+
+
+//______________________________________________________________________________
+bool BinaryVault::IsBinary(const char *data, size_t size)
+{
+    return size >= MagicSize && memcmp(data, gBinaryVaultMagic, MagicSize) == 0;
+}
+
+
+//______________________________________________________________________________
+bool BinaryVault::IsCompressed(const char *data, size_t size)
+{
+    return size >= CompressedHeaderSize && IsBinary(data, size) && ((unsigned char)data[MagicSize + 1] & FlagCompressed);
+}
+
+
+//______________________________________________________________________________
+bool BinaryVault::Compress(const string &blob, const VaultCodec &codec, string &compressed)
+{
+    if(IsCompressed(blob) || blob.size() > UINT32_MAX) return false;
+
+    string payload;
+    if(!codec.Compress(blob.data(), blob.size(), payload)) return false;
+
+    compressed.clear();
+    compressed.reserve(CompressedHeaderSize + payload.size());
+    compressed.append(gBinaryVaultMagic, MagicSize);
+    compressed.push_back((char)Version);
+    compressed.push_back((char)FlagCompressed);
+    compressed.push_back((char)codec.GetId());
+    BinaryVault_Write(compressed, blob.size(), 4);
+    compressed.append(payload);
+    return true;
+}
+
+
+//______________________________________________________________________________
+bool BinaryVault::Decompress(const char *data, size_t size, string &blob)
+{
+    if(!IsCompressed(data, size) || (unsigned char)data[MagicSize] != Version) return false;
+
+    const VaultCodec *codec = VaultCodec::Find((unsigned char)data[MagicSize + 2]);
+    if(!codec) return false;
+
+    size_t originalSize = (size_t)BinaryVault_Read(data + MagicSize + 3, 4);
+    return codec->Decompress(data + CompressedHeaderSize, size - CompressedHeaderSize, originalSize, blob);
+}
+
+
+//______________________________________________________________________________
+bool BinaryVault::Encode(const vector<string> &cells, const vector<ConstantsTypeColumn::ColumnTypes> &types, string &blob)
+{
+    /** @brief Encodes cells to binary vault. @see BinaryVault */
+    size_t columns = types.size();
+    if(columns == 0 || cells.size() % columns != 0) return false;
+    size_t rows = cells.size() / columns;
+
+    //each column is stored as its type if all its cells are values of the type
+    vector<ConstantsTypeColumn::ColumnTypes> storedTypes(types);
+    vector<uint64_t> bits(cells.size());
+    for(size_t column = 0; column < columns; column++)
+    {
+        for(size_t row = 0; row < rows; row++)
+        {
+            size_t index = row * columns + column;
+            if(!BinaryVault_EncodeCell(cells[index], storedTypes[column], bits[index]))
+            {
+                storedTypes[column] = ConstantsTypeColumn::cStringColumn;
+                break;
+            }
+        }
+    }
+
+    blob.clear();
+    blob.append(gBinaryVaultMagic, MagicSize);
+    blob.push_back((char)Version);
+    blob.push_back(0);
+    BinaryVault_Write(blob, rows, 4);
+    BinaryVault_Write(blob, columns, 4);
+    for(size_t column = 0; column < columns; column++) blob.push_back((char)storedTypes[column]);
+
+    for(size_t column = 0; column < columns; column++)
+    {
+        size_t valueSize = BinaryVault_ValueSize(storedTypes[column]);
+        for(size_t row = 0; row < rows; row++)
+        {
+            size_t index = row * columns + column;
+            if(valueSize)
+            {
+                BinaryVault_Write(blob, bits[index], valueSize);
+            }
+            else
+            {
+                BinaryVault_Write(blob, cells[index].size(), 4);
+                blob.append(cells[index]);
+            }
+        }
+    }
+    return true;
+}
+
+
+//______________________________________________________________________________
+bool BinaryVault::Decode(const char *data, size_t size, Layout &layout)
+{
+    /** @brief Checks the blob and finds its columns. @see BinaryVault */
+    layout.RowsCount = 0;
+    layout.Types.clear();
+    layout.ColumnOffsets.clear();
+    layout.Strings.clear();
+
+    if(size < HeaderSize || !IsBinary(data, size)) return false;
+    if((unsigned char)data[MagicSize] != Version || data[MagicSize + 1] != 0) return false;
+
+    uint64_t rows = BinaryVault_Read(data + 6, 4);
+    uint64_t columns = BinaryVault_Read(data + 10, 4);
+    if(columns > size - HeaderSize) return false;
+
+    size_t offset = HeaderSize + (size_t)columns;
+    layout.RowsCount = (size_t)rows;
+    layout.Types.resize((size_t)columns);
+    layout.ColumnOffsets.resize((size_t)columns);
+    layout.Strings.resize((size_t)columns);
+
+    for(size_t column = 0; column < columns; column++)
+    {
+        unsigned char type = (unsigned char)data[HeaderSize + column];
+        if(type > ConstantsTypeColumn::cStringColumn) return false;
+        layout.Types[column] = (ConstantsTypeColumn::ColumnTypes)type;
+        layout.ColumnOffsets[column] = offset;
+
+        size_t valueSize = BinaryVault_ValueSize(layout.Types[column]);
+        if(valueSize)
+        {
+            if(rows > (size - offset) / valueSize) return false;
+            offset += (size_t)rows * valueSize;
+            continue;
+        }
+
+        //string column: length and characters of each row
+        if(rows > (size - offset) / 4) return false;
+        vector<Layout::StringCell> &strings = layout.Strings[column];
+        strings.resize((size_t)rows);
+        for(size_t row = 0; row < rows; row++)
+        {
+            if(size - offset < 4) return false;
+            size_t length = (size_t)BinaryVault_Read(data + offset, 4);
+            offset += 4;
+            if(length > size - offset) return false;
+            strings[row].Offset = offset;
+            strings[row].Length = length;
+            offset += length;
+        }
+    }
+    return offset == size;
+}
+
+
+//______________________________________________________________________________
+bool BinaryVault::ReadNumber(const char *data, const Layout &layout, size_t row, size_t column, long long &integer, double &real)
+{
+    ConstantsTypeColumn::ColumnTypes type = layout.Types[column];
+    size_t valueSize = BinaryVault_ValueSize(type);
+    if(!valueSize) return false;
+
+    uint64_t bits = BinaryVault_Read(data + layout.ColumnOffsets[column] + row * valueSize, valueSize);
+    switch(type)
+    {
+    case ConstantsTypeColumn::cIntColumn:
+        integer = (int32_t)(uint32_t)bits;
+        real = (double)integer;
+        break;
+    case ConstantsTypeColumn::cULongColumn:
+        integer = (long long)bits;
+        real = (double)bits;
+        break;
+    case ConstantsTypeColumn::cDoubleColumn:
+        memcpy(&real, &bits, sizeof(real));
+        integer = (long long)real;
+        break;
+    default:        //uint, long, bool
+        integer = (long long)bits;
+        real = (double)integer;
+        break;
+    }
+    return true;
+}
+
+
+//______________________________________________________________________________
+CharSpan BinaryVault::ReadString(const char *data, const Layout &layout, size_t row, size_t column)
+{
+    const Layout::StringCell &cell = layout.Strings[column][row];
+    CharSpan span = { data + cell.Offset, cell.Length };
+    return span;
+}
+
+
+//______________________________________________________________________________
+void BinaryVault::AppendCellText(const char *data, const Layout &layout, size_t row, size_t column, string &text)
+{
+    ConstantsTypeColumn::ColumnTypes type = layout.Types[column];
+    if(type == ConstantsTypeColumn::cStringColumn)
+    {
+        CharSpan span = ReadString(data, layout, row, column);
+        text.append(span.Data, span.Length);
+        return;
+    }
+
+    long long integer;
+    double real;
+    ReadNumber(data, layout, row, column, integer, real);
+
+    char buffer[32];
+    switch(type)
+    {
+    case ConstantsTypeColumn::cDoubleColumn:
+        AppendDouble(real, text);
+        return;
+    case ConstantsTypeColumn::cULongColumn:
+        sprintf(buffer, "%llu", (unsigned long long)integer);
+        break;
+    default:
+        sprintf(buffer, "%lld", integer);
+        break;
+    }
+    text.append(buffer);
+}
+
+
+//______________________________________________________________________________
+void BinaryVault::AppendDouble(double value, string &text)
+{
+    /** @brief Shortest of %.15g, %.16g, %.17g that is parsed back to the same value
+     *
+     * The decimal point of the current locale is replaced by '.'
+     */
+    char buffer[32];
+    for(int precision = 15; precision <= 17; precision++)
+    {
+        int length = snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+        for(int i = 0; i < length; i++)
+        {
+            if(buffer[i] == ',') buffer[i] = '.';
+        }
+
+        double parsed;
+        if(precision == 17 || (NumberParsers::ParseDouble(buffer, length, parsed) && parsed == value))
+        {
+            text.append(buffer, length);
+            return;
+        }
+    }
+}
+
+}
@@ -0,0 +1,273 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <locale.h>
+#include <stdint.h>
+#include <string>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+
+#include "CCDB/Helpers/NumberParsers.h"
+#include "CCDB/Helpers/StringUtils.h"
+
+using namespace std;
+
+//8 digits at once conversion relies on little endian byte order
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_M_X64) || defined(_M_IX86)
+#define CCDB_NUMBER_PARSERS_SWAR 1
+#endif
+
+namespace ccdb
+{
+
+//Powers of 10 that are exactly representable as double
+static const double gNumberParsersPowersOf10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const int gNumberParsersMaxFastExponent = 22;
+static const int gNumberParsersMaxDigits = 19;        //19 decimal digits always fit uint64_t
+
+
+//______________________________________________________________________________
+static inline bool NumberParsersIsDigit(char c)
+{
+    return (unsigned char)(c - '0') < 10;
+}
+
+
+//______________________________________________________________________________
+static inline void NumberParsersTrim(const char *&begin, const char *&end)
+{
+    while(begin < end && CCDB_CHECK_CHAR_IS_BLANK(*begin)) begin++;
+    while(end > begin && CCDB_CHECK_CHAR_IS_BLANK(*(end - 1))) end--;
+}
+
+
+#ifdef CCDB_NUMBER_PARSERS_SWAR
+//______________________________________________________________________________
+static inline bool NumberParsersReadEightDigits(const char *p, uint32_t &value)
+{
+    /** @brief Converts 8 digits at once if all 8 chars are digits */
+    uint64_t chunk;
+    memcpy(&chunk, p, sizeof(chunk));
+
+    //all bytes are in '0'..'9'
+    if(((chunk & 0xF0F0F0F0F0F0F0F0ULL) | (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) != 0x3333333333333333ULL) return false;
+
+    chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+    chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+    value = (uint32_t)(((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32);
+    return true;
+}
+#endif
+
+
+//______________________________________________________________________________
+static const char *NumberParsersReadDigits(const char *p, const char *end, uint64_t &mantissa, int &significantDigits)
+{
+    /** @brief Reads consecutive digits to mantissa
+     *
+     * Leading zeros of the mantissa are not counted as significant digits.
+     * If there are more than gNumberParsersMaxDigits significant digits, the mantissa is not valid
+     * but all digits are read anyway
+     * @return pointer to the first not digit char
+     */
+#ifdef CCDB_NUMBER_PARSERS_SWAR
+    uint32_t eightDigits;
+    while(end - p >= 8 && significantDigits + 8 <= gNumberParsersMaxDigits && NumberParsersReadEightDigits(p, eightDigits))
+    {
+        if(mantissa != 0) significantDigits += 8;
+        else for(uint32_t rest = eightDigits; rest != 0; rest /= 10) significantDigits++;   //from the first not zero digit
+        mantissa = mantissa * 100000000ULL + eightDigits;
+        p += 8;
+    }
+#endif
+    for(; p < end && NumberParsersIsDigit(*p); p++)
+    {
+        if(mantissa == 0 && *p == '0') continue;    //leading zero
+        if(significantDigits < gNumberParsersMaxDigits) mantissa = mantissa * 10 + (*p - '0');
+        significantDigits++;
+    }
+    return p;
+}
+
+
+//______________________________________________________________________________
+static double NumberParsersStrtod(const char *str, char **stop)
+{
+    /** @brief strtod with "C" locale i.e. '.' is always the decimal point */
+#if defined(__GLIBC__) || defined(__APPLE__)
+    static locale_t cLocale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+    return strtod_l(str, stop, cLocale);
+#elif defined(_MSC_VER)
+    static _locale_t cLocale = _create_locale(LC_ALL, "C");
+    return _strtod_l(str, stop, cLocale);
+#else
+    return strtod(str, stop);
+#endif
+}
+
+
+//______________________________________________________________________________
+bool NumberParsers::ParseDouble(const char *data, size_t length, double &value)
+{
+    value = 0;
+    const char *begin = data;
+    const char *end = data + length;
+    NumberParsersTrim(begin, end);
+    if(begin == end) return false;
+
+    //fast path: [sign]digits[.digits][e[sign]digits]
+    const char *p = begin;
+    bool negative = false;
+    if(*p == '-' || *p == '+')
+    {
+        negative = (*p == '-');
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int significantDigits = 0;
+
+    const char *intBegin = p;
+    p = NumberParsersReadDigits(p, end, mantissa, significantDigits);
+    int digitsCount = (int)(p - intBegin);
+
+    int fractionDigits = 0;
+    if(p < end && *p == '.')
+    {
+        p++;
+        const char *fractionBegin = p;
+        p = NumberParsersReadDigits(p, end, mantissa, significantDigits);
+        fractionDigits = (int)(p - fractionBegin);
+        digitsCount += fractionDigits;
+    }
+
+    int exponent = 0;
+    bool exponentIsValid = true;
+    if(digitsCount > 0 && p < end && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+        bool negativeExponent = false;
+        if(p < end && (*p == '-' || *p == '+'))
+        {
+            negativeExponent = (*p == '-');
+            p++;
+        }
+        if(p == end || !NumberParsersIsDigit(*p)) exponentIsValid = false;
+        for(; p < end && NumberParsersIsDigit(*p); p++)
+        {
+            if(exponent < 100000) exponent = exponent * 10 + (*p - '0');
+        }
+        if(negativeExponent) exponent = -exponent;
+    }
+
+    if(p == end && digitsCount > 0 && exponentIsValid && significantDigits <= gNumberParsersMaxDigits)
+    {
+        if(mantissa == 0)
+        {
+            value = negative ? -0.0 : 0.0;
+            return true;
+        }
+
+        //mantissa and power of 10 are exact, so one multiplication or division is correctly rounded
+        int power = exponent - fractionDigits;
+        if(mantissa <= (1ULL << 53) && power >= -gNumberParsersMaxFastExponent && power <= gNumberParsersMaxFastExponent)
+        {
+            double result = (double)mantissa;
+            if(power < 0) result /= gNumberParsersPowersOf10[-power];
+            else          result *= gNumberParsersPowersOf10[power];
+            value = negative ? -result : result;
+            return true;
+        }
+    }
+
+    //slow path: nan, inf, long mantissas, big exponents and errors
+    string buffer(begin, end);
+    char *stop = NULL;
+    double result = NumberParsersStrtod(buffer.c_str(), &stop);
+    if(stop != buffer.c_str() + buffer.size()) return false;
+
+    value = result;
+    return true;
+}
+
+
+//______________________________________________________________________________
+bool NumberParsers::ParseLong(const char *data, size_t length, long &value)
+{
+    value = 0;
+    const char *p = data;
+    const char *end = data + length;
+    NumberParsersTrim(p, end);
+
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+    if(p == end) return false;
+
+    uint64_t magnitude = 0;
+    int significantDigits = 0;
+    p = NumberParsersReadDigits(p, end, magnitude, significantDigits);
+    if(p != end || significantDigits > gNumberParsersMaxDigits) return false;
+
+    //range check
+    uint64_t limit = negative ? (uint64_t)LONG_MAX + 1 : (uint64_t)LONG_MAX;
+    if(magnitude > limit) return false;
+
+    value = negative ? (long)(0 - magnitude) : (long)magnitude;
+    return true;
+}
+
+
+//______________________________________________________________________________
+bool NumberParsers::ParseInt(const char *data, size_t length, int &value)
+{
+    value = 0;
+    long result;
+    if(!ParseLong(data, length, result)) return false;
+    if(result < INT_MIN || result > INT_MAX) return false;
+
+    value = (int)result;
+    return true;
+}
+
+
+//______________________________________________________________________________
+size_t NumberParsers::ParseDoubles(const CharSpan *cells, size_t count, double *output, vector<size_t> *failedCells/*=NULL*/)
+{
+    size_t failedCount = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        if(!ParseDouble(cells[i].Data, cells[i].Length, output[i]))
+        {
+            failedCount++;
+            if(failedCells) failedCells->push_back(i);
+        }
+    }
+    return failedCount;
+}
+
+
+//______________________________________________________________________________
+size_t NumberParsers::ParseInts(const CharSpan *cells, size_t count, int *output, vector<size_t> *failedCells/*=NULL*/)
+{
+    size_t failedCount = 0;
+    for(size_t i = 0; i < count; i++)
+    {
+        if(!ParseInt(cells[i].Data, cells[i].Length, output[i]))
+        {
+            failedCount++;
+            if(failedCells) failedCells->push_back(i);
+        }
+    }
+    return failedCount;
+}
+
+}
@@ -1,6 +1,7 @@
 #include <cstdlib>
 
 #include "CCDB/Helpers/StringUtils.h"
+#include "CCDB/Helpers/NumberParsers.h"
 
 using namespace std;
 using namespace ccdb;
@@ -340,7 +341,15 @@ vector<string> & ccdb::StringUtils::Split( const string& str, vector<string>& to
 //______________________________________________________________________________
 int ccdb::StringUtils::ParseInt( const string& source, bool *result/*=NULL*/  )
 {
-    return atoi(source.c_str()); //ugly isn't it?
+    /** @brief Parses int with NumberParsers::ParseInt
+     *
+     * If source is not an int, *result is set to false and
+     * the value atoi would give is returned (for backward compatibility)
+     */
+    int value;
+    bool isParsed = NumberParsers::ParseInt(source.data(), source.size(), value);
+    if(result) *result = isParsed;
+    return isParsed ? value : atoi(source.c_str());
 }
 
 
@@ -354,7 +363,11 @@ unsigned int ccdb::StringUtils::ParseUInt( const string& source, bool *result/*=
 //______________________________________________________________________________
 long ccdb::StringUtils::ParseLong( const string& source, bool *result/*=NULL*/  )
 {
-    return atol(source.c_str()); //ugly isn't it?
+    /** @brief Parses long with NumberParsers::ParseLong. @see ParseInt */
+    long value;
+    bool isParsed = NumberParsers::ParseLong(source.data(), source.size(), value);
+    if(result) *result = isParsed;
+    return isParsed ? value : atol(source.c_str());
 }
 
 
@@ -377,7 +390,11 @@ bool ccdb::StringUtils::ParseBool( const string& source, bool *result/*=NULL*/
 //___________________________________________________________________________________
 double ccdb::StringUtils::ParseDouble( const string& source, bool *result/*=NULL*/  )
 {
-    return atof(source.c_str()); //ugly isn't it?
+    /** @brief Parses double with NumberParsers::ParseDouble (locale independent). @see ParseInt */
+    double value;
+    bool isParsed = NumberParsers::ParseDouble(source.data(), source.size(), value);
+    if(result) *result = isParsed;
+    return isParsed ? value : atof(source.c_str());
 }
 
 //_______________________________________________________________________________________
@@ -0,0 +1,104 @@
+#include <map>
+#include <mutex>
+#include <memory>
+
+#include <zlib.h>
+
+#include "CCDB/Helpers/VaultCodec.h"
+
+using namespace std;
+
+namespace ccdb
+{
+
+//______________________________________________________________________________
+const unsigned char ZlibVaultCodec::Id;
+
+
+//______________________________________________________________________________
+static map<unsigned char, unique_ptr<VaultCodec> >& VaultCodec_GetCodecs(unique_lock<mutex> &lock)
+{
+    /** @brief Registered codecs. zlib is added on the first call. The lock is taken for the caller */
+    static mutex codecsMutex;
+    static map<unsigned char, unique_ptr<VaultCodec> > codecs;
+
+    lock = unique_lock<mutex>(codecsMutex);
+    if(codecs.empty()) codecs[ZlibVaultCodec::Id].reset(new ZlibVaultCodec());
+    return codecs;
+}
+
+
+//______________________________________________________________________________
+bool VaultCodec::Register(VaultCodec *codec)
+{
+    unique_ptr<VaultCodec> owned(codec);
+    unique_lock<mutex> lock;
+    map<unsigned char, unique_ptr<VaultCodec> >& codecs = VaultCodec_GetCodecs(lock);
+    if(!codec || codec->GetId() == 0 || codecs.count(codec->GetId())) return false;
+
+    codecs[codec->GetId()] = move(owned);
+    return true;
+}
+
+
+//______________________________________________________________________________
+const VaultCodec *VaultCodec::Find(unsigned char id)
+{
+    unique_lock<mutex> lock;
+    map<unsigned char, unique_ptr<VaultCodec> >& codecs = VaultCodec_GetCodecs(lock);
+    map<unsigned char, unique_ptr<VaultCodec> >::const_iterator it = codecs.find(id);
+    return it == codecs.end() ? NULL : it->second.get();
+}
+
+
+//______________________________________________________________________________
+const VaultCodec *VaultCodec::Find(const string &name)
+{
+    unique_lock<mutex> lock;
+    map<unsigned char, unique_ptr<VaultCodec> >& codecs = VaultCodec_GetCodecs(lock);
+    for(map<unsigned char, unique_ptr<VaultCodec> >::const_iterator it = codecs.begin(); it != codecs.end(); ++it)
+    {
+        if(it->second->GetName() == name) return it->second.get();
+    }
+    return NULL;
+}
+
+
+//______________________________________________________________________________
+bool ZlibVaultCodec::Compress(const char *data, size_t size, string &output) const
+{
+    uLongf compressedSize = compressBound((uLong)size);
+    output.resize(compressedSize);
+    int result = compress2((Bytef *)&output[0], &compressedSize, (const Bytef *)data, (uLong)size, mLevel);
+    if(result != Z_OK)
+    {
+        output.clear();
+        return false;
+    }
+    output.resize(compressedSize);
+    return true;
+}
+
+
+//______________________________________________________________________________
+bool ZlibVaultCodec::Decompress(const char *data, size_t size, size_t originalSize, string &output) const
+{
+    //deflate doesn't compress better than ~1032:1, so bigger size is a broken header
+    if(originalSize / 1032 > size + 1) return false;
+
+    output.resize(originalSize);
+    uLongf decompressedSize = (uLongf)originalSize;
+
+    //uncompress needs a not NULL buffer even for empty output
+    char empty = 0;
+    Bytef *buffer = originalSize ? (Bytef *)&output[0] : (Bytef *)&empty;
+    int result = uncompress(buffer, &decompressedSize, (const Bytef *)data, (uLong)size);
+    if(result != Z_OK || decompressedSize != originalSize)
+    {
+        output.clear();
+        return false;
+    }
+    return true;
+}
+
+}
@@ -7,10 +7,16 @@
 #include <vector>
 #include <sstream>
 #include <assert.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "CCDB/Model/Assignment.h"
 #include "CCDB/Helpers/StringUtils.h"
 #include "CCDB/Globals.h"
+#include "CCDB/Log.h"
 
 using namespace ccdb;
 using namespace std;
@@ -21,6 +27,8 @@ ccdb::Assignment::Assignment( ObjectsOwner * owner/*=NULL*/, DataProvider *provi
 :StoredObject(owner, provider)
 {
 	mRawData = string(); 	// data blob
+	mIsBinary = false;		// data blob is a binary vault
+	mHasCells = true;		// empty text blob has no cells
 	mId=0;					// id in database
 	mDataBlobId   = 0;		// blob id in database
 	mVariationId  = 0;		// database ID of variation
@@ -218,6 +226,15 @@ string ccdb::Assignment::VectorToBlob(const vector<string>& values)
 }
 
 
+//______________________________________________________________________________
+string ccdb::Assignment::VectorToBinaryBlob(const vector<string>& values, const vector<ConstantsTypeColumn::ColumnTypes>& types)
+{
+	string result;
+	if(!BinaryVault::Encode(values, types, result)) result.clear();
+	return result;
+}
+
+
 //______________________________________________________________________________
 vector<map<string,string> > ccdb::Assignment::GetMappedData() const
 {
@@ -231,10 +248,23 @@ vector<map<string,string> > ccdb::Assignment::GetMappedData() const
 void ccdb::Assignment::GetMappedData(vector<map<string, string> >& mappedData) const
 {
     assert(mTypeTable !=NULL); // it is DataProvider work
-    	
-	//fill data
-	MapData(mappedData, GetVectorData(), mTypeTable->GetColumnNames() );
-	
+	PrepareCells();
+
+	vector<string> columns = mTypeTable->GetColumnNames();
+	assert(columns.size() != 0);
+
+	//fill data right from the cells
+	size_t rows = mCells.size() / columns.size();
+	mappedData.reserve(mappedData.size() + rows);
+	for (size_t rowIter = 0; rowIter < rows; rowIter++)
+	{
+		map<string,string> line;
+		for(size_t colIter = 0; colIter < columns.size(); colIter++)
+		{
+			line[columns[colIter]] = GetCell(rowIter*columns.size() + colIter);
+		}
+		mappedData.push_back(line);
+	}
 }
 
 
@@ -263,9 +293,23 @@ void ccdb::Assignment::GetData(std::vector<std::vector<std::string> >& data) con
 
 	//clear before filling
 	data.clear();
+	PrepareCells();
 
-	//fill data
-	MapData(data, GetVectorData(), mTypeTable->GetColumnsCount());
+	size_t columnsNum = mTypeTable->GetColumnsCount();
+	if(mCells.size() == 0) return;
+	assert(columnsNum!=0);
+
+	//fill data right from the cells
+	size_t rows = mCells.size() / columnsNum;
+	data.resize(rows);
+	for (size_t rowIter = 0; rowIter < rows; rowIter++)
+	{
+		data[rowIter].resize(columnsNum);
+		for(size_t colIter = 0; colIter < columnsNum; colIter++)
+		{
+			data[rowIter][colIter] = GetCell(rowIter*columnsNum + colIter);
+		}
+	}
 }
 
 
@@ -297,69 +341,289 @@ vector<string> ccdb::Assignment::GetVectorData() const
 //______________________________________________________________________________
 void ccdb::Assignment::GetVectorData(vector<string>& vectorData) const
 {
-	//split data
+	//cells are already decoded
+	PrepareCells();
 	vectorData.clear();
-	vector<string>::const_iterator iter = mVectorData.begin();
-	while (iter<mVectorData.end())
-	{	
-		vectorData.push_back(DecodeBlobSeparator(*iter));
-		iter++;
+	vectorData.reserve(mCells.size());
+	const string& buffer = GetCellsBuffer();
+	for (size_t i = 0; i < mCells.size(); i++)
+	{
+		vectorData.push_back(buffer.substr(mCells[i].Begin, mCells[i].End - mCells[i].Begin));
+	}
+}
+
+
+//______________________________________________________________________________
+static size_t FindBlobSpecialChar(const char* data, size_t pos, size_t size)
+{
+	/** @brief Finds the next '|' or '&' in data starting from pos
+	 * @return position of the found char or size if there is no such char
+	 */
+#if defined(__SSE2__) && defined(__GNUC__)
+	//compare 16 chars at once
+	const __m128i pipe = _mm_set1_epi8('|');
+	const __m128i ampersand = _mm_set1_epi8('&');
+	while(pos + 16 <= size)
+	{
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, pipe), _mm_cmpeq_epi8(chunk, ampersand)));
+		if(mask) return pos + __builtin_ctz(mask);
+		pos += 16;
+	}
+#endif
+	for(; pos < size; pos++)
+	{
+		if(data[pos] == '|' || data[pos] == '&') return pos;
 	}
+	return size;
 }
 
+
 //______________________________________________________________________________
 void ccdb::Assignment::SetRawData(std::string val)
 {
-	mVectorData.clear();
-	mRows.clear();
-	mRawData = val;
+	/** @brief Sets data blob and tokenizes it to cells
+	 *
+	 * The blob is scanned once. Cells are separated by '|', empty cells are skipped.
+	 * '&delimiter;' inside a cell is decoded to '|'. If the blob has no '&delimiter;'
+	 * the cells are just positions in the raw blob. Otherwise the decoded characters
+	 * are written to mDecodedData starting from the first '&delimiter;'
+	 */
+	mRawData.swap(val);
+	mDecodedData.clear();
+	mCells.clear();
+
+	//binary blob cells are made from columns when text is requested
+	mIsBinary = BinaryVault::IsBinary(mRawData);
+	if(mIsBinary)
+	{
+		mHasCells = false;
+		if(!BinaryVault::Decode(mRawData.data(), mRawData.size(), mBinaryLayout))
+		{
+			Log::Warning(CCDB_WARNING_VAULT_INVALID, "Assignment::SetRawData",
+				StringUtils::Format("Data blob of assignment %i is not a valid binary vault of version %i", mId, (int)BinaryVault::Version));
+			mBinaryLayout = BinaryVault::Layout();
+			mBinaryLayout.RowsCount = 0;
+		}
+		return;
+	}
+	mHasCells = true;
+
+	static const char delimiterCode[] = "&delimiter;";
+	static const size_t delimiterCodeLen = sizeof(delimiterCode) - 1;
 
-	mVectorData = StringUtils::Split(mRawData, CCDB_DATA_BLOB_DELIMETER);
-	for (size_t i = 0; i < mVectorData.size(); i++)
+	const char *data = mRawData.data();
+	size_t size = mRawData.size();
+	bool decoding = false;      //true after the first '&delimiter;'
+	bool inCell = false;
+	CellSpan cell = {0, 0};
+	size_t out = 0;             //position in cells buffer that corresponds to pos
+	size_t pos = 0;
+
+	while(pos < size)
 	{
-		mVectorData[i] = DecodeBlobSeparator(mVectorData[i]); //Decode blob separators
+		//copy ordinary chars
+		size_t next = FindBlobSpecialChar(data, pos, size);
+		if(next > pos)
+		{
+			if(!inCell) { inCell = true; cell.Begin = out; }
+			if(decoding) mDecodedData.append(data + pos, next - pos);
+			out += next - pos;
+			pos = next;
+		}
+		if(pos >= size) break;
+
+		if(data[pos] == '|')
+		{
+			//end of the cell
+			if(inCell) { cell.End = out; mCells.push_back(cell); inCell = false; }
+			pos++;
+			if(!decoding) out++;
+			continue;
+		}
+
+		//data[pos] == '&'
+		if(!inCell) { inCell = true; cell.Begin = out; }
+		if(size - pos >= delimiterCodeLen && memcmp(data + pos, delimiterCode, delimiterCodeLen) == 0)
+		{
+			//the buffer before the first code is the same as the raw blob
+			if(!decoding) { decoding = true; mDecodedData.assign(data, pos); }
+			mDecodedData.push_back('|');
+			out++;
+			pos += delimiterCodeLen;
+		}
+		else
+		{
+			if(decoding) mDecodedData.push_back('&');
+			out++;
+			pos++;
+		}
 	}
+
+	if(inCell) { cell.End = out; mCells.push_back(cell); }
 }
 
-std::string ccdb::Assignment::GetValue(string columnName)
+
+//______________________________________________________________________________
+size_t ccdb::Assignment::GetStorageSize() const
+{
+	size_t size = mRawData.capacity() + (mIsBinary ? mBinaryLayout.GetStorageSize() : 0);
+	lock_guard<mutex> lock(mCellsMutex);
+	return size + mDecodedData.capacity() + mCells.capacity() * sizeof(CellSpan);
+}
+
+
+//______________________________________________________________________________
+void ccdb::Assignment::PrepareCells() const
 {
-	if (mRows.size() == 0)
+	/** @brief Writes text of binary blob cells row by row to mDecodedData. @see BinaryVault::AppendCellText */
+	if(mHasCells) return;
+
+	lock_guard<mutex> lock(mCellsMutex);
+	if(mHasCells) return;
+
+	size_t rows = mBinaryLayout.RowsCount;
+	size_t columns = mBinaryLayout.GetColumnsCount();
+	mCells.resize(rows * columns);
+	for(size_t row = 0; row < rows; row++)
 	{
-		//fill data
-		MapData(mRows, GetVectorData(), mTypeTable->GetColumnNames());
+		for(size_t column = 0; column < columns; column++)
+		{
+			CellSpan& cell = mCells[row * columns + column];
+			cell.Begin = mDecodedData.size();
+			BinaryVault::AppendCellText(mRawData.data(), mBinaryLayout, row, column, mDecodedData);
+			cell.End = mDecodedData.size();
+		}
 	}
-	return mRows[0][columnName];
+	mHasCells = true;
 }
 
-std::string ccdb::Assignment::GetValue(size_t rowIndex, string columnName)
+
+//______________________________________________________________________________
+template<typename T>
+bool ccdb::Assignment::GetBinaryValuesT(vector<T> &values, vector<size_t> &notNumberCells) const
 {
-	if (mRows.size() == 0)
+	/** @brief Reads numbers column by column and puts them row by row. @see GetBinaryValues */
+	if(!mIsBinary) return false;
+
+	size_t rows = mBinaryLayout.RowsCount;
+	size_t columns = mBinaryLayout.GetColumnsCount();
+	const char *data = mRawData.data();
+	values.resize(rows * columns);
+
+	for(size_t column = 0; column < columns; column++)
 	{
-		//fill data
-		MapData(mRows, GetVectorData(), mTypeTable->GetColumnNames());
+		bool isString = mBinaryLayout.Types[column] == ConstantsTypeColumn::cStringColumn;
+		for(size_t row = 0; row < rows; row++)
+		{
+			size_t index = row * columns + column;
+			long long integer;
+			double real;
+			if(!isString)
+			{
+				BinaryVault::ReadNumber(data, mBinaryLayout, row, column, integer, real);
+				values[index] = (mBinaryLayout.Types[column] == ConstantsTypeColumn::cDoubleColumn) ? (T)real : (T)integer;
+				continue;
+			}
+
+			//string column, the same as text cells are parsed
+			CharSpan span = BinaryVault::ReadString(data, mBinaryLayout, row, column);
+			if(!NumberParsers::ParseDouble(span.Data, span.Length, real))
+			{
+				notNumberCells.push_back(index);
+				values[index] = (T)StringUtils::ParseDouble(string(span.Data, span.Length));
+			}
+			else
+			{
+				values[index] = (T)real;
+			}
+		}
 	}
-	return GetMappedData()[0][columnName];
+	return true;
 }
 
-std::string ccdb::Assignment::GetValue(size_t rowIndex, size_t columnIndex)
+
+//______________________________________________________________________________
+bool ccdb::Assignment::GetBinaryValues(vector<double> &values, vector<size_t> &notNumberCells) const
 {
-	return GetData()[rowIndex][columnIndex];
+	return GetBinaryValuesT(values, notNumberCells);
 }
 
-std::string ccdb::Assignment::GetValue(size_t columnIndex)
+
+//______________________________________________________________________________
+bool ccdb::Assignment::GetBinaryValues(vector<int> &values, vector<size_t> &notNumberCells) const
 {
-	return GetVectorData()[columnIndex];
+	return GetBinaryValuesT(values, notNumberCells);
 }
 
-ConstantsTypeColumn::ColumnTypes ccdb::Assignment::GetValueType(const string& columnName)
+
+//______________________________________________________________________________
+void ccdb::Assignment::GetCellSpans(vector<CharSpan> &spans) const
 {
-	return mTypeTable->GetColumnsByName()[columnName]->GetType();
+	PrepareCells();
+	const string& buffer = GetCellsBuffer();
+	spans.resize(mCells.size());
+	for (size_t i = 0; i < mCells.size(); i++)
+	{
+		spans[i].Data = buffer.data() + mCells[i].Begin;
+		spans[i].Length = mCells[i].End - mCells[i].Begin;
+	}
 }
 
 
+//______________________________________________________________________________
+std::string ccdb::Assignment::GetCell(size_t index) const
+{
+	PrepareCells();
+	if(index >= mCells.size()) return string();
+	return GetCellsBuffer().substr(mCells[index].Begin, mCells[index].End - mCells[index].Begin);
+}
 
 
+//______________________________________________________________________________
+int ccdb::Assignment::GetColumnIndex(const string& columnName) const
+{
+	const vector<ConstantsTypeColumn *>& columns = mTypeTable->GetColumns();
+	for (size_t i = 0; i < columns.size(); i++)
+	{
+		if(columns[i]->GetName() == columnName) return (int)i;
+	}
+	return -1;
+}
 
 
+//______________________________________________________________________________
+std::string ccdb::Assignment::GetValue(string columnName)
+{
+	return GetValue(0, columnName);
+}
 
 
+//______________________________________________________________________________
+std::string ccdb::Assignment::GetValue(size_t rowIndex, string columnName)
+{
+	int columnIndex = GetColumnIndex(columnName);
+	if(columnIndex < 0) return string();
+	return GetValue(rowIndex, (size_t)columnIndex);
+}
+
+
+//______________________________________________________________________________
+std::string ccdb::Assignment::GetValue(size_t rowIndex, size_t columnIndex)
+{
+	return GetCell(rowIndex * mTypeTable->GetColumnsCount() + columnIndex);
+}
+
+
+//______________________________________________________________________________
+std::string ccdb::Assignment::GetValue(size_t columnIndex)
+{
+	return GetCell(columnIndex);
+}
+
+
+//______________________________________________________________________________
+ConstantsTypeColumn::ColumnTypes ccdb::Assignment::GetValueType(const string& columnName)
+{
+	return mTypeTable->GetColumnsByName()[columnName]->GetType();
+}
@@ -9,18 +9,20 @@ ObjectsOwner::ObjectsOwner()
 
 ObjectsOwner::~ObjectsOwner()
 {
-	//delete owned objects
-	if(mOwnedObjects.size()>0)	//do we need to delete objects?
+	//delete owned objects. They are taken from the list first, deleted objects release ownership themselves
+	map<unsigned long, StoredObject *> ownedObjects;
 	{
+		lock_guard<mutex> lock(mOwnedObjectsMutex);
+		ownedObjects.swap(mOwnedObjects);
+	}
 
-		//iterate through list and delete
-		map<unsigned long, StoredObject *>::iterator it = mOwnedObjects.begin();
-		while(it != mOwnedObjects.end())
-		{
-			StoredObject *obj = it->second;
-			mOwnedObjects.erase(it++);
-			delete obj;
-		}
+	//iterate through list and delete
+	map<unsigned long, StoredObject *>::iterator it = ownedObjects.begin();
+	while(it != ownedObjects.end())
+	{
+		StoredObject *obj = it->second;
+		ownedObjects.erase(it++);
+		delete obj;
 	}
 }
 
@@ -37,6 +39,7 @@ void ObjectsOwner::BeOwner( StoredObject * object )
 	else
 	{
 		//if we are here the only need is to add object to a list
+		lock_guard<mutex> lock(mOwnedObjectsMutex);
 		mOwnedObjects[object->GetTempUID()]=object;
 	}
 }
@@ -44,12 +47,13 @@ void ObjectsOwner::BeOwner( StoredObject * object )
 void ObjectsOwner::ReleaseOwnership( StoredObject * object )
 {
 	//get iterator
+	lock_guard<mutex> lock(mOwnedObjectsMutex);
 	map<unsigned long, StoredObject *>::iterator it=mOwnedObjects.find(object->GetTempUID());
 
 	//if it is found
 	if(it!=mOwnedObjects.end())
 	{	
-		//check and release
+		//check and release. SetOwner with false flag doesn't call this owner back
 		if(it->second->GetOwner() == this && it->second->GetIsOwned())
 		{
 			it->second->SetOwner(this, false);
@@ -23,7 +23,8 @@ MySQLCalibration::MySQLCalibration( int defaultRun, string defaultVariation/*="d
 
 //______________________________________________________________________________
 MySQLCalibration::~MySQLCalibration()
-{   
+{
+    StopAsyncWorkers();     //requests of the workers use this object
 }
 
 
@@ -93,6 +94,7 @@ bool MySQLCalibration::Connect( std::string connectionString )
     }
 
     bool result = mProvider->Connect(connectionString);
+    mProvider->ReleaseConnection();     //connections of the pool are borrowed for each request
     Unlock();
     return result;
     //TODO decide maybe to throw an exception here?
@@ -1,10 +1,13 @@
 #include <stdio.h>
+#include <algorithm>
 
 
 #include "CCDB/Providers/DataProvider.h"
 #include "CCDB/Log.h"
 #include "CCDB/Helpers/StringUtils.h"
 #include "CCDB/Helpers/PathUtils.h"
+#include "CCDB/Helpers/TimeProvider.h"
+#include "CCDB/Helpers/BinaryVault.h"
 
 #include "CCDB/Globals.h"
 #include "CCDB/Providers/EnvironmentAuthentication.h"
@@ -24,6 +27,9 @@ DataProvider::DataProvider(void):
     mLogUserName = mAuthentication->GetLogin();
 	ClearErrorsOnFunctionStart();
     mConnectionString="";
+    mSchemaVersion = 0;
+    mIsRunRangeIndexEnabled = false;
+    mRunRangeIndexMaxAge = 0;
 }
 
 
@@ -359,6 +365,198 @@ Assignment* DataProvider::GetAssignmentFull( int run, const string& path,int ver
 #pragma endregion Assignments
 
 
+//----------------------------------------------------------------------------------------
+//	M E T A D A T A   C A T A L O G
+//----------------------------------------------------------------------------------------
+#pragma region Catalog
+
+//______________________________________________________________________________
+ConstantsTypeTable * DataProvider::GetCatalogTypeTable(const string& path)
+{
+    /** @brief Type table with loaded columns from the metadata catalog
+     *
+     * Reads the table from the database on the first request of the path
+     *
+     * @param [in] path - absolute path of the type table
+     * @return type table or NULL if no such table
+     */
+    unordered_map<string, ConstantsTypeTable *>::iterator found = mCatalogTypeTables.find(path);
+    if(found != mCatalogTypeTables.end()) return found->second;
+
+    //Not found tables are not remembered. The table may be created later
+    ConstantsTypeTable *table = GetConstantsTypeTable(path, true);
+    if(!table) return NULL;
+
+    return AddCatalogTypeTable(path, table);
+}
+
+
+//______________________________________________________________________________
+ConstantsTypeTable * DataProvider::AddCatalogTypeTable(const string& path, ConstantsTypeTable *table)
+{
+    /** @brief Puts the table that is read from the database to the catalog. @see DataProvider.h */
+
+    unordered_map<string, ConstantsTypeTable *>::iterator retired = mRetiredTypeTables.find(path);
+    if(retired != mRetiredTypeTables.end())
+    {
+        ConstantsTypeTable *previous = retired->second;
+        mRetiredTypeTables.erase(retired);
+
+        //the table is the same if it is not modified. Columns are checked as they are not modified with the table
+        bool isSame = previous->GetId() == table->GetId() &&
+                      previous->GetModifiedTime() == table->GetModifiedTime() &&
+                      previous->GetRowsCount() == table->GetRowsCount() &&
+                      previous->GetColumns().size() == table->GetColumns().size();
+        for(size_t i = 0; isSame && i < table->GetColumns().size(); i++)
+        {
+            ConstantsTypeColumn *previousColumn = previous->GetColumns()[i];
+            ConstantsTypeColumn *column = table->GetColumns()[i];
+            isSame = previousColumn->GetName() == column->GetName() && previousColumn->GetType() == column->GetType();
+        }
+
+        if(isSame)
+        {
+            delete table;
+            table = previous;
+        }
+        //else the changed table stays with the provider, assignments may still reference it
+    }
+
+    mCatalogTypeTables[path] = table;
+    return table;
+}
+
+
+//______________________________________________________________________________
+void DataProvider::EnableRunRangeIndex(bool value)
+{
+    mIsRunRangeIndexEnabled = value;
+    if(!value) ClearRunRangeIndex();
+}
+
+
+//______________________________________________________________________________
+void DataProvider::SetRunRangeIndexMaxAge(time_t seconds)
+{
+    lock_guard<mutex> lock(mRunRangeIndexMutex);
+    mRunRangeIndexMaxAge = seconds;
+}
+
+
+//______________________________________________________________________________
+time_t DataProvider::GetRunRangeIndexMaxAge()
+{
+    lock_guard<mutex> lock(mRunRangeIndexMutex);
+    return mRunRangeIndexMaxAge;
+}
+
+
+//______________________________________________________________________________
+void DataProvider::ClearRunRangeIndex()
+{
+    lock_guard<mutex> lock(mRunRangeIndexMutex);
+    mRunRangeIndexes.clear();
+}
+
+
+//______________________________________________________________________________
+bool DataProvider::FindInRunRangeIndex(ConstantsTypeTable *table, const vector<Variation *>& variations, int run, time_t time, dbkey_t& assignmentId)
+{
+    /** @brief Looks up the assignment in the run range index of the type table
+     *
+     * Lookups hold the index by shared pointer, so it may be replaced while they use it.
+     * Threads that miss the same table at the same time may load it twice, the last one stays
+     */
+    assignmentId = 0;
+    if(!mIsRunRangeIndexEnabled) return false;
+
+    time_t now = TimeProvider::GetUnixTimeStamp(ClockSources::Monotonic);
+    shared_ptr<RunRangeIndex> index;
+    {
+        lock_guard<mutex> lock(mRunRangeIndexMutex);
+        unordered_map<dbkey_t, shared_ptr<RunRangeIndex> >::iterator found = mRunRangeIndexes.find(table->GetId());
+        if(found != mRunRangeIndexes.end() && (!mRunRangeIndexMaxAge || now - found->second->GetLoadTime() < mRunRangeIndexMaxAge))
+        {
+            index = found->second;
+        }
+    }
+
+    if(!index)
+    {
+        vector<RunRangeIndexEntry> entries;
+        if(!LoadRunRangeIndex(table, entries)) return false;
+
+        index = make_shared<RunRangeIndex>(entries);
+        index->SetLoadTime(now);
+        Log::Verbose("ccdb::DataProvider::FindInRunRangeIndex", StringUtils::Format("Run range index of '%s' is loaded: %i assignments",
+            table->GetFullPath().c_str(), (int)entries.size()));
+
+        lock_guard<mutex> lock(mRunRangeIndexMutex);
+        mRunRangeIndexes[table->GetId()] = index;
+    }
+
+    assignmentId = index->Find(run, variations, time > 0, GetRunRangeIndexTimeKey(time));
+    return true;
+}
+
+
+//______________________________________________________________________________
+const vector<Variation *> * DataProvider::GetCatalogVariationChain(const string& name)
+{
+    /** @brief Variation and its ancestors from the metadata catalog
+     *
+     * @param [in] name - name of the variation
+     * @return [variation, parent, ..., default] or NULL if no such variation
+     */
+    unordered_map<string, vector<Variation *> >::iterator found = mCatalogVariationChains.find(name);
+    if(found != mCatalogVariationChains.end()) return &found->second;
+
+    //GetVariation loads parents of the variation recursively
+    Variation *variation = GetVariation(name);
+    if(!variation) return NULL;
+
+    vector<Variation *> chain;
+    for(Variation *ancestor = variation; ancestor != NULL; ancestor = ancestor->GetParent())
+    {
+        //protection against a loop of parents in the database
+        if(find(chain.begin(), chain.end(), ancestor) != chain.end()) break;
+        chain.push_back(ancestor);
+    }
+
+    vector<Variation *>& result = mCatalogVariationChains[name];
+    result.swap(chain);
+    return &result;
+}
+
+
+//______________________________________________________________________________
+void DataProvider::ClearCatalog()
+{
+    /** @brief Clears the catalog. The next requests read metadata from the database again */
+
+    //the objects are owned by the provider, assignments may still reference them.
+    //They are reused by AddCatalogTypeTable if the same table is read again
+    for(unordered_map<string, ConstantsTypeTable *>::iterator it = mCatalogTypeTables.begin(); it != mCatalogTypeTables.end(); ++it)
+    {
+        mRetiredTypeTables[it->first] = it->second;
+    }
+    mCatalogTypeTables.clear();
+    mCatalogVariationChains.clear();
+}
+
+
+//______________________________________________________________________________
+void DataProvider::ClearCaches()
+{
+    /** @brief Clears the catalog, run range indexes and assignments cache */
+    ClearCatalog();
+    ClearRunRangeIndex();
+    mAssignmentCache.Clear();
+}
+
+#pragma endregion Catalog
+
+
 //----------------------------------------------------------------------------------------
 //	E R R O R   H A N D L I N G 
 //----------------------------------------------------------------------------------------
@@ -367,6 +565,7 @@ Assignment* DataProvider::GetAssignmentFull( int run, const string& path,int ver
 int DataProvider::GetNErrors()
 {
 	//Get number of errors 
+	lock_guard<mutex> lock(mErrorsMutex);
 	return mErrorCodes.size();
 }
 
@@ -383,6 +582,7 @@ const vector<int>& DataProvider::GetErrorCodes()
 int DataProvider::GetLastError()
 {
 	//Gets last of the last error
+	lock_guard<mutex> lock(mErrorsMutex);
 	return mLastError;
 }
 
@@ -396,12 +596,16 @@ void DataProvider::Error(int errorCode, const string& module, const string& mess
 	error->SetSource(module);
 	error->SetMessage(message);
 	error->SetLevel(1);
-	//add error 
-	mErrorCodes.push_back(errorCode);
-	mLastError = errorCode;
-	
-	//cut array if needed
-	while(mErrorCodes.size()> mMaximumErrorsToHold) mErrorCodes.erase(mErrorCodes.begin());
+	{
+		lock_guard<mutex> lock(mErrorsMutex);
+
+		//add error 
+		mErrorCodes.push_back(errorCode);
+		mLastError = errorCode;
+
+		//cut array if needed
+		while(mErrorCodes.size()> mMaximumErrorsToHold) mErrorCodes.erase(mErrorCodes.begin());
+	}
 	
 	//do log error
 	Log::Error(errorCode, module, message);
@@ -412,6 +616,7 @@ void DataProvider::Error(int errorCode, const string& module, const string& mess
 void DataProvider::ClearErrorsOnFunctionStart()
 {
 	//Clear error state on start of each function that emmits error
+	lock_guard<mutex> lock(mErrorsMutex);
 	mErrorCodes.clear();
 	mLastError = CCDB_NO_ERRORS;
 }
@@ -420,12 +625,16 @@ void DataProvider::ClearErrorsOnFunctionStart()
 //______________________________________________________________________________
 void DataProvider::Warning( int errorCode, const string& module, const string& message )
 {
-	//add error 
-	mErrorCodes.push_back(errorCode);
-	mLastError = errorCode;
+	{
+		lock_guard<mutex> lock(mErrorsMutex);
 
-	//cut array if needed
-	while(mErrorCodes.size()> mMaximumErrorsToHold) mErrorCodes.erase(mErrorCodes.begin());
+		//add error 
+		mErrorCodes.push_back(errorCode);
+		mLastError = errorCode;
+
+		//cut array if needed
+		while(mErrorCodes.size()> mMaximumErrorsToHold) mErrorCodes.erase(mErrorCodes.begin());
+	}
 
 	//do log error
 	Log::Warning(errorCode, module, message);
@@ -435,6 +644,7 @@ void DataProvider::Warning( int errorCode, const string& module, const string& m
 //______________________________________________________________________________
 void DataProvider::ClearErrors()
 {
+	lock_guard<mutex> lock(mErrorsMutex);
 	mErrorCodes.clear();
 	mLastError = CCDB_NO_ERRORS;
 }
@@ -447,6 +657,62 @@ std::vector<CCDBError *> DataProvider::GetErrors()
 }
 
 
+//______________________________________________________________________________
+string DataProvider::DecompressVault(string blob)
+{
+	/** @brief Decompresses vault that is read from database. @see BinaryVault::Compress
+	 *
+	 * Not compressed vault is returned as is. Compressed vault that can't be decompressed
+	 * is returned as is too, then Assignment::SetRawData finds it is invalid
+	 */
+	if(!BinaryVault::IsCompressed(blob)) return blob;
+
+	string decompressed;
+	if(!BinaryVault::Decompress(blob.data(), blob.size(), decompressed))
+	{
+		Error(CCDB_ERROR_VAULT_DECOMPRESS, "DataProvider::DecompressVault",
+			StringUtils::Format("Compressed data blob can't be decompressed. Codec id is %i", (int)(unsigned char)blob[BinaryVault::MagicSize + 2]));
+		return blob;
+	}
+	return decompressed;
+}
+
+
+//______________________________________________________________________________
+bool DataProvider::GetAssignmentsShortBatch(vector<Assignment *>& assignments, int run, const vector<string>& paths, time_t time, const string& variation)
+{
+	/** @brief Get Assignments with data blob only for many type tables. By default it is GetAssignmentShort for each path
+	 *
+	 * Not found type tables and assignments give NULL. The first of other errors stops the batch
+	 */
+	assignments.assign(paths.size(), NULL);
+	for(size_t i=0; i<paths.size(); i++)
+	{
+		assignments[i] = GetAssignmentShort(run, paths[i], time, variation);
+		int lastError = GetLastError();
+		if(assignments[i] || lastError == CCDB_NO_ERRORS || lastError == CCDB_ERROR_NO_TYPETABLE || lastError == CCDB_ERROR_NO_ASSIGMENT) continue;
+
+		for(size_t j=0; j<i; j++) delete assignments[j];
+		assignments.assign(paths.size(), NULL);
+		return false;
+	}
+	return true;
+}
+
+
+//______________________________________________________________________________
+const size_t DataProvider::cMaxBatchQuerySize;
+
+
+//______________________________________________________________________________
+size_t DataProvider::GetBatchQuerySize(size_t count)
+{
+	size_t size = 1;
+	while(size < count) size *= 2;
+	return size;
+}
+
+
 
 
 
@@ -0,0 +1,530 @@
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <atomic>
+#include <algorithm>
+
+#include "CCDB/Providers/MySQLConnectionPool.h"
+#include "CCDB/Helpers/StringUtils.h"
+#include "CCDB/Helpers/TimeProvider.h"
+#include "CCDB/Log.h"
+
+using namespace ccdb;
+
+//pools of the process by connection info. Providers own the pools
+static std::mutex& MySQLConnectionPoolsMutex()
+{
+	static std::mutex poolsMutex;
+	return poolsMutex;
+}
+
+static map<string, std::weak_ptr<MySQLConnectionPool> >& MySQLConnectionPools()
+{
+	static map<string, std::weak_ptr<MySQLConnectionPool> > pools;
+	return pools;
+}
+
+static size_t gMySQLDefaultMaxConnections = 4;
+
+//mysql_init initializes the client library implicitly, but it is not thread safe. Is called once before the first connection
+static int MySQLLibraryInit()
+{
+	static std::once_flag initFlag;
+	static int initResult = 0;
+	std::call_once(initFlag, []() { initResult = mysql_library_init(0, NULL, NULL); });
+	return initResult;
+}
+
+//connection attempts of the process. Failures of a server make all its pools wait
+struct MySQLServerBackoff
+{
+	MySQLServerBackoff(): Failures(0) {}
+	unsigned int Failures;								//failures in a row
+	std::chrono::steady_clock::time_point LastFailure;
+};
+
+static std::mutex& MySQLConnectMutex()
+{
+	static std::mutex connectMutex;
+	return connectMutex;
+}
+
+static std::condition_variable& MySQLConnectFinished()
+{
+	static std::condition_variable connectFinished;
+	return connectFinished;
+}
+
+static map<string, MySQLServerBackoff>& MySQLServerBackoffs()
+{
+	static map<string, MySQLServerBackoff> backoffs;
+	return backoffs;
+}
+
+static size_t& MySQLMaxConcurrentConnects()
+{
+	static size_t count = getenv(CCDB_ENV_MYSQL_MAX_CONNECTING) && atoi(getenv(CCDB_ENV_MYSQL_MAX_CONNECTING)) > 0 ?
+		(size_t)atoi(getenv(CCDB_ENV_MYSQL_MAX_CONNECTING)) : 0;
+	return count;
+}
+
+static size_t gMySQLConnectsInProgress = 0;
+
+//statements that a connection keeps. Calls of a provider use a few of them at once
+static const size_t cMySQLMinStatementsPerConnection = 8;
+
+static std::atomic<size_t>& MySQLMaxStatementsPerConnection()
+{
+	static std::atomic<size_t> count(getenv(CCDB_ENV_MYSQL_MAX_STATEMENTS) && atoi(getenv(CCDB_ENV_MYSQL_MAX_STATEMENTS)) > 0 ?
+		std::max((size_t)atoi(getenv(CCDB_ENV_MYSQL_MAX_STATEMENTS)), cMySQLMinStatementsPerConnection) : 64);
+	return count;
+}
+
+
+ccdb::MySQLPooledConnection::~MySQLPooledConnection()
+{
+	for(StatementList::iterator it = mStatements.begin(); it != mStatements.end(); ++it)
+	{
+		delete *it;
+	}
+	mStatements.clear();
+	mStatementsByQuery.clear();
+
+	if(Handle) mysql_close(Handle);
+	Handle = NULL;
+}
+
+
+MySQLStatement* ccdb::MySQLPooledConnection::FindStatement( const string& query )
+{
+	map<string, StatementList::iterator>::iterator found = mStatementsByQuery.find(query);
+	if(found == mStatementsByQuery.end()) return NULL;
+
+	mStatements.splice(mStatements.begin(), mStatements, found->second);
+	return *found->second;
+}
+
+
+void ccdb::MySQLPooledConnection::AddStatement( MySQLStatement *statement )
+{
+	mStatements.push_front(statement);
+	mStatementsByQuery[statement->GetQuery()] = mStatements.begin();
+
+	//closing the statement frees its slot on the server
+	size_t maxCount = MySQLConnectionPool::GetMaxStatementsPerConnection();
+	while(mStatements.size() > maxCount)
+	{
+		MySQLStatement *leastUsed = mStatements.back();
+		mStatements.pop_back();
+		mStatementsByQuery.erase(leastUsed->GetQuery());
+		delete leastUsed;
+	}
+}
+
+
+std::shared_ptr<MySQLConnectionPool> ccdb::MySQLConnectionPool::GetPool( const MySQLConnectionInfo& connection )
+{
+	//the password is in the key, so users with different passwords don't share connections
+	string key = StringUtils::Format("%s:%s@%s:%i/%s?%u&%i&%i&%i", connection.UserName.c_str(), connection.Password.c_str(),
+		connection.HostName.c_str(), connection.Port, connection.Database.c_str(),
+		connection.ConnectTimeout, connection.ConnectRetries, connection.RetryDelayMs, connection.RetryMaxDelayMs);
+
+	std::lock_guard<std::mutex> lock(MySQLConnectionPoolsMutex());
+	std::shared_ptr<MySQLConnectionPool> pool = MySQLConnectionPools()[key].lock();
+	if(!pool)
+	{
+		pool = std::make_shared<MySQLConnectionPool>(connection);
+		MySQLConnectionPools()[key] = pool;
+	}
+	return pool;
+}
+
+
+void ccdb::MySQLConnectionPool::SetDefaultMaxConnections( size_t count )
+{
+	std::lock_guard<std::mutex> lock(MySQLConnectionPoolsMutex());
+	gMySQLDefaultMaxConnections = count > 0 ? count : 1;
+}
+
+
+size_t ccdb::MySQLConnectionPool::GetDefaultMaxConnections()
+{
+	std::lock_guard<std::mutex> lock(MySQLConnectionPoolsMutex());
+	return gMySQLDefaultMaxConnections;
+}
+
+
+void ccdb::MySQLConnectionPool::SetMaxConcurrentConnects( size_t count )
+{
+	{
+		std::lock_guard<std::mutex> lock(MySQLConnectMutex());
+		MySQLMaxConcurrentConnects() = count;
+	}
+	MySQLConnectFinished().notify_all();
+}
+
+
+size_t ccdb::MySQLConnectionPool::GetMaxConcurrentConnects()
+{
+	std::lock_guard<std::mutex> lock(MySQLConnectMutex());
+	return MySQLMaxConcurrentConnects();
+}
+
+
+void ccdb::MySQLConnectionPool::SetMaxStatementsPerConnection( size_t count )
+{
+	MySQLMaxStatementsPerConnection() = std::max(count, cMySQLMinStatementsPerConnection);
+}
+
+
+size_t ccdb::MySQLConnectionPool::GetMaxStatementsPerConnection()
+{
+	return MySQLMaxStatementsPerConnection();
+}
+
+
+int ccdb::MySQLConnectionPool::GetBackoffDelayMs( unsigned int failuresCount, int baseDelayMs, int maxDelayMs )
+{
+	if(failuresCount == 0 || baseDelayMs <= 0 || maxDelayMs <= 0) return 0;
+
+	long long delay = baseDelayMs;
+	for(unsigned int i = 1; i < failuresCount && delay < maxDelayMs; i++) delay *= 2;
+	if(delay > maxDelayMs) delay = maxDelayMs;
+
+	//jobs that failed together retry at different times
+	static thread_local std::mt19937 generator(std::random_device{}());
+	std::uniform_int_distribution<long long> jitter(0, delay - delay/2);
+	return (int)(delay/2 + jitter(generator));
+}
+
+
+ccdb::MySQLConnectionPool::MySQLConnectionPool( const MySQLConnectionInfo& connection )
+	:mConnectionInfo(connection),
+	mOpenCount(0),
+	mMaxConnections(gMySQLDefaultMaxConnections),	//GetPool holds the mutex of it
+	mIdleTimeout(300),
+	mHealthCheckInterval(30),
+	mAcquireTimeout(60)
+{
+	const char *poolSize = getenv(CCDB_ENV_MYSQL_POOL_SIZE);
+	if(poolSize && atoi(poolSize) > 0) mMaxConnections = (size_t)atoi(poolSize);
+}
+
+
+ccdb::MySQLConnectionPool::~MySQLConnectionPool()
+{
+	//borrowed connections are given back before providers release the pool
+	for(size_t i = 0; i < mIdle.size(); i++) delete mIdle[i];
+	mIdle.clear();
+}
+
+
+MySQLPooledConnection* ccdb::MySQLConnectionPool::Acquire( string& error )
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(mAcquireTimeout);
+
+	vector<MySQLPooledConnection *> toClose;
+	TakeIdleToClose(TimeProvider::GetUnixTimeStamp(ClockSources::Monotonic), toClose);
+	if(!toClose.empty())
+	{
+		lock.unlock();
+		for(size_t i = 0; i < toClose.size(); i++) delete toClose[i];
+		lock.lock();
+	}
+
+	for(;;)
+	{
+		//idle connection
+		while(!mIdle.empty())
+		{
+			MySQLPooledConnection *connection = mIdle.back();
+			mIdle.pop_back();
+
+			time_t now = TimeProvider::GetUnixTimeStamp(ClockSources::Monotonic);
+			if(now - connection->LastUsedTime < mHealthCheckInterval) return connection;
+
+			//server may close connections that were idle for a long time
+			lock.unlock();
+			bool isAlive = mysql_ping(connection->Handle) == 0;
+			if(!isAlive) delete connection;
+			lock.lock();
+
+			if(isAlive) return connection;
+			mOpenCount--;
+			Log::Verbose("ccdb::MySQLConnectionPool::Acquire", "Idle connection failed health check and is closed");
+		}
+
+		//new connection
+		if(mOpenCount < mMaxConnections)
+		{
+			mOpenCount++;	//the place is taken while the connection is opened
+			lock.unlock();
+			MySQLPooledConnection *connection = Open(error);
+			if(connection) return connection;
+
+			lock.lock();
+			mOpenCount--;
+			mReleased.notify_one();
+			return NULL;
+		}
+
+		//all connections are busy
+		if(mReleased.wait_until(lock, deadline) == std::cv_status::timeout && mIdle.empty() && mOpenCount >= mMaxConnections)
+		{
+			error = StringUtils::Format("All %i connections of the pool are busy for %i seconds", (int)mMaxConnections, (int)mAcquireTimeout);
+			return NULL;
+		}
+	}
+}
+
+
+void ccdb::MySQLConnectionPool::Release( MySQLPooledConnection* connection )
+{
+	if(!connection) return;
+
+	time_t now = TimeProvider::GetUnixTimeStamp(ClockSources::Monotonic);
+	vector<MySQLPooledConnection *> toClose;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		connection->LastUsedTime = now;
+
+		//the pool could be made smaller while the connection was borrowed
+		if(mOpenCount > mMaxConnections)
+		{
+			toClose.push_back(connection);
+			mOpenCount--;
+		}
+		else
+		{
+			mIdle.push_back(connection);
+		}
+		TakeIdleToClose(now, toClose);
+	}
+	mReleased.notify_one();
+
+	for(size_t i = 0; i < toClose.size(); i++) delete toClose[i];
+}
+
+
+void ccdb::MySQLConnectionPool::Discard( MySQLPooledConnection* connection )
+{
+	if(!connection) return;
+	delete connection;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mOpenCount--;
+	}
+	mReleased.notify_one();
+}
+
+
+void ccdb::MySQLConnectionPool::ReapIdleConnections()
+{
+	vector<MySQLPooledConnection *> toClose;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		TakeIdleToClose(TimeProvider::GetUnixTimeStamp(ClockSources::Monotonic), toClose);
+	}
+	for(size_t i = 0; i < toClose.size(); i++) delete toClose[i];
+}
+
+
+void ccdb::MySQLConnectionPool::TakeIdleToClose( time_t now, vector<MySQLPooledConnection *>& toClose )
+{
+	if(mIdleTimeout <= 0) return;
+
+	//the oldest connections are in the beginning
+	size_t count = 0;
+	while(count < mIdle.size() && now - mIdle[count]->LastUsedTime > mIdleTimeout) count++;
+	if(!count) return;
+
+	toClose.insert(toClose.end(), mIdle.begin(), mIdle.begin() + count);
+	mIdle.erase(mIdle.begin(), mIdle.begin() + count);
+	mOpenCount -= count;
+}
+
+
+MySQLPooledConnection* ccdb::MySQLConnectionPool::Open( string& error )
+{
+	string server = StringUtils::Format("%s:%i", mConnectionInfo.HostName.c_str(), mConnectionInfo.Port);
+	int attemptsCount = 1 + (mConnectionInfo.ConnectRetries > 0 ? mConnectionInfo.ConnectRetries : 0);
+
+	for(int attempt = 1; ; attempt++)
+	{
+		std::unique_lock<std::mutex> lock(MySQLConnectMutex());
+
+		//the server failed recently. Each attempt waits its own random part of the backoff
+		MySQLServerBackoff backoff = MySQLServerBackoffs()[server];
+		if(backoff.Failures)
+		{
+			int delayMs = GetBackoffDelayMs(backoff.Failures, mConnectionInfo.RetryDelayMs, mConnectionInfo.RetryMaxDelayMs);
+			lock.unlock();
+			std::this_thread::sleep_until(backoff.LastFailure + std::chrono::milliseconds(delayMs));
+			lock.lock();
+		}
+
+		//admission of the process
+		MySQLConnectFinished().wait(lock, []{ return !MySQLMaxConcurrentConnects() || gMySQLConnectsInProgress < MySQLMaxConcurrentConnects(); });
+		gMySQLConnectsInProgress++;
+		lock.unlock();
+
+		MYSQL *handle = ConnectToServer(error);
+
+		lock.lock();
+		gMySQLConnectsInProgress--;
+		if(handle)
+		{
+			MySQLServerBackoffs().erase(server);
+		}
+		else
+		{
+			MySQLServerBackoff& failed = MySQLServerBackoffs()[server];
+			failed.Failures++;
+			failed.LastFailure = std::chrono::steady_clock::now();
+		}
+		lock.unlock();
+		MySQLConnectFinished().notify_one();
+
+		if(handle) return new MySQLPooledConnection(handle);
+
+		if(attempt >= attemptsCount)
+		{
+			if(attemptsCount > 1) error += StringUtils::Format("Connection failed %i times\n", attemptsCount);
+			return NULL;
+		}
+		Log::Verbose("ccdb::MySQLConnectionPool::Open", StringUtils::Format("Connection attempt %i of %i failed:\n%s", attempt, attemptsCount, error.c_str()));
+	}
+}
+
+
+MYSQL* ccdb::MySQLConnectionPool::ConnectToServer( string& error )
+{
+	if(MySQLLibraryInit())
+	{
+		error = "mysql_library_init() failed, the MySQL client library can't be initialized";
+		return NULL;
+	}
+
+	MYSQL *handle = mysql_init(NULL);
+	if(handle == NULL)
+	{
+		error = "mysql_init() returned NULL, probably memory allocation problem";
+		return NULL;
+	}
+
+	if(mConnectionInfo.ConnectTimeout)
+	{
+		unsigned int timeout = mConnectionInfo.ConnectTimeout;
+		mysql_options(handle, MYSQL_OPT_CONNECT_TIMEOUT, (const char *)&timeout);
+	}
+
+	if(!mysql_real_connect (
+		handle,									//pointer to connection handler
+		mConnectionInfo.HostName.c_str(),		//host to connect to
+		mConnectionInfo.UserName.c_str(),		//user name
+		mConnectionInfo.Password.c_str(),		//password
+		mConnectionInfo.Database.c_str(),		//database to use
+		mConnectionInfo.Port,					//port
+		NULL,									//socket (use default)
+		0))										//flags (none)
+	{
+		error = StringUtils::Format("mysql_real_connect() failed:\nError %u (%s)\n", mysql_errno(handle), mysql_error(handle));
+		mysql_close(handle);
+		return NULL;
+	}
+	return handle;
+}
+
+
+size_t ccdb::MySQLConnectionPool::GetOpenConnectionsCount()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mOpenCount;
+}
+
+
+size_t ccdb::MySQLConnectionPool::GetIdleConnectionsCount()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mIdle.size();
+}
+
+
+size_t ccdb::MySQLConnectionPool::GetIdleStatementsCount()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	size_t count = 0;
+	for(size_t i = 0; i < mIdle.size(); i++) count += mIdle[i]->GetStatementsCount();
+	return count;
+}
+
+
+size_t ccdb::MySQLConnectionPool::GetMaxConnections()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mMaxConnections;
+}
+
+
+void ccdb::MySQLConnectionPool::SetMaxConnections( size_t count )
+{
+	vector<MySQLPooledConnection *> toClose;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mMaxConnections = count > 0 ? count : 1;
+
+		//extra idle connections are closed now, borrowed ones when they are given back
+		while(mOpenCount > mMaxConnections && !mIdle.empty())
+		{
+			toClose.push_back(mIdle.front());
+			mIdle.erase(mIdle.begin());
+			mOpenCount--;
+		}
+	}
+	mReleased.notify_all();
+	for(size_t i = 0; i < toClose.size(); i++) delete toClose[i];
+}
+
+
+time_t ccdb::MySQLConnectionPool::GetIdleTimeout()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mIdleTimeout;
+}
+
+
+void ccdb::MySQLConnectionPool::SetIdleTimeout( time_t seconds )
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mIdleTimeout = seconds;
+}
+
+
+time_t ccdb::MySQLConnectionPool::GetHealthCheckInterval()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mHealthCheckInterval;
+}
+
+
+void ccdb::MySQLConnectionPool::SetHealthCheckInterval( time_t seconds )
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mHealthCheckInterval = seconds;
+}
+
+
+time_t ccdb::MySQLConnectionPool::GetAcquireTimeout()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mAcquireTimeout;
+}
+
+
+void ccdb::MySQLConnectionPool::SetAcquireTimeout( time_t seconds )
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mAcquireTimeout = seconds;
+}
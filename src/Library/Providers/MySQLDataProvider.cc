@@ -5,6 +5,9 @@
 #include <time.h>
 #include <string.h>
 #include <limits.h>
+#include <algorithm>
+#include <set>
+#include <map>
 
 #include "CCDB/Globals.h"
 #include "CCDB/Log.h"
@@ -28,13 +31,15 @@ using namespace ccdb;
 ccdb::MySQLDataProvider::MySQLDataProvider(void)
 {
 	mIsConnected = false;
-	mMySQLHnd=NULL;
+	mConnection=NULL;
+	mCallDepth=0;
 	mResult=NULL;
 	mRootDir = new Directory(this, this);
 	mDirsAreLoaded = false;
 	mLastFullQuerry="";
 	mLastShortQuerry="";
     mLastVariation = NULL; 
+    mVariationsAreLoaded = false;
     
 }
 
@@ -77,6 +82,8 @@ bool ccdb::MySQLDataProvider::Connect( std::string connectionString )
 
 bool ccdb::MySQLDataProvider::Connect(MySQLConnectionInfo connection)
 {
+	ConnectionScope scope(this);	//the connection that checked the server goes back to the pool
+
 	ClearErrors(); //Clear error in function that can produce new ones
 
 	//check if we are connected
@@ -91,35 +98,41 @@ bool ccdb::MySQLDataProvider::Connect(MySQLConnectionInfo connection)
 	Log::Verbose("ccdb::MySQLDataProvider::Connect", StringUtils::Format("Connecting to database:\n UserName: %s \n Password: %i symbols \n HostName: %s Database: %s Port: %i",
 					connection.UserName.c_str(), connection.Password.length(), connection.HostName.c_str(), connection.Database.c_str(), connection.Port) );
 					
-	//init connection variable
-	if(mMySQLHnd == NULL)mMySQLHnd = mysql_init(NULL);
-	if(mMySQLHnd == NULL)
+	//Connections to the server are shared by all providers that connect to it
+	mPool = MySQLConnectionPool::GetPool(connection);
+	mIsConnected = true;
+
+	//A connection is borrowed now, so connection errors are reported by Connect
+	if(!AcquireConnection("bool MySQLDataProvider::Connect(MySQLConnectionInfo)"))
 	{
-		Error(CCDB_ERROR_CONNECTION_INITIALIZATION, "MySQLDataProvider::Connect(DMySQLConnectionInfo)", "mysql_init() returned NULL, probably memory allocation problem");
-		return false;
-	}
-	
-	//Try to connect to server
-	if(!mysql_real_connect (
-		mMySQLHnd,						//pointer to connection handler
-		connection.HostName.c_str(),	//host to connect to
-		connection.UserName.c_str(),	//user name
-		connection.Password.c_str(),	//password
-		connection.Database.c_str(),	//database to use
-		connection.Port, 				//port
-		NULL,							//socket (use default)
-		0))								//flags (none)
-	{
-		string errStr = ComposeMySQLError("mysql_real_connect()");
-		Error(CCDB_ERROR_CONNECTION_EXTERNAL_ERROR,"bool MySQLDataProvider::Connect(MySQLConnectionInfo)",errStr.c_str());
-
-		mMySQLHnd=NULL;		//some compilers dont set NULL after delete
+		mPool.reset();
+		mIsConnected = false;
 		return false;
 	}
-	mIsConnected = true;
+
+	ReadSchemaVersion();
 	return true;
 }
 
+
+void ccdb::MySQLDataProvider::ReadSchemaVersion()
+{
+	/** @brief Reads schemaVersions to mSchemaVersion
+	 *
+	 * A database without the table is read as an old one (version 0), it is not an error
+	 */
+	mSchemaVersion = 0;
+	if(!QuerySelect("SELECT `schemaVersion` FROM `schemaVersions` WHERE `id` = 1"))
+	{
+		ClearErrors();
+		Log::Verbose("ccdb::MySQLDataProvider::ReadSchemaVersion", "No schemaVersions table. The database is read as an old one");
+		return;
+	}
+
+	if(FetchRow()) mSchemaVersion = ReadInt(0);
+	FreeMySQLResult();
+}
+
 bool ccdb::MySQLDataProvider::ParseConnectionString(std::string conStr, MySQLConnectionInfo &connection)
 {
 	//first check for uri type
@@ -132,6 +145,15 @@ bool ccdb::MySQLDataProvider::ParseConnectionString(std::string conStr, MySQLCon
 	//ok we dont need mysql:// in the future. Moreover it will mess our separation logic
 	conStr.erase(0,8);
 
+	//options go after '?'
+	size_t optionsPos = conStr.find('?');
+	if(optionsPos!=string::npos)
+	{
+		string options = conStr.substr(optionsPos+1);
+		conStr.erase(optionsPos);
+		if(!ParseConnectOptions(options, connection)) return false;
+	}
+
 	//then if there is '@' that separates login/password part of uri
 	int atPos = conStr.find('@');
 	if(atPos!=string::npos)
@@ -199,6 +221,41 @@ bool ccdb::MySQLDataProvider::ParseConnectionString(std::string conStr, MySQLCon
 }
 
 
+bool ccdb::MySQLDataProvider::ParseConnectOptions(const string& options, MySQLConnectionInfo &connection)
+{
+	/** @brief Parses options of the connection string. @see Connect for the list of options */
+
+	vector<string> tokens = StringUtils::Split(options, "&");
+	for(size_t i = 0; i < tokens.size(); i++)
+	{
+		if(tokens[i].empty()) continue;
+
+		size_t equalPos = tokens[i].find('=');
+		string name = tokens[i].substr(0, equalPos);
+		string value = equalPos == string::npos ? string() : tokens[i].substr(equalPos + 1);
+
+		char *end = NULL;
+		long number = strtol(value.c_str(), &end, 10);
+		if(value.empty() || *end != '\0' || number < 0 || number > INT_MAX)
+		{
+			Log::Warning(CCDB_ERROR_PARSE_CONNECTION_STRING, "MySQLDataProvider::ParseConnectionString", "Invalid value of option '" + tokens[i] + "' in MySQL connection string");
+			return false;
+		}
+
+		if(name == "connect_timeout")			connection.ConnectTimeout = (unsigned int)number;
+		else if(name == "connect_retries")		connection.ConnectRetries = (int)number;
+		else if(name == "retry_delay_ms")		connection.RetryDelayMs = (int)number;
+		else if(name == "retry_max_delay_ms")	connection.RetryMaxDelayMs = (int)number;
+		else
+		{
+			Log::Warning(CCDB_ERROR_PARSE_CONNECTION_STRING, "MySQLDataProvider::ParseConnectionString", "Unknown option '" + tokens[i] + "' in MySQL connection string. Known options are connect_timeout, connect_retries, retry_delay_ms, retry_max_delay_ms");
+			return false;
+		}
+	}
+	return true;
+}
+
+
 bool ccdb::MySQLDataProvider::IsConnected()
 {
 	return mIsConnected;
@@ -209,11 +266,11 @@ void ccdb::MySQLDataProvider::Disconnect()
 {
 	if(IsConnected())
 	{
-		FreeMySQLResult();	//it would free the result or do nothing
-		
-		mysql_close(mMySQLHnd);
-		mMySQLHnd = NULL;
+		ReleaseConnection();	//it frees the result, statements stay with the connection in the pool
+		mPool.reset();
 		mIsConnected = false;
+
+		ClearCaches();	//the database may be changed while we are disconnected
 	}
 }
 
@@ -228,8 +285,57 @@ bool ccdb::MySQLDataProvider::CheckConnection( const string& errorSource/*=""*/
 		Error(CCDB_ERROR_NOT_CONNECTED,errorSource.c_str(), "Provider is not connected to MySQL.");
 		return false;
 	}
+
+	//a connection is borrowed for queries until ReleaseConnection
+	return AcquireConnection(errorSource.c_str());
+}
+
+
+bool ccdb::MySQLDataProvider::AcquireConnection( const char* functionName )
+{
+	if(mConnection) return true;
+
+	string error;
+	mConnection = mPool->Acquire(error);
+	if(!mConnection)
+	{
+		Error(CCDB_ERROR_CONNECTION_EXTERNAL_ERROR, functionName, error);
+		return false;
+	}
 	return true;
 }
+
+
+void ccdb::MySQLDataProvider::ReleaseConnection()
+{
+	/** @brief Gives the borrowed connection back to the pool
+	 *
+	 * Public functions call it when they return and Calibration calls it after each request,
+	 * so providers hold server connections only while they read.
+	 * A connection that was lost is closed instead
+	 */
+	if(!mConnection) return;
+
+	FreeMySQLResult();
+
+	unsigned int lastError = mysql_errno(mConnection->Handle);
+	if(lastError == CR_SERVER_GONE_ERROR || lastError == CR_SERVER_LOST)
+	{
+		mPool->Discard(mConnection);
+	}
+	else
+	{
+		mPool->Release(mConnection);
+	}
+	mConnection = NULL;
+}
+
+
+size_t ccdb::MySQLDataProvider::GetPreparedStatementsCount() const
+{
+	if(mConnection) return mConnection->GetStatementsCount();
+	return mPool ? mPool->GetIdleStatementsCount() : 0;
+}
 #pragma endregion Connection
 
 #pragma region Directories
@@ -244,6 +350,8 @@ Directory* ccdb::MySQLDataProvider::GetDirectory( const string& path )
 
 bool ccdb::MySQLDataProvider::SearchDirectories( vector<Directory *>& resultDirectories, const string& searchPattern, const string& parentPath/*=""*/,  int take/*=0*/, int startWith/*=0*/ )
 {	
+	ConnectionScope scope(this);
+
 	UpdateDirectoriesIfNeeded(); //do we need to update directories?
 
 	resultDirectories.clear();
@@ -309,12 +417,15 @@ bool ccdb::MySQLDataProvider::SearchDirectories( vector<Directory *>& resultDire
 
 bool ccdb::MySQLDataProvider::LoadDirectories()
 {
+	ConnectionScope scope(this);
+
 	//
 	if(IsConnected())
 	{
-		if(!QuerySelect("SELECT `id`, `name`, `parentId`, UNIX_TIMESTAMP(`directories`.`modified`) as `updateTime`, `comment` FROM `directories`"))
+		const char *functionName = "MySQLDataProvider::LoadDirectories()";
+		MySQLStatement *statement = PrepareStatement("SELECT `id`, `name`, `parentId`, UNIX_TIMESTAMP(`directories`.`modified`) as `updateTime`, `comment` FROM `directories`", functionName);
+		if(!statement || !ExecuteStatement(statement, functionName))
 		{
-			//TODO: report error
 			return false;
 		}
 
@@ -327,18 +438,19 @@ bool ccdb::MySQLDataProvider::LoadDirectories()
 		mRootDir->SetFullPath("/");
 
 		//Ok! We querryed our directories! lets catch them! 
-		while(FetchRow())
+		while(statement->Fetch())
 		{
 			Directory *dir = new Directory(this, this);
-			dir->SetId(ReadIndex(0));					// `id`, 
-			dir->SetName(ReadString(1));			// `name`, 
-			dir->SetParentId(ReadInt(2));			// `parentId`, 
-			dir->SetModifiedTime(ReadUnixTime(3));	// UNIX_TIMESTAMP(`directories`.`updateTime`) as `updateTime`, 
-			dir->SetComment(ReadString(4));			// `comment`
+			dir->SetId((dbkey_t)statement->ReadInt(0));					// `id`, 
+			dir->SetName(statement->ReadString(1));			// `name`, 
+			dir->SetParentId((int)statement->ReadInt(2));			// `parentId`, 
+			dir->SetModifiedTime((time_t)statement->ReadInt(3));	// UNIX_TIMESTAMP(`directories`.`updateTime`) as `updateTime`, 
+			dir->SetComment(statement->ReadString(4));			// `comment`
 
 			mDirectories.push_back(dir);
 			mDirectoriesById[dir->GetId()] = dir;
 		}
+		statement->FreeResult();
 
 		BuildDirectoryDependencies(); //
 
@@ -397,6 +509,8 @@ void ccdb::MySQLDataProvider::IsStoredObjectsOwner(bool flag)
 #pragma region Type Tables
 ConstantsTypeTable * ccdb::MySQLDataProvider::GetConstantsTypeTable( const string& name, Directory *parentDir,bool loadColumns/*=false*/ )
 {
+	ConnectionScope scope(this);
+
 	ClearErrors(); //Clear error in function that can produce new ones
 
 	//check the directory is ok
@@ -415,34 +529,37 @@ ConstantsTypeTable * ccdb::MySQLDataProvider::GetConstantsTypeTable( const strin
 		return NULL;
 	}
 	
-	string query = StringUtils::Format("SELECT `id`, UNIX_TIMESTAMP(`created`) as `created`, UNIX_TIMESTAMP(`modified`) as `modified`, `name`, `directoryId`, `nRows`, `nColumns`, `comment` FROM `typeTables` WHERE `name` = '%s' AND `directoryId` = '%i';",
-		 /*`name`*/ name.c_str(),
-		 /*`directoryId`*/ parentDir->GetId());
+	const char *functionName = "MySQLDataProvider::GetConstantsTypeTable";
+	MySQLStatement *statement = PrepareStatement("SELECT `id`, UNIX_TIMESTAMP(`created`) as `created`, UNIX_TIMESTAMP(`modified`) as `modified`, `name`, `directoryId`, `nRows`, `nColumns`, `comment` FROM `typeTables` WHERE `name` = ? AND `directoryId` = ?;", functionName);
+	if(!statement) return NULL;
 
-	if(!QuerySelect(query))
+	statement->BindString(0, name);
+	statement->BindInt(1, parentDir->GetId());
+	if(!ExecuteStatement(statement, functionName))
 	{
-		//TODO: report error
 		return NULL;
 	}
 
 	
 	//Ok! We querryed our directories! lets catch them! 
-	if(!FetchRow())
+	if(!statement->Fetch())
 	{
 		//TODO error not selected
+		statement->FreeResult();
 		return NULL;
 	}
 
 	//ok lets read the data...
 	ConstantsTypeTable *result = new ConstantsTypeTable(this, this);
-	result->SetId(ReadULong(0));
-	result->SetCreatedTime(ReadUnixTime(1));
-	result->SetModifiedTime(ReadUnixTime(2));
-	result->SetName(ReadString(3));
-	result->SetDirectoryId(ReadULong(4));
-	result->SetNRows(ReadInt(5));
-	result->SetNColumnsFromDB(ReadInt(6));
-	result->SetComment(ReadString(7));
+	result->SetId((dbkey_t)statement->ReadInt(0));
+	result->SetCreatedTime((time_t)statement->ReadInt(1));
+	result->SetModifiedTime((time_t)statement->ReadInt(2));
+	result->SetName(statement->ReadString(3));
+	result->SetDirectoryId((dbkey_t)statement->ReadInt(4));
+	result->SetNRows((int)statement->ReadInt(5));
+	result->SetNColumnsFromDB((int)statement->ReadInt(6));
+	result->SetComment(statement->ReadString(7));
+	statement->FreeResult();
 	
 	SetObjectLoaded(result); //set object flags that it was just loaded from DB
 	
@@ -461,8 +578,6 @@ ConstantsTypeTable * ccdb::MySQLDataProvider::GetConstantsTypeTable( const strin
 	result->SetFullPath(PathUtils::CombinePath(parentDir->GetFullPath(), result->GetName()));
 
 	
-	FreeMySQLResult();
-	
 	//load columns if needed
 	if(loadColumns) LoadColumns(result);
         
@@ -490,6 +605,8 @@ bool ccdb::MySQLDataProvider::GetConstantsTypeTables( vector<ConstantsTypeTable
 
 bool ccdb::MySQLDataProvider::GetConstantsTypeTables(  vector<ConstantsTypeTable *>& resultTypeTables, Directory *parentDir, bool loadColumns/*=false*/)
 {
+	ConnectionScope scope(this);
+
 	ClearErrors(); //Clear error in function that can produce new ones
 
 	//check the directory is ok
@@ -560,6 +677,8 @@ vector<ConstantsTypeTable *> ccdb::MySQLDataProvider::GetConstantsTypeTables( Di
 
 bool ccdb::MySQLDataProvider::SearchConstantsTypeTables( vector<ConstantsTypeTable *>& typeTables, const string& pattern, const string& parentPath /*= ""*/, bool loadColumns/*=false*/, int take/*=0*/, int startWith/*=0 */ )
 {
+	ConnectionScope scope(this);
+
 	ClearErrors(); //Clear error in function that can produce new ones
 
 	// in MYSQL compared to wildcards % is * and _ is 
@@ -670,6 +789,8 @@ std::vector<ConstantsTypeTable *> ccdb::MySQLDataProvider::SearchConstantsTypeTa
 
 bool ccdb::MySQLDataProvider::LoadColumns( ConstantsTypeTable* table )
 {
+	ConnectionScope scope(this);
+
 	ClearErrors(); //Clear error in function that can produce new ones
 
 	//check the directory is ok
@@ -680,10 +801,12 @@ bool ccdb::MySQLDataProvider::LoadColumns( ConstantsTypeTable* table )
 		return false;
 	}
 		
-	string query = StringUtils::Format("SELECT `id`, UNIX_TIMESTAMP(`created`) as `created`, UNIX_TIMESTAMP(`modified`) as `modified`, `name`, `columnType`, `comment` FROM `columns` WHERE `typeId` = '%i' ORDER BY `order`;",
-		/*`directoryId`*/ table->GetId());
+	const char *functionName = "MySQLDataProvider::LoadColumns";
+	MySQLStatement *statement = PrepareStatement("SELECT `id`, UNIX_TIMESTAMP(`created`) as `created`, UNIX_TIMESTAMP(`modified`) as `modified`, `name`, `columnType`, `comment` FROM `columns` WHERE `typeId` = ? ORDER BY `order`;", functionName);
+	if(!statement) return false;
 
-	if(!QuerySelect(query))
+	statement->BindInt(0, table->GetId());
+	if(!ExecuteStatement(statement, functionName))
 	{
 		return false;
 	}
@@ -691,16 +814,16 @@ bool ccdb::MySQLDataProvider::LoadColumns( ConstantsTypeTable* table )
 	//clear(); //we clear the consts. Considering that some one else should handle deletion
 
 	//Ok! We querried our directories! lets catch them! 
-	while(FetchRow())
+	while(statement->Fetch())
 	{
 		//ok lets read the data...
 		ConstantsTypeColumn *result = new ConstantsTypeColumn(table, this);
-		result->SetId(ReadULong(0));				
-		result->SetCreatedTime(ReadUnixTime(1));
-		result->SetModifiedTime(ReadUnixTime(2));
-		result->SetName(ReadString(3));
-		result->SetType(ReadString(4));
-		result->SetComment(ReadString(5));
+		result->SetId((dbkey_t)statement->ReadInt(0));				
+		result->SetCreatedTime((time_t)statement->ReadInt(1));
+		result->SetModifiedTime((time_t)statement->ReadInt(2));
+		result->SetName(statement->ReadString(3));
+		result->SetType(statement->ReadString(4));
+		result->SetComment(statement->ReadString(5));
 		result->SetDBTypeTableId(table->GetId());
 
 		SetObjectLoaded(result); //set object flags that it was just loaded from DB
@@ -708,7 +831,7 @@ bool ccdb::MySQLDataProvider::LoadColumns( ConstantsTypeTable* table )
 		table->AddColumn(result);
 	}
 
-	FreeMySQLResult();
+	statement->FreeResult();
 
 	return true;
 }
@@ -720,6 +843,8 @@ bool ccdb::MySQLDataProvider::LoadColumns( ConstantsTypeTable* table )
 
 RunRange* ccdb::MySQLDataProvider::GetRunRange( int min, int max, const string& name /*= ""*/ )
 {
+	ConnectionScope scope(this);
+
 	//build query
 	string query = "SELECT `id`, UNIX_TIMESTAMP(`created`) as `created`, UNIX_TIMESTAMP(`modified`) as `modified`, `name`, `runMin`, `runMax`,  `comment`"
 	               " FROM `runRanges` WHERE `runMin`='%i' AND `runMax`='%i' AND `name`=\"%s\"";
@@ -763,6 +888,8 @@ RunRange* ccdb::MySQLDataProvider::GetRunRange( int min, int max, const string&
 
 RunRange* ccdb::MySQLDataProvider::GetRunRange( const string& name )
 {
+	ConnectionScope scope(this);
+
 	ClearErrors(); //Clear error in function that can produce new ones
 
 	//build query
@@ -807,6 +934,8 @@ RunRange* ccdb::MySQLDataProvider::GetRunRange( const string& name )
 
 bool ccdb::MySQLDataProvider::GetRunRanges(vector<RunRange*>& resultRunRanges, ConstantsTypeTable* table, const string& variation/*=""*/, int take/*=0*/, int startWith/*=0*/)
 {
+	ConnectionScope scope(this);
+
 	ClearErrors(); //Clear error in function that can produce new ones
 
 	if(!CheckConnection("MySQLDataProvider::GetRunRanges(vector<DRunRange*>& resultRunRanges, ConstantsTypeTable* table, int take, int startWith)")) return false;
@@ -897,8 +1026,13 @@ bool ccdb::MySQLDataProvider::GetRunRanges(vector<RunRange*>& resultRunRanges, C
 
 #pragma region Variations
 
+//variation statements differ only by the condition
+static const char *cMySQLSelectVariationQuery = "SELECT `id`, UNIX_TIMESTAMP(`created`) as `created`, UNIX_TIMESTAMP(`modified`) as `modified`, `name`, `description`, `comment`, `parentId` FROM `variations` ";
+
 bool ccdb::MySQLDataProvider::GetVariations(vector<Variation*>& resultVariations, ConstantsTypeTable* table, int run, int take, int startWith)
 {
+	ConnectionScope scope(this);
+
 	ClearErrors(); //Clear error in function that can produce new ones
 
 	if(!CheckConnection("MySQLDataProvider::GetRunRanges(vector<DRunRange*>& resultRunRanges, ConstantsTypeTable* table, int take, int startWith)")) return false;
@@ -992,10 +1126,27 @@ vector<Variation *> ccdb::MySQLDataProvider::GetVariations( ConstantsTypeTable *
 
 Variation* ccdb::MySQLDataProvider::GetVariation( const string& name )
 {
+	ConnectionScope scope(this);
+
 	ClearErrors(); //Clear error in function that can produce new ones
     if(mLastVariation!=NULL && mLastVariation->GetName()==name) return mLastVariation;
 
-    return SelectVariation("`name`= \"" + name + "\"");
+    //variations are few. All of them are read by one query, then a chain needs no query for each parent
+    if(!mVariationsAreLoaded) LoadVariations();
+    for(map<dbkey_t, Variation *>::iterator it = mVariationsById.begin(); it != mVariationsById.end(); ++it)
+    {
+        if(it->second->GetName() == name)
+        {
+            mLastVariation = it->second;
+            return mLastVariation;
+        }
+    }
+
+    //the variation may be created after the load
+    MySQLStatement *statement = PrepareStatement(cMySQLSelectVariationQuery + string("WHERE `name` = ?;"), "MySQLDataProvider::GetVariation");
+    if(!statement) return NULL;
+    statement->BindString(0, name);
+    return SelectVariation(statement);
 }
 
 /** @brief Load variation by name
@@ -1005,55 +1156,49 @@ Variation* ccdb::MySQLDataProvider::GetVariation( const string& name )
 */
 Variation* ccdb::MySQLDataProvider::GetVariationById(int id)
 {
+    ConnectionScope scope(this);
+
     if(mVariationsById.find(id) != mVariationsById.end()) return mVariationsById[id];
     
     ClearErrors(); //Clear error in function that can produce new ones
-    return SelectVariation("`id`= " + StringUtils::IntToString(id) + "");
+    MySQLStatement *statement = PrepareStatement(cMySQLSelectVariationQuery + string("WHERE `id` = ?;"), "MySQLDataProvider::GetVariationById");
+    if(!statement) return NULL;
+    statement->BindInt(0, id);
+    return SelectVariation(statement);
 }
 
 /**
-* Get variation by database request
+* Get variation by executed variation statement
 */
-Variation* ccdb::MySQLDataProvider::SelectVariation(const string& whereClause)
+Variation* ccdb::MySQLDataProvider::SelectVariation(MySQLStatement* statement)
 {
-    //TODO: Implement method
-    string query = "SELECT `id`, UNIX_TIMESTAMP(`created`) as `created`, UNIX_TIMESTAMP(`modified`) as `modified`, `name`, `description`, `comment`, `parentId`"
-        " FROM `variations` WHERE "+whereClause+";";
-
     //query this
-    if(!QuerySelect(query))
+    if(!ExecuteStatement(statement, "MySQLDataProvider::SelectVariation"))
     {
-        //TODO report error
         return NULL;
     }
 
     //Ok! We queried our run range! lets catch it! 
-    if(!FetchRow())
+    if(!statement->Fetch())
     {
         //nothing was selected
+        statement->FreeResult();
         return NULL;
     }
 
     //ok lets read the data...
-    Variation *result = new Variation(this, this);
-    result->SetId(ReadULong(0));
-    result->SetCreatedTime(ReadUnixTime(1));
-    result->SetModifiedTime(ReadUnixTime(2));
-    result->SetName(ReadString(3));
-    result->SetDescription(ReadString(4));
-    result->SetComment(ReadString(5));
-    result->SetParentDbId(ReadULong(6));
-
-    if(mReturnedRowsNum>1)
+    Variation *result = FetchVariation(statement);
+
+    if(statement->GetRowsCount()>1)
     {
         //TODO warning not uniq row
     }
 
-    result->SetOwner(this, true);
-
     mVariationsById[result->GetId()] = result;
     mLastVariation = result;
-    FreeMySQLResult();
+
+    //the statement is executed again for the parent
+    statement->FreeResult();
 
     //Get parent recursively
     if(result->GetParentDbId()!=0)
@@ -1065,6 +1210,57 @@ Variation* ccdb::MySQLDataProvider::SelectVariation(const string& whereClause)
 }
 
 
+Variation* ccdb::MySQLDataProvider::FetchVariation(MySQLStatement* statement)
+{
+    //reads the fetched row of cMySQLSelectVariationQuery
+    Variation *result = new Variation(this, this);
+    result->SetId((dbkey_t)statement->ReadInt(0));
+    result->SetCreatedTime((time_t)statement->ReadInt(1));
+    result->SetModifiedTime((time_t)statement->ReadInt(2));
+    result->SetName(statement->ReadString(3));
+    result->SetDescription(statement->ReadString(4));
+    result->SetComment(statement->ReadString(5));
+    result->SetParentDbId((dbkey_t)statement->ReadInt(6));
+    result->SetOwner(this, true);
+    return result;
+}
+
+
+bool ccdb::MySQLDataProvider::LoadVariations()
+{
+    /** @brief Reads all variations by one query and links them to parents
+     *
+     * Variations that are already read are kept, so pointers to them stay valid
+     */
+    ConnectionScope scope(this);
+
+    const char *functionName = "MySQLDataProvider::LoadVariations";
+    MySQLStatement *statement = PrepareStatement(cMySQLSelectVariationQuery + string(";"), functionName);
+    if(!statement || !ExecuteStatement(statement, functionName)) return false;
+
+    vector<Variation *> loaded;
+    while(statement->Fetch())
+    {
+        dbkey_t id = (dbkey_t)statement->ReadInt(0);
+        if(mVariationsById.find(id) != mVariationsById.end()) continue;
+
+        Variation *variation = FetchVariation(statement);
+        mVariationsById[id] = variation;
+        loaded.push_back(variation);
+    }
+    statement->FreeResult();
+
+    for(size_t i = 0; i < loaded.size(); i++)
+    {
+        map<dbkey_t, Variation *>::iterator parent = mVariationsById.find(loaded[i]->GetParentDbId());
+        if(loaded[i]->GetParentDbId() != 0 && parent != mVariationsById.end()) loaded[i]->SetParent(parent->second);
+    }
+
+    mVariationsAreLoaded = true;
+    return true;
+}
+
+
 #pragma endregion Variations
 
 //----------------------------------------------------------------------------------------
@@ -1072,6 +1268,19 @@ Variation* ccdb::MySQLDataProvider::SelectVariation(const string& whereClause)
 //----------------------------------------------------------------------------------------
 
 #pragma region Assignment
+
+//type table id by its name and directory id. The parameters are bound by ExecuteAssignmentLookup
+static const char *cMySQLTypeTableIdQuery = "(SELECT `id` FROM `typeTables` WHERE `name` = ? AND `directoryId` = ?)";
+
+//type table and its columns. The first part of the cold lookup in ExecuteAssignmentLookup
+static const char *cMySQLTypeTableLookupQuery =
+    "(SELECT 0 AS `kind`, `id`, UNIX_TIMESTAMP(`created`) AS `created`, UNIX_TIMESTAMP(`modified`) AS `modified`, "
+    "`name`, `nRows` AS `number`, `nColumns` AS `number2`, `comment` AS `text`, NULL AS `text2`, 0 AS `ord` "
+    "FROM `typeTables` WHERE `name` = ? AND `directoryId` = ?) "
+    "UNION ALL "
+    "(SELECT 1, `id`, UNIX_TIMESTAMP(`created`), UNIX_TIMESTAMP(`modified`), "
+    "`name`, 0, 0, `columnType`, `comment`, `order` "
+    "FROM `columns` WHERE `typeId` = (SELECT `id` FROM `typeTables` WHERE `name` = ? AND `directoryId` = ?)) ";
 Assignment* ccdb::MySQLDataProvider::GetAssignmentShort(int run, const string& path, const string& variationName, bool loadColumns /*=false*/)
 {
     /** @brief Get Assignment with data blob only
@@ -1093,121 +1302,634 @@ Assignment* ccdb::MySQLDataProvider::GetAssignmentShort(int run, const string& p
     /** @brief Get specified by creation time version of Assignment with data blob only.
      *
      * The Time is a timestamp, data that is equal or earlier in time than that timestamp is returned
+     * Type table and variation are taken from the metadata catalog. If the type table is not in
+     * the catalog yet, it is read with its columns by the same statement as the assignment.
+     * So each lookup is one round trip to the server.
+     * The type table (with columns) is shared and is not owned by the assignment
      *
      * @remarks this function is named so
      * @param [in] run - run number
      * @param [in] path - object path
      * @param [in] time - timestamp, data that is equal or earlier in time than that timestamp is returned
      * @param [in] variation - variation name
+     * @param [in] loadColumns - ignored, catalog type tables always have columns
      * @return new DAssignment object or 
      */
 
-	ClearErrors(); //Clear error in function that can produce new ones
+    ConnectionScope scope(this);
 
-	if(!CheckConnection("MySQLDataProvider::GetAssignmentShort( int run, const char* path, const char* variation, int version /*= -1*/ )")) return NULL;
-	        
-    //Get directory. Directories should be cached. So this doesn't make a database request
-    
-    ConstantsTypeTable *table = GetConstantsTypeTable(path, loadColumns);
-    if(!table)
-    {
-        Error(CCDB_ERROR_NO_TYPETABLE, "MySQLDataProvider::GetAssignmentShort", "Type table was not found: '"+path+"'" );
-        return NULL;
-    }
+	ClearErrors(); //Clear error in function that can produce new ones
 
-    //retrieve name of our constant table 
-    string tableName = PathUtils::ExtractObjectname(path);
+	const char *functionName = "MySQLDataProvider::GetAssignmentShort(int, const string&, time_t, const string&)";
+	if(!CheckConnection(functionName)) return NULL;
 
-    //get variation
-    Variation* variation = GetVariation(variationName);
-    if(!variation)
+    //get variation and its parents
+    const vector<Variation *> *variations = GetCatalogVariationChain(variationName);
+    if(!variations)
     {
         Error(CCDB_ERROR_VARIATION_INVALID,"MySQLDataProvider::GetAssignmentShort", "No variation '"+variationName+"' was found");
         return NULL;
     }
 
-    //run number to string
-    string runStr = StringUtils::IntToString(run);
-
-	//ok now we must build our mighty query...
-	string query=
-        "SELECT `assignments`.`id` AS `asId`, "
-        "`constantSets`.`vault` AS `blob` "
-        "FROM  `assignments` "
-        "USE INDEX (id_UNIQUE) "
-        "INNER JOIN `runRanges` ON `assignments`.`runRangeId`= `runRanges`.`id` "
-        "INNER JOIN `constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id` "
-        "INNER JOIN `typeTables` ON `constantSets`.`constantTypeId` = `typeTables`.`id` "
-        "WHERE  `runRanges`.`runMin` <= '"+runStr+"' "
-        "AND `runRanges`.`runMax` >= '"+runStr+"' "
-        "AND `assignments`.`variationId`= '"+StringUtils::IntToString(variation->GetId())+"' "
-        "AND `constantSets`.`constantTypeId` ='"+StringUtils::IntToString(table->GetId())+"' ";
-    
-    //time in querY?
-    if(time>0)
-    {
-        char timeBuf[32];
-        sprintf(timeBuf,"%lu",time);
-        query=query + "AND UNIX_TIMESTAMP(`assignments`.`created`) <= '"+string(timeBuf)+"' ";
-    }
-
-    //finish query 
-    query = query + "ORDER BY `assignments`.`id` DESC LIMIT 1 ";
-	
-	//query this
-	if(!QuerySelect(query))
-	{
-		//TODO report error
-		return NULL;
-	}
-
-    //If We have not found data for this variation, getting data for parent variation
-    if(mReturnedRowsNum==0 && variation->GetParentDbId()!=0)
+    //the run is resolved by the index, only the blob is read
+    AssignmentLookup lookup;
+    if(FindInRunRangeIndex(path, *variations, run, time, lookup.AssignmentId))
     {
-        delete table;
-		return GetAssignmentShort(run, path, time, variation->GetParent()->GetName(), loadColumns);
+        if(lookup.AssignmentId)
+        {
+            Assignment *indexed = GetAssignmentShortById(lookup.AssignmentId, path, loadColumns);
+            if(indexed) indexed->SetRequestedRun(run);
+            return indexed;
+        }
     }
+    //the whole variation chain is looked up at once. The assignment of the nearest variation wins
+    else if(!ExecuteAssignmentLookup(lookup, path, true, 0, run, time, variations, functionName)) return NULL;
 
-	//Ok! We queried our run range! lets catch it! 
-	if(!FetchRow())
+	if(!lookup.AssignmentId)
 	{
-		Error(CCDB_ERROR_NO_ASSIGMENT,"MySQLDataProvider::GetAssignmentShort(int, const string&, time_t, const string&)", 
+		Error(CCDB_ERROR_NO_ASSIGMENT, functionName, 
             StringUtils::Format("No data was selected. Table '%s' for run='%i', timestampt='%lu' and variation='%s' ", path.c_str(), run, time, variationName.c_str()));
 		return NULL;
 	}
 
 	//ok lets read the data...
-	Assignment *result = new Assignment(this, this);
-	result->SetId( ReadIndex(0) );
-	result->SetRawData( ReadString(1) );
+	Assignment *result = new Assignment(NULL, this);
+	result->SetId(lookup.AssignmentId);
+	result->SetRawData(DecompressVault(std::move(lookup.Blob)));
 	
 	//additional fill
 	result->SetRequestedRun(run);
-	result->SetVariationId(variation->GetId());
+	result->SetVariationId(lookup.VariationId);
 	
-    //type table
-    result->SetTypeTable(table);
-    result->BeOwner(table);
-    table->SetOwner(result);
+    //type table belongs to the catalog
+    result->SetTypeTable(lookup.Table);
 
-	if(mReturnedRowsNum>1)
+	return result;
+
+}
+
+dbkey_t ccdb::MySQLDataProvider::GetAssignmentIdShort(int run, const string& path, time_t time, const string& variationName)
+{
+    /** @brief Resolves request to assignment id without reading data blob
+     *
+     * The same query as in GetAssignmentShort but without the blob
+     *
+     * @param [in] run - run number
+     * @param [in] path - object path
+     * @param [in] time - timestamp, data that is equal or earlier in time than that timestamp is returned. 0 - no time limit
+     * @param [in] variation - variation name
+     * @return assignment id or 0 if no assignment is found or error
+     */
+
+    ConnectionScope scope(this);
+
+	ClearErrors(); //Clear error in function that can produce new ones
+
+	const char *functionName = "MySQLDataProvider::GetAssignmentIdShort";
+	if(!CheckConnection(functionName)) return 0;
+
+    //get variation and its parents
+    const vector<Variation *> *variations = GetCatalogVariationChain(variationName);
+    if(!variations)
+    {
+        Error(CCDB_ERROR_VARIATION_INVALID,"MySQLDataProvider::GetAssignmentIdShort", "No variation '"+variationName+"' was found");
+        return 0;
+    }
+
+    dbkey_t indexedId = 0;
+    if(FindInRunRangeIndex(path, *variations, run, time, indexedId)) return indexedId;
+
+    AssignmentLookup lookup;
+    if(!ExecuteAssignmentLookup(lookup, path, false, 0, run, time, variations, functionName)) return 0;
+	return lookup.AssignmentId;
+}
+
+
+Assignment* ccdb::MySQLDataProvider::GetAssignmentShortById(dbkey_t id, const string& path, bool loadColumns /*=false*/)
+{
+    /** @brief Get Assignment with data blob only by assignment id
+     *
+     * @param [in] id - assignment id
+     * @param [in] path - object path
+     * @param [in] loadColumns - ignored, catalog type tables always have columns
+     * @return DAssignment object or NULL if no assignment is found or error
+     */
+
+    ConnectionScope scope(this);
+
+	ClearErrors(); //Clear error in function that can produce new ones
+
+	const char *functionName = "MySQLDataProvider::GetAssignmentShortById";
+	if(!CheckConnection(functionName)) return NULL;
+
+    AssignmentLookup lookup;
+    if(!ExecuteAssignmentLookup(lookup, path, true, id, 0, 0, NULL, functionName)) return NULL;
+
+	if(!lookup.AssignmentId)
 	{
-		//TODO warning not uniq row
+		Error(CCDB_ERROR_NO_ASSIGMENT, functionName,
+            StringUtils::Format("No assignment with id '%i'", id));
+		return NULL;
 	}
 
-	FreeMySQLResult();
+	Assignment *result = new Assignment(NULL, this);
+	result->SetId(lookup.AssignmentId);
+	result->SetVariationId(lookup.VariationId);
+	result->SetRawData(DecompressVault(std::move(lookup.Blob)));
+
+    //type table belongs to the catalog
+    result->SetTypeTable(lookup.Table);
+
 	return result;
+}
+
+
+bool ccdb::MySQLDataProvider::ExecuteAssignmentLookup(AssignmentLookup& lookup, const string& path, bool withBlob, dbkey_t id, int run, time_t time, const vector<Variation *> *variations, const char* functionName)
+{
+    /** @brief Resolves the assignment and, if it is not in the catalog, the type table by one statement
+     *
+     * A cold lookup used to run type table, columns and assignment queries one by one.
+     * Now they are parts of one UNION ALL statement. The rows are told apart by `kind` column:
+     *   0 - type table, 1 - columns (in their order), 2 - assignment (at most one row)
+     * The type table is found by its name and directory id. Directories are loaded once per provider
+     * The read type table is added to the catalog
+     *
+     * @param [out] lookup - type table and assignment. AssignmentId is 0 if no assignment is found
+     * @param [in] path - object path
+     * @param [in] withBlob - read data blob of the assignment
+     * @param [in] id - assignment id or 0 to look up by run, time and variations
+     * @return false if error (is reported)
+     */
+    lookup.Table = NULL;
+    lookup.AssignmentId = 0;
+    lookup.VariationId = 0;
+    lookup.Blob.clear();
+
+    //type table from the catalog or its directory to read it
+    Directory *dir = NULL;
+    unordered_map<string, ConstantsTypeTable *>::iterator found = mCatalogTypeTables.find(path);
+    if(found != mCatalogTypeTables.end())
+    {
+        lookup.Table = found->second;
+    }
+    else
+    {
+        dir = GetDirectory(PathUtils::ExtractDirectory(path));
+        if(!dir)
+        {
+            Error(CCDB_ERROR_NO_TYPETABLE, functionName, "Type table was not found: '"+path+"'" );
+            return false;
+        }
+    }
+
+    //The part that selects the assignment
+	string query=
+        "(SELECT 2 AS `kind`, `assignments`.`id` AS `id`, 0 AS `created`, 0 AS `modified`, "
+        "NULL AS `name`, `assignments`.`variationId` AS `number`, 0 AS `number2`, " +
+        string(withBlob ? "`constantSets`.`vault`" : "NULL") + " AS `text`, NULL AS `text2`, 0 AS `ord` "
+        "FROM  `assignments` ";
+
+    //assignments that keep constantTypeId are filtered by (constantTypeId, variationId, runRangeId, id) index,
+    //constantSets is joined only for the blob
+    bool hasTypeIds = HasAssignmentTypeIds();
+    if(withBlob || !hasTypeIds) query += "INNER JOIN `constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id` ";
+    if(id)
+    {
+        query += "WHERE `assignments`.`id` = ?) ";
+    }
+    else
+    {
+        query +=
+            "INNER JOIN `runRanges` ON `assignments`.`runRangeId`= `runRanges`.`id` "
+            "WHERE  " + string(hasTypeIds ? "`assignments`" : "`constantSets`") + ".`constantTypeId` = " + string(dir ? cMySQLTypeTableIdQuery : "?") + " "
+            "AND `runRanges`.`runMin` <= ? "
+            "AND `runRanges`.`runMax` >= ? ";
+
+        //time in querY?
+        if(time>0) query += "AND UNIX_TIMESTAMP(`assignments`.`created`) <= ? ";
+
+        query += PrepareVariationChainInsertion(variations->size()) + "LIMIT 1) ";
+    }
+
+    //cold lookup. Type table and columns are read by the same statement
+    if(dir) query = cMySQLTypeTableLookupQuery + string("UNION ALL ") + query + "ORDER BY `kind`, `ord`";
+
+    //The statement is prepared once for each combination of the parts
+	MySQLStatement *statement = PrepareStatement(query, functionName);
+	if(!statement) return false;
+
+	size_t parameter = 0;
+    string name = PathUtils::ExtractObjectname(path);
+    if(dir)
+    {
+        //type table and columns
+        statement->BindString(parameter++, name);
+        statement->BindInt(parameter++, dir->GetId());
+        statement->BindString(parameter++, name);
+        statement->BindInt(parameter++, dir->GetId());
+    }
+    if(id)
+    {
+        statement->BindInt(parameter++, id);
+    }
+    else
+    {
+        if(dir)
+        {
+            statement->BindString(parameter++, name);
+            statement->BindInt(parameter++, dir->GetId());
+        }
+        else
+        {
+            statement->BindInt(parameter++, lookup.Table->GetId());
+        }
+        statement->BindInt(parameter++, run);
+        statement->BindInt(parameter++, run);
+        if(time>0) statement->BindInt(parameter++, (long long)time);
+        BindVariationChain(statement, *variations, parameter);
+    }
+
+	if(!ExecuteStatement(statement, functionName))
+	{
+		return false;
+	}
+
+    ConstantsTypeTable *table = NULL;
+	while(statement->Fetch())
+	{
+        switch(statement->ReadInt(0))
+        {
+        case 0:
+            table = new ConstantsTypeTable(this, this);
+            table->SetId((dbkey_t)statement->ReadInt(1));
+            table->SetCreatedTime((time_t)statement->ReadInt(2));
+            table->SetModifiedTime((time_t)statement->ReadInt(3));
+            table->SetName(statement->ReadString(4));
+            table->SetDirectoryId(dir->GetId());
+            table->SetNRows((int)statement->ReadInt(5));
+            table->SetNColumnsFromDB((int)statement->ReadInt(6));
+            table->SetComment(statement->ReadString(7));
+            SetObjectLoaded(table);
+            break;
+        case 1:
+            if(table)
+            {
+                ConstantsTypeColumn *column = new ConstantsTypeColumn(table, this);
+                column->SetId((dbkey_t)statement->ReadInt(1));
+                column->SetCreatedTime((time_t)statement->ReadInt(2));
+                column->SetModifiedTime((time_t)statement->ReadInt(3));
+                column->SetName(statement->ReadString(4));
+                column->SetType(statement->ReadString(7));
+                column->SetComment(statement->ReadString(8));
+                column->SetDBTypeTableId(table->GetId());
+                SetObjectLoaded(column);
+                table->AddColumn(column);
+            }
+            break;
+        case 2:
+            lookup.AssignmentId = (dbkey_t)statement->ReadInt(1);
+            lookup.VariationId = (dbkey_t)statement->ReadInt(5);
+            if(withBlob) lookup.Blob = statement->ReadString(7);
+            break;
+        }
+	}
+	statement->FreeResult();
+
+    if(dir)
+    {
+        if(!table)
+        {
+            Error(CCDB_ERROR_NO_TYPETABLE, functionName, "Type table was not found: '"+path+"'" );
+            return false;
+        }
+
+        //the same as GetConstantsTypeTable gives
+        table->SetDirectory(dir);
+        table->SetFullPath(PathUtils::CombinePath(dir->GetFullPath(), table->GetName()));
+        lookup.Table = AddCatalogTypeTable(path, table);
+    }
+
+	return true;
+}
+
+bool ccdb::MySQLDataProvider::LoadCatalogTypeTables(const vector<string>& paths, const char* functionName)
+{
+    /** @brief Reads type tables that are not in the catalog and their columns by one UNION ALL statement
+     *
+     * GetCatalogTypeTable reads one table with its columns by two queries. For a batch of N cold paths
+     * it was 2N round trips before the batch itself. Now tables are found by their names and directory ids:
+     *   0 - type tables, 1 - their columns (in their order)
+     * One statement reads up to cMaxBatchQuerySize tables. Directories are loaded once per provider
+     */
+    ConnectionScope scope(this);
+
+    //paths to read and their directories. Paths of not existing directories have no tables
+    vector<string> missingPaths;
+    vector<Directory *> dirs;
+    set<string> seenPaths;
+    for(size_t i=0; i<paths.size(); i++)
+    {
+        if(mCatalogTypeTables.count(paths[i]) || !seenPaths.insert(paths[i]).second) continue;
+
+        Directory *dir = GetDirectory(PathUtils::ExtractDirectory(paths[i]));
+        if(!dir) continue;
+        missingPaths.push_back(paths[i]);
+        dirs.push_back(dir);
+    }
+
+    for(size_t first=0; first<missingPaths.size(); first+=cMaxBatchQuerySize)
+    {
+        size_t count = min(cMaxBatchQuerySize, missingPaths.size() - first);
+        size_t querySize = GetBatchQuerySize(count);
+
+        string whereList;
+        for(size_t i=0; i<querySize; i++)
+        {
+            whereList += i==0 ? "" : "OR ";
+            whereList += "(`typeTables`.`name` = ? AND `typeTables`.`directoryId` = ?) ";
+        }
+
+        //The statement is prepared once for each batch size
+        MySQLStatement *statement = PrepareStatement(
+            "(SELECT 0 AS `kind`, `typeTables`.`id`, UNIX_TIMESTAMP(`typeTables`.`created`) AS `created`, "
+            "UNIX_TIMESTAMP(`typeTables`.`modified`) AS `modified`, `typeTables`.`name`, `typeTables`.`directoryId` AS `parentId`, "
+            "`typeTables`.`nRows` AS `number`, `typeTables`.`nColumns` AS `number2`, `typeTables`.`comment` AS `text`, NULL AS `text2`, 0 AS `ord` "
+            "FROM `typeTables` WHERE " + whereList + ") "
+            "UNION ALL "
+            "(SELECT 1, `columns`.`id`, UNIX_TIMESTAMP(`columns`.`created`), UNIX_TIMESTAMP(`columns`.`modified`), "
+            "`columns`.`name`, `columns`.`typeId`, 0, 0, `columns`.`columnType`, `columns`.`comment`, `columns`.`order` "
+            "FROM `columns` INNER JOIN `typeTables` ON `columns`.`typeId` = `typeTables`.`id` WHERE " + whereList + ") "
+            "ORDER BY `kind`, `parentId`, `ord`", functionName);
+        if(!statement) return false;
+
+        size_t parameter = 0;
+        for(int part=0; part<2; part++)
+        {
+            for(size_t i=0; i<querySize; i++)
+            {
+                size_t index = first + min(i, count - 1);
+                statement->BindString(parameter++, PathUtils::ExtractObjectname(missingPaths[index]));
+                statement->BindInt(parameter++, dirs[index]->GetId());
+            }
+        }
+
+        if(!ExecuteStatement(statement, functionName)) return false;
+
+        //id => table, (directory id, name) => table
+        map<dbkey_t, ConstantsTypeTable *> tablesById;
+        map<pair<dbkey_t, string>, ConstantsTypeTable *> tablesByName;
+        while(statement->Fetch())
+        {
+            if(statement->ReadInt(0) == 0)
+            {
+                ConstantsTypeTable *table = new ConstantsTypeTable(this, this);
+                table->SetId((dbkey_t)statement->ReadInt(1));
+                table->SetCreatedTime((time_t)statement->ReadInt(2));
+                table->SetModifiedTime((time_t)statement->ReadInt(3));
+                table->SetName(statement->ReadString(4));
+                table->SetDirectoryId((dbkey_t)statement->ReadInt(5));
+                table->SetNRows((int)statement->ReadInt(6));
+                table->SetNColumnsFromDB((int)statement->ReadInt(7));
+                table->SetComment(statement->ReadString(8));
+                SetObjectLoaded(table);
+                tablesById[table->GetId()] = table;
+                tablesByName[make_pair(table->GetDirectoryId(), table->GetName())] = table;
+                continue;
+            }
+
+            map<dbkey_t, ConstantsTypeTable *>::iterator found = tablesById.find((dbkey_t)statement->ReadInt(5));
+            if(found == tablesById.end()) continue;
+
+            ConstantsTypeColumn *column = new ConstantsTypeColumn(found->second, this);
+            column->SetId((dbkey_t)statement->ReadInt(1));
+            column->SetCreatedTime((time_t)statement->ReadInt(2));
+            column->SetModifiedTime((time_t)statement->ReadInt(3));
+            column->SetName(statement->ReadString(4));
+            column->SetType(statement->ReadString(8));
+            column->SetComment(statement->ReadString(9));
+            column->SetDBTypeTableId(found->second->GetId());
+            SetObjectLoaded(column);
+            found->second->AddColumn(column);
+        }
+        statement->FreeResult();
+
+        //the same as GetConstantsTypeTable gives. Each read table goes to the catalog once
+        for(size_t i=first; i<first + count; i++)
+        {
+            map<pair<dbkey_t, string>, ConstantsTypeTable *>::iterator found =
+                tablesByName.find(make_pair(dirs[i]->GetId(), PathUtils::ExtractObjectname(missingPaths[i])));
+            if(found == tablesByName.end() || !found->second) continue;
+
+            ConstantsTypeTable *table = found->second;
+            table->SetDirectory(dirs[i]);
+            table->SetFullPath(PathUtils::CombinePath(dirs[i]->GetFullPath(), table->GetName()));
+            AddCatalogTypeTable(missingPaths[i], table);
+            found->second = NULL;
+        }
+
+        //tables that no path took
+        for(map<pair<dbkey_t, string>, ConstantsTypeTable *>::iterator it = tablesByName.begin(); it != tablesByName.end(); ++it)
+        {
+            delete it->second;
+        }
+    }
 
+    return true;
 }
 
+
+bool ccdb::MySQLDataProvider::FindInRunRangeIndex(const string& path, const vector<Variation *>& variations, int run, time_t time, dbkey_t& assignmentId)
+{
+    /** @brief Looks up the assignment in the run range index if the type table is in the catalog
+     *
+     * The first lookup of a table reads it by ExecuteAssignmentLookup in one round trip,
+     * the next lookups use the index. @see DataProvider::FindInRunRangeIndex
+     */
+    if(!IsRunRangeIndexEnabled()) return false;
+
+    unordered_map<string, ConstantsTypeTable *>::iterator found = mCatalogTypeTables.find(path);
+    if(found == mCatalogTypeTables.end()) return false;
+    return DataProvider::FindInRunRangeIndex(found->second, variations, run, time, assignmentId);
+}
+
+
+bool ccdb::MySQLDataProvider::LoadRunRangeIndex(ConstantsTypeTable *table, vector<RunRangeIndexEntry>& entries)
+{
+    /** @brief Reads run ranges, ids, variations and creation times of all assignments of the type table */
+    ConnectionScope scope(this);
+
+    const char *functionName = "MySQLDataProvider::LoadRunRangeIndex";
+    MySQLStatement *statement = PrepareStatement(
+        "SELECT `runRanges`.`runMin`, `runRanges`.`runMax`, `assignments`.`id`, `assignments`.`variationId`, "
+        "UNIX_TIMESTAMP(`assignments`.`created`) "
+        "FROM  `assignments` "
+        "INNER JOIN `runRanges` ON `assignments`.`runRangeId`= `runRanges`.`id` " +
+        string(HasAssignmentTypeIds() ?
+            "WHERE `assignments`.`constantTypeId` = ?" :
+            "INNER JOIN `constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id` "
+            "WHERE `constantSets`.`constantTypeId` = ?"), functionName);
+    if(!statement) return false;
+
+    statement->BindInt(0, table->GetId());
+    if(!ExecuteStatement(statement, functionName)) return false;
+
+    entries.reserve(statement->GetRowsCount());
+    while(statement->Fetch())
+    {
+        RunRangeIndexEntry entry;
+        entry.RunMin = (int)statement->ReadInt(0);
+        entry.RunMax = (int)statement->ReadInt(1);
+        entry.AssignmentId = (dbkey_t)statement->ReadInt(2);
+        entry.VariationId = (dbkey_t)statement->ReadInt(3);
+        entry.Created = statement->ReadInt(4);
+        entries.push_back(entry);
+    }
+    statement->FreeResult();
+    return true;
+}
+
+
+bool ccdb::MySQLDataProvider::GetAssignmentsShortBatch(vector<Assignment *>& assignments, int run, const vector<string>& paths, time_t time, const string& variationName)
+{
+    /** @brief Get Assignments with data blob only for many type tables of the same run, variation and time
+     *
+     * Each type table is resolved by the same subquery as in ExecuteAssignmentLookup, all of them by one statement:
+     * SELECT ... FROM (SELECT id, (<assignment query of the type table>) FROM typeTables WHERE id IN (...))
+     * So N lookups are one round trip. Window functions would do the same, but they need MySQL 8.0.
+     * Type tables that are not in the catalog are read first, all of them by one statement (@see LoadCatalogTypeTables).
+     * If run range index is on, the assignments are read one by one by indexed ids
+     *
+     * @see DataProvider::GetAssignmentsShortBatch
+     */
+
+    ConnectionScope scope(this);
+
+	ClearErrors(); //Clear error in function that can produce new ones
+
+	const char *functionName = "MySQLDataProvider::GetAssignmentsShortBatch";
+	assignments.assign(paths.size(), NULL);
+	if(!CheckConnection(functionName)) return false;
+
+	if(IsRunRangeIndexEnabled()) return DataProvider::GetAssignmentsShortBatch(assignments, run, paths, time, variationName);
+
+    //get variation and its parents
+    const vector<Variation *> *variations = GetCatalogVariationChain(variationName);
+    if(!variations)
+    {
+        Error(CCDB_ERROR_VARIATION_INVALID,"MySQLDataProvider::GetAssignmentsShortBatch", "No variation '"+variationName+"' was found");
+        return false;
+    }
+
+    //type tables that are not in the catalog are read by one statement
+    if(!LoadCatalogTypeTables(paths, functionName)) return false;
+
+    //type table id => indexes of paths. The same table may be requested several times
+    vector<ConstantsTypeTable *> tables(paths.size(), NULL);
+    vector<dbkey_t> typeIds;
+    multimap<dbkey_t, size_t> pathIndexes;
+    for(size_t i=0; i<paths.size(); i++)
+    {
+        unordered_map<string, ConstantsTypeTable *>::iterator found = mCatalogTypeTables.find(paths[i]);
+        if(found != mCatalogTypeTables.end()) tables[i] = found->second;
+        if(!tables[i])
+        {
+            Error(CCDB_ERROR_NO_TYPETABLE, functionName, "Type table was not found: '"+paths[i]+"'" );
+            continue;
+        }
+        if(!pathIndexes.count(tables[i]->GetId())) typeIds.push_back(tables[i]->GetId());
+        pathIndexes.insert(make_pair(tables[i]->GetId(), i));
+    }
+
+    //assignments that keep constantTypeId are filtered by (constantTypeId, variationId, runRangeId, id) index
+    bool hasTypeIds = HasAssignmentTypeIds();
+    string lookupQuery =
+        "SELECT `assignments`.`id` FROM `assignments` " +
+        string(hasTypeIds ? "" : "INNER JOIN `constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id` ") +
+        "INNER JOIN `runRanges` ON `assignments`.`runRangeId`= `runRanges`.`id` "
+        "WHERE  " + string(hasTypeIds ? "`assignments`" : "`constantSets`") + ".`constantTypeId` = `typeTables`.`id` "
+        "AND `runRanges`.`runMin` <= ? "
+        "AND `runRanges`.`runMax` >= ? " +
+        string(time>0 ? "AND UNIX_TIMESTAMP(`assignments`.`created`) <= ? " : "") +
+        PrepareVariationChainInsertion(variations->size()) + "LIMIT 1";
+
+    bool isOk = true;
+    for(size_t first=0; isOk && first<typeIds.size(); first+=cMaxBatchQuerySize)
+    {
+        size_t count = min(cMaxBatchQuerySize, typeIds.size() - first);
+        size_t querySize = GetBatchQuerySize(count);
+
+        string inList;
+        for(size_t i=0; i<querySize; i++) inList += (i==0 ? "?" : ",?");
+
+        //The statement is prepared once for each variation chain length and batch size
+        MySQLStatement *statement = PrepareStatement(
+            "SELECT `assignments`.`id`, `found`.`typeId`, `assignments`.`variationId`, `constantSets`.`vault` "
+            "FROM (SELECT `typeTables`.`id` AS `typeId`, (" + lookupQuery + ") AS `asId` "
+            "      FROM `typeTables` WHERE `typeTables`.`id` IN (" + inList + ")) AS `found` "
+            "INNER JOIN `assignments` ON `assignments`.`id` = `found`.`asId` "
+            "INNER JOIN `constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id`", functionName);
+        if(!statement)
+        {
+            isOk = false;
+            break;
+        }
+
+        size_t parameter = 0;
+        statement->BindInt(parameter++, run);
+        statement->BindInt(parameter++, run);
+        if(time>0) statement->BindInt(parameter++, (long long)time);
+        BindVariationChain(statement, *variations, parameter);
+        parameter += variations->size() > 1 ? 2 * variations->size() : variations->size();
+        for(size_t i=0; i<querySize; i++) statement->BindInt(parameter++, typeIds[first + min(i, count - 1)]);
+
+        if(!ExecuteStatement(statement, functionName))
+        {
+            isOk = false;
+            break;
+        }
+
+        while(statement->Fetch())
+        {
+            dbkey_t typeId = (dbkey_t)statement->ReadInt(1);
+            string blob = DecompressVault(statement->ReadString(3));
+
+            pair<multimap<dbkey_t, size_t>::iterator, multimap<dbkey_t, size_t>::iterator> range = pathIndexes.equal_range(typeId);
+            for(multimap<dbkey_t, size_t>::iterator it = range.first; it != range.second; ++it)
+            {
+                Assignment *assignment = new Assignment(NULL, this);
+                assignment->SetId((dbkey_t)statement->ReadInt(0));
+                assignment->SetVariationId((dbkey_t)statement->ReadInt(2));
+                assignment->SetRawData(blob);
+                assignment->SetRequestedRun(run);
+                assignment->SetTypeTable(tables[it->second]);   //type table belongs to the catalog
+                assignments[it->second] = assignment;
+            }
+        }
+        statement->FreeResult();
+    }
+
+    if(!isOk)
+    {
+        for(size_t i=0; i<assignments.size(); i++) delete assignments[i];
+        assignments.assign(paths.size(), NULL);
+        return false;
+    }
+    return true;
+}
+
+
 Assignment* ccdb::MySQLDataProvider::GetAssignmentFull( int run, const string& path, const string& variation )
 {
+	ConnectionScope scope(this);
+
 	if(!CheckConnection("MySQLDataProvider::GetAssignmentFull(int run, cconst string& path, const string& variation")) return NULL;
 	return DataProvider::GetAssignmentFull(run, path, variation);
 }
 
 Assignment* ccdb::MySQLDataProvider::GetAssignmentFull( int run, const string& path,int version, const string& variation/*= "default"*/)
 {
+	ConnectionScope scope(this);
+
 	if(!CheckConnection("MySQLDataProvider::GetAssignmentFull( int run, const char* path, const char* variation, int version /*= -1*/ )")) return NULL;
 	return DataProvider::GetAssignmentFull(run, path, variation);
 }
@@ -1215,6 +1937,8 @@ Assignment* ccdb::MySQLDataProvider::GetAssignmentFull( int run, const string& p
 
 bool ccdb::MySQLDataProvider::GetAssignments( vector<Assignment *> &assingments,const string& path, int runMin, int runMax, const string& runRangeName, const string& variation, time_t beginTime, time_t endTime, int sortBy/*=0*/,  int take/*=0*/, int startWith/*=0*/ )
 {
+	ConnectionScope scope(this);
+
 	ClearErrors(); //Clear error in function that can produce new ones
 
 	if(!CheckConnection("MySQLDataProvider::GetAssignments( ... )")) return false;
@@ -1354,6 +2078,8 @@ vector<Assignment *> ccdb::MySQLDataProvider::GetAssignments( const string& path
 
 bool ccdb::MySQLDataProvider::FillAssignment(Assignment* assignment)
 {
+	ConnectionScope scope(this);
+
 	ClearErrors(); //Clear error in function that can produce new ones
 	if(assignment == NULL || !assignment->GetId())
 	{
@@ -1471,7 +2197,7 @@ void ccdb::MySQLDataProvider::FetchAssignment(Assignment* assignment, ConstantsT
 	assignment->SetModifiedTime(ReadUnixTime(2));	/*02  " UNIX_TIMESTAMP(`assignments`.`modified`) as `asModified`,	"*/
 	assignment->SetComment(ReadString(3));			/*03  " `assignments`.`comment) as `asComment`,	"					 */
 	assignment->SetDataVaultId(ReadIndex(4));		/*04  " `constantSets`.`id` AS `constId`, "							 */
-	assignment->SetRawData(ReadString(5));			/*05  " `constantSets`.`vault` AS `blob`, "							 */
+	assignment->SetRawData(DecompressVault(ReadBlob(5)));	/*05  " `constantSets`.`vault` AS `blob`, "							 */
 	
 	RunRange * runRange = new RunRange(assignment, this);	
 	runRange->SetId(ReadIndex(6));					/*06  " `runRanges`.`id`   AS `rrId`, "	*/
@@ -1625,6 +2351,15 @@ std::string ccdb::MySQLDataProvider::ReadString( int fieldNum )
 	return string(mRow[fieldNum]);
 }
 
+std::string ccdb::MySQLDataProvider::ReadBlob( int fieldNum )
+{
+	//vault may be binary (@see BinaryVault), so it is read with its length and not as C string
+	if(IsNullOrUnreadable(fieldNum)) return string("");
+	unsigned long *lengths = mysql_fetch_lengths(mResult);
+	if(!lengths) return string(mRow[fieldNum]);
+	return string(mRow[fieldNum], lengths[fieldNum]);
+}
+
 
 time_t ccdb::MySQLDataProvider::ReadUnixTime( int fieldNum )
 {	
@@ -1647,7 +2382,7 @@ bool ccdb::MySQLDataProvider::QuerySelect(const char* query)
 	}
 
 	//query
-	if(mysql_query(mMySQLHnd, query))
+	if(mysql_query(mConnection->Handle, query))
 	{
 		string errStr = ComposeMySQLError("mysql_query()"); errStr.append("\n Query: "); errStr.append(query);
 		Error(CCDB_ERROR_QUERY_SELECT,"ccdb::MySQLDataProvider::QuerySelect()",errStr.c_str());
@@ -1655,7 +2390,7 @@ bool ccdb::MySQLDataProvider::QuerySelect(const char* query)
 	}
 
 	//get results
-	mResult = mysql_store_result(mMySQLHnd);
+	mResult = mysql_store_result(mConnection->Handle);
 
 	if(!mResult)
 	{
@@ -1693,7 +2428,7 @@ bool ccdb::MySQLDataProvider::QueryCustom( const string& query )
 		FreeMySQLResult();
 	}
 	//query
-	if(mysql_query(mMySQLHnd, query.c_str()))
+	if(mysql_query(mConnection->Handle, query.c_str()))
 	{
 		string errStr = ComposeMySQLError("mysql_query()"); errStr.append("\n Query: "); errStr.append(query);
 		Error(CCDB_ERROR_MYSQL_CUSTOM_QUERY,"ccdb::MySQLDataProvider::QueryCustom( string query )",errStr.c_str());
@@ -1724,15 +2459,50 @@ void ccdb::MySQLDataProvider::FreeMySQLResult()
 
 std::string ccdb::MySQLDataProvider::ComposeMySQLError(std::string mySqlFunctionName)
 {
-	string mysqlErr=StringUtils::Format("%s failed:\nError %u (%s)\n",mySqlFunctionName.c_str(), mysql_errno(mMySQLHnd), mysql_error (mMySQLHnd));
+	if(!mConnection) return mySqlFunctionName + " failed:\nNo connection\n";
+	string mysqlErr=StringUtils::Format("%s failed:\nError %u (%s)\n",mySqlFunctionName.c_str(), mysql_errno(mConnection->Handle), mysql_error (mConnection->Handle));
 	return mysqlErr;
 }
+
+MySQLStatement* ccdb::MySQLDataProvider::PrepareStatement(const string& query, const char* functionName)
+{
+	if(!CheckConnection(functionName)) return NULL;
+
+	MySQLStatement *cached = mConnection->FindStatement(query);
+	if(cached) return cached;
+
+	//the first call with this query. The server parses it once for the connection
+	MySQLStatement *statement = new MySQLStatement();
+	if(!statement->Prepare(mConnection->Handle, query))
+	{
+		//the server may have no room for more statements (max_prepared_stmt_count) or may not prepare the query.
+		//Then it is sent as text, errors of the query itself are reported by ExecuteStatement
+		Log::Verbose("ccdb::MySQLDataProvider::PrepareStatement", statement->ComposeError("mysql_stmt_prepare()") + " The query is executed as text");
+		statement->PrepareText(mConnection->Handle, query);
+	}
+
+	mConnection->AddStatement(statement);
+	return statement;
+}
+
+
+bool ccdb::MySQLDataProvider::ExecuteStatement(MySQLStatement* statement, const char* functionName)
+{
+	if(statement->Execute()) return true;
+
+	Error(CCDB_ERROR_QUERY_SELECT, functionName, statement->ComposeError("mysql_stmt_execute()"));
+	statement->FreeResult();
+	return false;
+}
+
 #pragma endregion Fetch_free_and_other_MySQL_operations
 
 
 
 dbkey_t ccdb::MySQLDataProvider::GetUserId( string userName )
 {
+	ConnectionScope scope(this);
+
 	if(userName == "" || !ValidateName(userName))
 	{
 		return 1; //anonymous id
@@ -1769,6 +2539,44 @@ std::string ccdb::MySQLDataProvider::PrepareLimitInsertion(  int take/*=0*/, int
 }
 
 
+std::string ccdb::MySQLDataProvider::PrepareVariationChainInsertion( size_t chainSize )
+{
+	/** @brief Condition and ordering that select assignments of the nearest variation of a chain
+	 *
+	 * Gives "AND `assignments`.`variationId` IN (?,?,?) ORDER BY CASE `assignments`.`variationId` WHEN ? THEN 0 WHEN ? THEN 1 ... END, `assignments`.`id` DESC "
+	 * So the result is the same as if each variation was looked up in turn from the requested one to the "default"
+	 * The ids are bound by BindVariationChain
+	 *
+	 * @param [in] chainSize - number of variations in chain (@see GetCatalogVariationChain)
+	 * @return string to insert after WHERE conditions
+	 */
+	string inList;
+	string orderBy;
+	for(size_t i=0; i<chainSize; i++)
+	{
+		inList += (i==0 ? "?" : ",?");
+		orderBy += StringUtils::Format(" WHEN ? THEN %i", (int)i);
+	}
+
+	//one variation needs no ordering by depth
+	if(chainSize<=1) return "AND `assignments`.`variationId` IN (" + inList + ") ORDER BY `assignments`.`id` DESC ";
+
+	return "AND `assignments`.`variationId` IN (" + inList + ") "
+	       "ORDER BY CASE `assignments`.`variationId`" + orderBy + " END, `assignments`.`id` DESC ";
+}
+
+
+void ccdb::MySQLDataProvider::BindVariationChain( MySQLStatement* statement, const vector<Variation *>& chain, size_t firstParameter )
+{
+	//IN list, then CASE list if the chain is longer than one
+	for(size_t i=0; i<chain.size(); i++)
+	{
+		statement->BindInt(firstParameter + i, chain[i]->GetId());
+		if(chain.size()>1) statement->BindInt(firstParameter + chain.size() + i, chain[i]->GetId());
+	}
+}
+
+
 int ccdb::MySQLDataProvider::CountConstantsTypeTables(Directory *dir)
 {
 	/**
@@ -1776,6 +2584,8 @@ int ccdb::MySQLDataProvider::CountConstantsTypeTables(Directory *dir)
 	 * @param [in] directory to look tables in
 	 * @return number of tables to return
 	 */
+	ConnectionScope scope(this);
+
 	return 0;
 }
 
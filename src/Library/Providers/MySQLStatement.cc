@@ -0,0 +1,363 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "CCDB/Providers/MySQLStatement.h"
+#include "CCDB/Helpers/StringUtils.h"
+
+using namespace ccdb;
+
+//initial size of a string column buffer. It grows if a value is longer
+static const size_t cMySQLStatementStringBufferSize = 256;
+
+ccdb::MySQLStatement::MySQLStatement()
+{
+	mStatement = NULL;
+	mHasResult = false;
+	mConnection = NULL;
+	mIsText = false;
+	mTextResult = NULL;
+	mTextRow = NULL;
+	mTextLengths = NULL;
+	mTextFieldsCount = 0;
+}
+
+
+ccdb::MySQLStatement::~MySQLStatement()
+{
+	Close();
+}
+
+
+bool ccdb::MySQLStatement::Prepare( MYSQL *connection, const string& query )
+{
+	Close();
+
+	mQuery = query;
+	mConnection = connection;
+	mStatement = mysql_stmt_init(connection);
+	if(!mStatement) return false;
+
+	if(mysql_stmt_prepare(mStatement, query.c_str(), query.length())) return false;
+
+	mParameters.assign(mysql_stmt_param_count(mStatement), Parameter());
+	for(size_t i = 0; i < mParameters.size(); i++)
+	{
+		mParameters[i].IsInt = true;
+		mParameters[i].Int = 0;
+	}
+
+	//integer columns are read in binary form, others as strings
+	MYSQL_RES *metadata = mysql_stmt_result_metadata(mStatement);
+	if(metadata)
+	{
+		unsigned int fieldsCount = mysql_num_fields(metadata);
+		MYSQL_FIELD *fields = mysql_fetch_fields(metadata);
+		mColumns.assign(fieldsCount, Column());
+		for(unsigned int i = 0; i < fieldsCount; i++)
+		{
+			Column& column = mColumns[i];
+			switch(fields[i].type)
+			{
+			case MYSQL_TYPE_TINY:
+			case MYSQL_TYPE_SHORT:
+			case MYSQL_TYPE_LONG:
+			case MYSQL_TYPE_INT24:
+			case MYSQL_TYPE_LONGLONG:
+			case MYSQL_TYPE_YEAR:
+				column.IsInt = true;
+				break;
+			default:
+				column.IsInt = false;
+				column.Buffer.resize(cMySQLStatementStringBufferSize);
+			}
+			column.Int = 0;
+			column.Length = 0;
+			column.IsNull = 0;
+			column.Error = 0;
+		}
+		mysql_free_result(metadata);
+	}
+
+	return true;
+}
+
+
+void ccdb::MySQLStatement::PrepareText( MYSQL *connection, const string& query )
+{
+	Close();
+
+	mQuery = query;
+	mConnection = connection;
+	mIsText = true;
+
+	//parameters are '?' out of quotes
+	char quote = 0;
+	size_t parametersCount = 0;
+	for(size_t i = 0; i < query.length(); i++)
+	{
+		char symbol = query[i];
+		if(quote && symbol == quote) quote = 0;
+		else if(!quote && (symbol == '\'' || symbol == '"' || symbol == '`')) quote = symbol;
+		else if(!quote && symbol == '?') parametersCount++;
+	}
+
+	mParameters.assign(parametersCount, Parameter());
+	for(size_t i = 0; i < mParameters.size(); i++)
+	{
+		mParameters[i].IsInt = true;
+		mParameters[i].Int = 0;
+	}
+}
+
+
+void ccdb::MySQLStatement::Close()
+{
+	FreeResult();
+	if(mStatement) mysql_stmt_close(mStatement);
+	mStatement = NULL;
+	mIsText = false;
+	mParameters.clear();
+	mParameterBinds.clear();
+	mColumns.clear();
+	mResultBinds.clear();
+}
+
+
+void ccdb::MySQLStatement::BindInt( size_t index, long long value )
+{
+	if(index >= mParameters.size()) return;
+	mParameters[index].IsInt = true;
+	mParameters[index].Int = value;
+}
+
+
+void ccdb::MySQLStatement::BindString( size_t index, const string& value )
+{
+	if(index >= mParameters.size()) return;
+	mParameters[index].IsInt = false;
+	mParameters[index].String = value;
+}
+
+
+bool ccdb::MySQLStatement::Execute()
+{
+	if(mIsText) return ExecuteText();
+	if(!mStatement) return false;
+	FreeResult();
+
+	//binds point to mParameters, which don't move after Prepare
+	mParameterBinds.resize(mParameters.size());
+	for(size_t i = 0; i < mParameters.size(); i++)
+	{
+		Parameter& parameter = mParameters[i];
+		MYSQL_BIND& bind = mParameterBinds[i];
+		memset(&bind, 0, sizeof(MYSQL_BIND));
+		if(parameter.IsInt)
+		{
+			bind.buffer_type = MYSQL_TYPE_LONGLONG;
+			bind.buffer = &parameter.Int;
+		}
+		else
+		{
+			parameter.Length = parameter.String.length();
+			bind.buffer_type = MYSQL_TYPE_STRING;
+			bind.buffer = (void *)parameter.String.data();
+			bind.buffer_length = parameter.Length;
+			bind.length = &parameter.Length;
+		}
+	}
+
+	if(!mParameterBinds.empty() && mysql_stmt_bind_param(mStatement, &mParameterBinds[0])) return false;
+	if(mysql_stmt_execute(mStatement)) return false;
+	if(mColumns.empty()) return true;
+
+	if(!BindResult()) return false;
+	if(mysql_stmt_store_result(mStatement)) return false;
+	mHasResult = true;
+	return true;
+}
+
+
+std::string ccdb::MySQLStatement::ComposeTextQuery()
+{
+	string query;
+	query.reserve(mQuery.length() + 16 * mParameters.size());
+
+	char quote = 0;
+	size_t parameter = 0;
+	for(size_t i = 0; i < mQuery.length(); i++)
+	{
+		char symbol = mQuery[i];
+		if(quote && symbol == quote) quote = 0;
+		else if(!quote && (symbol == '\'' || symbol == '"' || symbol == '`')) quote = symbol;
+		else if(!quote && symbol == '?' && parameter < mParameters.size())
+		{
+			Parameter& value = mParameters[parameter++];
+			if(value.IsInt)
+			{
+				query += StringUtils::Format("%lld", value.Int);
+			}
+			else
+			{
+				vector<char> escaped(value.String.length() * 2 + 1);
+				unsigned long length = mysql_real_escape_string(mConnection, &escaped[0], value.String.data(), value.String.length());
+				query += '\'';
+				query.append(&escaped[0], length);
+				query += '\'';
+			}
+			continue;
+		}
+		query += symbol;
+	}
+	return query;
+}
+
+
+bool ccdb::MySQLStatement::ExecuteText()
+{
+	FreeResult();
+
+	string query = ComposeTextQuery();
+	if(mysql_real_query(mConnection, query.c_str(), query.length())) return false;
+
+	mTextResult = mysql_store_result(mConnection);
+	if(!mTextResult) return mysql_field_count(mConnection) == 0;	//no result is expected or error
+
+	mTextFieldsCount = mysql_num_fields(mTextResult);
+	mHasResult = true;
+	return true;
+}
+
+
+bool ccdb::MySQLStatement::BindResult()
+{
+	mResultBinds.resize(mColumns.size());
+	for(size_t i = 0; i < mColumns.size(); i++)
+	{
+		Column& column = mColumns[i];
+		MYSQL_BIND& bind = mResultBinds[i];
+		memset(&bind, 0, sizeof(MYSQL_BIND));
+		if(column.IsInt)
+		{
+			bind.buffer_type = MYSQL_TYPE_LONGLONG;
+			bind.buffer = &column.Int;
+		}
+		else
+		{
+			bind.buffer_type = MYSQL_TYPE_STRING;
+			bind.buffer = &column.Buffer[0];
+			bind.buffer_length = column.Buffer.size();
+		}
+		bind.length = &column.Length;
+		bind.is_null = &column.IsNull;
+		bind.error = &column.Error;
+	}
+	return !mysql_stmt_bind_result(mStatement, &mResultBinds[0]);
+}
+
+
+bool ccdb::MySQLStatement::Fetch()
+{
+	if(!mHasResult) return false;
+
+	if(mIsText)
+	{
+		mTextRow = mysql_fetch_row(mTextResult);
+		mTextLengths = mTextRow ? mysql_fetch_lengths(mTextResult) : NULL;
+		return mTextRow != NULL;
+	}
+
+	int result = mysql_stmt_fetch(mStatement);
+	if(result == MYSQL_DATA_TRUNCATED) return FetchLongColumns();
+	return result == 0;
+}
+
+
+bool ccdb::MySQLStatement::FetchLongColumns()
+{
+	/** @brief Reads columns of the fetched row that didn't fit to the buffers
+	 *
+	 * The buffers are enlarged to the value length and stay so,
+	 * then the next rows of such length are read by one fetch
+	 */
+	bool isResized = false;
+	for(size_t i = 0; i < mColumns.size(); i++)
+	{
+		Column& column = mColumns[i];
+		if(column.IsInt || column.IsNull || column.Length <= column.Buffer.size()) continue;
+
+		column.Buffer.resize(column.Length);
+		MYSQL_BIND& bind = mResultBinds[i];
+		bind.buffer = &column.Buffer[0];
+		bind.buffer_length = column.Buffer.size();
+		if(mysql_stmt_fetch_column(mStatement, &bind, (unsigned int)i, 0)) return false;
+		isResized = true;
+	}
+
+	//buffers have moved
+	return !isResized || !mysql_stmt_bind_result(mStatement, &mResultBinds[0]);
+}
+
+
+void ccdb::MySQLStatement::FreeResult()
+{
+	if(mStatement && mHasResult) mysql_stmt_free_result(mStatement);
+	mHasResult = false;
+
+	if(mTextResult) mysql_free_result(mTextResult);
+	mTextResult = NULL;
+	mTextRow = NULL;
+	mTextLengths = NULL;
+	mTextFieldsCount = 0;
+}
+
+
+bool ccdb::MySQLStatement::IsNull( size_t column ) const
+{
+	if(mIsText) return !mTextRow || column >= mTextFieldsCount || !mTextRow[column];
+	return column >= mColumns.size() || mColumns[column].IsNull;
+}
+
+
+long long ccdb::MySQLStatement::ReadInt( size_t column ) const
+{
+	if(IsNull(column)) return 0;
+	if(mIsText) return atoll(mTextRow[column]);
+	if(mColumns[column].IsInt) return mColumns[column].Int;
+	return atoll(ReadString(column).c_str());	//DECIMAL and other not integer types
+}
+
+
+std::string ccdb::MySQLStatement::ReadString( size_t column ) const
+{
+	if(IsNull(column)) return string();
+	if(mIsText) return string(mTextRow[column], mTextLengths[column]);
+
+	const Column& field = mColumns[column];
+	if(field.IsInt) return StringUtils::Format("%lld", field.Int);
+
+	size_t length = field.Length < field.Buffer.size() ? field.Length : field.Buffer.size();
+	return length ? string(&field.Buffer[0], length) : string();
+}
+
+
+size_t ccdb::MySQLStatement::GetRowsCount() const
+{
+	if(!mHasResult) return 0;
+	if(mIsText) return (size_t)mysql_num_rows(mTextResult);
+	return (size_t)mysql_stmt_num_rows(mStatement);
+}
+
+
+std::string ccdb::MySQLStatement::ComposeError( const string& mySqlFunctionName ) const
+{
+	if(mIsText)
+	{
+		return StringUtils::Format("%s failed:\nError %u (%s)\n Query: %s", mySqlFunctionName.c_str(),
+			mysql_errno(mConnection), mysql_error(mConnection), mQuery.c_str());
+	}
+	if(!mStatement) return mySqlFunctionName + " failed:\nmysql_stmt_init() returned NULL, probably memory allocation problem\n";
+
+	return StringUtils::Format("%s failed:\nError %u (%s)\n Query: %s", mySqlFunctionName.c_str(),
+		mysql_stmt_errno(mStatement), mysql_stmt_error(mStatement), mQuery.c_str());
+}
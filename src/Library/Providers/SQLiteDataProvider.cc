@@ -6,6 +6,8 @@
 #include <time.h>
 #include <string.h>
 #include <limits.h>
+#include <stdio.h>
+#include <algorithm>
 
 
 #include "CCDB/Globals.h"
@@ -15,10 +17,24 @@
 #include "CCDB/Providers/SQLiteDataProvider.h"
 #include "CCDB/Model/ConstantsTypeTable.h"
 #include "CCDB/Model/RunRange.h"
+#include "CCDB/Helpers/StopWatch.h"
+
+//sqlite3_deserialize is in SQLite since 3.23 if it is built with SQLITE_ENABLE_DESERIALIZE and since 3.36 by default
+#if (SQLITE_VERSION_NUMBER >= 3036000 || defined(SQLITE_ENABLE_DESERIALIZE)) && !defined(SQLITE_OMIT_DESERIALIZE)
+#define CCDB_SQLITE_DESERIALIZE
+#endif
 
 
 using namespace ccdb;
 
+//vault may be binary (@see BinaryVault), so it is read with its length and not as C string
+static string SQLiteDataProvider_ReadBlob(sqlite3_stmt *statement, int column)
+{
+	const char *blob = (const char*)sqlite3_column_blob(statement, column);
+	int size = sqlite3_column_bytes(statement, column);
+	return blob ? string(blob, size) : string();
+}
+
 #pragma region constructors
 
 ccdb::SQLiteDataProvider::SQLiteDataProvider(void)
@@ -26,6 +42,11 @@ ccdb::SQLiteDataProvider::SQLiteDataProvider(void)
 	mIsConnected = false;
 	mDatabase=NULL;
 	mStatement=NULL;
+	mPooledConnectionsCount = 0;
+	mOpenFlags = 0;
+	mInMemory = false;
+	mInMemoryMaxBytes = 0;
+	mInMemoryDatabase = NULL;
     mLastVariation = NULL;
 	mRootDir = new Directory(this, this);
 	mDirsAreLoaded = false;
@@ -67,24 +88,46 @@ bool ccdb::SQLiteDataProvider::Connect( std::string connectionString )
 		return false;
 	}
 
+	//options go after '?'
+	string options;
+	size_t optionsPos = connectionString.find('?');
+	if(optionsPos != string::npos)
+	{
+		options = connectionString.substr(optionsPos + 1);
+		connectionString.erase(optionsPos);
+	}
+
+	if(!ParseOpenOptions(connectionString, options))
+	{
+		mConnectionString = "";
+		return false;
+	}
+
+#ifdef CCDB_SQLITE_DESERIALIZE
+	if(mInMemory && !LoadInMemoryImage(connectionString, "bool SQLiteDataProvider::Connect(std::string connectionString)"))
+#else
+	if(mInMemory && !LoadInMemoryDatabase(connectionString, "bool SQLiteDataProvider::Connect(std::string connectionString)"))
+#endif
+	{
+		mConnectionString = "";
+		return false;
+	}
+
 	//verbose...
-	Log::Verbose("ccdb::SQLiteDataProvider::Connect", StringUtils::Format("Connecting to database:\n %s", connectionString.c_str()));
+	Log::Verbose("ccdb::SQLiteDataProvider::Connect", StringUtils::Format("Connecting to database:\n %s", mOpenName.c_str()));
 	
 	//Try to open sqlite database
-	int result = sqlite3_open_v2(connectionString.c_str(), &mDatabase, SQLITE_OPEN_READONLY|SQLITE_OPEN_FULLMUTEX|SQLITE_OPEN_SHAREDCACHE, NULL);
-    //int result = sqlite3_open(connectionString.c_str(), &mDatabase);
-
-	if (result != SQLITE_OK) 
+	if(!OpenDatabase(&mDatabase, SQLITE_OPEN_READONLY|SQLITE_OPEN_FULLMUTEX|SQLITE_OPEN_SHAREDCACHE, "bool SQLiteDataProvider::Connect(std::string connectionString)"))
 	{
-		string errStr = ComposeSQLiteError("Connect()");
-		Error(CCDB_ERROR_CONNECTION_EXTERNAL_ERROR,"bool SQLiteDataProvider::Connect(std::string connectionString)",errStr.c_str());
-		mDatabase=NULL;		//some compilers dont set NULL after delete
 		mConnectionString = "";
+		vector<unsigned char>().swap(mInMemoryImage);
+		sqlite3_close(mInMemoryDatabase);
+		mInMemoryDatabase = NULL;
 		return false;
 	}
 
-    sqlite3_exec(mDatabase, "PRAGMA journal_mode = OFF;", NULL, 0, 0);
-	
+	ReadSchemaVersion();
+
 	mIsConnected = true;
 	return true;
 }
@@ -99,10 +142,17 @@ void ccdb::SQLiteDataProvider::Disconnect()
 	if(IsConnected())
 	{
 //		FreeSQLiteResult();	//it would free the result or do nothing
-		
+		FinalizeCachedStatements();	//sqlite3_close fails if there are not finalized statements
+		ClosePooledConnections();
+		vector<unsigned char>().swap(mInMemoryImage);	//connections that read it are closed
+
 		sqlite3_close(mDatabase);
 		mDatabase = NULL;
+		sqlite3_close(mInMemoryDatabase);				//the last connection to the in memory copy frees it
+		mInMemoryDatabase = NULL;
 		mIsConnected = false;
+
+		ClearCaches();	//the next connection may be to another file or the file may be changed
 	}
 }
 
@@ -245,26 +295,20 @@ ConstantsTypeTable * ccdb::SQLiteDataProvider::GetConstantsTypeTable( const stri
 	// prepare the SQL statement from the command line
 	//sqlite3_finalize(mStatement);
 	//int result = sqlite3_prepare_v2(mDatabase,"SELECT `id`, strftime('%s', created , 'localtime') as `created`, strftime('%s', modified , 'localtime') as `modified`, `name`, `directoryId`, `nRows`, `nColumns`, `comments` FROM `typeTables` WHERE `name` = '?1' AND `directoryId` = ?2", -1, &mStatement, 0);
-	int result = sqlite3_prepare_v2(mDatabase,"SELECT `id`, strftime('%s', created , 'localtime') as `created`, strftime('%s', modified , 'localtime') as `modified`, `name`, `directoryId`, `nRows`, `nColumns`, `comment` FROM `typeTables`WHERE `name` = ?1 AND `directoryId` = ?2", -1, &mStatement, 0);
-	if( result )
-	{
-		ComposeSQLiteError("SQLiteDataProvider::GetConstantsTypeTable");
-		sqlite3_finalize(mStatement);
-		return NULL;
-	}
+	if(!PrepareCachedStatement("SELECT `id`, strftime('%s', created , 'localtime') as `created`, strftime('%s', modified , 'localtime') as `modified`, `name`, `directoryId`, `nRows`, `nColumns`, `comment` FROM `typeTables`WHERE `name` = ?1 AND `directoryId` = ?2", "SQLiteDataProvider::GetConstantsTypeTable")) return NULL;
 
-	result = sqlite3_bind_text(mStatement, 1, name.c_str(), -1, SQLITE_TRANSIENT); /*`name`*/
+	int result = sqlite3_bind_text(mStatement, 1, name.c_str(), -1, SQLITE_TRANSIENT); /*`name`*/
 	if( result )
 	{
 		ComposeSQLiteError("SQLiteDataProvider::GetConstantsTypeTable");
-		sqlite3_finalize(mStatement);
+		sqlite3_reset(mStatement);
 		return NULL;
 	}
-	sqlite3_bind_int(mStatement, 2, parentDir->GetId()); /*`directoryId`*/
+	result = sqlite3_bind_int(mStatement, 2, parentDir->GetId()); /*`directoryId`*/
 	if( result )
 	{
 		ComposeSQLiteError("SQLiteDataProvider::GetConstantsTypeTable");
-		sqlite3_finalize(mStatement);
+		sqlite3_reset(mStatement);
 		return NULL;
 	}
 
@@ -301,7 +345,7 @@ ConstantsTypeTable * ccdb::SQLiteDataProvider::GetConstantsTypeTable( const stri
 				//TODO error, name should be not null and not empty
 				Error(CCDB_ERROR_TYPETABLE_HAS_NO_NAME,"SQLiteDataProvider::GetConstantsTypeTable", "");
 				delete table;
-				sqlite3_finalize(mStatement);
+				sqlite3_reset(mStatement);
 				return NULL;
 			}
 				
@@ -323,8 +367,8 @@ ConstantsTypeTable * ccdb::SQLiteDataProvider::GetConstantsTypeTable( const stri
 	}
 	while(result==SQLITE_ROW );
 
-	// finalize the statement to release resources
-	sqlite3_finalize(mStatement);
+	// reset the statement to release resources, the statement is cached for next calls
+	sqlite3_reset(mStatement);
 
 	//load columns if needed
 	if(loadColumns && table) LoadColumns(table);
@@ -516,19 +560,13 @@ bool ccdb::SQLiteDataProvider::LoadColumns( ConstantsTypeTable* table )
 	}
 
 	// prepare the SQL statement from the command line
-	int result = sqlite3_prepare_v2(mDatabase, "SELECT `id`, strftime('%s', created , 'localtime') as `created`, strftime('%s', modified , 'localtime') as `modified`, `name`, `columnType`, `comment` FROM `columns` WHERE `typeId` = ?1 ORDER BY `order`;", -1, &mStatement, 0);
-	if( result != 0)
-	{
-		ComposeSQLiteError("ccdb::SQLiteDataProvider::LoadColumns");
-		sqlite3_finalize(mStatement);
-		return false;
-	}
+	if(!PrepareCachedStatement("SELECT `id`, strftime('%s', created , 'localtime') as `created`, strftime('%s', modified , 'localtime') as `modified`, `name`, `columnType`, `comment` FROM `columns` WHERE `typeId` = ?1 ORDER BY `order`;", "ccdb::SQLiteDataProvider::LoadColumns")) return false;
 
-	result = sqlite3_bind_int(mStatement, 1, table->GetId());	/*`directoryId`*/
+	int result = sqlite3_bind_int(mStatement, 1, table->GetId());	/*`directoryId`*/
 	if( result )
 	{
 		ComposeSQLiteError("ccdb::SQLiteDataProvider::LoadColumns");
-		sqlite3_finalize(mStatement);
+		sqlite3_reset(mStatement);
 		return false;
 	}
 
@@ -565,8 +603,8 @@ bool ccdb::SQLiteDataProvider::LoadColumns( ConstantsTypeTable* table )
 	}
 	while(result==SQLITE_ROW );
 
-	// finalize the statement to release resources
-	sqlite3_finalize(mStatement);
+	// reset the statement to release resources, the statement is cached for next calls
+	sqlite3_reset(mStatement);
 	return true;
 }
 
@@ -873,12 +911,10 @@ Variation* ccdb::SQLiteDataProvider::GetVariation( const string& name )
 
     string query = "SELECT `id`, `parentId`, `name` FROM `variations` WHERE `name`= ?1";
 
-	// prepare the SQL statement from the command line
-	int result = sqlite3_prepare_v2(mDatabase, query.c_str(), -1, &mStatement, 0);
-	if( result ) { ComposeSQLiteError(thisFunc); sqlite3_finalize(mStatement); return NULL; }
+	if(!PrepareCachedStatement(query, thisFunc)) return NULL;
 
-	result = sqlite3_bind_text(mStatement, 1, name.c_str(), -1, SQLITE_TRANSIENT);
-	if( result ) { ComposeSQLiteError(thisFunc); sqlite3_finalize(mStatement); return NULL; }
+	int result = sqlite3_bind_text(mStatement, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+	if( result ) { ComposeSQLiteError(thisFunc); sqlite3_reset(mStatement); return NULL; }
 
 	mQueryColumns = sqlite3_column_count(mStatement);
     //select variation
@@ -905,12 +941,10 @@ Variation* ccdb::SQLiteDataProvider::GetVariationById( dbkey_t id )
 
     string query = "SELECT `id`, `parentId`, `name` FROM `variations` WHERE `id`= ?1";
 
-	// prepare the SQL statement from the command line
-	int result = sqlite3_prepare_v2(mDatabase, query.c_str(), -1, &mStatement, 0);
-	if( result ) { ComposeSQLiteError(thisFunc); sqlite3_finalize(mStatement); return NULL; }
+	if(!PrepareCachedStatement(query, thisFunc)) return NULL;
 
-	result = sqlite3_bind_int(mStatement, 1, id);
-	if( result ) { ComposeSQLiteError(thisFunc); sqlite3_finalize(mStatement); return NULL; }
+	int result = sqlite3_bind_int(mStatement, 1, id);
+	if( result ) { ComposeSQLiteError(thisFunc); sqlite3_reset(mStatement); return NULL; }
 
     //select variation
     mLastVariation = SelectVariation();
@@ -944,15 +978,18 @@ Variation* ccdb::SQLiteDataProvider::SelectVariation()
 			break;
 		default:
 			ComposeSQLiteError(thisFunc);
-            sqlite3_finalize(mStatement); 
+            sqlite3_reset(mStatement); 
             return NULL;
 			break;
 		}
 	}
 	while(result==SQLITE_ROW );
 
-	// finalize the statement to release resources
-	sqlite3_finalize(mStatement);
+	// reset the statement to release resources, the statement is cached for next calls
+	sqlite3_reset(mStatement);
+
+    //nothing was selected
+    if(id == (dbkey_t)-1) return NULL;
 	
     Variation *var = new Variation(this, this);
     var->SetName(name);
@@ -996,124 +1033,469 @@ Assignment* ccdb::SQLiteDataProvider::GetAssignmentShort(int run, const string&
     /** @brief Get specified by creation time version of Assignment with data blob only.
      *
      * The Time is a timestamp, data that is equal or earlier in time than that timestamp is returned
+     * Type table and variation are taken from the metadata catalog, so only the assignment query
+     * goes to the database. The type table (with columns) is shared and is not owned by the assignment
      *
-     * @remarks this function is named so
+     * @remark the function is reentrant, the query runs on a pooled connection
      * @param [in] run - run number
      * @param [in] path - object path
      * @param [in] time - timestamp, data that is equal or earlier in time than that timestamp is returned
      * @param [in] variation - variation name
-     * @return new DAssignment object or 
+     * @param [in] loadColumns - ignored, catalog type tables always have columns
+     * @return new DAssignment object that is owned by caller or NULL
      */
 	char thisFunc[] = "ccdb::SQLiteDataProvider::GetAssignmentShort(int run, const string& path, time_t time, const string& variation, bool loadColumns /*=true*/)";
 	ClearErrors(); //Clear error in function that can produce new ones
 
 	if(!CheckConnection(thisFunc)) return NULL;
 	
-    //Get type table
-    ConstantsTypeTable *table = GetConstantsTypeTable(path, loadColumns);
+    //Get type table and variation with its parents.
+    //The catalog is read through the main connection, so it is locked as any other query of it
+    ConstantsTypeTable *table;
+    const vector<Variation *> *variations;
+    {
+        lock_guard<mutex> lock(mQueryMutex);
+        table = GetCatalogTypeTable(path);
+        variations = table ? GetCatalogVariationChain(variationName) : NULL;
+    }
+
     if(!table)
     {
         Error(CCDB_ERROR_NO_TYPETABLE, "SQLiteDataProvider::GetAssignmentShort", "Type table was not found: '"+path+"'" );
         return NULL;
     }
     
-    //get variation
-    Variation* variation = GetVariation(variationName);
-    if(!variation)
+    if(!variations)
     {
         Error(CCDB_ERROR_VARIATION_INVALID,"SQLiteDataProvider::GetAssignmentShort", "No variation '"+variationName+"' was found");
         return NULL;
     }
 
-	////ok now we must build our mighty query...
+    //the run is resolved by the index, only the blob is read
+    dbkey_t indexedId = 0;
+    if(FindInRunRangeIndex(table, *variations, run, time, indexedId))
+    {
+        Assignment *assignment = indexedId ? GetAssignmentShortById(indexedId, path, loadColumns) : NULL;
+        if(assignment) assignment->SetRequestedRun(run);
+        return assignment;
+    }
+
+	ConnectionLease connection(this, thisFunc);
+	if(!connection.Get()) return NULL;
+
+	sqlite3_stmt *statement = PrepareAssignmentQuery(connection.Get(), true, run, table, time, *variations, thisFunc);
+	if(!statement) return NULL;
+
+	// execute the statement
+	Assignment *assignment = NULL;
+	int result = sqlite3_step(statement);
+	if(result == SQLITE_ROW)
+	{
+		assignment = new Assignment(NULL, this);
+		assignment->SetId( sqlite3_column_int(statement, 0) );
+		assignment->SetRawData( DecompressVault(SQLiteDataProvider_ReadBlob(statement, 1)) );
+
+		//additional fill
+		assignment->SetRequestedRun(run);
+	}
+	else if(result != SQLITE_DONE)
+	{
+		Error(CCDB_ERROR_QUERY_SELECT, thisFunc, ComposeSQLiteError(thisFunc, connection.Get()->Database));
+		sqlite3_reset(statement); 
+		return NULL;
+	}
+
+    // reset the statement to release resources, the statement is cached for next calls
+    sqlite3_reset(statement);
+        
+	if(assignment == NULL) return NULL;
+
+    //the table belongs to the catalog
+    assignment->SetTypeTable(table);
+
+	return assignment;
+}
+
+
+dbkey_t ccdb::SQLiteDataProvider::GetAssignmentIdShort(int run, const string& path, time_t time, const string& variationName)
+{
+    /** @brief Resolves request to assignment id without reading data blob
+     *
+     * The same query as in GetAssignmentShort but without the blob
+     *
+     * @remark the function is reentrant, the query runs on a pooled connection
+     * @param [in] run - run number
+     * @param [in] path - object path
+     * @param [in] time - timestamp, data that is equal or earlier in time than that timestamp is returned. 0 - no time limit
+     * @param [in] variation - variation name
+     * @return assignment id or 0 if no assignment is found or error
+     */
+	char thisFunc[] = "ccdb::SQLiteDataProvider::GetAssignmentIdShort(int run, const string& path, time_t time, const string& variation)";
+	ClearErrors(); //Clear error in function that can produce new ones
+
+	if(!CheckConnection(thisFunc)) return 0;
+
+    //Get type table and variation with its parents. @see GetAssignmentShort
+    ConstantsTypeTable *table;
+    const vector<Variation *> *variations;
+    {
+        lock_guard<mutex> lock(mQueryMutex);
+        table = GetCatalogTypeTable(path);
+        variations = table ? GetCatalogVariationChain(variationName) : NULL;
+    }
+
+    if(!table)
+    {
+        Error(CCDB_ERROR_NO_TYPETABLE, "SQLiteDataProvider::GetAssignmentIdShort", "Type table was not found: '"+path+"'" );
+        return 0;
+    }
+
+    if(!variations)
+    {
+        Error(CCDB_ERROR_VARIATION_INVALID,"SQLiteDataProvider::GetAssignmentIdShort", "No variation '"+variationName+"' was found");
+        return 0;
+    }
+
+    dbkey_t indexedId = 0;
+    if(FindInRunRangeIndex(table, *variations, run, time, indexedId)) return indexedId;
+
+	ConnectionLease connection(this, thisFunc);
+	if(!connection.Get()) return 0;
+
+	sqlite3_stmt *statement = PrepareAssignmentQuery(connection.Get(), false, run, table, time, *variations, thisFunc);
+	if(!statement) return 0;
+
+	dbkey_t assignmentId = 0;
+	int result = sqlite3_step(statement);
+	if(result == SQLITE_ROW)
+	{
+		assignmentId = sqlite3_column_int(statement, 0);
+	}
+	else if(result != SQLITE_DONE)
+	{
+		Error(CCDB_ERROR_QUERY_SELECT, thisFunc, ComposeSQLiteError(thisFunc, connection.Get()->Database));
+		sqlite3_reset(statement);
+		return 0;
+	}
+    sqlite3_reset(statement);
+
+	return assignmentId;
+}
+
+
+Assignment* ccdb::SQLiteDataProvider::GetAssignmentShortById(dbkey_t id, const string& path, bool loadColumns /*=false*/)
+{
+    /** @brief Get Assignment with data blob only by assignment id
+     *
+     * @remark the function is reentrant, the query runs on a pooled connection
+     * @param [in] id - assignment id
+     * @param [in] path - object path
+     * @param [in] loadColumns - ignored, catalog type tables always have columns
+     * @return DAssignment object that is owned by caller or NULL if no assignment is found or error
+     */
+	char thisFunc[] = "ccdb::SQLiteDataProvider::GetAssignmentShortById(dbkey_t id, const string& path, bool loadColumns)";
+	ClearErrors(); //Clear error in function that can produce new ones
+
+	if(!CheckConnection(thisFunc)) return NULL;
+
+    //Get type table. @see GetAssignmentShort
+    ConstantsTypeTable *table;
+    {
+        lock_guard<mutex> lock(mQueryMutex);
+        table = GetCatalogTypeTable(path);
+    }
+
+    if(!table)
+    {
+        Error(CCDB_ERROR_NO_TYPETABLE, "SQLiteDataProvider::GetAssignmentShortById", "Type table was not found: '"+path+"'" );
+        return NULL;
+    }
+
 	string query(
         "SELECT `assignments`.`id` AS `asId`, "
         "`constantSets`.`vault` AS `blob` "
         "FROM  `assignments` "
-        "INNER JOIN `runRanges` ON `assignments`.`runRangeId`= `runRanges`.`id` "
         "INNER JOIN `constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id` "
-        "INNER JOIN `typeTables` ON `constantSets`.`constantTypeId` = `typeTables`.`id` "
-        "WHERE  `runRanges`.`runMin` <= ?1 "
-        "AND `runRanges`.`runMax` >= ?1 "
-        "AND `assignments`.`variationId`= ?2 "
-        "AND  `constantSets`.`constantTypeId` =?3 " + 
-        ((time>0)? string("AND  `assignments`.`created` <= datetime(?4, 'unixepoch', 'localtime') ") : string()) +
-        "ORDER BY `assignments`.`id` DESC "
-        "LIMIT 1 ");
-	
-//	cout<<query<<endl;
+        "WHERE  `assignments`.`id` = ?1 ");
 
-	// prepare the SQL statement from the command line
-	int result = sqlite3_prepare_v2(mDatabase, query.c_str(), -1, &mStatement, 0);
-	if( result ) { ComposeSQLiteError(thisFunc); sqlite3_finalize(mStatement); return NULL; }
+	ConnectionLease connection(this, thisFunc);
+	if(!connection.Get()) return NULL;
 
-	result = sqlite3_bind_int(mStatement, 1, run);	/*`directoryId`*/
-	if( result ) { ComposeSQLiteError(thisFunc); sqlite3_finalize(mStatement); return NULL; }
-	
-	result = sqlite3_bind_int(mStatement, 2, variation->GetId());	/*`variationId`*/
-	if( result ) { ComposeSQLiteError(thisFunc); sqlite3_finalize(mStatement); return NULL; }
-			
-	result = sqlite3_bind_int(mStatement, 3, table->GetId());	/*``typeTables`.`directoryId``*/
-	if( result ) { ComposeSQLiteError(thisFunc); sqlite3_finalize(mStatement); return NULL; }
-    
-    if(time>0)
+	sqlite3_stmt *statement = PreparePooledStatement(connection.Get(), query, thisFunc);
+	if(!statement) return NULL;
+
+	int result = sqlite3_bind_int(statement, 1, id);
+	if( result ) { Error(CCDB_ERROR_QUERY_SELECT, thisFunc, ComposeSQLiteError(thisFunc, connection.Get()->Database)); sqlite3_reset(statement); return NULL; }
+
+	Assignment *assignment = NULL;
+	result = sqlite3_step(statement);
+	if(result == SQLITE_ROW)
+	{
+		assignment = new Assignment(NULL, this);
+		assignment->SetId( sqlite3_column_int(statement, 0) );
+		assignment->SetRawData( DecompressVault(SQLiteDataProvider_ReadBlob(statement, 1)) );
+	}
+	else if(result != SQLITE_DONE)
+	{
+		Error(CCDB_ERROR_QUERY_SELECT, thisFunc, ComposeSQLiteError(thisFunc, connection.Get()->Database));
+		sqlite3_reset(statement);
+		return NULL;
+	}
+    sqlite3_reset(statement);
+
+	if(assignment == NULL)
+	{
+		Error(CCDB_ERROR_NO_ASSIGMENT, "SQLiteDataProvider::GetAssignmentShortById", "No assignment with id '"+StringUtils::IntToString(id)+"'");
+		return NULL;
+	}
+
+    //the table belongs to the catalog
+    assignment->SetTypeTable(table);
+
+	return assignment;
+}
+
+
+bool ccdb::SQLiteDataProvider::GetAssignmentsShortBatch(vector<Assignment *>& assignments, int run, const vector<string>& paths, time_t time, const string& variationName)
+{
+    /** @brief Get Assignments with data blob only for many type tables of the same run, variation and time
+     *
+     * Each type table is resolved by the same subquery as in GetAssignmentShort, all of them by one statement:
+     * SELECT ... FROM (SELECT id, (<assignment query of the type table>) FROM typeTables WHERE id IN (...))
+     * Window functions would do the same, but SQLite has them only since 3.25
+     * If run range index is on, the assignments are read one by one by indexed ids
+     *
+     * @remark the function is reentrant, the query runs on a pooled connection
+     * @see DataProvider::GetAssignmentsShortBatch
+     */
+	char thisFunc[] = "ccdb::SQLiteDataProvider::GetAssignmentsShortBatch";
+	ClearErrors(); //Clear error in function that can produce new ones
+
+	assignments.assign(paths.size(), NULL);
+	if(!CheckConnection(thisFunc)) return false;
+
+	if(IsRunRangeIndexEnabled()) return DataProvider::GetAssignmentsShortBatch(assignments, run, paths, time, variationName);
+
+    //Get type tables and variation with its parents. @see GetAssignmentShort
+    vector<ConstantsTypeTable *> tables(paths.size(), NULL);
+    const vector<Variation *> *variations;
     {
-        result = sqlite3_bind_int64(mStatement, 4, time);	/*` `assignments`.`created``*/
-        if( result ) { ComposeSQLiteError(thisFunc); sqlite3_finalize(mStatement); return NULL; }
+        lock_guard<mutex> lock(mQueryMutex);
+        variations = GetCatalogVariationChain(variationName);
+        for(size_t i=0; variations && i<paths.size(); i++) tables[i] = GetCatalogTypeTable(paths[i]);
     }
-	//cout<<endl<<"time "<<time<<endl;
-	mQueryColumns = sqlite3_column_count(mStatement);
-    int selectedRows = 0;
-	// execute the statement
-	Assignment *assignment = NULL;
-	do
+
+    if(!variations)
+    {
+        Error(CCDB_ERROR_VARIATION_INVALID,"SQLiteDataProvider::GetAssignmentsShortBatch", "No variation '"+variationName+"' was found");
+        return false;
+    }
+
+    //type table id => indexes of paths. The same table may be requested several times
+    vector<dbkey_t> typeIds;
+    multimap<dbkey_t, size_t> pathIndexes;
+    for(size_t i=0; i<paths.size(); i++)
+    {
+        if(!tables[i])
+        {
+            Error(CCDB_ERROR_NO_TYPETABLE, "SQLiteDataProvider::GetAssignmentsShortBatch", "Type table was not found: '"+paths[i]+"'" );
+            continue;
+        }
+        if(!pathIndexes.count(tables[i]->GetId())) typeIds.push_back(tables[i]->GetId());
+        pathIndexes.insert(make_pair(tables[i]->GetId(), i));
+    }
+
+	ConnectionLease connection(this, thisFunc);
+	if(!connection.Get()) return false;
+
+	bool isOk = true;
+	for(size_t first=0; isOk && first<typeIds.size(); first+=cMaxBatchQuerySize)
 	{
-		result = sqlite3_step(mStatement);
-		
-		switch( result )
+		size_t count = min(cMaxBatchQuerySize, typeIds.size() - first);
+		size_t querySize = GetBatchQuerySize(count);
+		int firstTypeParameter = 4 + (int)variations->size();
+
+		string inList;
+		for(size_t i=0; i<querySize; i++) inList += StringUtils::Format(i ? ", ?%i" : "?%i", firstTypeParameter + (int)i);
+
+		string query(
+			"SELECT `assignments`.`id` AS `asId`, `found`.`typeId`, `constantSets`.`vault` AS `blob` "
+			"FROM (SELECT `typeTables`.`id` AS `typeId`, (" + ComposeAssignmentQuery(false, "`typeTables`.`id`", time, variations->size()) + ") AS `asId` "
+			"      FROM `typeTables` WHERE `typeTables`.`id` IN (" + inList + ")) AS `found` "
+			"INNER JOIN `assignments` ON `assignments`.`id` = `found`.`asId` "
+			"INNER JOIN `constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id` ");
+
+		sqlite3_stmt *statement = PreparePooledStatement(connection.Get(), query, thisFunc);
+		if(!statement)
 		{
-		case SQLITE_DONE:
+			isOk = false;
 			break;
-		case SQLITE_ROW:
-			assignment = new Assignment(this, this);
-			assignment->SetId( ReadIndex(0) );			
-			assignment->SetRawData( ReadString(1) );
+		}
 
-			//additional fill
-			assignment->SetRequestedRun(run);
-            selectedRows++;
-			break;
-		default:
-			ComposeSQLiteError(thisFunc); 
-            sqlite3_finalize(mStatement); 
-            return NULL;
-			break;
+		int result = sqlite3_bind_int(statement, 1, run);                      /*`runMin`, `runMax`*/
+		if(!result && time>0) result = sqlite3_bind_int64(statement, 3, time); /*`assignments`.`created`*/
+		for(size_t i=0; !result && i<variations->size(); i++)
+		{
+			result = sqlite3_bind_int(statement, 4 + i, (*variations)[i]->GetId()); /*`variationId`*/
+		}
+		for(size_t i=0; !result && i<querySize; i++)
+		{
+			result = sqlite3_bind_int(statement, firstTypeParameter + i, typeIds[first + min(i, count - 1)]); /*`typeTables`.`id`*/
 		}
-	} while(result==SQLITE_ROW );
 
-    // finalize the statement to release resources
-    sqlite3_finalize(mStatement);
-        
-    //If We have not found data for this variation, getting data for parent variation
-    if((assignment == NULL && selectedRows==0) && variation->GetParentDbId()!=0)
-    {
-        return GetAssignmentShort(run, path, time, variation->GetParent()->GetName(), loadColumns);
-    }
-    
-	if(assignment == NULL) 
+		while(!result && (result = sqlite3_step(statement)) == SQLITE_ROW)
+		{
+			result = 0;
+			dbkey_t typeId = sqlite3_column_int(statement, 1);
+			string blob = DecompressVault(SQLiteDataProvider_ReadBlob(statement, 2));
+
+			pair<multimap<dbkey_t, size_t>::iterator, multimap<dbkey_t, size_t>::iterator> range = pathIndexes.equal_range(typeId);
+			for(multimap<dbkey_t, size_t>::iterator it = range.first; it != range.second; ++it)
+			{
+				Assignment *assignment = new Assignment(NULL, this);
+				assignment->SetId( sqlite3_column_int(statement, 0) );
+				assignment->SetRawData(blob);
+				assignment->SetRequestedRun(run);
+				assignment->SetTypeTable(tables[it->second]);   //the table belongs to the catalog
+				assignments[it->second] = assignment;
+			}
+		}
+		sqlite3_reset(statement);
+
+		if(result != SQLITE_DONE)
+		{
+			Error(CCDB_ERROR_QUERY_SELECT, thisFunc, ComposeSQLiteError(thisFunc, connection.Get()->Database));
+			isOk = false;
+		}
+	}
+
+	if(!isOk)
+	{
+		for(size_t i=0; i<assignments.size(); i++) delete assignments[i];
+		assignments.assign(paths.size(), NULL);
+		return false;
+	}
+	return true;
+}
+
+
+std::string ccdb::SQLiteDataProvider::ComposeAssignmentQuery(bool withBlob, const string& typeId, time_t time, size_t chainSize)
+{
+	/** @brief Query that selects assignment of run, type table, time and variation chain
+	 *
+	 * The whole variation chain is looked up at once. The assignment of the nearest variation wins.
+	 * If assignments keep constantTypeId (@see HasAssignmentTypeIds) the candidates are taken from
+	 * (constantTypeId, variationId, runRangeId, id) index, and constantSets is joined only for the blob.
+	 * Parameters: ?1 - run, ?3 - time (if time>0), ?4... - variation chain
+	 *
+	 * @param [in] typeId - SQL expression of type table id: parameter or column of outer query
+	 * @return query that selects `asId` and (withBlob) `blob` columns
+	 */
+	string query(
+        string("SELECT `assignments`.`id` AS `asId`") + (withBlob ? ", `constantSets`.`vault` AS `blob` " : " ") +
+        "FROM  `assignments` "
+        "INNER JOIN `runRanges` ON `assignments`.`runRangeId`= `runRanges`.`id` ");
+	if(HasAssignmentTypeIds())
+	{
+		if(withBlob) query += "INNER JOIN `constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id` ";
+		query += "WHERE  `assignments`.`constantTypeId` = " + typeId + " ";
+	}
+	else
+	{
+		query += "INNER JOIN `constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id` "
+		         "WHERE  `constantSets`.`constantTypeId` = " + typeId + " ";
+	}
+	query +=
+        string("AND `runRanges`.`runMin` <= ?1 "
+        "AND `runRanges`.`runMax` >= ?1 ") +
+        ((time>0)? string("AND  `assignments`.`created` <= datetime(?3, 'unixepoch', 'localtime') ") : string()) +
+        PrepareVariationChainInsertion(chainSize, 4) +
+        "LIMIT 1 ";
+	return query;
+}
+
+
+sqlite3_stmt* ccdb::SQLiteDataProvider::PrepareAssignmentQuery(PooledConnection *connection, bool withBlob, int run, ConstantsTypeTable *table, time_t time, const vector<Variation *>& variations, const char *functionName)
+{
+	/** @brief Prepares and binds the query that resolves assignment of run, type table, time and variation chain */
+	string query = ComposeAssignmentQuery(withBlob, "?2", time, variations.size());
+
+	sqlite3_stmt *statement = PreparePooledStatement(connection, query, functionName);
+	if(!statement) return NULL;
+
+	int result = sqlite3_bind_int(statement, 1, run);                    /*`runMin`, `runMax`*/
+	if(!result) result = sqlite3_bind_int(statement, 2, table->GetId()); /*`constantTypeId`*/
+	if(!result && time>0) result = sqlite3_bind_int64(statement, 3, time); /*`assignments`.`created`*/
+	for(size_t i=0; !result && i<variations.size(); i++)
 	{
-		delete table;
+		result = sqlite3_bind_int(statement, 4 + i, variations[i]->GetId()); /*`variationId`*/
+	}
+
+	if( result )
+	{
+		Error(CCDB_ERROR_QUERY_SELECT, functionName, ComposeSQLiteError(functionName, connection->Database));
+		sqlite3_reset(statement);
 		return NULL;
 	}
+	return statement;
+}
 
 
+bool ccdb::SQLiteDataProvider::LoadRunRangeIndex(ConstantsTypeTable *table, vector<RunRangeIndexEntry>& entries)
+{
+	/** @brief Reads run ranges, ids, variations and creation times of all assignments of the type table */
+	const char *thisFunc = "ccdb::SQLiteDataProvider::LoadRunRangeIndex";
 
-    assignment->SetTypeTable(table);
-    assignment->BeOwner(table);
-    table->SetOwner(assignment);
+	ConnectionLease connection(this, thisFunc);
+	if(!connection.Get()) return false;
 
+	sqlite3_stmt *statement = PreparePooledStatement(connection.Get(), string(
+        "SELECT `runRanges`.`runMin`, `runRanges`.`runMax`, `assignments`.`id`, `assignments`.`variationId`, "
+        "CAST(strftime('%Y%m%d%H%M%S', `assignments`.`created`) AS INTEGER) "
+        "FROM  `assignments` "
+        "INNER JOIN `runRanges` ON `assignments`.`runRangeId`= `runRanges`.`id` ") +
+        (HasAssignmentTypeIds() ?
+            "WHERE  `assignments`.`constantTypeId` = ?1" :
+            "INNER JOIN `constantSets` ON `assignments`.`constantSetId` = `constantSets`.`id` "
+            "WHERE  `constantSets`.`constantTypeId` = ?1"), thisFunc);
+	if(!statement) return false;
+
+	int result = sqlite3_bind_int(statement, 1, table->GetId());
+	while(result == SQLITE_OK || result == SQLITE_ROW)
+	{
+		result = sqlite3_step(statement);
+		if(result != SQLITE_ROW) break;
+
+		RunRangeIndexEntry entry;
+		entry.RunMin = sqlite3_column_int(statement, 0);
+		entry.RunMax = sqlite3_column_int(statement, 1);
+		entry.AssignmentId = sqlite3_column_int(statement, 2);
+		entry.VariationId = sqlite3_column_int(statement, 3);
+		entry.Created = sqlite3_column_int64(statement, 4);
+		entries.push_back(entry);
+	}
 
-	return assignment;
+	if(result != SQLITE_DONE)
+	{
+		Error(CCDB_ERROR_QUERY_SELECT, thisFunc, ComposeSQLiteError(thisFunc, connection.Get()->Database));
+		sqlite3_reset(statement);
+		return false;
+	}
+	sqlite3_reset(statement);
+	return true;
+}
+
+
+long long ccdb::SQLiteDataProvider::GetRunRangeIndexTimeKey(time_t time)
+{
+	struct tm local;
+#ifdef WIN32
+	localtime_s(&local, &time);
+#else
+	localtime_r(&time, &local);
+#endif
+	return (local.tm_year + 1900) * 10000000000LL + (local.tm_mon + 1) * 100000000LL + local.tm_mday * 1000000LL +
+		local.tm_hour * 10000LL + local.tm_min * 100LL + local.tm_sec;
 }
 
 
@@ -1401,7 +1783,7 @@ void ccdb::SQLiteDataProvider::FetchAssignment(Assignment* assignment, Constants
 	assignment->SetModifiedTime(ReadUnixTime(2));	/*02  " UNIX_TIMESTAMP(`assignments`.`modified`) as `asModified`,	"*/
 	assignment->SetComment(ReadString(3));			/*03  " `assignments`.`comment) as `asComment`,	"					 */
 	assignment->SetDataVaultId(ReadIndex(4));		/*04  " `constantSets`.`id` AS `constId`, "							 */
-	assignment->SetRawData(ReadString(5));			/*05  " `constantSets`.`vault` AS `blob`, "							 */
+	assignment->SetRawData(DecompressVault(ReadBlob(5)));	/*05  " `constantSets`.`vault` AS `blob`, "							 */
 	
 	RunRange * runRange = new RunRange(assignment, this);	
 	runRange->SetId(ReadIndex(6));					/*06  " `runRanges`.`id`   AS `rrId`, "	*/
@@ -1540,6 +1922,12 @@ double ccdb::SQLiteDataProvider::ReadDouble( int fieldNum )
 	return atof((const char*)sqlite3_column_text(mStatement,fieldNum)); //ugly isn't it?
 }
 
+std::string ccdb::SQLiteDataProvider::ReadBlob( int fieldNum )
+{
+	if(IsNullOrUnreadable(fieldNum)) return string("");
+	return SQLiteDataProvider_ReadBlob(mStatement, fieldNum);
+}
+
 std::string ccdb::SQLiteDataProvider::ReadString( int fieldNum )
 {
 	if(IsNullOrUnreadable(fieldNum)) return string("");
@@ -1559,6 +1947,455 @@ time_t ccdb::SQLiteDataProvider::ReadUnixTime( int fieldNum )
 
 #pragma region Queries
 
+bool ccdb::SQLiteDataProvider::PrepareCachedStatement(const string& query, const char *functionName)
+{
+	/** @brief Sets mStatement to the cached prepared statement of the query
+	 *
+	 * The statement is prepared once per connection (as persistent if SQLite supports it)
+	 * and then is reused through sqlite3_reset and sqlite3_clear_bindings.
+	 * Call sqlite3_reset (not sqlite3_finalize) when the statement is done
+	 *
+	 * @param query         SQL query. It is the key of the cache
+	 * @param functionName  caller name for error reporting
+	 * @return true if mStatement is ready to bind and step
+	 */
+	map<string, sqlite3_stmt*>::iterator found = mCachedStatements.find(query);
+	if(found != mCachedStatements.end())
+	{
+		mStatement = found->second;
+		sqlite3_reset(mStatement);
+		sqlite3_clear_bindings(mStatement);
+		return true;
+	}
+
+#if SQLITE_VERSION_NUMBER >= 3020000
+	int result = sqlite3_prepare_v3(mDatabase, query.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &mStatement, 0);
+#else
+	int result = sqlite3_prepare_v2(mDatabase, query.c_str(), -1, &mStatement, 0);
+#endif
+	if( result )
+	{
+		Error(CCDB_ERROR_QUERY_PREPARE, functionName, ComposeSQLiteError(functionName));
+		sqlite3_finalize(mStatement);
+		mStatement = NULL;
+		return false;
+	}
+
+	mCachedStatements[query] = mStatement;
+	return true;
+}
+
+
+void ccdb::SQLiteDataProvider::FinalizeCachedStatements()
+{
+	///Finalizes all cached statements. Must be done before the database is closed
+
+	for(map<string, sqlite3_stmt*>::iterator it = mCachedStatements.begin(); it != mCachedStatements.end(); ++it)
+	{
+		sqlite3_finalize(it->second);
+	}
+	mCachedStatements.clear();
+	mStatement = NULL;
+}
+
+
+bool ccdb::SQLiteDataProvider::ParseOpenOptions(const string& path, const string& options)
+{
+	/** @brief Parses options of the connection string and sets mOpenName, mOpenFlags and mOpenPragmas
+	 *
+	 * @see Connect for the list of options
+	 */
+	string uriParameters = "mode=ro";
+	mOpenPragmas = "";
+	mOpenFlags = 0;
+	mInMemory = false;
+	mInMemoryMaxBytes = 0;
+
+	vector<string> tokens = StringUtils::Split(options, "&");
+	for(size_t i = 0; i < tokens.size(); i++)
+	{
+		if(tokens[i].empty()) continue;
+
+		size_t equalPos = tokens[i].find('=');
+		string name = tokens[i].substr(0, equalPos);
+		string value = equalPos == string::npos ? string() : tokens[i].substr(equalPos + 1);
+
+		char *end = NULL;
+		long long number = strtoll(value.c_str(), &end, 10);
+		bool isNumber = !value.empty() && *end == '\0';
+
+		if((name == "immutable" || name == "nolock") && (value == "0" || value == "1"))
+		{
+			if(value == "1") uriParameters += "&" + name + "=1";
+		}
+		else if(name == "mmap_size" && isNumber && number >= 0)
+		{
+			mOpenPragmas += "PRAGMA mmap_size = " + value + ";";
+		}
+		else if(name == "cache_size" && isNumber)
+		{
+			mOpenPragmas += "PRAGMA cache_size = " + value + ";";
+		}
+		else if(name == "inmemory" && (value == "0" || value == "1"))
+		{
+			mInMemory = (value == "1");
+		}
+		else if(name == "inmemory_max_bytes" && isNumber && number >= 0)
+		{
+			mInMemoryMaxBytes = (size_t)number;
+		}
+		else
+		{
+			Error(CCDB_ERROR_PARSE_CONNECTION_STRING, "SQLiteDataProvider::Connect()", "Unknown or invalid option '" + tokens[i] + "' in SQLite connection string. Known options are immutable=0|1, nolock=0|1, mmap_size=<bytes>, cache_size=<N>, inmemory=0|1, inmemory_max_bytes=<bytes>");
+			return false;
+		}
+	}
+
+	if(mInMemory)
+	{
+#ifdef CCDB_SQLITE_DESERIALIZE
+		//each connection is an empty in memory database that gets the image. The file options don't matter
+		mOpenName = ":memory:";
+#else
+		//all connections open the same shared cache in memory database, LoadInMemoryDatabase fills it
+		mOpenName = StringUtils::Format("file:ccdb_inmemory_%p?mode=memory&cache=shared", (void*)this);
+		mOpenFlags = SQLITE_OPEN_URI;
+#endif
+		return true;
+	}
+
+	if(uriParameters == "mode=ro")
+	{
+		mOpenName = path;   //the file name is given as it is without URI options
+		return true;
+	}
+
+	//The file name is a path part of URI
+	string uriPath;
+	for(size_t i = 0; i < path.size(); i++)
+	{
+		char c = path[i];
+		if(c == '%')       uriPath += "%25";
+		else if(c == '?')  uriPath += "%3f";
+		else if(c == '#')  uriPath += "%23";
+#ifdef WIN32
+		else if(c == '\\') uriPath += '/';
+#endif
+		else uriPath += c;
+	}
+
+	mOpenName = "file:" + uriPath + "?" + uriParameters;
+	mOpenFlags = SQLITE_OPEN_URI;
+	return true;
+}
+
+
+bool ccdb::SQLiteDataProvider::OpenDatabase(sqlite3 **database, int flags, const char *functionName)
+{
+	/** @brief Opens the database with the options of the connection string
+	 *
+	 * Is used for the main connection and for connections of the pool, so all of them have the same options
+	 */
+	int result = sqlite3_open_v2(mOpenName.c_str(), database, flags | mOpenFlags, NULL);
+	if (result != SQLITE_OK)
+	{
+		Error(CCDB_ERROR_CONNECTION_EXTERNAL_ERROR, functionName, ComposeSQLiteError("sqlite3_open_v2", *database));
+		sqlite3_close(*database);
+		*database = NULL;		//some compilers dont set NULL after delete
+		return false;
+	}
+
+#ifdef CCDB_SQLITE_DESERIALIZE
+	if(mInMemory)
+	{
+		//The image is not copied. It is read only, so all connections read the same memory
+		sqlite3_int64 size = (sqlite3_int64)mInMemoryImage.size();
+		result = sqlite3_deserialize(*database, "main", &mInMemoryImage[0], size, size, SQLITE_DESERIALIZE_READONLY);
+
+		//deserialize doesn't check the data, the first query does
+		if(result == SQLITE_OK) result = sqlite3_exec(*database, "SELECT count(*) FROM sqlite_master;", NULL, 0, 0);
+		if(result != SQLITE_OK)
+		{
+			Error(CCDB_ERROR_CONNECTION_EXTERNAL_ERROR, functionName, ComposeSQLiteError("sqlite3_deserialize", *database));
+			sqlite3_close(*database);
+			*database = NULL;
+			return false;
+		}
+	}
+#endif
+
+	sqlite3_exec(*database, "PRAGMA journal_mode = OFF;", NULL, 0, 0);
+
+	if(!mOpenPragmas.empty() && sqlite3_exec(*database, mOpenPragmas.c_str(), NULL, 0, 0) != SQLITE_OK)
+	{
+		Error(CCDB_ERROR_CONNECTION_EXTERNAL_ERROR, functionName, ComposeSQLiteError(mOpenPragmas, *database));
+		sqlite3_close(*database);
+		*database = NULL;
+		return false;
+	}
+	return true;
+}
+
+
+void ccdb::SQLiteDataProvider::ReadSchemaVersion()
+{
+	/** @brief Reads schemaVersions of the main connection to mSchemaVersion
+	 *
+	 * A database without the table is read as an old one (version 0), it is not an error
+	 */
+	mSchemaVersion = 0;
+
+	sqlite3_stmt *statement = NULL;
+	if(sqlite3_prepare_v2(mDatabase, "SELECT `schemaVersion` FROM `schemaVersions` WHERE `id` = 1", -1, &statement, 0) != SQLITE_OK)
+	{
+		Log::Verbose("ccdb::SQLiteDataProvider::ReadSchemaVersion", "No schemaVersions table. The database is read as an old one");
+		sqlite3_finalize(statement);
+		return;
+	}
+
+	if(sqlite3_step(statement) == SQLITE_ROW) mSchemaVersion = sqlite3_column_int(statement, 0);
+	sqlite3_finalize(statement);
+}
+
+
+bool ccdb::SQLiteDataProvider::LoadInMemoryImage(const string& path, const char *functionName)
+{
+	/** @brief Reads the whole database file to mInMemoryImage
+	 *
+	 * The file is read sequentially by big chunks, that is much faster on network file systems
+	 * than random page reads of queries. Load time and size are logged
+	 */
+	const size_t chunkSize = 16*1024*1024;
+	StopWatch stopwatch;
+
+	FILE *file = fopen(path.c_str(), "rb");
+	if(!file)
+	{
+		Error(CCDB_ERROR_CONNECTION_EXTERNAL_ERROR, functionName, "Can't open file '" + path + "' to read it to memory");
+		return false;
+	}
+
+	//the size is used to check the limit early and to allocate memory once
+	long fileSize = (fseek(file, 0, SEEK_END) == 0) ? ftell(file) : -1;
+	rewind(file);
+	if(mInMemoryMaxBytes && fileSize > 0 && (size_t)fileSize > mInMemoryMaxBytes)
+	{
+		fclose(file);
+		Error(CCDB_ERROR_CONNECTION_INITIALIZATION, functionName, StringUtils::Format("File '%s' of %ld bytes is bigger than inmemory_max_bytes=%lu", path.c_str(), fileSize, (unsigned long)mInMemoryMaxBytes));
+		return false;
+	}
+
+	vector<unsigned char> image;
+	if(fileSize > 0) image.reserve((size_t)fileSize);
+
+	size_t readSize = chunkSize;
+	while(readSize == chunkSize)
+	{
+		size_t oldSize = image.size();
+		image.resize(oldSize + chunkSize);
+		readSize = fread(&image[oldSize], 1, chunkSize, file);
+		image.resize(oldSize + readSize);
+
+		//the file could grow after its size was taken
+		if(mInMemoryMaxBytes && image.size() > mInMemoryMaxBytes)
+		{
+			fclose(file);
+			Error(CCDB_ERROR_CONNECTION_INITIALIZATION, functionName, StringUtils::Format("File '%s' is bigger than inmemory_max_bytes=%lu", path.c_str(), (unsigned long)mInMemoryMaxBytes));
+			return false;
+		}
+	}
+
+	bool isReadError = ferror(file) != 0;
+	fclose(file);
+	if(isReadError || image.empty())
+	{
+		Error(CCDB_ERROR_CONNECTION_EXTERNAL_ERROR, functionName, "Can't read file '" + path + "' to memory or the file is empty");
+		return false;
+	}
+
+	mInMemoryImage.swap(image);
+	Log::Verbose("ccdb::SQLiteDataProvider::Connect", StringUtils::Format("Database is read to memory: %.1f MB in %.3f s",
+		mInMemoryImage.size() / (1024.0*1024.0), stopwatch.ElapsedUs() / 1000000.0));
+	return true;
+}
+
+
+bool ccdb::SQLiteDataProvider::LoadInMemoryDatabase(const string& path, const char *functionName)
+{
+	/** @brief Copies the database file to the shared cache in memory database mOpenName
+	 *
+	 * SQLite before 3.36 usually has no sqlite3_deserialize. Then the file is copied page by page
+	 * by sqlite3_backup_step to mInMemoryDatabase, which is kept open, so the copy lives until Disconnect.
+	 * Other connections open the same copy read only. Load time and size are logged
+	 */
+	StopWatch stopwatch;
+
+	FILE *file = fopen(path.c_str(), "rb");
+	if(!file)
+	{
+		Error(CCDB_ERROR_CONNECTION_EXTERNAL_ERROR, functionName, "Can't open file '" + path + "' to read it to memory");
+		return false;
+	}
+	long fileSize = (fseek(file, 0, SEEK_END) == 0) ? ftell(file) : -1;
+	fclose(file);
+	if(mInMemoryMaxBytes && fileSize > 0 && (size_t)fileSize > mInMemoryMaxBytes)
+	{
+		Error(CCDB_ERROR_CONNECTION_INITIALIZATION, functionName, StringUtils::Format("File '%s' of %ld bytes is bigger than inmemory_max_bytes=%lu", path.c_str(), fileSize, (unsigned long)mInMemoryMaxBytes));
+		return false;
+	}
+
+	sqlite3 *source = NULL;
+	int result = sqlite3_open_v2(path.c_str(), &source, SQLITE_OPEN_READONLY, NULL);
+	if(result != SQLITE_OK)
+	{
+		Error(CCDB_ERROR_CONNECTION_EXTERNAL_ERROR, functionName, ComposeSQLiteError("sqlite3_open_v2", source));
+		sqlite3_close(source);
+		return false;
+	}
+
+	result = sqlite3_open_v2(mOpenName.c_str(), &mInMemoryDatabase, SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE|SQLITE_OPEN_FULLMUTEX|mOpenFlags, NULL);
+	if(result == SQLITE_OK)
+	{
+		//the errors of the backup go to the destination connection. Not a database file fails here
+		sqlite3_backup *backup = sqlite3_backup_init(mInMemoryDatabase, "main", source, "main");
+		if(!backup) result = sqlite3_errcode(mInMemoryDatabase);
+		else
+		{
+			sqlite3_backup_step(backup, -1);	//all pages at once
+			result = sqlite3_backup_finish(backup);
+		}
+	}
+	if(result == SQLITE_OK) result = sqlite3_exec(mInMemoryDatabase, "SELECT count(*) FROM sqlite_master;", NULL, 0, 0);
+	if(result != SQLITE_OK)
+	{
+		Error(CCDB_ERROR_CONNECTION_EXTERNAL_ERROR, functionName, ComposeSQLiteError("sqlite3_backup_step", mInMemoryDatabase));
+		sqlite3_close(mInMemoryDatabase);
+		mInMemoryDatabase = NULL;
+		sqlite3_close(source);
+		return false;
+	}
+	sqlite3_close(source);
+
+	Log::Verbose("ccdb::SQLiteDataProvider::Connect", StringUtils::Format("Database is copied to memory: %.1f MB in %.3f s",
+		fileSize / (1024.0*1024.0), stopwatch.ElapsedUs() / 1000000.0));
+	return true;
+}
+
+
+bool ccdb::SQLiteDataProvider::IsInMemorySupported()
+{
+	return true;
+}
+
+
+bool ccdb::SQLiteDataProvider::IsInMemoryShared()
+{
+#ifdef CCDB_SQLITE_DESERIALIZE
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+size_t ccdb::SQLiteDataProvider::GetPooledConnectionsCount()
+{
+	lock_guard<mutex> lock(mPoolMutex);
+	return mPooledConnectionsCount;
+}
+
+
+ccdb::SQLiteDataProvider::PooledConnection* ccdb::SQLiteDataProvider::AcquireConnection(const char *functionName)
+{
+	/** @brief Takes idle connection of the pool or opens a new one
+	 *
+	 * The pool grows up to the number of threads that read at the same time.
+	 * Connections are read only and are opened with SQLITE_OPEN_NOMUTEX
+	 * as each of them is used by one thread at a time
+	 *
+	 * @return connection or NULL (with error) if it can't be opened
+	 */
+	{
+		lock_guard<mutex> lock(mPoolMutex);
+		if(!mIdleConnections.empty())
+		{
+			PooledConnection *connection = mIdleConnections.back();
+			mIdleConnections.pop_back();
+			return connection;
+		}
+	}
+
+	sqlite3 *database = NULL;
+	if(!OpenDatabase(&database, SQLITE_OPEN_READONLY|SQLITE_OPEN_NOMUTEX, functionName)) return NULL;
+
+	PooledConnection *connection = new PooledConnection();
+	connection->Database = database;
+
+	lock_guard<mutex> lock(mPoolMutex);
+	mPooledConnectionsCount++;
+	return connection;
+}
+
+
+void ccdb::SQLiteDataProvider::ReleaseConnection(PooledConnection *connection)
+{
+	lock_guard<mutex> lock(mPoolMutex);
+	mIdleConnections.push_back(connection);
+}
+
+
+void ccdb::SQLiteDataProvider::ClosePooledConnections()
+{
+	///Closes connections of the pool. Connections must not be used by other threads at this time
+
+	lock_guard<mutex> lock(mPoolMutex);
+	for(size_t i = 0; i < mIdleConnections.size(); i++)
+	{
+		PooledConnection *connection = mIdleConnections[i];
+		for(map<string, sqlite3_stmt*>::iterator it = connection->Statements.begin(); it != connection->Statements.end(); ++it)
+		{
+			sqlite3_finalize(it->second);
+		}
+		sqlite3_close(connection->Database);
+		delete connection;
+	}
+	mIdleConnections.clear();
+	mPooledConnectionsCount = 0;
+}
+
+
+sqlite3_stmt* ccdb::SQLiteDataProvider::PreparePooledStatement(PooledConnection *connection, const string& query, const char *functionName)
+{
+	/** @brief Prepared statement of the query on the pooled connection
+	 *
+	 * The same as PrepareCachedStatement, but statements belong to the connection of the pool
+	 */
+	map<string, sqlite3_stmt*>::iterator found = connection->Statements.find(query);
+	if(found != connection->Statements.end())
+	{
+		sqlite3_reset(found->second);
+		sqlite3_clear_bindings(found->second);
+		return found->second;
+	}
+
+	sqlite3_stmt *statement = NULL;
+#if SQLITE_VERSION_NUMBER >= 3020000
+	int result = sqlite3_prepare_v3(connection->Database, query.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &statement, 0);
+#else
+	int result = sqlite3_prepare_v2(connection->Database, query.c_str(), -1, &statement, 0);
+#endif
+	if( result )
+	{
+		Error(CCDB_ERROR_QUERY_PREPARE, functionName, ComposeSQLiteError(functionName, connection->Database));
+		sqlite3_finalize(statement);
+		return NULL;
+	}
+
+	connection->Statements[query] = statement;
+	return statement;
+}
+
+
 bool ccdb::SQLiteDataProvider::QueryPrepare(const char* query, const char *functionName)
 {
 	int result = sqlite3_prepare_v2(mDatabase, query, -1, &mStatement, 0);
@@ -1582,9 +2419,9 @@ void ccdb::SQLiteDataProvider::FreeSQLiteResult()
 	sqlite3_free(mStatement);
 }
 
-std::string ccdb::SQLiteDataProvider::ComposeSQLiteError(const std::string& SQLiteFunctionName)
+std::string ccdb::SQLiteDataProvider::ComposeSQLiteError(const std::string& SQLiteFunctionName, sqlite3 *database/*=NULL*/)
 {
-	string sqliteErr=StringUtils::Format("%s failed:\nError (%s)\n",SQLiteFunctionName.c_str(), sqlite3_errmsg(mDatabase));
+	string sqliteErr=StringUtils::Format("%s failed:\nError (%s)\n",SQLiteFunctionName.c_str(), sqlite3_errmsg(database ? database : mDatabase));
 	return sqliteErr;
 }
 #pragma endregion Fetch_free_and_other_SQLite_operations
@@ -1601,6 +2438,35 @@ std::string ccdb::SQLiteDataProvider::PrepareLimitInsertion(  int take/*=0*/, in
 }
 
 
+std::string ccdb::SQLiteDataProvider::PrepareVariationChainInsertion( size_t chainSize, int firstParameter )
+{
+	/** @brief Condition and ordering that select assignments of the nearest variation of a chain
+	 *
+	 * Gives "AND `assignments`.`variationId` IN (?4, ?5, ?6) ORDER BY CASE `assignments`.`variationId` WHEN ?4 THEN 0 WHEN ?5 THEN 1 ... END, `assignments`.`id` DESC "
+	 * for chainSize=3 and firstParameter=4. The i-th variation of the chain should be bound to firstParameter+i
+	 * So the result is the same as if each variation was looked up in turn from the requested one to the "default"
+	 *
+	 * @param [in] chainSize - number of variations in chain (@see GetCatalogVariationChain)
+	 * @param [in] firstParameter - number of SQL parameter of the first variation
+	 * @return string to insert after WHERE conditions
+	 */
+	string inList;
+	string orderBy;
+	for(size_t i=0; i<chainSize; i++)
+	{
+		string parameter = StringUtils::Format("?%i", firstParameter + (int)i);
+		inList += (i==0 ? "" : ", ") + parameter;
+		orderBy += StringUtils::Format(" WHEN %s THEN %i", parameter.c_str(), (int)i);
+	}
+
+	//one variation needs no ordering by depth
+	if(chainSize<=1) return "AND `assignments`.`variationId` IN (" + inList + ") ORDER BY `assignments`.`id` DESC ";
+
+	return "AND `assignments`.`variationId` IN (" + inList + ") "
+	       "ORDER BY CASE `assignments`.`variationId`" + orderBy + " END, `assignments`.`id` DESC ";
+}
+
+
 int ccdb::SQLiteDataProvider::CountConstantsTypeTables(Directory *dir)
 {
 	/**
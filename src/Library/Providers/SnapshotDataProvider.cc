@@ -0,0 +1,586 @@
+#include <string.h>
+
+#include "CCDB/Globals.h"
+#include "CCDB/Log.h"
+#include "CCDB/Helpers/StringUtils.h"
+#include "CCDB/Helpers/PathUtils.h"
+#include "CCDB/Providers/SnapshotDataProvider.h"
+#include "CCDB/Model/ConstantsTypeTable.h"
+
+using namespace std;
+
+namespace ccdb
+{
+
+//______________________________________________________________________________
+SnapshotDataProvider::SnapshotDataProvider(void)
+{
+    mIsConnected = false;
+    mVariation = NULL;
+    mRootDir = new Directory(this, this);
+    mDirsAreLoaded = true;     //there are no directories in snapshot
+}
+
+
+//______________________________________________________________________________
+SnapshotDataProvider::~SnapshotDataProvider(void)
+{
+    if(IsConnected()) Disconnect();
+}
+
+
+//----------------------------------------------------------------------------------------
+//	C O N N E C T I O N
+//----------------------------------------------------------------------------------------
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::Connect(std::string connectionString)
+{
+    /** @brief Maps snapshot file
+     *
+     * @param connectionString "snapshot://<path to file>" or "snapshot://<path to file>?verify=0"
+     * @return true if the file is mapped and is valid
+     */
+    ClearErrors(); //Clear error in function that can produce new ones
+
+    if(connectionString.find("snapshot://") != 0)
+    {
+        Error(CCDB_ERROR_PARSE_CONNECTION_STRING, "SnapshotDataProvider::Connect()", "Error parse snapshot string. The string is not started with snapshot://");
+        return false;
+    }
+
+    if(IsConnected())
+    {
+        Error(CCDB_ERROR_CONNECTION_ALREADY_OPENED, "SnapshotDataProvider::Connect()", "Connection already opened");
+        return false;
+    }
+
+    string fileName = connectionString.substr(11);
+    bool verifyChecksum = true;
+    size_t optionsPos = fileName.rfind("?verify=");
+    if(optionsPos != string::npos)
+    {
+        verifyChecksum = fileName.substr(optionsPos + 8) != "0";
+        fileName.erase(optionsPos);
+    }
+
+    Log::Verbose("ccdb::SnapshotDataProvider::Connect", StringUtils::Format("Opening snapshot:\n %s", fileName.c_str()));
+
+    string error;
+    if(!mFile.Open(fileName, verifyChecksum, error))
+    {
+        Error(CCDB_ERROR_SNAPSHOT_INVALID, "SnapshotDataProvider::Connect()", error);
+        return false;
+    }
+
+    mVariation = new Variation(this, this);
+    mVariation->SetName(mFile.GetVariation());
+
+    mConnectionString = connectionString;
+    mIsConnected = true;
+    return true;
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::IsConnected()
+{
+    return mIsConnected;
+}
+
+
+//______________________________________________________________________________
+void SnapshotDataProvider::Disconnect()
+{
+    if(!IsConnected()) return;
+
+    //the catalog and cached data describe the closed file
+    ClearCaches();
+    mFile.Close();
+    delete mVariation;
+    mVariation = NULL;
+    mIsConnected = false;
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::CheckConnection(const string& errorSource/*=""*/)
+{
+    ClearErrors(); //Clear error in function that can produce new ones
+
+    if(!IsConnected())
+    {
+        Error(CCDB_ERROR_NOT_CONNECTED, errorSource, "Provider is not connected to snapshot.");
+        return false;
+    }
+    return true;
+}
+
+
+//______________________________________________________________________________
+void SnapshotDataProvider::NotImplemented(const char* errorSource)
+{
+    ClearErrors(); //Clear error in function that can produce new ones
+    Error(CCDB_ERROR_NOT_IMPLEMENTED, errorSource, "The function is not available for snapshots");
+}
+
+
+//----------------------------------------------------------------------------------------
+//	D I R E C T O R I E S   A N D   T Y P E   T A B L E S
+//----------------------------------------------------------------------------------------
+
+//______________________________________________________________________________
+Directory* SnapshotDataProvider::GetDirectory(const string& path)
+{
+    if(path == "/" || path.empty()) return mRootDir;
+    return NULL;
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::SearchDirectories(vector<Directory *>& resultDirectories, const string& searchPattern, const string& parentPath/*=""*/, int take/*=0*/, int startWith/*=0*/)
+{
+    NotImplemented("SnapshotDataProvider::SearchDirectories");
+    return false;
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::LoadDirectories()
+{
+    //there are no directories in snapshot, only paths of type tables
+    return true;
+}
+
+
+//______________________________________________________________________________
+ConstantsTypeTable * SnapshotDataProvider::GetConstantsTypeTable(const string& path, bool loadColumns/*=false*/)
+{
+    /** @brief Type table from the snapshot. The table always has columns
+     *
+     * @param  [in] path absolute path of the type table
+     * @return new object of ConstantsTypeTable or NULL if the table is not in the snapshot
+     */
+    if(!CheckConnection("SnapshotDataProvider::GetConstantsTypeTable")) return NULL;
+
+    const SnapshotTable *record = mFile.FindTable(path);
+    if(!record) return NULL;
+
+    ConstantsTypeTable *table = new ConstantsTypeTable(this, this);
+    table->SetId(record->Id);
+    table->SetName(PathUtils::ExtractObjectname(path));
+    table->SetFullPath(path);   //after the name, as SetName resets the path
+    table->SetNRows(record->RowsCount);
+    table->SetNColumnsFromDB(record->ColumnsCount);
+    for(uint32_t i = 0; i < record->ColumnsCount; i++)
+    {
+        const SnapshotColumn *column = mFile.GetColumn(record, i);
+        table->AddColumn(mFile.GetName(column), (ConstantsTypeColumn::ColumnTypes)column->Type);
+    }
+    return table;
+}
+
+
+//______________________________________________________________________________
+ConstantsTypeTable * SnapshotDataProvider::GetConstantsTypeTable(const string& name, Directory *parentDir, bool loadColumns/*=false*/)
+{
+    if(!parentDir)
+    {
+        ClearErrors();
+        Error(CCDB_ERROR_NO_PARENT_DIRECTORY, "SnapshotDataProvider::GetConstantsTypeTable", "Parent directory is NULL");
+        return NULL;
+    }
+    return GetConstantsTypeTable(PathUtils::CombinePath(parentDir->GetFullPath(), name), loadColumns);
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::GetConstantsTypeTables(vector<ConstantsTypeTable *>& typeTables, const string& parentDirPath, bool loadColumns/*=false*/)
+{
+    return SearchConstantsTypeTables(typeTables, "*", parentDirPath.empty() ? string("/") : parentDirPath, loadColumns);
+}
+
+
+//______________________________________________________________________________
+vector<ConstantsTypeTable *> SnapshotDataProvider::GetConstantsTypeTables(Directory *parentDir, bool loadColumns/*=false*/)
+{
+    vector<ConstantsTypeTable *> tables;
+    GetConstantsTypeTables(tables, parentDir, loadColumns);
+    return tables;
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::GetConstantsTypeTables(vector<ConstantsTypeTable *>& typeTables, Directory *parentDir, bool loadColumns/*=false*/)
+{
+    if(!parentDir) return false;
+    return GetConstantsTypeTables(typeTables, parentDir->GetFullPath(), loadColumns);
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::SearchConstantsTypeTables(vector<ConstantsTypeTable *>& typeTables, const string& pattern, const string& parentPath/*= ""*/, bool loadColumns/*=false*/, int take/*=0*/, int startWith/*=0*/)
+{
+    /** @brief Searches type tables of the snapshot by name pattern with '*' and '?'
+     *
+     * If parentPath is not empty only tables that are directly in this directory are selected
+     */
+    if(!CheckConnection("SnapshotDataProvider::SearchConstantsTypeTables")) return false;
+
+    int found = 0;
+    for(size_t i = 0; i < mFile.GetTablesCount(); i++)
+    {
+        string path = mFile.GetPath(mFile.GetTable(i));
+        if(!parentPath.empty() && PathUtils::ExtractDirectory(path) != PathUtils::CombinePath("/", parentPath)) continue;
+        if(!PathUtils::WildCardCheck(pattern.c_str(), PathUtils::ExtractObjectname(path).c_str())) continue;
+
+        //paging
+        if(found++ < startWith) continue;
+        if(take > 0 && (int)typeTables.size() >= take) break;
+
+        typeTables.push_back(GetConstantsTypeTable(path, loadColumns));
+    }
+    return true;
+}
+
+
+//______________________________________________________________________________
+vector<ConstantsTypeTable *> SnapshotDataProvider::SearchConstantsTypeTables(const string& pattern, const string& parentPath/*= ""*/, bool loadColumns/*=false*/, int take/*=0*/, int startWith/*=0*/)
+{
+    vector<ConstantsTypeTable *> tables;
+    SearchConstantsTypeTables(tables, pattern, parentPath, loadColumns, take, startWith);
+    return tables;
+}
+
+
+//______________________________________________________________________________
+int SnapshotDataProvider::CountConstantsTypeTables(Directory *dir)
+{
+    vector<ConstantsTypeTable *> tables;
+    if(!GetConstantsTypeTables(tables, dir)) return 0;
+    for(size_t i = 0; i < tables.size(); i++) delete tables[i];
+    return (int)tables.size();
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::LoadColumns(ConstantsTypeTable* table)
+{
+    //tables of the snapshot are created with columns
+    return table != NULL && table->GetColumnsCount() > 0;
+}
+
+
+//----------------------------------------------------------------------------------------
+//	R U N   R A N G E S   A N D   V A R I A T I O N S
+//----------------------------------------------------------------------------------------
+
+//______________________________________________________________________________
+RunRange* SnapshotDataProvider::GetRunRange(int min, int max, const string& name/*= ""*/)
+{
+    NotImplemented("SnapshotDataProvider::GetRunRange");
+    return NULL;
+}
+
+
+//______________________________________________________________________________
+RunRange* SnapshotDataProvider::GetRunRange(const string& name)
+{
+    NotImplemented("SnapshotDataProvider::GetRunRange");
+    return NULL;
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::GetRunRanges(vector<RunRange *>& resultRunRanges, ConstantsTypeTable *table, const string& variation/*=""*/, int take/*=0*/, int startWith/*=0*/)
+{
+    NotImplemented("SnapshotDataProvider::GetRunRanges");
+    return false;
+}
+
+
+//______________________________________________________________________________
+Variation* SnapshotDataProvider::GetVariation(const string& name)
+{
+    /** @brief Variation of the snapshot. Other variations are not in the snapshot
+     *
+     * @warning User should not delete this object
+     */
+    if(!CheckConnection("SnapshotDataProvider::GetVariation")) return NULL;
+
+    if(name != mVariation->GetName()) return NULL;
+    return mVariation;
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::GetVariations(vector<Variation *>& resultVariations, ConstantsTypeTable *table, int run/*=0*/, int take/*=0*/, int startWith/*=0*/)
+{
+    NotImplemented("SnapshotDataProvider::GetVariations");
+    return false;
+}
+
+
+//______________________________________________________________________________
+vector<Variation *> SnapshotDataProvider::GetVariations(ConstantsTypeTable *table, int run/*=0*/, int take/*=0*/, int startWith/*=0*/)
+{
+    vector<Variation *> variations;
+    GetVariations(variations, table, run, take, startWith);
+    return variations;
+}
+
+
+//----------------------------------------------------------------------------------------
+//	A S S I G N M E N T S
+//----------------------------------------------------------------------------------------
+
+//______________________________________________________________________________
+const SnapshotTable* SnapshotDataProvider::FindRequestTable(const string& path, time_t time, const string& variation, const char* errorSource)
+{
+    /** @brief Snapshot table for the request or NULL (with error) if the request can't be served by the snapshot
+     *
+     * The snapshot has data resolved only for its variation and its time
+     */
+    if(!CheckConnection(errorSource)) return NULL;
+
+    if(variation != mVariation->GetName())
+    {
+        Error(CCDB_ERROR_VARIATION_INVALID, errorSource, "Snapshot is written for variation '" + mVariation->GetName() + "', not '" + variation + "'");
+        return NULL;
+    }
+
+    if(time != 0 && time != mFile.GetHeader()->Time)
+    {
+        Error(CCDB_ERROR_SNAPSHOT_INVALID, errorSource, "Snapshot is written for time " + StringUtils::IntToString((int)mFile.GetHeader()->Time) + ", not " + StringUtils::IntToString((int)time));
+        return NULL;
+    }
+
+    const SnapshotTable *table = mFile.FindTable(path);
+    if(!table)
+    {
+        Error(CCDB_ERROR_NO_TYPETABLE, errorSource, "Type table was not found: '" + path + "'");
+        return NULL;
+    }
+    return table;
+}
+
+
+//______________________________________________________________________________
+Assignment* SnapshotDataProvider::MakeAssignment(const SnapshotAssignment* record, const string& path)
+{
+    ConstantsTypeTable *table = GetCatalogTypeTable(path);
+    if(!table) return NULL;
+
+    Assignment *assignment = new Assignment(NULL, this);     //assignments go to the cache, the provider doesn't own them
+    assignment->SetId((int)record->Id);
+    assignment->SetCreatedTime(record->CreatedTime);
+    assignment->SetRawData(string(mFile.GetBlob(record), record->BlobLength));
+
+    //the table belongs to the catalog
+    assignment->SetTypeTable(table);
+    return assignment;
+}
+
+
+//______________________________________________________________________________
+template<typename T>
+bool SnapshotDataProvider::GetTypedValues(const Assignment& assignment, vector<T>& values)
+{
+    /** @brief Fills values of the assignment from the typed column arrays that are in the mapped file
+     *
+     * Arrays are column by column, values are row by row as cells of the data blob are
+     */
+    if(!IsConnected() || !assignment.GetTypeTable()) return false;
+
+    const SnapshotTable *table = mFile.FindTable(assignment.GetTypeTable()->GetFullPath());
+    const SnapshotAssignment *record = mFile.FindAssignmentById(table, assignment.GetId());
+    if(!record) return false;
+
+    //arrays of strings are zeros and bools are 0 or 1, parsed cells of them are not the same
+    size_t columnsCount = table->ColumnsCount;
+    for(size_t column = 0; column < columnsCount; column++)
+    {
+        uint32_t type = mFile.GetColumn(table, column)->Type;
+        if(type == ConstantsTypeColumn::cStringColumn || type == ConstantsTypeColumn::cBoolColumn) return false;
+    }
+
+    size_t rowsCount = record->RowsCount;
+    values.resize(rowsCount * columnsCount);
+    for(size_t column = 0; column < columnsCount; column++)
+    {
+        const double *doubles = mFile.GetDoubleColumn(table, record, column);
+        if(doubles)
+        {
+            //truncated to int as the parsed cells are
+            for(size_t row = 0; row < rowsCount; row++) values[row * columnsCount + column] = (T)doubles[row];
+            continue;
+        }
+
+        const int64_t *ints = mFile.GetIntColumn(table, record, column);
+        uint32_t type = mFile.GetColumn(table, column)->Type;
+        bool isUnsigned = type == ConstantsTypeColumn::cUIntColumn || type == ConstantsTypeColumn::cULongColumn;
+        for(size_t row = 0; row < rowsCount; row++)
+        {
+            values[row * columnsCount + column] = isUnsigned ? (T)(uint64_t)ints[row] : (T)ints[row];
+        }
+    }
+    return true;
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::GetAssignmentValues(const Assignment& assignment, vector<double>& values)
+{
+    return GetTypedValues(assignment, values);
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::GetAssignmentValues(const Assignment& assignment, vector<int>& values)
+{
+    return GetTypedValues(assignment, values);
+}
+
+
+//______________________________________________________________________________
+Assignment* SnapshotDataProvider::GetAssignmentShort(int run, const string& path, const string& variation, bool loadColumns/*=false*/)
+{
+    return GetAssignmentShort(run, path, 0, variation, loadColumns);
+}
+
+
+//______________________________________________________________________________
+Assignment* SnapshotDataProvider::GetAssignmentShort(int run, const string& path, time_t time, const string& variation, bool loadColumns/*=false*/)
+{
+    /** @brief Assignment with data blob from the snapshot
+     *
+     * The run is found by binary search in the run index of the table
+     *
+     * @param [in] run - run number
+     * @param [in] path - object path
+     * @param [in] time - 0 or the time the snapshot was written for
+     * @param [in] variation - variation name, must be the snapshot variation
+     * @param [in] loadColumns - ignored, catalog type tables always have columns
+     * @return new Assignment object or NULL if no assignment is found or error
+     */
+    const SnapshotTable *table = FindRequestTable(path, time, variation, "SnapshotDataProvider::GetAssignmentShort");
+    if(!table) return NULL;
+
+    const SnapshotAssignment *record = mFile.FindAssignment(table, run);
+    if(!record) return NULL;
+
+    Assignment *assignment = MakeAssignment(record, path);
+    if(assignment) assignment->SetRequestedRun(run);
+    return assignment;
+}
+
+
+//______________________________________________________________________________
+dbkey_t SnapshotDataProvider::GetAssignmentIdShort(int run, const string& path, time_t time, const string& variation)
+{
+    /** @brief Resolves request to assignment id by the snapshot run index
+     *
+     * @return assignment id or 0 if no assignment is found or error
+     */
+    const SnapshotTable *table = FindRequestTable(path, time, variation, "SnapshotDataProvider::GetAssignmentIdShort");
+    if(!table) return 0;
+
+    const SnapshotAssignment *record = mFile.FindAssignment(table, run);
+    return record ? (dbkey_t)record->Id : 0;
+}
+
+
+//______________________________________________________________________________
+Assignment* SnapshotDataProvider::GetAssignmentShortById(dbkey_t id, const string& path, bool loadColumns/*=false*/)
+{
+    /** @brief Assignment with data blob from the snapshot by assignment id
+     *
+     * Only assignments of the snapshot runs are in the file
+     */
+    const char *thisFunc = "SnapshotDataProvider::GetAssignmentShortById";
+    if(!CheckConnection(thisFunc)) return NULL;
+
+    const SnapshotTable *table = mFile.FindTable(path);
+    if(!table)
+    {
+        Error(CCDB_ERROR_NO_TYPETABLE, thisFunc, "Type table was not found: '" + path + "'");
+        return NULL;
+    }
+
+    const SnapshotAssignment *record = mFile.FindAssignmentById(table, id);
+    if(!record)
+    {
+        Error(CCDB_ERROR_NO_ASSIGMENT, thisFunc, "No assignment with id '" + StringUtils::IntToString((int)id) + "'");
+        return NULL;
+    }
+
+    return MakeAssignment(record, path);
+}
+
+
+//______________________________________________________________________________
+Assignment* SnapshotDataProvider::GetAssignmentFull(int run, const string& path, const string& variation)
+{
+    NotImplemented("SnapshotDataProvider::GetAssignmentFull");
+    return NULL;
+}
+
+
+//______________________________________________________________________________
+Assignment* SnapshotDataProvider::GetAssignmentFull(int run, const string& path, int version, const string& variation)
+{
+    NotImplemented("SnapshotDataProvider::GetAssignmentFull");
+    return NULL;
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::GetAssignments(vector<Assignment *> &assingments, const string& path, int runMin, int runMax, const string& runRangeName, const string& variation, time_t beginTime, time_t endTime, int sortBy/*=0*/, int take/*=0*/, int startWith/*=0*/)
+{
+    NotImplemented("SnapshotDataProvider::GetAssignments");
+    return false;
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::GetAssignments(vector<Assignment *> &assingments, const string& path, int run, const string& variation, time_t date, int take, int startWith)
+{
+    NotImplemented("SnapshotDataProvider::GetAssignments");
+    return false;
+}
+
+
+//______________________________________________________________________________
+vector<Assignment *> SnapshotDataProvider::GetAssignments(const string& path, int run, const string& variation, time_t date, int take, int startWith)
+{
+    vector<Assignment *> assingments;
+    GetAssignments(assingments, path, run, variation, date, take, startWith);
+    return assingments;
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::GetAssignments(vector<Assignment *> &assingments, const string& path, const string& runName, const string& variation, time_t date, int take, int startWith)
+{
+    NotImplemented("SnapshotDataProvider::GetAssignments");
+    return false;
+}
+
+
+//______________________________________________________________________________
+vector<Assignment *> SnapshotDataProvider::GetAssignments(const string& path, const string& runName, const string& variation, time_t date, int take, int startWith)
+{
+    vector<Assignment *> assingments;
+    GetAssignments(assingments, path, runName, variation, date, take, startWith);
+    return assingments;
+}
+
+
+//______________________________________________________________________________
+bool SnapshotDataProvider::FillAssignment(Assignment* assignment)
+{
+    NotImplemented("SnapshotDataProvider::FillAssignment");
+    return false;
+}
+
+}
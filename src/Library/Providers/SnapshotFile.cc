@@ -0,0 +1,413 @@
+#include <string.h>
+#include <stdio.h>
+#ifdef _WIN32
+#include <vector>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "CCDB/Providers/SnapshotFile.h"
+#include "CCDB/Model/ConstantsTypeColumn.h"
+
+using namespace std;
+
+namespace ccdb
+{
+
+static const uint64_t gSnapshotFnvOffset = 14695981039346656037ULL;
+static const uint64_t gSnapshotFnvPrime = 1099511628211ULL;
+
+
+//______________________________________________________________________________
+SnapshotFile::SnapshotFile()
+{
+    mData = NULL;
+    mSize = 0;
+    mHeader = NULL;
+    mIsMapped = false;
+}
+
+
+//______________________________________________________________________________
+SnapshotFile::~SnapshotFile()
+{
+    Close();
+}
+
+
+//______________________________________________________________________________
+bool SnapshotFile::Open(const string& fileName, bool verifyChecksum, string& error)
+{
+    /** @brief Maps the snapshot file
+     *
+     * @param [in]  fileName       - path to the file
+     * @param [in]  verifyChecksum - if true, the whole file is read once to check the checksum
+     * @param [out] error          - the reason if the file can't be opened
+     * @return true if the file is mapped and is a valid snapshot
+     */
+    Close();
+
+#ifdef _WIN32
+    //no mmap here, just read the file
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if(!file)
+    {
+        error = "Can't open snapshot file '" + fileName + "'";
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *buffer = size > 0 ? new char[size] : NULL;
+    if(!buffer || fread(buffer, 1, size, file) != (size_t)size)
+    {
+        delete[] buffer;
+        fclose(file);
+        error = "Can't read snapshot file '" + fileName + "'";
+        return false;
+    }
+    fclose(file);
+    mData = buffer;
+    mSize = (size_t)size;
+    mIsMapped = false;
+#else
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        error = "Can't open snapshot file '" + fileName + "'";
+        return false;
+    }
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0)
+    {
+        close(fd);
+        error = "Snapshot file '" + fileName + "' is empty or can't be read";
+        return false;
+    }
+
+    void *mapped = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  //the mapping keeps the file
+    if(mapped == MAP_FAILED)
+    {
+        error = "Can't map snapshot file '" + fileName + "'";
+        return false;
+    }
+    mData = (const char*)mapped;
+    mSize = (size_t)fileStat.st_size;
+    mIsMapped = true;
+#endif
+
+    //header
+    if(mSize < sizeof(SnapshotHeader))
+    {
+        Close();
+        error = "File '" + fileName + "' is too small to be a snapshot";
+        return false;
+    }
+    const SnapshotHeader *header = (const SnapshotHeader*)mData;
+    if(memcmp(header->Magic, CCDB_SNAPSHOT_MAGIC, sizeof(header->Magic)) != 0)
+    {
+        Close();
+        error = "File '" + fileName + "' is not a CCDB snapshot";
+        return false;
+    }
+    if(header->ByteOrderMark != 0x01020304)
+    {
+        Close();
+        error = "Snapshot '" + fileName + "' has different byte order";
+        return false;
+    }
+    if(header->Version != CCDB_SNAPSHOT_VERSION)
+    {
+        Close();
+        error = "Snapshot '" + fileName + "' has unsupported version " + to_string((long long)header->Version);
+        return false;
+    }
+    if(header->FileSize != mSize)
+    {
+        Close();
+        error = "Snapshot '" + fileName + "' is truncated";
+        return false;
+    }
+    if(verifyChecksum && Checksum(mData + sizeof(SnapshotHeader), mSize - sizeof(SnapshotHeader)) != header->Checksum)
+    {
+        Close();
+        error = "Snapshot '" + fileName + "' is corrupted. Checksum doesn't match";
+        return false;
+    }
+
+    mHeader = header;
+    if(!CheckLayout(error))
+    {
+        Close();
+        error = "Snapshot '" + fileName + "' is corrupted. " + error;
+        return false;
+    }
+
+    return true;
+}
+
+
+//______________________________________________________________________________
+void SnapshotFile::Close()
+{
+    if(mData)
+    {
+#ifdef _WIN32
+        delete[] mData;
+#else
+        if(mIsMapped) munmap((void*)mData, mSize);
+#endif
+    }
+    mData = NULL;
+    mSize = 0;
+    mHeader = NULL;
+    mIsMapped = false;
+}
+
+
+//______________________________________________________________________________
+bool SnapshotFile::CheckLayout(string& error) const
+{
+    /** @brief Checks that all sections and records point inside the file
+     *
+     * Only records are checked (not values), so it is fast even for big files
+     */
+    const SnapshotHeader *h = mHeader;
+    struct Section { uint64_t Offset; uint64_t Count; uint64_t RecordSize; const char* Name; };
+    Section sections[] = {
+        {h->TablesOffset,      h->TablesCount,      sizeof(SnapshotTable),      "tables"},
+        {h->BucketsOffset,     h->BucketsCount,     sizeof(uint32_t),           "index"},
+        {h->ColumnsOffset,     h->ColumnsCount,     sizeof(SnapshotColumn),     "columns"},
+        {h->RangesOffset,      h->RangesCount,      sizeof(SnapshotRange),      "ranges"},
+        {h->AssignmentsOffset, h->AssignmentsCount, sizeof(SnapshotAssignment), "assignments"},
+        {h->VariationOffset,   h->VariationLength,  1,                          "variation"}
+    };
+    for(size_t i = 0; i < sizeof(sections)/sizeof(sections[0]); i++)
+    {
+        if(sections[i].Offset > mSize || sections[i].Count * sections[i].RecordSize > mSize - sections[i].Offset || (sections[i].Offset % 8 != 0 && sections[i].RecordSize > 1))
+        {
+            error = string("Section '") + sections[i].Name + "' is out of file";
+            return false;
+        }
+    }
+    if(h->BucketsCount == 0 || (h->BucketsCount & (h->BucketsCount - 1)) != 0 || h->BucketsCount < h->TablesCount)
+    {
+        error = "Invalid index size";
+        return false;
+    }
+
+    for(uint32_t i = 0; i < h->TablesCount; i++)
+    {
+        const SnapshotTable *table = GetTable(i);
+        if(table->PathOffset + table->PathLength > mSize ||
+           (uint64_t)table->FirstColumn + table->ColumnsCount > h->ColumnsCount ||
+           (uint64_t)table->FirstRange + table->RangesCount > h->RangesCount)
+        {
+            error = "Invalid table record " + to_string((long long)i);
+            return false;
+        }
+        for(uint32_t r = 0; r < table->RangesCount; r++)
+        {
+            const SnapshotRange *range = GetRange(table, r);
+            if(range->Assignment >= h->AssignmentsCount) { error = "Invalid run range record"; return false; }
+
+            const SnapshotAssignment *assignment = (const SnapshotAssignment*)(mData + h->AssignmentsOffset) + range->Assignment;
+            uint64_t valuesSize = (uint64_t)assignment->RowsCount * table->ColumnsCount * 8;
+            if(assignment->BlobOffset > mSize || assignment->BlobLength > mSize - assignment->BlobOffset ||
+               (valuesSize && (assignment->ValuesOffset > mSize || valuesSize > mSize - assignment->ValuesOffset || assignment->ValuesOffset % 8 != 0)))
+            {
+                error = "Invalid assignment record " + to_string((long long)range->Assignment);
+                return false;
+            }
+        }
+    }
+    for(uint32_t i = 0; i < h->ColumnsCount; i++)
+    {
+        const SnapshotColumn *column = (const SnapshotColumn*)(mData + h->ColumnsOffset) + i;
+        if(column->NameOffset + column->NameLength > mSize) { error = "Invalid column record"; return false; }
+    }
+    return true;
+}
+
+
+//______________________________________________________________________________
+const SnapshotTable* SnapshotFile::FindTable(const string& path) const
+{
+    if(!mHeader) return NULL;
+
+    uint64_t hash = Hash(path.data(), path.size());
+    const uint32_t *buckets = (const uint32_t*)(mData + mHeader->BucketsOffset);
+    uint32_t mask = mHeader->BucketsCount - 1;
+
+    //linear probing until an empty bucket
+    for(uint32_t probe = 0; probe < mHeader->BucketsCount; probe++)
+    {
+        uint32_t value = buckets[(hash + probe) & mask];
+        if(value == 0 || value > mHeader->TablesCount) return NULL;
+
+        const SnapshotTable *table = GetTable(value - 1);
+        if(table->PathHash == hash && table->PathLength == path.size() &&
+           memcmp(GetString(table->PathOffset), path.data(), path.size()) == 0)
+        {
+            return table;
+        }
+    }
+    return NULL;
+}
+
+
+//______________________________________________________________________________
+const SnapshotAssignment* SnapshotFile::FindAssignment(const SnapshotTable* table, int run) const
+{
+    if(!mHeader || !table) return NULL;
+
+    //binary search of the last range with RunMin <= run
+    const SnapshotRange *ranges = GetRange(table, 0);
+    size_t begin = 0;
+    size_t end = table->RangesCount;
+    while(begin < end)
+    {
+        size_t middle = begin + (end - begin) / 2;
+        if(ranges[middle].RunMin <= run) begin = middle + 1;
+        else end = middle;
+    }
+    if(begin == 0) return NULL;
+
+    const SnapshotRange *range = &ranges[begin - 1];
+    if(run > range->RunMax) return NULL;
+
+    return (const SnapshotAssignment*)(mData + mHeader->AssignmentsOffset) + range->Assignment;
+}
+
+
+//______________________________________________________________________________
+const SnapshotAssignment* SnapshotFile::FindAssignmentById(const SnapshotTable* table, int64_t id) const
+{
+    if(!mHeader || !table) return NULL;
+
+    for(uint32_t i = 0; i < table->RangesCount; i++)
+    {
+        const SnapshotAssignment *assignment = (const SnapshotAssignment*)(mData + mHeader->AssignmentsOffset) + GetRange(table, i)->Assignment;
+        if(assignment->Id == id) return assignment;
+    }
+    return NULL;
+}
+
+
+//______________________________________________________________________________
+const SnapshotTable* SnapshotFile::GetTable(size_t index) const
+{
+    if(!mHeader || index >= mHeader->TablesCount) return NULL;
+    return (const SnapshotTable*)(mData + mHeader->TablesOffset) + index;
+}
+
+
+//______________________________________________________________________________
+const SnapshotColumn* SnapshotFile::GetColumn(const SnapshotTable* table, size_t column) const
+{
+    if(!mHeader || !table || column >= table->ColumnsCount) return NULL;
+    return (const SnapshotColumn*)(mData + mHeader->ColumnsOffset) + table->FirstColumn + column;
+}
+
+
+//______________________________________________________________________________
+const SnapshotRange* SnapshotFile::GetRange(const SnapshotTable* table, size_t range) const
+{
+    if(!mHeader || !table) return NULL;
+    return (const SnapshotRange*)(mData + mHeader->RangesOffset) + table->FirstRange + range;
+}
+
+
+//______________________________________________________________________________
+string SnapshotFile::GetPath(const SnapshotTable* table) const
+{
+    if(!table) return string();
+    return string(GetString(table->PathOffset), table->PathLength);
+}
+
+
+//______________________________________________________________________________
+string SnapshotFile::GetName(const SnapshotColumn* column) const
+{
+    if(!column) return string();
+    return string(GetString(column->NameOffset), column->NameLength);
+}
+
+
+//______________________________________________________________________________
+string SnapshotFile::GetVariation() const
+{
+    if(!mHeader) return string();
+    return string(GetString(mHeader->VariationOffset), mHeader->VariationLength);
+}
+
+
+//______________________________________________________________________________
+const char* SnapshotFile::GetBlob(const SnapshotAssignment* assignment) const
+{
+    if(!assignment) return NULL;
+    return GetString(assignment->BlobOffset);
+}
+
+
+//______________________________________________________________________________
+const double* SnapshotFile::GetDoubleColumn(const SnapshotTable* table, const SnapshotAssignment* assignment, size_t column) const
+{
+    const SnapshotColumn *columnRecord = GetColumn(table, column);
+    if(!columnRecord || !assignment || columnRecord->Type != ConstantsTypeColumn::cDoubleColumn) return NULL;
+
+    return (const double*)(mData + assignment->ValuesOffset) + column * assignment->RowsCount;
+}
+
+
+//______________________________________________________________________________
+const int64_t* SnapshotFile::GetIntColumn(const SnapshotTable* table, const SnapshotAssignment* assignment, size_t column) const
+{
+    const SnapshotColumn *columnRecord = GetColumn(table, column);
+    if(!columnRecord || !assignment) return NULL;
+    if(columnRecord->Type == ConstantsTypeColumn::cDoubleColumn || columnRecord->Type == ConstantsTypeColumn::cStringColumn) return NULL;
+
+    return (const int64_t*)(mData + assignment->ValuesOffset) + column * assignment->RowsCount;
+}
+
+
+//______________________________________________________________________________
+uint64_t SnapshotFile::Hash(const char* data, size_t length)
+{
+    uint64_t hash = gSnapshotFnvOffset;
+    for(size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= gSnapshotFnvPrime;
+    }
+    return hash;
+}
+
+
+//______________________________________________________________________________
+uint64_t SnapshotFile::Checksum(const char* data, size_t length)
+{
+    /** @brief FNV-1a 64 by 8 byte little endian words, the tail byte by byte */
+    uint64_t hash = gSnapshotFnvOffset;
+    size_t words = length / 8;
+    for(size_t i = 0; i < words; i++)
+    {
+        uint64_t word;
+        memcpy(&word, data + i * 8, sizeof(word));
+        hash ^= word;
+        hash *= gSnapshotFnvPrime;
+    }
+    for(size_t i = words * 8; i < length; i++)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= gSnapshotFnvPrime;
+    }
+    return hash;
+}
+
+}
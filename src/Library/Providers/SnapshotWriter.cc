@@ -0,0 +1,456 @@
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
+#include <map>
+
+#include "CCDB/Providers/SnapshotWriter.h"
+#include "CCDB/Providers/DataProvider.h"
+#include "CCDB/Helpers/StringUtils.h"
+#include "CCDB/Helpers/PathUtils.h"
+#include "CCDB/Globals.h"
+#include "CCDB/Log.h"
+
+using namespace std;
+
+namespace ccdb
+{
+
+/** @brief Assignment as it goes to the snapshot */
+struct SnapshotWriterAssignment
+{
+    SnapshotAssignment Record;
+    string Blob;
+    vector<uint64_t> Values;        /// ColumnsCount arrays of RowsCount values (bits of int64 or double)
+};
+
+
+/** @brief Type table as it goes to the snapshot */
+struct SnapshotWriterTable
+{
+    SnapshotTable Record;
+    string Path;
+    vector<pair<string, ConstantsTypeColumn::ColumnTypes> > Columns;
+    vector<SnapshotRange> Ranges;
+};
+
+
+//______________________________________________________________________________
+static uint64_t SnapshotWriter_Align(uint64_t offset)
+{
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+
+//______________________________________________________________________________
+static uint64_t SnapshotWriter_AddString(string& strings, uint64_t stringsOffset, const string& value)
+{
+    uint64_t offset = stringsOffset + strings.size();
+    strings.append(value);
+    return offset;
+}
+
+
+//______________________________________________________________________________
+static void SnapshotWriter_ConvertValues(Assignment* assignment, const vector<ConstantsTypeColumn *>& columns, SnapshotWriterAssignment& result)
+{
+    /** @brief Converts cells of the assignment to typed column arrays
+     *
+     * Cells are converted the same way as Assignment::GetValueXXX does, so
+     * the snapshot arrays give the same values as the database
+     */
+    vector<string> cells;
+    assignment->GetVectorData(cells);
+
+    size_t columnsCount = columns.size();
+    size_t rowsCount = columnsCount ? cells.size() / columnsCount : 0;
+    result.Record.RowsCount = (uint32_t)rowsCount;
+    result.Values.assign(rowsCount * columnsCount, 0);
+
+    for(size_t column = 0; column < columnsCount; column++)
+    {
+        ConstantsTypeColumn::ColumnTypes type = columns[column]->GetType();
+        uint64_t *values = result.Values.data() + column * rowsCount;
+
+        for(size_t row = 0; row < rowsCount; row++)
+        {
+            const string& cell = cells[row * columnsCount + column];
+            int64_t intValue = 0;
+            switch(type)
+            {
+            case ConstantsTypeColumn::cDoubleColumn:
+            {
+                double doubleValue = StringUtils::ParseDouble(cell);
+                memcpy(&values[row], &doubleValue, sizeof(doubleValue));
+                continue;
+            }
+            case ConstantsTypeColumn::cStringColumn:
+                continue;
+            case ConstantsTypeColumn::cBoolColumn:
+                intValue = StringUtils::ParseBool(cell) ? 1 : 0;
+                break;
+            case ConstantsTypeColumn::cUIntColumn:
+            case ConstantsTypeColumn::cULongColumn:
+                intValue = (int64_t)StringUtils::ParseULong(cell);
+                break;
+            default:
+                intValue = (int64_t)StringUtils::ParseLong(cell);
+                break;
+            }
+            memcpy(&values[row], &intValue, sizeof(intValue));
+        }
+    }
+}
+
+
+//______________________________________________________________________________
+SnapshotWriter::SnapshotWriter(DataProvider* provider)
+{
+    mProvider = provider;
+    mVariation = CCDB_DEFAULT_VARIATION_NAME;
+    mTime = 0;
+    mWrittenTables = 0;
+    mWrittenAssignments = 0;
+}
+
+
+//______________________________________________________________________________
+SnapshotWriter::~SnapshotWriter()
+{
+}
+
+
+//______________________________________________________________________________
+void SnapshotWriter::AddRuns(int min, int max)
+{
+    if(min > max) swap(min, max);
+    mRuns.push_back(make_pair(min, max));
+}
+
+
+//______________________________________________________________________________
+void SnapshotWriter::AddTable(const string& path)
+{
+    string absolutePath = path;
+    mTables.push_back(PathUtils::MakeAbsolute(absolutePath));
+}
+
+
+//______________________________________________________________________________
+bool SnapshotWriter::Write(const string& fileName)
+{
+    /** @brief Resolves all tables and writes the snapshot
+     *
+     * The whole file is built in memory and then is written at once
+     *
+     * @param [in] fileName - file to write. The file is overwritten
+     * @return true if the file is written. Errors are logged
+     */
+    const char *thisFunc = "SnapshotWriter::Write";
+    mWrittenTables = 0;
+    mWrittenAssignments = 0;
+
+    if(!mProvider || !mProvider->IsConnected())
+    {
+        Log::Error(CCDB_ERROR_NOT_CONNECTED, thisFunc, "Provider is not connected");
+        return false;
+    }
+
+    //tables to write
+    vector<string> paths = mTables;
+    if(paths.empty())
+    {
+        vector<ConstantsTypeTable *> typeTables;
+        if(!mProvider->SearchConstantsTypeTables(typeTables, "*"))
+        {
+            Log::Error(CCDB_ERROR_NO_TYPETABLE, thisFunc, "Error selecting all type tables");
+            return false;
+        }
+        for(size_t i = 0; i < typeTables.size(); i++)
+        {
+            paths.push_back(typeTables[i]->GetFullPath());
+            delete typeTables[i];
+        }
+    }
+    sort(paths.begin(), paths.end());
+    paths.erase(unique(paths.begin(), paths.end()), paths.end());
+
+    //runs to write, sorted and merged
+    vector<pair<int, int> > runs = mRuns;
+    if(runs.empty()) runs.push_back(make_pair(0, INT_MAX));
+    sort(runs.begin(), runs.end());
+    vector<pair<int, int> > mergedRuns;
+    for(size_t i = 0; i < runs.size(); i++)
+    {
+        if(!mergedRuns.empty() && (int64_t)runs[i].first <= (int64_t)mergedRuns.back().second + 1)
+        {
+            mergedRuns.back().second = max(mergedRuns.back().second, runs[i].second);
+        }
+        else
+        {
+            mergedRuns.push_back(runs[i]);
+        }
+    }
+
+    //resolve assignments of every table
+    vector<SnapshotWriterTable> tables(paths.size());
+    vector<SnapshotWriterAssignment> assignments;
+    uint32_t columnsCount = 0;
+    uint32_t rangesCount = 0;
+
+    for(size_t tableIndex = 0; tableIndex < paths.size(); tableIndex++)
+    {
+        const string& path = paths[tableIndex];
+        ConstantsTypeTable *typeTable = mProvider->GetCatalogTypeTable(path);
+        if(!typeTable)
+        {
+            Log::Error(CCDB_ERROR_NO_TYPETABLE, thisFunc, "Type table was not found: '" + path + "'");
+            return false;
+        }
+
+        SnapshotWriterTable& table = tables[tableIndex];
+        memset(&table.Record, 0, sizeof(table.Record));
+        table.Path = path;
+        table.Record.Id = typeTable->GetId();
+        table.Record.RowsCount = (uint32_t)typeTable->GetRowsCount();
+        table.Record.FirstColumn = columnsCount;
+        table.Record.FirstRange = rangesCount;
+        const vector<ConstantsTypeColumn *>& columns = typeTable->GetColumns();
+        for(size_t i = 0; i < columns.size(); i++)
+        {
+            table.Columns.push_back(make_pair(columns[i]->GetName(), columns[i]->GetType()));
+        }
+        table.Record.ColumnsCount = (uint32_t)columns.size();
+        columnsCount += table.Record.ColumnsCount;
+
+        //All assignments of the table. The resolved assignment can change only on their run range bounds
+        vector<Assignment *> tableAssignments;
+        if(!mProvider->GetAssignments(tableAssignments, path, 0, 0, "", "", 0, 0))
+        {
+            Log::Error(CCDB_ERROR_NO_ASSIGMENT, thisFunc, "Error selecting assignments of '" + path + "'");
+            return false;
+        }
+
+        map<dbkey_t, Assignment *> assignmentsById;
+        vector<int64_t> bounds;
+        for(size_t i = 0; i < tableAssignments.size(); i++)
+        {
+            Assignment *assignment = tableAssignments[i];
+            assignmentsById[assignment->GetId()] = assignment;
+            if(assignment->GetRunRange())
+            {
+                bounds.push_back(assignment->GetRunRange()->GetMin());
+                bounds.push_back((int64_t)assignment->GetRunRange()->GetMax() + 1);
+            }
+        }
+
+        //intervals of requested runs split by the bounds
+        vector<pair<int64_t, int64_t> > segments;
+        for(size_t i = 0; i < mergedRuns.size(); i++)
+        {
+            int64_t runMin = mergedRuns[i].first;
+            int64_t runMax = mergedRuns[i].second;
+            vector<int64_t> starts(1, runMin);
+            for(size_t j = 0; j < bounds.size(); j++)
+            {
+                if(bounds[j] > runMin && bounds[j] <= runMax) starts.push_back(bounds[j]);
+            }
+            sort(starts.begin(), starts.end());
+            starts.erase(unique(starts.begin(), starts.end()), starts.end());
+            for(size_t j = 0; j < starts.size(); j++)
+            {
+                segments.push_back(make_pair(starts[j], j + 1 < starts.size() ? starts[j + 1] - 1 : runMax));
+            }
+        }
+
+        map<dbkey_t, uint32_t> indexById;
+        bool ok = true;
+        for(size_t i = 0; i < segments.size() && ok; i++)
+        {
+            dbkey_t id = mProvider->GetAssignmentIdShort((int)segments[i].first, path, mTime, mVariation);
+            if(id <= 0)
+            {
+                if(mProvider->GetLastError() == CCDB_ERROR_VARIATION_INVALID)
+                {
+                    Log::Error(CCDB_ERROR_VARIATION_INVALID, thisFunc, "No variation '" + mVariation + "' was found");
+                    ok = false;
+                }
+                continue;   //no data for these runs
+            }
+
+            //the assignment of the previous adjacent interval just grows
+            if(!table.Ranges.empty() && table.Ranges.back().RunMax + (int64_t)1 == segments[i].first &&
+               assignments[table.Ranges.back().Assignment].Record.Id == id)
+            {
+                table.Ranges.back().RunMax = (int32_t)segments[i].second;
+                continue;
+            }
+
+            map<dbkey_t, uint32_t>::iterator found = indexById.find(id);
+            if(found == indexById.end())
+            {
+                SnapshotWriterAssignment written;
+                memset(&written.Record, 0, sizeof(written.Record));
+
+                Assignment *assignment = NULL;
+                Assignment *loaded = NULL;
+                map<dbkey_t, Assignment *>::iterator foundAssignment = assignmentsById.find(id);
+                if(foundAssignment != assignmentsById.end())
+                {
+                    assignment = foundAssignment->second;
+                }
+                else
+                {
+                    assignment = loaded = mProvider->GetAssignmentShortById(id, path, true);
+                }
+                if(!assignment)
+                {
+                    Log::Error(CCDB_ERROR_NO_ASSIGMENT, thisFunc, "Error reading assignment " + StringUtils::IntToString((int)id) + " of '" + path + "'");
+                    ok = false;
+                    break;
+                }
+
+                written.Record.Id = id;
+                written.Record.CreatedTime = assignment->GetCreatedTime();
+                if(assignment->GetVariation()) written.Record.VariationId = assignment->GetVariation()->GetId();
+                if(assignment->GetRunRange())
+                {
+                    written.Record.RunRangeMin = assignment->GetRunRange()->GetMin();
+                    written.Record.RunRangeMax = assignment->GetRunRange()->GetMax();
+                }
+                written.Blob = assignment->GetRawData();
+                SnapshotWriter_ConvertValues(assignment, columns, written);
+                delete loaded;
+
+                found = indexById.insert(make_pair(id, (uint32_t)assignments.size())).first;
+                assignments.push_back(written);
+            }
+
+            SnapshotRange range;
+            range.RunMin = (int32_t)segments[i].first;
+            range.RunMax = (int32_t)segments[i].second;
+            range.Assignment = found->second;
+            range.Reserved = 0;
+            table.Ranges.push_back(range);
+        }
+
+        //the first assignment owns the type table, so it is deleted with them
+        for(size_t i = 0; i < tableAssignments.size(); i++) delete tableAssignments[i];
+        if(!ok) return false;
+
+        table.Record.RangesCount = (uint32_t)table.Ranges.size();
+        rangesCount += table.Record.RangesCount;
+    }
+
+    //layout
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.Magic, CCDB_SNAPSHOT_MAGIC, sizeof(header.Magic));
+    header.Version = CCDB_SNAPSHOT_VERSION;
+    header.ByteOrderMark = 0x01020304;
+    header.Time = mTime;
+    header.CreatedTime = time(NULL);
+    header.TablesCount = (uint32_t)tables.size();
+    header.BucketsCount = 1;
+    while(header.BucketsCount < 2 * tables.size()) header.BucketsCount *= 2;
+    header.ColumnsCount = columnsCount;
+    header.RangesCount = rangesCount;
+    header.AssignmentsCount = (uint32_t)assignments.size();
+
+    header.TablesOffset = SnapshotWriter_Align(sizeof(SnapshotHeader));
+    header.BucketsOffset = SnapshotWriter_Align(header.TablesOffset + header.TablesCount * sizeof(SnapshotTable));
+    header.ColumnsOffset = SnapshotWriter_Align(header.BucketsOffset + header.BucketsCount * sizeof(uint32_t));
+    header.RangesOffset = SnapshotWriter_Align(header.ColumnsOffset + header.ColumnsCount * sizeof(SnapshotColumn));
+    header.AssignmentsOffset = SnapshotWriter_Align(header.RangesOffset + header.RangesCount * sizeof(SnapshotRange));
+    uint64_t stringsOffset = SnapshotWriter_Align(header.AssignmentsOffset + header.AssignmentsCount * sizeof(SnapshotAssignment));
+
+    //strings and blobs
+    string strings;
+    header.VariationOffset = SnapshotWriter_AddString(strings, stringsOffset, mVariation);
+    header.VariationLength = (uint32_t)mVariation.size();
+
+    vector<SnapshotColumn> columnRecords;
+    vector<uint32_t> buckets(header.BucketsCount, 0);
+    for(size_t i = 0; i < tables.size(); i++)
+    {
+        SnapshotWriterTable& table = tables[i];
+        table.Record.PathOffset = SnapshotWriter_AddString(strings, stringsOffset, table.Path);
+        table.Record.PathLength = (uint32_t)table.Path.size();
+        table.Record.PathHash = SnapshotFile::Hash(table.Path.data(), table.Path.size());
+        for(size_t j = 0; j < table.Columns.size(); j++)
+        {
+            SnapshotColumn column;
+            column.NameOffset = SnapshotWriter_AddString(strings, stringsOffset, table.Columns[j].first);
+            column.NameLength = (uint32_t)table.Columns[j].first.size();
+            column.Type = (uint32_t)table.Columns[j].second;
+            columnRecords.push_back(column);
+        }
+
+        uint32_t bucket = (uint32_t)(table.Record.PathHash & (header.BucketsCount - 1));
+        while(buckets[bucket] != 0) bucket = (bucket + 1) & (header.BucketsCount - 1);
+        buckets[bucket] = (uint32_t)i + 1;
+    }
+    for(size_t i = 0; i < assignments.size(); i++)
+    {
+        assignments[i].Record.BlobOffset = SnapshotWriter_AddString(strings, stringsOffset, assignments[i].Blob);
+        assignments[i].Record.BlobLength = assignments[i].Blob.size();
+    }
+
+    //typed values
+    uint64_t valuesOffset = SnapshotWriter_Align(stringsOffset + strings.size());
+    uint64_t fileSize = valuesOffset;
+    for(size_t i = 0; i < assignments.size(); i++)
+    {
+        assignments[i].Record.ValuesOffset = fileSize;
+        fileSize += assignments[i].Values.size() * sizeof(uint64_t);
+    }
+    header.FileSize = fileSize;
+
+    //build the file
+    string data(fileSize, '\0');
+    char *out = &data[0];
+    for(size_t i = 0; i < tables.size(); i++)
+    {
+        memcpy(out + header.TablesOffset + i * sizeof(SnapshotTable), &tables[i].Record, sizeof(SnapshotTable));
+        if(!tables[i].Ranges.empty())
+        {
+            memcpy(out + header.RangesOffset + tables[i].Record.FirstRange * sizeof(SnapshotRange), tables[i].Ranges.data(), tables[i].Ranges.size() * sizeof(SnapshotRange));
+        }
+    }
+    memcpy(out + header.BucketsOffset, buckets.data(), buckets.size() * sizeof(uint32_t));
+    if(!columnRecords.empty()) memcpy(out + header.ColumnsOffset, columnRecords.data(), columnRecords.size() * sizeof(SnapshotColumn));
+    for(size_t i = 0; i < assignments.size(); i++)
+    {
+        memcpy(out + header.AssignmentsOffset + i * sizeof(SnapshotAssignment), &assignments[i].Record, sizeof(SnapshotAssignment));
+        if(!assignments[i].Values.empty())
+        {
+            memcpy(out + assignments[i].Record.ValuesOffset, assignments[i].Values.data(), assignments[i].Values.size() * sizeof(uint64_t));
+        }
+    }
+    if(!strings.empty()) memcpy(out + stringsOffset, strings.data(), strings.size());
+
+    header.Checksum = SnapshotFile::Checksum(out + sizeof(SnapshotHeader), data.size() - sizeof(SnapshotHeader));
+    memcpy(out, &header, sizeof(header));
+
+    //write
+    FILE *file = fopen(fileName.c_str(), "wb");
+    if(!file)
+    {
+        Log::Error(CCDB_ERROR_SNAPSHOT_INVALID, thisFunc, "Can't open file '" + fileName + "' for writing");
+        return false;
+    }
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    written = (fclose(file) == 0) && written;
+    if(!written)
+    {
+        Log::Error(CCDB_ERROR_SNAPSHOT_INVALID, thisFunc, "Error writing file '" + fileName + "'");
+        remove(fileName.c_str());
+        return false;
+    }
+
+    mWrittenTables = tables.size();
+    mWrittenAssignments = assignments.size();
+    return true;
+}
+
+}
@@ -0,0 +1,122 @@
+#include <algorithm>
+
+#include "CCDB/RunRangeIndex.h"
+
+using namespace std;
+
+namespace ccdb
+{
+
+//______________________________________________________________________________
+RunRangeIndex::RunRangeIndex(const vector<RunRangeIndexEntry>& entries)
+{
+    mEntriesCount = entries.size();
+    mLoadTime = 0;
+
+    map<dbkey_t, vector<const RunRangeIndexEntry *> > byVariation;
+    for(size_t i = 0; i < entries.size(); i++)
+    {
+        if(entries[i].RunMin > entries[i].RunMax) continue;    //such range covers no run
+        byVariation[entries[i].VariationId].push_back(&entries[i]);
+    }
+
+    for(map<dbkey_t, vector<const RunRangeIndexEntry *> >::iterator it = byVariation.begin(); it != byVariation.end(); ++it)
+    {
+        mTrees[it->first].Build(it->second);
+    }
+}
+
+
+//______________________________________________________________________________
+dbkey_t RunRangeIndex::Find(int run, const vector<Variation *>& variations, bool hasCreatedLimit, long long createdLimit) const
+{
+    //the nearest variation that has an assignment wins. The same as ORDER BY CASE `variationId` of the query
+    for(size_t i = 0; i < variations.size(); i++)
+    {
+        map<dbkey_t, VariationTree>::const_iterator tree = mTrees.find(variations[i]->GetId());
+        if(tree == mTrees.end()) continue;
+
+        dbkey_t id = tree->second.Find(run, hasCreatedLimit, createdLimit);
+        if(id) return id;
+    }
+    return 0;
+}
+
+
+//______________________________________________________________________________
+void RunRangeIndex::VariationTree::Build(const vector<const RunRangeIndexEntry *>& entries)
+{
+    //bounds of the elementary intervals. RunMax + 1 is the first run after a range
+    for(size_t i = 0; i < entries.size(); i++)
+    {
+        mBounds.push_back(entries[i]->RunMin);
+        mBounds.push_back((long long)entries[i]->RunMax + 1);
+    }
+    sort(mBounds.begin(), mBounds.end());
+    mBounds.erase(unique(mBounds.begin(), mBounds.end()), mBounds.end());
+
+    size_t leaves = mBounds.size() - 1;
+    mNodes.assign(2 * leaves, Node());
+
+    //the range is put to the nodes that cover its intervals [first, last)
+    vector<vector<pair<long long, dbkey_t> > > nodeEntries(mNodes.size());
+    for(size_t i = 0; i < entries.size(); i++)
+    {
+        size_t first = lower_bound(mBounds.begin(), mBounds.end(), (long long)entries[i]->RunMin) - mBounds.begin();
+        size_t last = lower_bound(mBounds.begin(), mBounds.end(), (long long)entries[i]->RunMax + 1) - mBounds.begin();
+        pair<long long, dbkey_t> value(entries[i]->Created, entries[i]->AssignmentId);
+
+        for(first += leaves, last += leaves; first < last; first /= 2, last /= 2)
+        {
+            if(first & 1) nodeEntries[first++].push_back(value);
+            if(last & 1) nodeEntries[--last].push_back(value);
+        }
+    }
+
+    for(size_t i = 0; i < mNodes.size(); i++)
+    {
+        vector<pair<long long, dbkey_t> >& values = nodeEntries[i];
+        sort(values.begin(), values.end());
+
+        Node& node = mNodes[i];
+        node.Created.reserve(values.size());
+        node.MaxId.reserve(values.size());
+        dbkey_t maxId = 0;
+        for(size_t j = 0; j < values.size(); j++)
+        {
+            maxId = max(maxId, values[j].second);
+            node.Created.push_back(values[j].first);
+            node.MaxId.push_back(maxId);
+        }
+    }
+}
+
+
+//______________________________________________________________________________
+dbkey_t RunRangeIndex::VariationTree::Find(int run, bool hasCreatedLimit, long long createdLimit) const
+{
+    //elementary interval of the run
+    vector<long long>::const_iterator bound = upper_bound(mBounds.begin(), mBounds.end(), (long long)run);
+    if(bound == mBounds.begin() || bound == mBounds.end()) return 0;
+
+    size_t leaves = mBounds.size() - 1;
+    dbkey_t result = 0;
+    for(size_t i = (bound - mBounds.begin() - 1) + leaves; i > 0; i /= 2)
+    {
+        const Node& node = mNodes[i];
+        if(node.Created.empty()) continue;
+
+        if(!hasCreatedLimit)
+        {
+            result = max(result, node.MaxId.back());
+            continue;
+        }
+
+        //the last assignment that was created not later than the limit
+        size_t count = upper_bound(node.Created.begin(), node.Created.end(), createdLimit) - node.Created.begin();
+        if(count) result = max(result, node.MaxId[count - 1]);
+    }
+    return result;
+}
+
+}
@@ -23,7 +23,8 @@ SQLiteCalibration::SQLiteCalibration( int defaultRun, string defaultVariation/*=
 
 //______________________________________________________________________________
 SQLiteCalibration::~SQLiteCalibration()
-{   
+{
+    StopAsyncWorkers();     //requests of the workers use this object
 }
 
 
@@ -0,0 +1,410 @@
+#pragma warning(disable:4800)
+#include "Tests/catch.hpp"
+#include "Tests/tests.h"
+#include "Tests/test_CountingProvider.h"
+
+#include "CCDB/AssignmentCache.h"
+#include "CCDB/SQLiteCalibration.h"
+#include "CCDB/Providers/SQLiteDataProvider.h"
+#include "CCDB/Model/Assignment.h"
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+using namespace std;
+using namespace ccdb;
+
+//creates assignment with given id and blob of given size
+static Assignment* test_AssignmentCache_MakeAssignment(int id, size_t blobSize)
+{
+    Assignment* assignment = new Assignment(NULL, NULL);
+    assignment->SetId(id);
+    assignment->SetRawData(string(blobSize, '1'));
+    return assignment;
+}
+
+
+TEST_CASE("CCDB/AssignmentCache/LRU","Eviction of least recently used entries")
+{
+    Assignment* probe = test_AssignmentCache_MakeAssignment(0, 1000);
+    size_t entrySize = AssignmentCache::EstimateSize(probe);
+    delete probe;
+    AssignmentCache cache(entrySize * 3);
+
+    cache.Put("/a", test_AssignmentCache_MakeAssignment(1, 1000), true);
+    cache.Put("/b", test_AssignmentCache_MakeAssignment(2, 1000), true);
+    cache.Put("/c", test_AssignmentCache_MakeAssignment(3, 1000), true);
+    REQUIRE(cache.GetCount() == 3);
+    REQUIRE(cache.GetUsedBytes() == entrySize * 3);
+
+    //touch 1 so 2 becomes the least recently used
+    REQUIRE(cache.Get(1));
+
+    cache.Put("/d", test_AssignmentCache_MakeAssignment(4, 1000), true);
+    REQUIRE(cache.GetCount() == 3);
+    REQUIRE(cache.GetUsedBytes() <= cache.GetMaxBytes());
+    REQUIRE(cache.Get(1));
+    REQUIRE_FALSE(cache.Get(2));
+    REQUIRE(cache.Get(3));
+    REQUIRE(cache.Get(4));
+
+    //evicted assignment stays alive while it is used
+    shared_ptr<Assignment> held = cache.Get(1);
+    cache.SetMaxBytes(0);
+    REQUIRE(cache.GetCount() == 0);
+    REQUIRE(held->GetRawData().size() == 1000);
+}
+
+
+TEST_CASE("CCDB/AssignmentCache/Pin","Pinned paths are not evicted")
+{
+    Assignment* probe = test_AssignmentCache_MakeAssignment(0, 1000);
+    size_t entrySize = AssignmentCache::EstimateSize(probe);
+    delete probe;
+    AssignmentCache cache(entrySize * 2);
+
+    cache.Pin("/hot");
+    REQUIRE(cache.IsPinned("/hot"));
+    cache.Put("/hot", test_AssignmentCache_MakeAssignment(1, 1000), true);
+    for(int i=0; i<100; i++)
+    {
+        cache.Put("/cold", test_AssignmentCache_MakeAssignment(100 + i, 1000), true);
+    }
+
+    REQUIRE(cache.Get(1));
+    REQUIRE(cache.GetCount() == 2);
+
+    cache.Unpin("/hot");
+    cache.SetMaxBytes(entrySize);
+    REQUIRE(cache.GetCount() == 1);
+}
+
+
+TEST_CASE("CCDB/AssignmentCache/PinnedOverBudget","Pinned entries over the budget stay and others go")
+{
+    Assignment* probe = test_AssignmentCache_MakeAssignment(0, 1000);
+    size_t entrySize = AssignmentCache::EstimateSize(probe);
+    delete probe;
+    AssignmentCache cache(entrySize);
+
+    //pinned entries alone exceed the budget
+    cache.Pin("/hot");
+    for(int i=0; i<3; i++) cache.Put("/hot", test_AssignmentCache_MakeAssignment(1 + i, 1000), true);
+    REQUIRE(cache.GetCount() == 3);
+    REQUIRE(cache.GetUsedBytes() == 3 * entrySize);
+
+    //not pinned entries are evicted at once
+    cache.Put("/cold", test_AssignmentCache_MakeAssignment(100, 1000), true);
+    REQUIRE_FALSE(cache.Get(100));
+    REQUIRE(cache.GetCount() == 3);
+
+    //a path pinned after its entry was put
+    cache.SetMaxBytes(entrySize * 10);
+    cache.Put("/warm", test_AssignmentCache_MakeAssignment(200, 1000), true);
+    cache.Pin("/warm");
+    cache.SetMaxBytes(0);
+    REQUIRE(cache.Get(200));
+    REQUIRE(cache.GetCount() == 4);
+
+    cache.Unpin("/hot");
+    cache.Unpin("/warm");
+    REQUIRE(cache.GetCount() == 0);
+    REQUIRE(cache.GetUsedBytes() == 0);
+}
+
+
+TEST_CASE("CCDB/AssignmentCache/Columns","Entry without columns is not returned if columns are needed")
+{
+    AssignmentCache cache;
+    cache.Put("/a", test_AssignmentCache_MakeAssignment(1, 10), false);
+    REQUIRE(cache.Get(1, false));
+    REQUIRE_FALSE(cache.Get(1, true));
+
+    cache.Put("/a", test_AssignmentCache_MakeAssignment(1, 10), true);
+    REQUIRE(cache.Get(1, true));
+    REQUIRE(cache.GetCount() == 1);
+}
+
+
+TEST_CASE("CCDB/AssignmentCache/Index","Requests are resolved to assignment ids")
+{
+    AssignmentCache cache(CCDB_CACHE_DEFAULT_MAX_BYTES, 2);
+    dbkey_t id = 0;
+
+    REQUIRE(AssignmentCache::MakeRequestKey("/a/b", 100, "default", 0) != AssignmentCache::MakeRequestKey("/a/b", 101, "default", 0));
+    REQUIRE_FALSE(cache.GetAssignmentId(AssignmentCache::MakeRequestKey("/a/b", 100, "default", 0), id));
+
+    cache.PutAssignmentId(AssignmentCache::MakeRequestKey("/a/b", 100, "default", 0), 5);
+    cache.PutAssignmentId(AssignmentCache::MakeRequestKey("/a/b", 101, "default", 0), 5);
+    REQUIRE(cache.GetAssignmentId(AssignmentCache::MakeRequestKey("/a/b", 100, "default", 0), id));
+    REQUIRE(id == 5);
+
+    //the index is bounded, 101 is the least recently used
+    cache.PutAssignmentId(AssignmentCache::MakeRequestKey("/a/b", 102, "default", 0), 5);
+    REQUIRE(cache.GetIndexCount() == 2);
+    REQUIRE_FALSE(cache.GetAssignmentId(AssignmentCache::MakeRequestKey("/a/b", 101, "default", 0), id));
+}
+
+
+TEST_CASE("CCDB/AssignmentCache/Calibration","Cache belongs to connection and has a budget")
+{
+    SQLiteCalibration calib(100);
+    calib.EnableCache(true);
+    REQUIRE(calib.Connect(TESTS_SQLITE_STRING));
+
+    AssignmentCache *cache = calib.GetProvider()->GetAssignmentCache();
+    cache->Clear();
+
+    vector<vector<string> > values;
+    REQUIRE(calib.GetCalib(values, "/test/test_vars/test_table"));
+    REQUIRE(calib.GetCalib(values, "/test/test_vars/test_table2::test"));
+    REQUIRE(cache->GetCount() == 2);
+
+    //the same request written differently and other runs of the same run range share one entry
+    REQUIRE(calib.GetCalib(values, "test/test_vars/test_table"));
+    REQUIRE(calib.GetCalib(values, "/test/test_vars/test_table:100"));
+    REQUIRE(cache->GetIndexCount() == 2);
+    REQUIRE(calib.GetCalib(values, "/test/test_vars/test_table:101"));
+    REQUIRE(calib.GetCalib(values, "/test/test_vars/test_table:102"));
+    REQUIRE(cache->GetIndexCount() == 4);
+    REQUIRE(cache->GetCount() == 2);
+
+    calib.PinNamepath("test/test_vars/test_table");
+    calib.SetCacheMaxBytes(1);
+    REQUIRE(cache->GetCount() == 1);
+
+    //pinned data is still in cache, columns are loaded on demand
+    vector<map<string, string> > mappedValues;
+    REQUIRE(calib.GetCalib(mappedValues, "/test/test_vars/test_table"));
+    REQUIRE(mappedValues.size() == 2);
+    REQUIRE(cache->GetCount() == 1);
+
+    calib.UnpinNamepath("/test/test_vars/test_table");
+    calib.SetCacheMaxBytes(CCDB_CACHE_DEFAULT_MAX_BYTES);
+}
+
+
+TEST_CASE("CCDB/AssignmentCache/RawPointers","Assignments of GetAssignment outlive eviction")
+{
+    SQLiteCalibration calib(100);
+    calib.EnableCache(true);
+    REQUIRE(calib.Connect(TESTS_SQLITE_STRING));
+    AssignmentCache *cache = calib.GetProvider()->GetAssignmentCache();
+    cache->Clear();
+
+    Assignment *assignment = calib.GetAssignment("/test/test_vars/test_table");
+    REQUIRE(assignment != NULL);
+    string rawData = assignment->GetRawData();
+    weak_ptr<Assignment> cached = calib.GetAssignmentShared("/test/test_vars/test_table");
+    REQUIRE(cached.lock().get() == assignment);
+
+    //the cache drops it, the Calibration keeps it
+    cache->Clear();
+    REQUIRE_FALSE(cached.expired());
+    REQUIRE(assignment->GetRawData() == rawData);
+    REQUIRE(calib.GetAssignment("/test/test_vars/no_such_table") == NULL);
+}
+
+TEST_CASE("CCDB/AssignmentCache/Reconnect","Cached data is dropped on disconnect")
+{
+    SQLiteCalibration calib(100);
+    calib.EnableCache(true);
+    REQUIRE(calib.Connect(TESTS_SQLITE_STRING));
+    DataProvider *provider = calib.GetProvider();
+    provider->EnableRunRangeIndex(true);
+
+    vector<vector<string> > values;
+    REQUIRE(calib.GetCalib(values, "/test/test_vars/test_table"));
+    REQUIRE(provider->GetAssignmentCache()->GetCount() > 0);
+    REQUIRE(provider->GetAssignmentCache()->GetIndexCount() > 0);
+
+    //the database may be changed while the connection is closed
+    calib.Disconnect();
+    REQUIRE(provider->GetAssignmentCache()->GetCount() == 0);
+    REQUIRE(provider->GetAssignmentCache()->GetIndexCount() == 0);
+
+    values.clear();
+    REQUIRE(calib.Connect(TESTS_SQLITE_STRING));
+    REQUIRE(calib.GetCalib(values, "/test/test_vars/test_table"));
+    REQUIRE(values.size() == 2);
+    provider->EnableRunRangeIndex(false);
+}
+
+
+TEST_CASE("CCDB/AssignmentCache/TypedValues","Converted cells are cached next to the assignment")
+{
+    AssignmentCache cache;
+    shared_ptr<const vector<double> > doubles;
+    shared_ptr<const vector<int> > ints;
+
+    //values of not cached assignment are ignored
+    cache.PutValues(1, make_shared<const vector<double> >(3, 1.5));
+    REQUIRE_FALSE(cache.GetValues(1, doubles));
+
+    cache.Put("/a", test_AssignmentCache_MakeAssignment(1, 10), false);
+    size_t usedBytes = cache.GetUsedBytes();
+    REQUIRE_FALSE(cache.GetValues(1, doubles));
+
+    cache.PutValues(1, make_shared<const vector<double> >(3, 1.5));
+    REQUIRE(cache.GetValues(1, doubles));
+    REQUIRE(doubles->size() == 3);
+    REQUIRE((*doubles)[2] == 1.5);
+    REQUIRE_FALSE(cache.GetValues(1, ints));
+    REQUIRE(cache.GetUsedBytes() > usedBytes);
+
+    //typed values are evicted with the assignment
+    cache.SetMaxBytes(0);
+    REQUIRE_FALSE(cache.GetValues(1, doubles));
+    REQUIRE(cache.GetUsedBytes() == 0);
+
+    //warm requests take converted values from cache
+    SQLiteCalibration calib(100);
+    calib.EnableCache(true);
+    REQUIRE(calib.Connect(TESTS_SQLITE_STRING));
+    AssignmentCache *calibCache = calib.GetProvider()->GetAssignmentCache();
+    calibCache->Clear();
+
+    vector<vector<string> > strings;
+    vector<vector<double> > tableValues;
+    vector<vector<double> > warmTableValues;
+    REQUIRE(calib.GetCalib(strings, "/test/test_vars/test_table"));
+    REQUIRE(calib.GetCalib(tableValues, "/test/test_vars/test_table"));
+    REQUIRE(calibCache->GetCount() == 1);
+
+    shared_ptr<Assignment> assignment = calib.GetAssignmentShared("/test/test_vars/test_table", false);
+    REQUIRE(calibCache->GetValues(assignment->GetId(), doubles));
+    REQUIRE(doubles->size() == assignment->GetCellsCount());
+
+    REQUIRE(calib.GetCalib(warmTableValues, "/test/test_vars/test_table"));
+    REQUIRE(warmTableValues == tableValues);
+    REQUIRE(tableValues.size() == strings.size());
+    REQUIRE(tableValues[1][2] == StringUtils::ParseDouble(strings[1][2]));
+
+    vector<vector<int> > intValues;
+    REQUIRE(calib.GetCalib(intValues, "/test/test_vars/test_table"));
+    REQUIRE(calibCache->GetValues(assignment->GetId(), ints));
+    REQUIRE(intValues[1][2] == StringUtils::ParseInt(strings[1][2]));
+}
+
+
+TEST_CASE("CCDB/AssignmentCache/Threads","Hits, inserts and eviction from many threads")
+{
+    Assignment* probe = test_AssignmentCache_MakeAssignment(0, 100);
+    size_t entrySize = AssignmentCache::EstimateSize(probe);
+    delete probe;
+    AssignmentCache cache(entrySize * 20, 50);
+    cache.Pin("/hot");
+    cache.Put("/hot", test_AssignmentCache_MakeAssignment(1, 100), true);
+
+    atomic<int> errors(0);
+    vector<thread> threads;
+    for(int threadIndex = 0; threadIndex < 8; threadIndex++)
+    {
+        threads.push_back(thread([&cache, &errors, threadIndex]()
+        {
+            for(int i = 0; i < 2000; i++)
+            {
+                int id = 2 + (threadIndex * 2000 + i) % 100;
+                string key = AssignmentCache::MakeRequestKey("/cold", id, "default", 0);
+                dbkey_t resolvedId = 0;
+                if(!cache.GetAssignmentId(key, resolvedId)) cache.PutAssignmentId(key, id);
+                else if(resolvedId != id) errors++;
+
+                if(!cache.Get(id)) cache.Put("/cold", test_AssignmentCache_MakeAssignment(id, 100), true);
+                if(!cache.Get(1)) errors++;
+            }
+        }));
+    }
+    for(size_t i = 0; i < threads.size(); i++) threads[i].join();
+
+    REQUIRE(errors == 0);
+
+    //entries that were used while eviction went might be skipped, the next insert evicts them
+    cache.Put("/cold", test_AssignmentCache_MakeAssignment(2, 100), true);
+    REQUIRE(cache.GetUsedBytes() <= cache.GetMaxBytes());
+    REQUIRE(cache.GetCount() <= 20);
+    REQUIRE(cache.GetIndexCount() <= 50);
+
+    cache.Clear();
+    REQUIRE(cache.GetUsedBytes() == 0);
+    REQUIRE(cache.GetIndexCount() == 0);
+}
+
+
+TEST_CASE("CCDB/AssignmentCache/SingleFlight","Threads that miss the same request share one load")
+{
+    AssignmentCache cache;
+    const size_t threadsCount = 8;
+    atomic<int> loadsCount(0);
+
+    //the loader waits until all other threads came for the same key
+    auto loader = [&cache, &loadsCount, threadsCount]() -> shared_ptr<Assignment>
+    {
+        loadsCount++;
+        for(int i = 0; i < 5000 && cache.GetCoalescedLoadsCount() < threadsCount - 1; i++)
+        {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        return cache.Put("/a", test_AssignmentCache_MakeAssignment(1, 10), true);
+    };
+
+    vector<shared_ptr<Assignment> > results(threadsCount);
+    vector<thread> threads;
+    for(size_t i = 0; i < threadsCount; i++)
+    {
+        threads.push_back(thread([&cache, &loader, &results, i]()
+        {
+            results[i] = cache.Load(AssignmentCache::MakeRequestKey("/a", 100, "default", 0), loader);
+        }));
+    }
+    for(size_t i = 0; i < threads.size(); i++) threads[i].join();
+
+    REQUIRE(loadsCount == 1);
+    REQUIRE(cache.GetCoalescedLoadsCount() == threadsCount - 1);
+    for(size_t i = 0; i < threadsCount; i++) REQUIRE(results[i] == results[0]);
+
+    //the load is finished, the next one runs the loader again. Exceptions are passed to the caller
+    auto failingLoader = []() -> shared_ptr<Assignment> { throw logic_error("load failed"); };
+    REQUIRE_THROWS(cache.Load(AssignmentCache::MakeRequestKey("/a", 100, "default", 0), failingLoader));
+    REQUIRE(cache.Load(AssignmentCache::MakeRequestKey("/a", 100, "default", 0), loader)->GetId() == 1);
+    REQUIRE(loadsCount == 2);
+}
+
+
+TEST_CASE("CCDB/AssignmentCache/RoundTrips","Queries of Calibration requests with cache enabled")
+{
+    SQLiteCalibration calib(100);
+    calib.EnableCache(true);
+    test_CountingProvider<SQLiteDataProvider> *provider = new test_CountingProvider<SQLiteDataProvider>();
+    calib.UseProvider(provider, false);
+    REQUIRE(calib.Connect(TESTS_SQLITE_STRING));
+
+    test_CheckCalibrationRoundTrips(calib, provider);
+}
+
+
+TEST_CASE("CCDB/AssignmentCache/BatchColumns","Batch entries with type tables of the catalog have columns")
+{
+    SQLiteCalibration calib(100);
+    calib.EnableCache(true);
+    test_CountingProvider<SQLiteDataProvider> *provider = new test_CountingProvider<SQLiteDataProvider>();
+    calib.UseProvider(provider, false);
+    REQUIRE(calib.Connect(TESTS_SQLITE_STRING));
+    provider->GetAssignmentCache()->Clear();
+
+    vector<string> namepaths;
+    namepaths.push_back("/test/test_vars/test_table");
+    namepaths.push_back("/test/test_vars/test_table2::test");
+    vector<shared_ptr<Assignment> > assignments;
+    calib.GetAssignmentsSharedBatch(assignments, namepaths, false);
+    REQUIRE(assignments[0]);
+    REQUIRE(assignments[1]);
+    REQUIRE(assignments[0]->GetTypeTable()->GetColumns().size() > 0);
+
+    //the batch read the columns too, requests that need them are cache hits
+    shared_ptr<Assignment> assignment = calib.GetAssignmentShared("/test/test_vars/test_table", true);
+    REQUIRE(assignment == assignments[0]);
+    REQUIRE(provider->GetQueriesCount() == 0);
+}
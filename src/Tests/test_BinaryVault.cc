@@ -0,0 +1,352 @@
+#pragma warning(disable:4800)
+#include "Tests/tests.h"
+#include "Tests/catch.hpp"
+
+#include "CCDB/Helpers/BinaryVault.h"
+#include "CCDB/Helpers/VaultCodec.h"
+#include "CCDB/Model/Assignment.h"
+#include "CCDB/Providers/SQLiteDataProvider.h"
+#include "CCDB/SQLiteCalibration.h"
+
+#include <fstream>
+#include <stdio.h>
+
+using namespace std;
+using namespace ccdb;
+
+/********************************************************************* **
+ * @brief Binary vault gives the same cells as text vault
+ */
+TEST_CASE("CCDB/BinaryVault/Encode","Binary vault is decoded to the cells it was encoded from")
+{
+	const char *cellArr[] = {
+		"1.5",  "-7", "4294967295", "-9000000000", "18446744073709551615", "1", "text",
+		"0.1",  "0",  "0",          "9000000000",  "0",                    "0", "",
+		"-2e+300", "2147483647", "1", "-1", "1", "0", "a|b"};
+	vector<string> cells(cellArr, cellArr + 21);
+
+	vector<ConstantsTypeColumn::ColumnTypes> types;
+	types.push_back(ConstantsTypeColumn::cDoubleColumn);
+	types.push_back(ConstantsTypeColumn::cIntColumn);
+	types.push_back(ConstantsTypeColumn::cUIntColumn);
+	types.push_back(ConstantsTypeColumn::cLongColumn);
+	types.push_back(ConstantsTypeColumn::cULongColumn);
+	types.push_back(ConstantsTypeColumn::cBoolColumn);
+	types.push_back(ConstantsTypeColumn::cStringColumn);
+
+	string blob;
+	REQUIRE(BinaryVault::Encode(cells, types, blob));
+	REQUIRE(BinaryVault::IsBinary(blob));
+	REQUIRE_FALSE(BinaryVault::IsBinary(Assignment::VectorToBlob(cells)));
+
+	BinaryVault::Layout layout;
+	REQUIRE(BinaryVault::Decode(blob.data(), blob.size(), layout));
+	REQUIRE(layout.RowsCount == 3);
+	REQUIRE(layout.Types == types);
+
+	Assignment assignment;
+	assignment.SetRawData(blob);
+	REQUIRE(assignment.IsBinaryData());
+	REQUIRE(assignment.GetCellsCount() == 21);
+	REQUIRE(assignment.GetVectorData() == cells);
+	REQUIRE(assignment.GetVectorData()[6] == "text");
+	REQUIRE(assignment.GetVectorData()[20] == "a|b");
+
+	vector<double> values;
+	vector<size_t> notNumberCells;
+	REQUIRE(assignment.GetBinaryValues(values, notNumberCells));
+	REQUIRE(values.size() == 21);
+	REQUIRE(values[0] == 1.5);
+	REQUIRE(values[1] == -7);
+	REQUIRE(values[3] == -9000000000.0);
+	REQUIRE(values[7] == 0.1);
+	REQUIRE(notNumberCells.size() == 3);    //"text", "" and "a|b"
+
+	vector<int> ints;
+	REQUIRE(assignment.GetBinaryValues(ints, notNumberCells));
+	REQUIRE(ints[0] == 1);
+	REQUIRE(ints[15] == 2147483647);
+
+	//text data is not read by GetBinaryValues
+	Assignment text;
+	text.SetRawData(Assignment::VectorToBlob(cells));
+	REQUIRE_FALSE(text.IsBinaryData());
+	REQUIRE_FALSE(text.GetBinaryValues(values, notNumberCells));
+
+	//number of cells must fit the columns
+	cells.pop_back();
+	REQUIRE_FALSE(BinaryVault::Encode(cells, types, blob));
+	REQUIRE(Assignment::VectorToBinaryBlob(cells, types).empty());
+}
+
+
+/********************************************************************* **
+ * @brief Cells that are not values of the column type are kept as text
+ */
+TEST_CASE("CCDB/BinaryVault/Fallback","Column with not canonical cells is stored as string column")
+{
+	vector<ConstantsTypeColumn::ColumnTypes> types(2, ConstantsTypeColumn::cIntColumn);
+	types.push_back(ConstantsTypeColumn::cDoubleColumn);
+
+	const char *cellArr[] = {"1", "007", "1.50", "2", "8", "nan?"};
+	vector<string> cells(cellArr, cellArr + 6);
+
+	string blob;
+	REQUIRE(BinaryVault::Encode(cells, types, blob));
+
+	BinaryVault::Layout layout;
+	REQUIRE(BinaryVault::Decode(blob.data(), blob.size(), layout));
+	REQUIRE(layout.Types[0] == ConstantsTypeColumn::cIntColumn);
+	REQUIRE(layout.Types[1] == ConstantsTypeColumn::cStringColumn);    //"007" would be read as "7"
+	REQUIRE(layout.Types[2] == ConstantsTypeColumn::cStringColumn);
+
+	Assignment assignment;
+	assignment.SetRawData(blob);
+	REQUIRE(assignment.GetVectorData() == cells);
+
+	//doubles are written back in canonical form
+	types[2] = ConstantsTypeColumn::cDoubleColumn;
+	cells[5] = "1e-5";
+	REQUIRE(BinaryVault::Encode(cells, types, blob));
+	assignment.SetRawData(blob);
+	REQUIRE(assignment.GetVectorData()[2] == "1.5");
+	REQUIRE(assignment.GetVectorData()[5] == "1e-05");
+}
+
+
+/********************************************************************* **
+ * @brief Broken binary vault has no cells
+ */
+TEST_CASE("CCDB/BinaryVault/Truncated","Truncated binary vault is not decoded")
+{
+	vector<string> cells(6, "12.5");
+	vector<ConstantsTypeColumn::ColumnTypes> types(3, ConstantsTypeColumn::cDoubleColumn);
+	string blob = Assignment::VectorToBinaryBlob(cells, types);
+	REQUIRE(!blob.empty());
+
+	BinaryVault::Layout layout;
+	for(size_t size = 0; size < blob.size(); size++)
+	{
+		REQUIRE_FALSE(BinaryVault::Decode(blob.data(), size, layout));
+	}
+	REQUIRE_FALSE(BinaryVault::Decode((blob + "x").data(), blob.size() + 1, layout));
+
+	Assignment assignment;
+	assignment.SetRawData(blob.substr(0, blob.size() - 3));
+	REQUIRE(assignment.IsBinaryData());
+	REQUIRE(assignment.GetCellsCount() == 0);
+	REQUIRE(assignment.GetVectorData().empty());
+}
+
+
+/********************************************************************* **
+ * @brief GetCalib gives the same numbers from binary and text vaults
+ *
+ * Constant sets of the test database copy are rewritten to binary vaults
+ */
+TEST_CASE("CCDB/BinaryVault/SQLite","Binary vaults are read through SQLite provider")
+{
+	string dbPath = "ccdb_test_binary_vault.sqlite";
+	{
+		ifstream src((string(getenv("CCDB_HOME")) + "/sql/ccdb.sqlite").c_str(), ios::binary);
+		ofstream dst(dbPath.c_str(), ios::binary | ios::trunc);
+		dst << src.rdbuf();
+	}
+
+	int runArr[] = {0, 100, 600, 2500, 3500};
+	const char *pathArr[] = {"/test/test_vars/test_table", "/test/test_vars/test_table2::test", "/test/test_vars/test_table::subtest"};
+	vector<vector<vector<double> > > textDoubles, binaryDoubles;
+	vector<vector<vector<int> > > textInts, binaryInts;
+
+	for(int pass = 0; pass < 2; pass++)
+	{
+		for(size_t r = 0; r < sizeof(runArr)/sizeof(int); r++)
+		{
+			SQLiteCalibration calib(runArr[r]);
+			REQUIRE(calib.Connect("sqlite://" + dbPath));
+			for(size_t p = 0; p < 3; p++)
+			{
+				vector<vector<double> > doubles;
+				vector<vector<int> > ints;
+				REQUIRE(calib.GetCalib(doubles, pathArr[p]));
+				REQUIRE(calib.GetCalib(ints, pathArr[p]));
+				(pass ? binaryDoubles : textDoubles).push_back(doubles);
+				(pass ? binaryInts : textInts).push_back(ints);
+			}
+		}
+		if(pass) break;
+
+		//rewrite vaults: type table 1 has double columns, type table 2 has int columns
+		sqlite3 *db = NULL;
+		REQUIRE(sqlite3_open(dbPath.c_str(), &db) == SQLITE_OK);
+		sqlite3_stmt *select = NULL;
+		REQUIRE(sqlite3_prepare_v2(db, "SELECT id, vault, constantTypeId FROM constantSets", -1, &select, 0) == SQLITE_OK);
+		vector<pair<int, string> > blobs;
+		while(sqlite3_step(select) == SQLITE_ROW)
+		{
+			Assignment text;
+			text.SetRawData((const char*)sqlite3_column_text(select, 1));
+
+			vector<ConstantsTypeColumn::ColumnTypes> types(3, sqlite3_column_int(select, 2) == 1 ? ConstantsTypeColumn::cDoubleColumn : ConstantsTypeColumn::cIntColumn);
+			blobs.push_back(make_pair(sqlite3_column_int(select, 0), Assignment::VectorToBinaryBlob(text.GetVectorData(), types)));
+		}
+		sqlite3_finalize(select);
+		REQUIRE(blobs.size() == 5);
+
+		sqlite3_stmt *update = NULL;
+		REQUIRE(sqlite3_prepare_v2(db, "UPDATE constantSets SET vault = ? WHERE id = ?", -1, &update, 0) == SQLITE_OK);
+		for(size_t i = 0; i < blobs.size(); i++)
+		{
+			REQUIRE(!blobs[i].second.empty());
+			sqlite3_bind_blob(update, 1, blobs[i].second.data(), (int)blobs[i].second.size(), SQLITE_TRANSIENT);
+			sqlite3_bind_int(update, 2, blobs[i].first);
+			REQUIRE(sqlite3_step(update) == SQLITE_DONE);
+			sqlite3_reset(update);
+		}
+		sqlite3_finalize(update);
+		sqlite3_close(db);
+	}
+
+	REQUIRE(binaryDoubles == textDoubles);
+	REQUIRE(binaryInts == textInts);
+	REQUIRE(textDoubles[0][0][0] == 2.2);
+
+	//the provider reads the blob with its zero bytes
+	SQLiteDataProvider prov;
+	REQUIRE(prov.Connect("sqlite://" + dbPath));
+	Assignment *assignment = prov.GetAssignmentShort(100, "/test/test_vars/test_table2", "test");
+	REQUIRE(assignment != NULL);
+	REQUIRE(assignment->IsBinaryData());
+	REQUIRE(assignment->GetVectorData()[1] == "20");
+	delete assignment;
+
+	assignment = prov.GetAssignmentFull(100, "/test/test_vars/test_table", "default");
+	REQUIRE(assignment != NULL);
+	REQUIRE(assignment->IsBinaryData());
+	REQUIRE(assignment->GetCellsCount() == 6);
+	delete assignment;
+
+	remove(dbPath.c_str());
+}
+
+
+/********************************************************************* **
+ * @brief Codec that keeps data as is, to test registration of codecs
+ */
+class CopyVaultCodec: public VaultCodec
+{
+public:
+	unsigned char GetId() const { return 200; }
+	string GetName() const { return "copy"; }
+	bool Compress(const char *data, size_t size, string &output) const { output.assign(data, size); return true; }
+	bool Decompress(const char *data, size_t size, size_t originalSize, string &output) const
+	{
+		output.assign(data, size);
+		return size == originalSize;
+	}
+};
+
+
+/********************************************************************* **
+ * @brief Compressed vaults are decompressed to the same blobs
+ */
+TEST_CASE("CCDB/BinaryVault/Compression","Text and binary vaults are compressed and decompressed")
+{
+	const VaultCodec *zlib = VaultCodec::Find("zlib");
+	REQUIRE(zlib != NULL);
+	REQUIRE(VaultCodec::Find(ZlibVaultCodec::Id) == zlib);
+	REQUIRE(VaultCodec::Find(7) == NULL);
+
+	vector<string> cells;
+	for(int i = 0; i < 3000; i++) cells.push_back(StringUtils::Format("%i", i % 50));
+	vector<ConstantsTypeColumn::ColumnTypes> types(3, ConstantsTypeColumn::cIntColumn);
+	string blobs[] = {Assignment::VectorToBlob(cells), Assignment::VectorToBinaryBlob(cells, types), string()};
+
+	for(size_t i = 0; i < 3; i++)
+	{
+		string compressed, decompressed;
+		REQUIRE(BinaryVault::Compress(blobs[i], *zlib, compressed));
+		REQUIRE(BinaryVault::IsCompressed(compressed));
+		REQUIRE_FALSE(BinaryVault::IsCompressed(blobs[i]));
+		if(!blobs[i].empty()) REQUIRE(compressed.size() * 5 < blobs[i].size());
+		REQUIRE(BinaryVault::Decompress(compressed.data(), compressed.size(), decompressed));
+		REQUIRE(decompressed == blobs[i]);
+
+		//compressed vault is not decoded as binary vault
+		BinaryVault::Layout layout;
+		REQUIRE_FALSE(BinaryVault::Decode(compressed.data(), compressed.size(), layout));
+		REQUIRE_FALSE(BinaryVault::Compress(compressed, *zlib, decompressed));
+
+		//broken data
+		REQUIRE_FALSE(BinaryVault::Decompress(compressed.data(), compressed.size() - 1, decompressed));
+		compressed[BinaryVault::CompressedHeaderSize - 1]++;
+		REQUIRE_FALSE(BinaryVault::Decompress(compressed.data(), compressed.size(), decompressed));
+	}
+
+	//other codecs are added by registration
+	if(!VaultCodec::Find("copy")) REQUIRE(VaultCodec::Register(new CopyVaultCodec()));
+	REQUIRE_FALSE(VaultCodec::Register(new CopyVaultCodec()));    //the id is taken
+	string compressed, decompressed;
+	REQUIRE(BinaryVault::Compress(blobs[0], *VaultCodec::Find("copy"), compressed));
+	REQUIRE(compressed.size() == blobs[0].size() + BinaryVault::CompressedHeaderSize);
+	REQUIRE(BinaryVault::Decompress(compressed.data(), compressed.size(), decompressed));
+	REQUIRE(decompressed == blobs[0]);
+}
+
+
+/********************************************************************* **
+ * @brief Providers decompress vaults before they are given to assignments
+ */
+TEST_CASE("CCDB/BinaryVault/CompressedSQLite","Compressed vaults are read through SQLite provider")
+{
+	string dbPath = "ccdb_test_compressed_vault.sqlite";
+	{
+		ifstream src((string(getenv("CCDB_HOME")) + "/sql/ccdb.sqlite").c_str(), ios::binary);
+		ofstream dst(dbPath.c_str(), ios::binary | ios::trunc);
+		dst << src.rdbuf();
+	}
+
+	//the vault of assignment 4 (runs 0-2147483647 of default) is compressed, vault of assignment 1 is broken
+	sqlite3 *db = NULL;
+	REQUIRE(sqlite3_open(dbPath.c_str(), &db) == SQLITE_OK);
+	string compressed, broken;
+	REQUIRE(BinaryVault::Compress("2.2|2.3|2.4|2.5|2.6|2.7", *VaultCodec::Find("zlib"), compressed));
+	broken = compressed;
+	broken[BinaryVault::MagicSize + 2] = 7;        //unknown codec
+
+	sqlite3_stmt *update = NULL;
+	REQUIRE(sqlite3_prepare_v2(db, "UPDATE constantSets SET vault = ? WHERE id = (SELECT constantSetId FROM assignments WHERE id = ?)", -1, &update, 0) == SQLITE_OK);
+	sqlite3_bind_blob(update, 1, compressed.data(), (int)compressed.size(), SQLITE_TRANSIENT);
+	sqlite3_bind_int(update, 2, 4);
+	REQUIRE(sqlite3_step(update) == SQLITE_DONE);
+	sqlite3_reset(update);
+	sqlite3_bind_blob(update, 1, broken.data(), (int)broken.size(), SQLITE_TRANSIENT);
+	sqlite3_bind_int(update, 2, 1);
+	REQUIRE(sqlite3_step(update) == SQLITE_DONE);
+	sqlite3_finalize(update);
+	sqlite3_close(db);
+
+	SQLiteCalibration calib(100);
+	REQUIRE(calib.Connect("sqlite://" + dbPath));
+	vector<vector<double> > values;
+	REQUIRE(calib.GetCalib(values, "/test/test_vars/test_table"));
+	REQUIRE(values.size() == 2);
+	REQUIRE(values[0][0] == 2.2);
+	REQUIRE(values[1][2] == 2.7);
+
+	SQLiteDataProvider prov;
+	REQUIRE(prov.Connect("sqlite://" + dbPath));
+	Assignment *assignment = prov.GetAssignmentFull(100, "/test/test_vars/test_table", "default");
+	REQUIRE(assignment != NULL);
+	REQUIRE(assignment->GetRawData() == "2.2|2.3|2.4|2.5|2.6|2.7");
+	delete assignment;
+
+	//the vault that can't be decompressed gives an error and the assignment has no cells
+	assignment = prov.GetAssignmentShortById(1, "/test/test_vars/test_table");
+	REQUIRE(assignment != NULL);
+	REQUIRE(prov.GetLastError() == CCDB_ERROR_VAULT_DECOMPRESS);
+	REQUIRE(assignment->GetCellsCount() == 0);
+	delete assignment;
+
+	remove(dbPath.c_str());
+}
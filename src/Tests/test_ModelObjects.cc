@@ -49,4 +49,64 @@ TEST_CASE("CCDB/ModelObjects","ModelObjects tests")
 
 	//TODO more complicated tests with a - benchmark, b - check for memory management
 };
+
+
+TEST_CASE("CCDB/ModelObjects/AssignmentBlob","Data blob tokenizing")
+{
+	Assignment assignment(NULL, NULL);
+
+	//simple blob, empty cells are skipped as before
+	assignment.SetRawData("1|2.5||abc|");
+	vector<string> cells = assignment.GetVectorData();
+	REQUIRE(assignment.GetCellsCount() == 3);
+	REQUIRE(cells.size() == 3);
+	REQUIRE(cells[0] == "1");
+	REQUIRE(cells[1] == "2.5");
+	REQUIRE(cells[2] == "abc");
+	REQUIRE(assignment.GetRawData() == "1|2.5||abc|");
+
+	//encoded delimiters and ampersands that are not delimiters
+	assignment.SetRawData("a&b|x&delimiter;y|&delimiter;|long_value_longer_than_16_chars&delimiter;end|&delimiter|last");
+	cells = assignment.GetVectorData();
+	REQUIRE(cells.size() == 6);
+	REQUIRE(cells[0] == "a&b");
+	REQUIRE(cells[1] == "x|y");
+	REQUIRE(cells[2] == "|");
+	REQUIRE(cells[3] == "long_value_longer_than_16_chars|end");
+	REQUIRE(cells[4] == "&delimiter");
+	REQUIRE(cells[5] == "last");
+
+	//tokenizer gives the same cells as split and decode
+	string blob;
+	vector<string> values;
+	for(int i=0; i<1000; i++)
+	{
+		values.push_back(StringUtils::Format("%i.%i%s", i, i*7, (i%10==0)? "|&":""));
+	}
+	blob = Assignment::VectorToBlob(values);
+	assignment.SetRawData(blob);
+	REQUIRE(assignment.GetVectorData() == values);
+
+	//accessors are served from cells
+	ConstantsTypeTable table(NULL, NULL);
+	table.AddColumn("x", ConstantsTypeColumn::cDoubleColumn);
+	table.AddColumn("y", ConstantsTypeColumn::cDoubleColumn);
+	table.SetNRows(2);
+	assignment.SetTypeTable(&table);
+	assignment.SetRawData("1|2|3|4");
+
+	vector<vector<string> > rows = assignment.GetData();
+	REQUIRE(rows.size() == 2);
+	REQUIRE(rows[1][0] == "3");
+	vector<map<string, string> > mapped = assignment.GetMappedData();
+	REQUIRE(mapped.size() == 2);
+	REQUIRE(mapped[1]["y"] == "4");
+	REQUIRE(assignment.GetValue(1) == "2");
+	REQUIRE(assignment.GetValue(1, 1) == "4");
+	REQUIRE(assignment.GetValue("y") == "2");
+	REQUIRE(assignment.GetValue(1, "x") == "3");
+	REQUIRE(assignment.GetValue("z") == "");
+	REQUIRE(assignment.GetValueDouble(1, "y") == 4.0);
+	assignment.SetTypeTable(NULL);
+}
 #endif
@@ -2,10 +2,12 @@
 #ifdef CCDB_MYSQL
 #include "Tests/tests.h"
 #include "Tests/catch.hpp"
+#include "Tests/test_CountingProvider.h"
 
 #include "CCDB/Console.h"
 #include "CCDB/Helpers/StringUtils.h"
 #include "CCDB/Providers/MySQLDataProvider.h"
+#include "CCDB/MySQLCalibration.h"
 #include "CCDB/Model/Variation.h"
 #include "CCDB/Model/Directory.h"
 
@@ -72,5 +74,234 @@ TEST_CASE("CCDB/MySQLDataProvider/Assignments","Assignments tests")
 
 
 
+}
+
+
+/********************************************************************* **
+ * @brief Assignment lookups go through prepared statements
+ *
+ * @return true if test passed
+ */
+TEST_CASE("CCDB/MySQLDataProvider/PreparedStatements","Prepared statements are reused")
+{
+	MySQLDataProvider prov;
+	if(!prov.Connect(TESTS_CONENCTION_STRING)) return;
+
+	//the first lookup reads the type table too, the next one only the assignment
+	Assignment *assignment = prov.GetAssignmentShort(100, "/test/test_vars/test_table", "subtest");
+	REQUIRE(assignment != NULL);
+	delete assignment;
+	assignment = prov.GetAssignmentShort(100, "/test/test_vars/test_table", "subtest");
+	REQUIRE(assignment != NULL);
+	string data = assignment->GetRawData();
+	dbkey_t id = assignment->GetId();
+	delete assignment;
+
+	//the same request again and requests with other parameters reuse the statements
+	size_t statementsCount = prov.GetPreparedStatementsCount();
+	REQUIRE(statementsCount > 0);
+	for(int run = 0; run < 1000; run += 100)
+	{
+		assignment = prov.GetAssignmentShort(run, "/test/test_vars/test_table", "subtest");
+		REQUIRE(assignment != NULL);
+		delete assignment;
+	}
+	REQUIRE(prov.GetPreparedStatementsCount() == statementsCount);
+
+	//binary results are the same as text ones
+	REQUIRE(prov.GetAssignmentIdShort(100, "/test/test_vars/test_table", 0, "subtest") == id);
+	assignment = prov.GetAssignmentShortById(id, "/test/test_vars/test_table");
+	REQUIRE(assignment != NULL);
+	REQUIRE(assignment->GetRawData() == data);
+	delete assignment;
+
+	//statements belong to the connection
+	prov.Disconnect();
+	REQUIRE(prov.GetPreparedStatementsCount() == 0);
+}
+
+
+/********************************************************************* **
+ * @brief Statements of a connection are bounded and text statements read the same
+ *
+ * @return true if test passed
+ */
+TEST_CASE("CCDB/MySQLDataProvider/StatementsLimit","Least recently used statements are closed")
+{
+	size_t maxStatements = MySQLConnectionPool::GetMaxStatementsPerConnection();
+	MySQLConnectionPool::SetMaxStatementsPerConnection(8);
+
+	MySQLDataProvider prov;
+	if(!prov.Connect(TESTS_CONENCTION_STRING))
+	{
+		MySQLConnectionPool::SetMaxStatementsPerConnection(maxStatements);
+		return;
+	}
+
+	//calls with different statements
+	for(int i = 0; i < 3; i++)
+	{
+		Assignment *assignment = prov.GetAssignmentShort(100, "/test/test_vars/test_table", "subtest");
+		REQUIRE(assignment != NULL);
+		delete assignment;
+		REQUIRE(prov.GetVariation("subtest") != NULL);
+		REQUIRE(prov.GetDirectory("/test/test_vars") != NULL);
+		vector<ConstantsTypeTable *> tables;
+		REQUIRE(prov.SearchConstantsTypeTables(tables, "t??t_tab*", "/test/test_vars"));
+		for(size_t j = 0; j < tables.size(); j++) delete tables[j];
+		REQUIRE(prov.GetPreparedStatementsCount() <= 8);
+	}
+
+	//the query sent as text reads the same as the prepared one
+	string error;
+	MySQLPooledConnection *connection = prov.GetConnectionPool()->Acquire(error);
+	REQUIRE(connection != NULL);
+	MySQLStatement prepared, text;
+	string query = "SELECT ?, ?, NULL, '?' ";
+	REQUIRE(prepared.Prepare(connection->Handle, query));
+	text.PrepareText(connection->Handle, query);
+	REQUIRE(text.IsText());
+	MySQLStatement *statements[] = {&prepared, &text};
+	for(int i = 0; i < 2; i++)
+	{
+		statements[i]->BindInt(0, 123456789012LL);
+		statements[i]->BindString(1, "it's \\ \"quoted\"");
+		REQUIRE(statements[i]->Execute());
+		REQUIRE(statements[i]->GetRowsCount() == 1);
+		REQUIRE(statements[i]->Fetch());
+		REQUIRE(statements[i]->ReadInt(0) == 123456789012LL);
+		REQUIRE(statements[i]->ReadString(1) == "it's \\ \"quoted\"");
+		REQUIRE(statements[i]->IsNull(2));
+		REQUIRE(statements[i]->ReadString(3) == "?");
+		REQUIRE_FALSE(statements[i]->Fetch());
+		statements[i]->Close();
+	}
+	prov.GetConnectionPool()->Release(connection);
+
+	MySQLConnectionPool::SetMaxStatementsPerConnection(maxStatements);
+}
+
+
+/********************************************************************* **
+ * @brief Cold lookup reads type table, columns and assignment by one statement
+ *
+ * @return true if test passed
+ */
+TEST_CASE("CCDB/MySQLDataProvider/ColdLookup","Cold lookup gives the same as separate queries")
+{
+	MySQLDataProvider prov;
+	if(!prov.Connect(TESTS_CONENCTION_STRING)) return;
+
+	//type table is not in the catalog, so it is read with the assignment
+	Assignment *cold = prov.GetAssignmentShort(100, "/test/test_vars/test_table", "subtest");
+	REQUIRE(cold != NULL);
+	ConstantsTypeTable *table = cold->GetTypeTable();
+	REQUIRE(table != NULL);
+	REQUIRE(prov.GetCatalogTypeTable("/test/test_vars/test_table") == table);
+
+	//the same as separate queries give
+	ConstantsTypeTable *expectedTable = prov.GetConstantsTypeTable("/test/test_vars/test_table", true);
+	REQUIRE(expectedTable != NULL);
+	REQUIRE(table->GetId() == expectedTable->GetId());
+	REQUIRE(table->GetFullPath() == expectedTable->GetFullPath());
+	REQUIRE(table->GetRowsCount() == expectedTable->GetRowsCount());
+	REQUIRE(table->GetColumnNames() == expectedTable->GetColumnNames());
+	REQUIRE(table->GetColumnTypeStrings() == expectedTable->GetColumnTypeStrings());
+
+	Assignment *warm = prov.GetAssignmentShort(100, "/test/test_vars/test_table", "subtest");
+	REQUIRE(warm != NULL);
+	REQUIRE(warm->GetId() == cold->GetId());
+	REQUIRE(warm->GetRawData() == cold->GetRawData());
+	REQUIRE(warm->GetVariationId() == cold->GetVariationId());
+
+	//cold lookups by id and without the blob
+	prov.ClearCatalog();
+	Assignment *byId = prov.GetAssignmentShortById(cold->GetId(), "/test/test_vars/test_table");
+	REQUIRE(byId != NULL);
+	REQUIRE(byId->GetRawData() == cold->GetRawData());
+	REQUIRE(byId->GetTypeTable()->GetColumnNames() == expectedTable->GetColumnNames());
+	prov.ClearCatalog();
+	REQUIRE(prov.GetAssignmentIdShort(100, "/test/test_vars/test_table", 0, "subtest") == cold->GetId());
+
+	//not existing table
+	REQUIRE(prov.GetAssignmentShort(100, "/test/test_vars/no_such_table", "subtest") == NULL);
+	REQUIRE(prov.GetLastError() == CCDB_ERROR_NO_TYPETABLE);
+
+	delete byId;
+	delete warm;
+	delete cold;
+	delete expectedTable;
+}
+
+
+/********************************************************************* **
+ * @brief Batch of type tables gives the same assignments as lookups one by one
+ *
+ * @return true if test passed
+ */
+TEST_CASE("CCDB/MySQLDataProvider/AssignmentsBatch","Many type tables are resolved by one statement")
+{
+	MySQLDataProvider prov;
+	if(!prov.Connect(TESTS_CONENCTION_STRING)) return;
+
+	vector<string> paths;
+	paths.push_back("/test/test_vars/test_table");
+	paths.push_back("/test/test_vars/test_table2");
+	paths.push_back("/test/test_vars/no_such_table");
+	paths.push_back("/test/test_vars/test_table");
+
+	//cold batch reads the type tables with columns
+	{
+		vector<Assignment *> batch;
+		REQUIRE(prov.GetAssignmentsShortBatch(batch, 100, paths, 0, "default"));
+		REQUIRE(batch[0] != NULL);
+		REQUIRE(batch[0]->GetTypeTable()->GetFullPath() == "/test/test_vars/test_table");
+		REQUIRE(batch[0]->GetTypeTable()->GetColumns().size() > 0);
+		REQUIRE(batch[0]->GetTypeTable() == batch[3]->GetTypeTable());
+		if(batch[1]) REQUIRE(batch[1]->GetTypeTable()->GetName() == "test_table2");
+		for(size_t i = 0; i < batch.size(); i++) delete batch[i];
+	}
+
+	int runs[] = {100, 600, 2500};
+	const char *variations[] = {"default", "test", "subtest"};
+	for(size_t r = 0; r < 3; r++)
+		for(size_t v = 0; v < 3; v++)
+		{
+			vector<Assignment *> batch;
+			REQUIRE(prov.GetAssignmentsShortBatch(batch, runs[r], paths, 0, variations[v]));
+			REQUIRE(batch.size() == paths.size());
+			REQUIRE(batch[2] == NULL);
+
+			for(size_t i = 0; i < paths.size(); i++)
+			{
+				Assignment *single = prov.GetAssignmentShort(runs[r], paths[i], variations[v]);
+				REQUIRE(!single == !batch[i]);
+				if(single)
+				{
+					REQUIRE(batch[i]->GetId() == single->GetId());
+					REQUIRE(batch[i]->GetRawData() == single->GetRawData());
+					REQUIRE(batch[i]->GetVariationId() == single->GetVariationId());
+				}
+				delete single;
+				delete batch[i];
+			}
+		}
+}
+
+
+TEST_CASE("CCDB/MySQLDataProvider/CalibrationRoundTrips","Cold Calibration request is one statement")
+{
+	MySQLDataProvider probe;
+	if(!probe.Connect(TESTS_CONENCTION_STRING)) return;
+	probe.Disconnect();
+
+	//GetAssignmentShort resolves the request and reads type table, columns and data by one UNION ALL statement
+	MySQLCalibration calib(100);
+	calib.EnableCache(true);
+	test_CountingProvider<MySQLDataProvider> *provider = new test_CountingProvider<MySQLDataProvider>();
+	calib.UseProvider(provider, false);
+	REQUIRE(calib.Connect(TESTS_CONENCTION_STRING));
+
+	test_CheckCalibrationRoundTrips(calib, provider);
 }
 #endif //ifdef CCDB_MYSQL
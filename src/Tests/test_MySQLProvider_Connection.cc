@@ -6,6 +6,20 @@
 #include "CCDB/Console.h"
 #include "CCDB/Providers/MySQLDataProvider.h"
 #include "CCDB/Model/Directory.h"
+#include "CCDB/CalibrationGenerator.h"
+#include "CCDB/Helpers/TimeProvider.h"
+
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 using namespace ccdb;
@@ -40,4 +54,225 @@ TEST_CASE("CCDB/MySQLDataProvider/Connection","Connection tests")
 	prov->Disconnect();
 	delete prov;
 }
+
+
+/********************************************************************* **
+ * @brief Providers with the same connection string share connections
+ *
+ * @return true if test passed
+ */
+TEST_CASE("CCDB/MySQLDataProvider/ConnectionPool","Connection pool")
+{
+	MySQLDataProvider first;
+	if(!first.Connect(TESTS_CONENCTION_STRING)) return;
+
+	MySQLConnectionPool *pool = first.GetConnectionPool();
+	REQUIRE(pool != NULL);
+	pool->SetMaxConnections(2);
+	REQUIRE(pool->GetOpenConnectionsCount() == 1);
+
+	//Connect gives the connection back, it is borrowed by the next provider
+	REQUIRE(pool->GetIdleConnectionsCount() == 1);
+	MySQLDataProvider second;
+	REQUIRE(second.Connect(TESTS_CONENCTION_STRING));
+	REQUIRE(second.GetConnectionPool() == pool);
+	REQUIRE(pool->GetOpenConnectionsCount() == 1);
+
+	//queries borrow a connection only while they run
+	Assignment *assignment = first.GetAssignmentShort(100, "/test/test_vars/test_table", "default");
+	REQUIRE(assignment != NULL);
+	delete assignment;
+	REQUIRE(pool->GetOpenConnectionsCount() == 1);
+	REQUIRE(pool->GetIdleConnectionsCount() == 1);
+
+	//providers that are used directly don't hold connections between calls
+	{
+		vector<MySQLDataProvider *> providers;
+		for(int i = 0; i < 5; i++)
+		{
+			providers.push_back(new MySQLDataProvider());
+			REQUIRE(providers.back()->Connect(TESTS_CONENCTION_STRING));
+			assignment = providers.back()->GetAssignmentShort(100, "/test/test_vars/test_table", "default");
+			REQUIRE(assignment != NULL);
+			delete assignment;
+		}
+		REQUIRE(pool->GetOpenConnectionsCount() <= 2);
+		for(size_t i = 0; i < providers.size(); i++) delete providers[i];
+	}
+
+	//many calibrations hold no more than the pool size
+	{
+		CalibrationGenerator generator;
+		for(int run = 0; run < 10; run++)
+		{
+			Calibration *calib = generator.MakeCalibration(TESTS_CONENCTION_STRING, run, "default");
+			vector<vector<double> > values;
+			REQUIRE(calib->GetCalib(values, "/test/test_vars/test_table"));
+		}
+		REQUIRE(pool->GetOpenConnectionsCount() <= 2);
+	}
+
+	//idle connections are closed
+	pool->SetIdleTimeout(10);
+	TimeProvider::SetTimeUnitTest(true);
+	TimeProvider::SetUnitTestTime(TimeProvider::GetUnixTimeStamp(ClockSources::Monotonic) + 3600);
+	pool->ReapIdleConnections();
+	TimeProvider::SetTimeUnitTest(false);
+	REQUIRE(pool->GetIdleConnectionsCount() == 0);
+	REQUIRE(pool->GetOpenConnectionsCount() == 0);
+
+	//and are opened again on demand
+	REQUIRE(second.GetAssignmentShort(100, "/test/test_vars/test_table", "default") != NULL);
+	REQUIRE(pool->GetOpenConnectionsCount() == 1);
+}
+
+
+#ifndef WIN32
+/** @brief Local server that accepts TCP connections and closes them without MySQL handshake */
+class RefusingServer
+{
+public:
+	explicit RefusingServer(int holdMs): mHoldMs(holdMs), mAccepted(0), mActive(0), mMaxActive(0)
+	{
+		mSocket = socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in address = sockaddr_in();
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = inet_addr("127.0.0.1");
+		address.sin_port = 0;
+		socklen_t length = sizeof(address);
+		bind(mSocket, (sockaddr *)&address, sizeof(address));
+		listen(mSocket, 64);
+		getsockname(mSocket, (sockaddr *)&address, &length);
+		mPort = ntohs(address.sin_port);
+		mAcceptThread = thread([this]() { AcceptLoop(); });
+	}
+
+	~RefusingServer()
+	{
+		shutdown(mSocket, SHUT_RDWR);
+		mAcceptThread.join();
+		for(size_t i = 0; i < mClientThreads.size(); i++) mClientThreads[i].join();
+		close(mSocket);
+	}
+
+	string GetConnectionString(const string& database, const string& options)
+	{
+		return StringUtils::Format("mysql://ccdb_user@127.0.0.1:%i/%s?%s", mPort, database.c_str(), options.c_str());
+	}
+
+	int GetAcceptedCount() { return mAccepted; }
+	int GetMaxActiveCount() { return mMaxActive; }
+
+private:
+	void AcceptLoop()
+	{
+		for(;;)
+		{
+			int client = accept(mSocket, NULL, NULL);
+			if(client < 0) return;
+			mAccepted++;
+			int active = ++mActive;
+			int maxActive = mMaxActive;
+			while(active > maxActive && !mMaxActive.compare_exchange_weak(maxActive, active)) {}
+
+			mClientThreads.push_back(thread([this, client]()
+			{
+				this_thread::sleep_for(chrono::milliseconds(mHoldMs));
+				mActive--;
+				close(client);
+			}));
+		}
+	}
+
+	int mSocket;
+	int mPort;
+	int mHoldMs;
+	atomic<int> mAccepted;
+	atomic<int> mActive;
+	atomic<int> mMaxActive;
+	thread mAcceptThread;
+	vector<thread> mClientThreads;
+};
+
+
+/********************************************************************* **
+ * @brief Failed connections are retried with growing backoff
+ *
+ * @return true if test passed
+ */
+TEST_CASE("CCDB/MySQLDataProvider/ConnectBackoff","Connection retries with backoff")
+{
+	//options of the connection string
+	MySQLConnectionInfo info;
+	REQUIRE(MySQLDataProvider::ParseConnectionString("mysql://user@host:3306/ccdb?connect_timeout=5&connect_retries=3&retry_delay_ms=50&retry_max_delay_ms=200", info));
+	REQUIRE(info.Database == "ccdb");
+	REQUIRE(info.Port == 3306);
+	REQUIRE(info.ConnectTimeout == 5);
+	REQUIRE(info.ConnectRetries == 3);
+	REQUIRE(info.RetryDelayMs == 50);
+	REQUIRE(info.RetryMaxDelayMs == 200);
+	REQUIRE_FALSE(MySQLDataProvider::ParseConnectionString("mysql://user@host/ccdb?no_such_option=1", info));
+	REQUIRE_FALSE(MySQLDataProvider::ParseConnectionString("mysql://user@host/ccdb?connect_retries=-1", info));
+
+	//delay doubles up to the limit and is randomized in [delay/2, delay]
+	for(int i = 0; i < 100; i++)
+	{
+		int delay = MySQLConnectionPool::GetBackoffDelayMs(3, 50, 1000);
+		REQUIRE(delay >= 100);
+		REQUIRE(delay <= 200);
+		delay = MySQLConnectionPool::GetBackoffDelayMs(30, 50, 1000);
+		REQUIRE(delay >= 500);
+		REQUIRE(delay <= 1000);
+	}
+	REQUIRE(MySQLConnectionPool::GetBackoffDelayMs(0, 50, 1000) == 0);
+
+	//the server refuses. 1 attempt + 3 retries with backoff not less than 25 + 50 + 100 ms
+	RefusingServer server(0);
+	string connectionString = server.GetConnectionString("ccdb", "connect_timeout=5&connect_retries=3&retry_delay_ms=50&retry_max_delay_ms=200");
+	MySQLDataProvider provider;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	REQUIRE_FALSE(provider.Connect(connectionString));
+	REQUIRE_FALSE(provider.IsConnected());
+	REQUIRE(server.GetAcceptedCount() == 4);
+	REQUIRE(chrono::steady_clock::now() - start >= chrono::milliseconds(175));
+
+	//reconnection after the failure waits the backoff too
+	start = chrono::steady_clock::now();
+	REQUIRE_FALSE(provider.Connect(server.GetConnectionString("ccdb", "connect_timeout=5&retry_delay_ms=50&retry_max_delay_ms=200")));
+	REQUIRE(server.GetAcceptedCount() == 5);
+	REQUIRE(chrono::steady_clock::now() - start >= chrono::milliseconds(100));
+}
+
+
+/********************************************************************* **
+ * @brief No more connections are opened at once than the process limit
+ *
+ * @return true if test passed
+ */
+TEST_CASE("CCDB/MySQLDataProvider/ConnectAdmission","Limit of connections that are opened at once")
+{
+	RefusingServer server(100);
+	MySQLConnectionPool::SetMaxConcurrentConnects(2);
+
+	//different databases, so each provider has its own pool
+	const int threadsCount = 8;
+	atomic<int> connected(0);
+	vector<thread> threads;
+	for(int i = 0; i < threadsCount; i++)
+	{
+		string connectionString = server.GetConnectionString(StringUtils::Format("ccdb%i", i), "connect_timeout=5&retry_delay_ms=0");
+		threads.push_back(thread([&connected, connectionString]()
+		{
+			MySQLDataProvider provider;
+			if(provider.Connect(connectionString)) connected++;
+		}));
+	}
+	for(size_t i = 0; i < threads.size(); i++) threads[i].join();
+	MySQLConnectionPool::SetMaxConcurrentConnects(0);
+
+	REQUIRE(connected == 0);
+	REQUIRE(server.GetAcceptedCount() == threadsCount);
+	REQUIRE(server.GetMaxActiveCount() <= 2);
+}
+#endif //ifndef WIN32
 #endif //ifdef CCDB_MYSQL
@@ -193,3 +193,118 @@ TEST_CASE("CCDB/UserAPI/SQLite_CalibrationGenerator","Use universal generator to
         }
 	}
 }
+
+
+TEST_CASE("CCDB/UserAPI/SQLite_ConstantsView","Read only view of cached constants")
+{
+    SQLiteCalibration calib(100);
+    calib.EnableCache(true);
+    REQUIRE(calib.Connect(TESTS_SQLITE_STRING));
+
+    vector<vector<double> > values;
+    REQUIRE(calib.GetCalib(values, "/test/test_vars/test_table"));
+
+    ConstantsView view;
+    REQUIRE(view.IsEmpty());
+    REQUIRE_FALSE(calib.GetCalib(view, "/test/test_vars/no_such_table"));
+    REQUIRE(calib.GetCalib(view, "/test/test_vars/test_table"));
+    REQUIRE_FALSE(view.IsEmpty());
+
+    REQUIRE(view.GetRowsCount() == values.size());
+    REQUIRE(view.GetColumnsCount() == 3);
+    REQUIRE(view.GetColumnNames()[1] == "y");
+    REQUIRE(view.GetColumnIndex("z") == 2);
+    REQUIRE(view.GetColumnIndex("w") == -1);
+    REQUIRE(view.GetColumnType(0) == ConstantsTypeColumn::cDoubleColumn);
+    REQUIRE_THROWS(view(0, "w"));
+
+    for(size_t row = 0; row < values.size(); row++)
+    {
+        DoubleSpan rowSpan = view.GetRow(row);
+        REQUIRE(rowSpan.size() == 3);
+        for(size_t column = 0; column < 3; column++)
+        {
+            REQUIRE(view(row, column) == values[row][column]);
+            REQUIRE(rowSpan[column] == values[row][column]);
+            REQUIRE(view.GetColumn(column)[row] == values[row][column]);
+        }
+        REQUIRE(view(row, "y") == values[row][1]);
+    }
+    DoubleSpan zColumn = view.GetColumn("z");
+    REQUIRE(zColumn.size() == values.size());
+    REQUIRE(zColumn.begin() + values.size() == zColumn.end());
+
+    //warm request returns the same data, no copies
+    ConstantsView warmView;
+    REQUIRE(calib.GetCalib(warmView, "/test/test_vars/test_table"));
+    REQUIRE(warmView.GetRowMajorData() == view.GetRowMajorData());
+    REQUIRE(warmView.GetColumnMajorData() == view.GetColumnMajorData());
+
+    //the view keeps data alive when the cache drops it
+    calib.GetProvider()->GetAssignmentCache()->Clear();
+    REQUIRE(view(1, 2) == values[1][2]);
+    REQUIRE(view.GetAssignment());
+
+    //the view works without cache too
+    SQLiteCalibration noCacheCalib(100);
+    noCacheCalib.EnableCache(false);
+    REQUIRE(noCacheCalib.Connect(TESTS_SQLITE_STRING));
+    ConstantsView noCacheView;
+    REQUIRE(noCacheCalib.GetCalib(noCacheView, "/test/test_vars/test_table"));
+    REQUIRE(noCacheView(1, "z") == values[1][2]);
+}
+
+
+TEST_CASE("CCDB/UserAPI/SQLite_GetCalibBatch","Many namepaths are read by one provider call")
+{
+    SQLiteCalibration calib(100);
+    calib.EnableCache(true);
+    REQUIRE(calib.Connect(TESTS_SQLITE_STRING));
+    calib.GetProvider()->GetAssignmentCache()->Clear();
+
+    vector<string> namepaths;
+    namepaths.push_back("/test/test_vars/test_table");
+    namepaths.push_back("/test/test_vars/test_table2::test");
+    namepaths.push_back("/test/test_vars/test_table::test");
+    namepaths.push_back("/test/test_vars/no_such_table");
+    namepaths.push_back("/test/test_vars/test_table:600:subtest");
+
+    vector<ConstantsView> views;
+    REQUIRE_FALSE(calib.GetCalibBatch(views, namepaths));
+    REQUIRE(views.size() == namepaths.size());
+    REQUIRE(views[3].IsEmpty());
+
+    //the same as one by one requests
+    for(size_t i = 0; i < namepaths.size(); i++)
+    {
+        if(i == 3) continue;
+        vector<vector<double> > values;
+        REQUIRE(calib.GetCalib(values, namepaths[i]));
+        REQUIRE_FALSE(views[i].IsEmpty());
+        REQUIRE(views[i].GetRowsCount() == values.size());
+        for(size_t row = 0; row < values.size(); row++)
+            for(size_t column = 0; column < values[row].size(); column++)
+                REQUIRE(views[i](row, column) == values[row][column]);
+    }
+
+    //the batch filled the cache, views are the same data
+    ConstantsView view;
+    REQUIRE(calib.GetCalib(view, "/test/test_vars/test_table"));
+    REQUIRE(view.GetRowMajorData() == views[0].GetRowMajorData());
+    REQUIRE(views[0].GetAssignment()->GetId() == 4);
+    REQUIRE(views[4].GetAssignment()->GetId() == 5);
+
+    //warm batch
+    vector<ConstantsView> warmViews;
+    namepaths.erase(namepaths.begin() + 3);
+    REQUIRE(calib.GetCalibBatch(warmViews, namepaths));
+    REQUIRE(warmViews[1].GetRowMajorData() == views[1].GetRowMajorData());
+
+    //no cache
+    SQLiteCalibration noCacheCalib(100);
+    noCacheCalib.EnableCache(false);
+    REQUIRE(noCacheCalib.Connect(TESTS_SQLITE_STRING));
+    vector<ConstantsView> noCacheViews;
+    REQUIRE(noCacheCalib.GetCalibBatch(noCacheViews, namepaths));
+    REQUIRE(noCacheViews[3](1, 2) == views[4](1, 2));
+}
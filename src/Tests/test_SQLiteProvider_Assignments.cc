@@ -8,6 +8,11 @@
 #include "CCDB/Model/Variation.h"
 #include "CCDB/Model/Directory.h"
 
+#include <fstream>
+#include <algorithm>
+#include <stdio.h>
+#include <time.h>
+
 using namespace std;
 using namespace ccdb;
 
@@ -81,3 +86,432 @@ TEST_CASE("CCDB/SQLiteDataProvider/Assignments","Assignments tests")
 	REQUIRE(Assignment::DecodeBlobSeparator("30e-2") == "30e-2");	
 	
 }
+
+
+/********************************************************************* ** 
+ * @brief Test of metadata catalog that is used by GetAssignmentShort
+ */
+TEST_CASE("CCDB/SQLiteDataProvider/Catalog","Type tables and variations are read once and shared")
+{
+	DataProvider *prov = new SQLiteDataProvider();
+	if(!prov->Connect(TESTS_SQLITE_STRING)) return;
+
+	//type table has columns and is the same object for each request
+	ConstantsTypeTable *table = prov->GetCatalogTypeTable("/test/test_vars/test_table");
+	REQUIRE(table != NULL);
+	REQUIRE(table->GetColumns().size() == 3);
+	REQUIRE(prov->GetCatalogTypeTable("/test/test_vars/test_table") == table);
+	REQUIRE(prov->GetCatalogTypeTable("/test/test_vars/not_existing_table") == NULL);
+
+	//variation chain goes from the variation to the default
+	const vector<Variation *> *chain = prov->GetCatalogVariationChain("subtest");
+	REQUIRE(chain != NULL);
+	REQUIRE(chain->size() == 3);
+	REQUIRE((*chain)[0]->GetName() == "subtest");
+	REQUIRE((*chain)[1]->GetName() == "test");
+	REQUIRE((*chain)[2]->GetName() == "default");
+	REQUIRE(prov->GetCatalogVariationChain("subtest") == chain);
+	REQUIRE(prov->GetCatalogVariationChain("not_existing_variation") == NULL);
+
+	//assignments share the table and don't delete it
+	Assignment *assignment = prov->GetAssignmentShort(100, "/test/test_vars/test_table", "subtest");
+	REQUIRE(assignment != NULL);
+	REQUIRE(assignment->GetTypeTable() == table);
+	REQUIRE(assignment->GetMappedData().size() == 2);
+	delete assignment;
+
+	assignment = prov->GetAssignmentShort(100, "/test/test_vars/test_table", "default", true);
+	REQUIRE(assignment != NULL);
+	REQUIRE(assignment->GetTypeTable() == table);
+	REQUIRE(table->GetColumns().size() == 3);
+	delete assignment;
+
+	//the table is read again after the catalog is cleared, the not changed table is reused
+	prov->ClearCatalog();
+	REQUIRE(prov->GetCatalogTypeTable("/test/test_vars/test_table") == table);
+	prov->Disconnect();
+	REQUIRE(prov->Connect(TESTS_SQLITE_STRING));
+	REQUIRE(prov->GetCatalogTypeTable("/test/test_vars/test_table") == table);
+	REQUIRE(prov->IsOwner(table));
+	REQUIRE(table->GetColumns().size() == 3);
+
+	delete prov;
+}
+
+
+/********************************************************************* ** 
+ * @brief Test of variation fallback over deep variation tree
+ *
+ * The test database is copied and the variations tree
+ * default <- test <- subtest <- deep1 <- deep2 <- deep3 <- deep4 <- deep5
+ * is added with assignments of /test/test_vars/test_table
+ */
+TEST_CASE("CCDB/SQLiteDataProvider/DeepVariations","Assignment of the nearest variation in the chain is selected")
+{
+	string dbPath = "ccdb_test_deep_variations.sqlite";
+	{
+		ifstream src((string(getenv("CCDB_HOME")) + "/sql/ccdb.sqlite").c_str(), ios::binary);
+		ofstream dst(dbPath.c_str(), ios::binary | ios::trunc);
+		dst << src.rdbuf();
+	}
+
+	sqlite3 *db = NULL;
+	REQUIRE(sqlite3_open(dbPath.c_str(), &db) == SQLITE_OK);
+	const char *fill =
+		"INSERT INTO variations (id, name, parentId) VALUES (10, 'deep1', 4), (11, 'deep2', 10), (12, 'deep3', 11), (13, 'deep4', 12), (14, 'deep5', 13);"
+		"INSERT INTO constantSets (id, vault, constantTypeId) VALUES (100, '1|1|1|1|1|1', 1), (101, '2|2|2|2|2|2', 1), (102, '3|3|3|3|3|3', 1), (103, '4|4|4|4|4|4', 1);"
+		//deep2 has two assignments for all runs, the later one wins
+		"INSERT INTO assignments (id, created, variationId, runRangeId, constantSetId) VALUES (100, '2013-01-01 00:00:00', 11, 1, 100);"
+		"INSERT INTO assignments (id, created, variationId, runRangeId, constantSetId) VALUES (101, '2013-01-02 00:00:00', 11, 1, 101);"
+		//deep4 has assignment only for runs 500-3000
+		"INSERT INTO assignments (id, created, variationId, runRangeId, constantSetId) VALUES (102, '2013-01-03 00:00:00', 13, 2, 102);"
+		//deep1 has assignment with bigger id, but deep2 is nearer to deep5
+		"INSERT INTO assignments (id, created, variationId, runRangeId, constantSetId) VALUES (103, '2013-01-04 00:00:00', 10, 1, 103);";
+	REQUIRE(sqlite3_exec(db, fill, NULL, NULL, NULL) == SQLITE_OK);
+	sqlite3_close(db);
+
+	DataProvider *prov = new SQLiteDataProvider();
+	REQUIRE(prov->Connect("sqlite://" + dbPath));
+
+	const vector<Variation *> *chain = prov->GetCatalogVariationChain("deep5");
+	REQUIRE(chain != NULL);
+	REQUIRE(chain->size() == 8);
+	REQUIRE(chain->back()->GetName() == "default");
+
+	//run 100: deep4 and deep3 have nothing, deep2 has two assignments
+	Assignment *assignment = prov->GetAssignmentShort(100, "/test/test_vars/test_table", "deep5");
+	REQUIRE(assignment != NULL);
+	REQUIRE(assignment->GetId() == 101);
+	REQUIRE(assignment->GetVectorData()[0] == "2");
+	REQUIRE(prov->GetAssignmentIdShort(100, "/test/test_vars/test_table", 0, "deep5") == 101);
+	delete assignment;
+
+	//run 600: deep4 has assignment
+	assignment = prov->GetAssignmentShort(600, "/test/test_vars/test_table", "deep5");
+	REQUIRE(assignment != NULL);
+	REQUIRE(assignment->GetId() == 102);
+	REQUIRE(prov->GetAssignmentIdShort(600, "/test/test_vars/test_table", 0, "deep5") == 102);
+	delete assignment;
+
+	//requested variation is in the middle of the tree
+	REQUIRE(prov->GetAssignmentIdShort(100, "/test/test_vars/test_table", 0, "deep1") == 103);
+	REQUIRE(prov->GetAssignmentIdShort(600, "/test/test_vars/test_table", 0, "test") == 2);
+	REQUIRE(prov->GetAssignmentIdShort(100, "/test/test_vars/test_table", 0, "test") == 4);
+
+	//before deep variations were filled, the data comes from subtest
+	struct tm beforeDeep = {0};
+	beforeDeep.tm_year = 2012 - 1900;
+	beforeDeep.tm_mon = 11;
+	beforeDeep.tm_mday = 1;
+	beforeDeep.tm_isdst = -1;
+	time_t time = mktime(&beforeDeep);
+	assignment = prov->GetAssignmentShort(100, "/test/test_vars/test_table", time, "deep5");
+	REQUIRE(assignment != NULL);
+	REQUIRE(assignment->GetId() == 5);
+	REQUIRE(prov->GetAssignmentIdShort(100, "/test/test_vars/test_table", time, "deep5") == 5);
+	delete assignment;
+
+	//table2 has assignments only in default and test
+	REQUIRE(prov->GetAssignmentIdShort(100, "/test/test_vars/test_table2", 0, "deep5") == 3);
+
+	delete prov;
+	remove(dbPath.c_str());
+}
+
+
+/********************************************************************* ** 
+ * @brief Run range index gives the same assignments as SQL lookup
+ *
+ * The deep variations database is used, it has overlapped run ranges,
+ * several assignments of one variation and assignments created at different times
+ */
+TEST_CASE("CCDB/SQLiteDataProvider/RunRangeIndex","Run range index lookups are the same as SQL lookups")
+{
+	string dbPath = "ccdb_test_run_range_index.sqlite";
+	{
+		ifstream src((string(getenv("CCDB_HOME")) + "/sql/ccdb.sqlite").c_str(), ios::binary);
+		ofstream dst(dbPath.c_str(), ios::binary | ios::trunc);
+		dst << src.rdbuf();
+	}
+
+	sqlite3 *db = NULL;
+	REQUIRE(sqlite3_open(dbPath.c_str(), &db) == SQLITE_OK);
+	const char *fill =
+		"INSERT INTO variations (id, name, parentId) VALUES (10, 'deep1', 4), (11, 'deep2', 10);"
+		"INSERT INTO runRanges (id, name, runMin, runMax) VALUES (100, '', 1000, 1999), (101, '', 1500, 1500), (102, '', 2000, 2000);"
+		"INSERT INTO constantSets (id, vault, constantTypeId) VALUES (100, '1|1|1|1|1|1', 1), (101, '2|2|2|2|2|2', 1), (102, '3|3|3|3|3|3', 1), (103, '4|4|4|4|4|4', 1);"
+		"INSERT INTO assignments (id, created, variationId, runRangeId, constantSetId) VALUES (100, '2013-01-01 00:00:00', 11, 100, 100);"
+		"INSERT INTO assignments (id, created, variationId, runRangeId, constantSetId) VALUES (101, '2013-01-02 00:00:00', 11, 101, 101);"
+		"INSERT INTO assignments (id, created, variationId, runRangeId, constantSetId) VALUES (102, '2013-01-03 00:00:00', 11, 102, 102);"
+		"INSERT INTO assignments (id, created, variationId, runRangeId, constantSetId) VALUES (103, '2013-01-04 00:00:00', 10, 2, 103);";
+	REQUIRE(sqlite3_exec(db, fill, NULL, NULL, NULL) == SQLITE_OK);
+	sqlite3_close(db);
+
+	DataProvider *prov = new SQLiteDataProvider();
+	REQUIRE(prov->Connect("sqlite://" + dbPath));
+	REQUIRE_FALSE(prov->IsRunRangeIndexEnabled());
+
+	//time limits: no limit, before the deep variations, between their assignments
+	vector<time_t> times;
+	times.push_back(0);
+	struct tm limit = {0};
+	limit.tm_year = 2012 - 1900;
+	limit.tm_mon = 11;
+	limit.tm_mday = 1;
+	limit.tm_isdst = -1;
+	times.push_back(mktime(&limit));
+	limit.tm_year = 2013 - 1900;
+	limit.tm_mon = 0;
+	limit.tm_mday = 2;
+	limit.tm_hour = 12;
+	limit.tm_isdst = -1;
+	times.push_back(mktime(&limit));
+
+	int runArr[] = {0, 100, 499, 500, 999, 1000, 1499, 1500, 1501, 1999, 2000, 2001, 3000, 3001, 10000, 2147483647};
+	vector<int> runs(runArr, runArr + sizeof(runArr)/sizeof(int));
+	const char *variationArr[] = {"default", "test", "subtest", "deep1", "deep2"};
+	vector<string> variations(variationArr, variationArr + 5);
+	const char *pathArr[] = {"/test/test_vars/test_table", "/test/test_vars/test_table2"};
+	vector<string> paths(pathArr, pathArr + 2);
+
+	//reference ids by SQL
+	vector<dbkey_t> expected;
+	for(size_t p = 0; p < paths.size(); p++)
+		for(size_t v = 0; v < variations.size(); v++)
+			for(size_t t = 0; t < times.size(); t++)
+				for(size_t r = 0; r < runs.size(); r++)
+					expected.push_back(prov->GetAssignmentIdShort(runs[r], paths[p], times[t], variations[v]));
+
+	prov->EnableRunRangeIndex(true);
+	REQUIRE(prov->IsRunRangeIndexEnabled());
+
+	size_t index = 0;
+	size_t mismatches = 0;
+	for(size_t p = 0; p < paths.size(); p++)
+		for(size_t v = 0; v < variations.size(); v++)
+			for(size_t t = 0; t < times.size(); t++)
+				for(size_t r = 0; r < runs.size(); r++, index++)
+				{
+					if(prov->GetAssignmentIdShort(runs[r], paths[p], times[t], variations[v]) != expected[index]) mismatches++;
+				}
+	REQUIRE(mismatches == 0);
+
+	//overlapped ranges of one variation: the newest wins
+	REQUIRE(prov->GetAssignmentIdShort(1500, "/test/test_vars/test_table", 0, "deep2") == 101);
+	REQUIRE(prov->GetAssignmentIdShort(1501, "/test/test_vars/test_table", 0, "deep2") == 100);
+	REQUIRE(prov->GetAssignmentIdShort(2000, "/test/test_vars/test_table", 0, "deep2") == 102);
+	REQUIRE(prov->GetAssignmentIdShort(2500, "/test/test_vars/test_table", 0, "deep2") == 103);
+
+	//the data is read by the indexed id
+	Assignment *assignment = prov->GetAssignmentShort(1500, "/test/test_vars/test_table", "deep2");
+	REQUIRE(assignment != NULL);
+	REQUIRE(assignment->GetId() == 101);
+	REQUIRE(assignment->GetRequestedRun() == 1500);
+	REQUIRE(assignment->GetVectorData()[0] == "2");
+	delete assignment;
+
+	//the index is read once, new assignments are seen after it is cleared
+	REQUIRE(sqlite3_open(dbPath.c_str(), &db) == SQLITE_OK);
+	REQUIRE(sqlite3_exec(db, "INSERT INTO assignments (id, created, variationId, runRangeId, constantSetId) VALUES (104, '2013-01-05 00:00:00', 11, 101, 100);", NULL, NULL, NULL) == SQLITE_OK);
+	sqlite3_close(db);
+	REQUIRE(prov->GetAssignmentIdShort(1500, "/test/test_vars/test_table", 0, "deep2") == 101);
+	prov->ClearRunRangeIndex();
+	REQUIRE(prov->GetAssignmentIdShort(1500, "/test/test_vars/test_table", 0, "deep2") == 104);
+
+	prov->EnableRunRangeIndex(false);
+	REQUIRE(prov->GetAssignmentIdShort(1500, "/test/test_vars/test_table", 0, "deep2") == 104);
+
+	delete prov;
+	remove(dbPath.c_str());
+}
+
+
+/********************************************************************* ** 
+ * @brief Lookups by assignments.constantTypeId are the same as lookups by constantSets
+ *
+ * The test database has schema version 5 (sql/update_1.00_1.01.sqlite.sql).
+ * Its copy with version 4 is read by the old queries
+ */
+TEST_CASE("CCDB/SQLiteDataProvider/AssignmentTypeIds","Assignments keep type table id of their constant sets")
+{
+	string dbPath = "ccdb_test_assignment_type_ids.sqlite";
+	{
+		ifstream src((string(getenv("CCDB_HOME")) + "/sql/ccdb.sqlite").c_str(), ios::binary);
+		ofstream dst(dbPath.c_str(), ios::binary | ios::trunc);
+		dst << src.rdbuf();
+	}
+
+	//the triggers fill constantTypeId of new assignments
+	sqlite3 *db = NULL;
+	REQUIRE(sqlite3_open(dbPath.c_str(), &db) == SQLITE_OK);
+	const char *fill =
+		"INSERT INTO constantSets (id, vault, constantTypeId) VALUES (100, '1|1|1|1|1|1', 1), (101, '2|2|2', 2);"
+		"INSERT INTO assignments (id, created, variationId, runRangeId, constantSetId) VALUES (100, '2013-01-01 00:00:00', 4, 2, 100);"
+		"INSERT INTO assignments (id, created, variationId, runRangeId, constantSetId) VALUES (101, '2013-01-02 00:00:00', 1, 3, 101);";
+	REQUIRE(sqlite3_exec(db, fill, NULL, NULL, NULL) == SQLITE_OK);
+
+	sqlite3_stmt *statement = NULL;
+	REQUIRE(sqlite3_prepare_v2(db, "SELECT count(*) FROM assignments INNER JOIN constantSets ON assignments.constantSetId = constantSets.id "
+		"WHERE assignments.constantTypeId IS NULL OR assignments.constantTypeId <> constantSets.constantTypeId", -1, &statement, 0) == SQLITE_OK);
+	REQUIRE(sqlite3_step(statement) == SQLITE_ROW);
+	REQUIRE(sqlite3_column_int(statement, 0) == 0);
+	sqlite3_finalize(statement);
+
+	const char *variationArr[] = {"default", "test", "subtest"};
+	const char *pathArr[] = {"/test/test_vars/test_table", "/test/test_vars/test_table2"};
+	int runArr[] = {0, 100, 499, 500, 2000, 2001, 3000, 3001};
+	vector<dbkey_t> byTypeIds, byConstantSets;
+
+	for(int version = 5; version >= 4; version--)
+	{
+		if(version == 4) REQUIRE(sqlite3_exec(db, "UPDATE schemaVersions SET schemaVersion=4 WHERE id=1;", NULL, NULL, NULL) == SQLITE_OK);
+
+		DataProvider *prov = new SQLiteDataProvider();
+		REQUIRE(prov->Connect("sqlite://" + dbPath));
+		REQUIRE(prov->GetSchemaVersion() == version);
+		REQUIRE(prov->HasAssignmentTypeIds() == (version == 5));
+
+		vector<dbkey_t>& ids = (version == 5) ? byTypeIds : byConstantSets;
+		for(size_t p = 0; p < 2; p++)
+			for(size_t v = 0; v < 3; v++)
+				for(size_t r = 0; r < sizeof(runArr)/sizeof(int); r++)
+					ids.push_back(prov->GetAssignmentIdShort(runArr[r], pathArr[p], 0, variationArr[v]));
+
+		//the blob is read by the same query
+		Assignment *assignment = prov->GetAssignmentShort(600, "/test/test_vars/test_table", "subtest");
+		REQUIRE(assignment != NULL);
+		REQUIRE(assignment->GetId() == 100);
+		REQUIRE(assignment->GetVectorData()[0] == "1");
+		delete assignment;
+
+		delete prov;
+	}
+	sqlite3_close(db);
+
+	REQUIRE(byTypeIds == byConstantSets);
+	REQUIRE(find(byTypeIds.begin(), byTypeIds.end(), 101) != byTypeIds.end());
+
+	remove(dbPath.c_str());
+}
+
+
+/********************************************************************* ** 
+ * @brief Batch of type tables gives the same assignments as lookups one by one
+ *
+ * There are more type tables than one batch query takes, so the batch is split
+ */
+TEST_CASE("CCDB/SQLiteDataProvider/AssignmentsBatch","Many type tables are resolved by one query")
+{
+	string dbPath = "ccdb_test_assignments_batch.sqlite";
+	{
+		ifstream src((string(getenv("CCDB_HOME")) + "/sql/ccdb.sqlite").c_str(), ios::binary);
+		ofstream dst(dbPath.c_str(), ios::binary | ios::trunc);
+		dst << src.rdbuf();
+	}
+
+	//even tables have data in default for all runs, odd tables in test for runs 500-3000,
+	//each third table has the second, newer assignment
+	sqlite3 *db = NULL;
+	REQUIRE(sqlite3_open(dbPath.c_str(), &db) == SQLITE_OK);
+	string fill = "BEGIN;";
+	int tablesCount = 200;
+	for(int i = 0; i < tablesCount; i++)
+	{
+		int id = 100 + i;
+		fill += StringUtils::Format("INSERT INTO typeTables (id, directoryId, name, nRows, nColumns) VALUES (%i, 3, 'batch_%i', 1, 1);", id, i);
+		fill += StringUtils::Format("INSERT INTO columns (id, name, typeId, columnType, \"order\") VALUES (%i, 'x', %i, 'double', 0);", id, id);
+		fill += StringUtils::Format("INSERT INTO constantSets (id, vault, constantTypeId) VALUES (%i, '%i', %i);", id, i, id);
+		fill += StringUtils::Format("INSERT INTO assignments (id, created, variationId, runRangeId, constantSetId) VALUES (%i, '2013-01-01 00:00:00', %i, %i, %i);",
+		                            id, i % 2 ? 3 : 1, i % 2 ? 2 : 1, id);
+		if(i % 3 == 0)
+		{
+			fill += StringUtils::Format("INSERT INTO constantSets (id, vault, constantTypeId) VALUES (%i, '%i', %i);", 1000 + id, 1000 + i, id);
+			fill += StringUtils::Format("INSERT INTO assignments (id, created, variationId, runRangeId, constantSetId) VALUES (%i, '2013-01-03 00:00:00', %i, %i, %i);",
+			                            1000 + id, i % 2 ? 3 : 1, i % 2 ? 2 : 1, 1000 + id);
+		}
+	}
+	fill += "COMMIT;";
+	REQUIRE(sqlite3_exec(db, fill.c_str(), NULL, NULL, NULL) == SQLITE_OK);
+
+	//paths of all tables, the original ones, not existing and repeated
+	vector<string> paths;
+	for(int i = 0; i < tablesCount; i++) paths.push_back(StringUtils::Format("/test/test_vars/batch_%i", i));
+	paths.push_back("/test/test_vars/test_table");
+	paths.push_back("/test/test_vars/test_table2");
+	paths.push_back("/test/test_vars/no_such_table");
+	paths.push_back("/test/test_vars/batch_3");
+
+	struct tm limit = {0};
+	limit.tm_year = 2013 - 1900;
+	limit.tm_mon = 0;
+	limit.tm_mday = 2;
+	limit.tm_isdst = -1;
+	time_t times[] = {0, mktime(&limit)};
+	int runs[] = {100, 600};
+	const char *variations[] = {"default", "test", "subtest"};
+
+	for(int version = 5; version >= 4; version--)
+	{
+		if(version == 4) REQUIRE(sqlite3_exec(db, "UPDATE schemaVersions SET schemaVersion=4 WHERE id=1;", NULL, NULL, NULL) == SQLITE_OK);
+
+		DataProvider *prov = new SQLiteDataProvider();
+		REQUIRE(prov->Connect("sqlite://" + dbPath));
+		REQUIRE(prov->HasAssignmentTypeIds() == (version == 5));
+
+		size_t mismatches = 0;
+		size_t foundCount = 0;
+		for(size_t t = 0; t < 2; t++)
+			for(size_t r = 0; r < 2; r++)
+				for(size_t v = 0; v < 3; v++)
+				{
+					vector<Assignment *> batch;
+					REQUIRE(prov->GetAssignmentsShortBatch(batch, runs[r], paths, times[t], variations[v]));
+					REQUIRE(batch.size() == paths.size());
+					REQUIRE(prov->GetLastError() == CCDB_ERROR_NO_TYPETABLE);
+
+					for(size_t i = 0; i < paths.size(); i++)
+					{
+						Assignment *single = prov->GetAssignmentShort(runs[r], paths[i], times[t], variations[v]);
+						if(!single != !batch[i]) mismatches++;
+						if(single && batch[i])
+						{
+							foundCount++;
+							if(single->GetId() != batch[i]->GetId() || single->GetRawData() != batch[i]->GetRawData()) mismatches++;
+							if(batch[i]->GetRequestedRun() != runs[r] || batch[i]->GetTypeTable() != single->GetTypeTable()) mismatches++;
+						}
+						delete single;
+						delete batch[i];
+					}
+				}
+		REQUIRE(mismatches == 0);
+		REQUIRE(foundCount > 0);
+
+		//the newest assignment of the nearest variation
+		vector<Assignment *> batch;
+		REQUIRE(prov->GetAssignmentsShortBatch(batch, 600, paths, 0, "subtest"));
+		REQUIRE(batch[0]->GetId() == 1100);
+		REQUIRE(batch[1]->GetId() == 101);
+		REQUIRE(batch[3]->GetVectorData()[0] == "1003");
+		REQUIRE(batch[tablesCount + 2] == NULL);
+		REQUIRE(batch[tablesCount + 3] != batch[3]);
+		REQUIRE(batch[tablesCount + 3]->GetRawData() == batch[3]->GetRawData());
+		for(size_t i = 0; i < batch.size(); i++) delete batch[i];
+
+		//run range index gives the same
+		prov->EnableRunRangeIndex(true);
+		REQUIRE(prov->GetAssignmentsShortBatch(batch, 600, paths, 0, "subtest"));
+		REQUIRE(batch[0]->GetId() == 1100);
+		REQUIRE(batch[3]->GetVectorData()[0] == "1003");
+		for(size_t i = 0; i < batch.size(); i++) delete batch[i];
+
+		//no variation is an error of the whole batch
+		REQUIRE_FALSE(prov->GetAssignmentsShortBatch(batch, 600, paths, 0, "no_such_variation"));
+		REQUIRE(batch.size() == paths.size());
+		REQUIRE(count(batch.begin(), batch.end(), (Assignment *)NULL) == (int)paths.size());
+
+		delete prov;
+	}
+	sqlite3_close(db);
+
+	remove(dbPath.c_str());
+}
@@ -5,6 +5,10 @@
 #include "CCDB/Console.h"
 #include "CCDB/Providers/SQLiteDataProvider.h"
 
+#include <memory>
+#include <fstream>
+#include <stdlib.h>
+
 
 using namespace std;
 using namespace ccdb;
@@ -41,3 +45,141 @@ TEST_CASE("CCDB/SQLiteDataProvider/Connection","Connection tests")
 	prov->Disconnect();
 	delete prov;
 }
+
+
+/********************************************************************* ** 
+ * @brief Test open options of the connection string
+ *
+ * @return true if test passed
+ */
+TEST_CASE("CCDB/SQLiteDataProvider/ConnectionOptions","Open options in connection string")
+{
+	SQLiteDataProvider prov;
+
+	//options are applied to the main connection and to the pool
+	string connectionString = string(TESTS_SQLITE_STRING) + "?immutable=1&nolock=1&mmap_size=1048576&cache_size=-4096";
+	REQUIRE(prov.Connect(connectionString));
+	REQUIRE(prov.GetConnectionString() == connectionString);
+	REQUIRE(prov.GetAssignmentIdShort(100, "/test/test_vars/test_table", 0, "default") > 0);
+	ConstantsTypeTable *table = prov.GetConstantsTypeTable("/test/test_vars/test_table", true);
+	REQUIRE(table != NULL);
+	REQUIRE(table->GetColumns().size() == 3);
+	prov.Disconnect();
+
+	//options that are turned off
+	REQUIRE(prov.Connect(string(TESTS_SQLITE_STRING) + "?immutable=0&mmap_size=0"));
+	REQUIRE(prov.GetAssignmentIdShort(100, "/test/test_vars/test_table", 0, "default") > 0);
+	prov.Disconnect();
+
+	//unknown options and invalid values
+	REQUIRE_FALSE(prov.Connect(string(TESTS_SQLITE_STRING) + "?no_such_option=1"));
+	REQUIRE(prov.GetLastError() == CCDB_ERROR_PARSE_CONNECTION_STRING);
+	REQUIRE_FALSE(prov.Connect(string(TESTS_SQLITE_STRING) + "?mmap_size=big"));
+	REQUIRE_FALSE(prov.Connect(string(TESTS_SQLITE_STRING) + "?immutable=yes"));
+	REQUIRE_FALSE(prov.IsConnected());
+
+	//missing file is reported with options too
+	REQUIRE_FALSE(prov.Connect("sqlite://no_such_dir/no_such_file.sqlite?immutable=1"));
+	REQUIRE(prov.GetLastError() == CCDB_ERROR_CONNECTION_EXTERNAL_ERROR);
+}
+
+
+/********************************************************************* **
+ * @brief Database is read to memory on connect
+ *
+ * @return true if test passed
+ */
+TEST_CASE("CCDB/SQLiteDataProvider/InMemory","Database file is read to memory")
+{
+	//SQLite without sqlite3_deserialize copies the file by the backup API
+	REQUIRE(SQLiteDataProvider::IsInMemorySupported());
+
+	SQLiteDataProvider prov;
+	SQLiteDataProvider fileProv;
+	REQUIRE(fileProv.Connect(TESTS_SQLITE_STRING));
+	REQUIRE(prov.Connect(string(TESTS_SQLITE_STRING) + "?inmemory=1&cache_size=-4096"));
+
+	//the main connection and pooled connections read the same data as the file
+	int runs[] = {0, 100, 499, 500, 2000, 3000, 3001, 10000};
+	for(size_t i = 0; i < sizeof(runs)/sizeof(runs[0]); i++)
+	{
+		dbkey_t id = fileProv.GetAssignmentIdShort(runs[i], "/test/test_vars/test_table", 0, "subtest");
+		REQUIRE(prov.GetAssignmentIdShort(runs[i], "/test/test_vars/test_table", 0, "subtest") == id);
+
+		unique_ptr<Assignment> expected(fileProv.GetAssignmentShort(runs[i], "/test/test_vars/test_table", "subtest"));
+		unique_ptr<Assignment> assignment(prov.GetAssignmentShort(runs[i], "/test/test_vars/test_table", "subtest"));
+		REQUIRE(assignment.get() != NULL);
+		REQUIRE(assignment->GetRawData() == expected->GetRawData());
+	}
+	ConstantsTypeTable *table = prov.GetConstantsTypeTable("/test/test_vars/test_table", true);
+	REQUIRE(table != NULL);
+	REQUIRE(table->GetColumns().size() == 3);
+	delete table;
+	prov.Disconnect();
+
+	//queries don't touch the file, it may be removed
+	string dbPath = "ccdb_test_inmemory.sqlite";
+	{
+		ifstream src((string(getenv("CCDB_HOME")) + "/sql/ccdb.sqlite").c_str(), ios::binary);
+		ofstream dst(dbPath.c_str(), ios::binary | ios::trunc);
+		dst << src.rdbuf();
+	}
+	REQUIRE(prov.Connect("sqlite://" + dbPath + "?inmemory=1"));
+	remove(dbPath.c_str());
+	REQUIRE(prov.GetAssignmentIdShort(100, "/test/test_vars/test_table", 0, "subtest") == fileProv.GetAssignmentIdShort(100, "/test/test_vars/test_table", 0, "subtest"));
+	prov.Disconnect();
+
+	//the file is bigger than the limit
+	REQUIRE_FALSE(prov.Connect(string(TESTS_SQLITE_STRING) + "?inmemory=1&inmemory_max_bytes=1024"));
+	REQUIRE(prov.GetLastError() == CCDB_ERROR_CONNECTION_INITIALIZATION);
+	REQUIRE(prov.Connect(string(TESTS_SQLITE_STRING) + "?inmemory=1&inmemory_max_bytes=1000000000"));
+	prov.Disconnect();
+
+	//invalid values, missing file and a file that is not a database
+	REQUIRE_FALSE(prov.Connect(string(TESTS_SQLITE_STRING) + "?inmemory=yes"));
+	REQUIRE(prov.GetLastError() == CCDB_ERROR_PARSE_CONNECTION_STRING);
+	REQUIRE_FALSE(prov.Connect("sqlite://no_such_dir/no_such_file.sqlite?inmemory=1"));
+	REQUIRE(prov.GetLastError() == CCDB_ERROR_CONNECTION_EXTERNAL_ERROR);
+	REQUIRE_FALSE(prov.Connect("sqlite://" + string(getenv("CCDB_HOME")) + "/sql/ccdb.mysql.sql?inmemory=1"));
+	REQUIRE(prov.GetLastError() == CCDB_ERROR_CONNECTION_EXTERNAL_ERROR);
+	REQUIRE_FALSE(prov.IsConnected());
+}
+
+
+/********************************************************************* **
+ * @brief Prepared statements are reused and are finalized on disconnect
+ *
+ * @return true if test passed
+ */
+TEST_CASE("CCDB/SQLiteDataProvider/CachedStatements","Prepared statements are cached by connection")
+{
+	SQLiteDataProvider prov;
+	if(!prov.Connect(TESTS_SQLITE_STRING)) return;
+
+	//the same queries take the cached statements, no new statements are prepared
+	unique_ptr<ConstantsTypeTable> table(prov.GetConstantsTypeTable("/test/test_vars/test_table", true));
+	REQUIRE(table.get() != NULL);
+	size_t statementsCount = prov.GetCachedStatementsCount();
+	REQUIRE(statementsCount > 0);
+	for(int i = 0; i < 3; i++)
+	{
+		unique_ptr<ConstantsTypeTable> sameTable(prov.GetConstantsTypeTable("/test/test_vars/test_table", true));
+		REQUIRE(sameTable.get() != NULL);
+		REQUIRE(sameTable->GetColumns().size() == 3);
+	}
+	REQUIRE(prov.GetCachedStatementsCount() == statementsCount);
+
+	//statements are finalized on disconnect, otherwise the database is not closed
+	prov.Disconnect();
+	REQUIRE(prov.GetCachedStatementsCount() == 0);
+	REQUIRE(prov.GetPooledConnectionsCount() == 0);
+	REQUIRE_FALSE(prov.IsConnected());
+
+	//statements are prepared again for the new connection
+	REQUIRE(prov.Connect(TESTS_SQLITE_STRING));
+	table.reset(prov.GetConstantsTypeTable("/test/test_vars/test_table2", true));
+	REQUIRE(table.get() != NULL);
+	REQUIRE(prov.GetCachedStatementsCount() == statementsCount);
+	prov.Disconnect();
+	REQUIRE(prov.GetCachedStatementsCount() == 0);
+}
@@ -0,0 +1,206 @@
+#pragma warning(disable:4800)
+#include "Tests/catch.hpp"
+#include "Tests/tests.h"
+
+#include <thread>
+#include <atomic>
+#include <memory>
+
+#include "CCDB/Providers/SQLiteDataProvider.h"
+#include "CCDB/SQLiteCalibration.h"
+
+
+using namespace std;
+using namespace ccdb;
+
+/********************************************************************* **
+ * @brief Many threads read constants through one provider at the same time
+ *
+ * @return true if test passed
+ */
+TEST_CASE("CCDB/SQLiteDataProvider/Threads","Reads of one provider from many threads")
+{
+	SQLiteDataProvider provider;
+	REQUIRE(provider.Connect(TESTS_SQLITE_STRING));
+	REQUIRE(provider.IsReentrant());
+
+	//expected results are read by one thread
+	int runs[] = {0, 100, 499, 500, 2000, 3000, 3001, 10000};
+	const size_t runsCount = sizeof(runs)/sizeof(runs[0]);
+	dbkey_t expectedIds[runsCount];
+	string expectedData[runsCount];
+	for(size_t i = 0; i < runsCount; i++)
+	{
+		unique_ptr<Assignment> assignment(provider.GetAssignmentShort(runs[i], "/test/test_vars/test_table", "subtest"));
+		REQUIRE(assignment.get() != NULL);
+		expectedIds[i] = assignment->GetId();
+		expectedData[i] = assignment->GetRawData();
+	}
+
+	const int threadsCount = 16;
+	atomic<int> errors(0);
+	vector<thread> threads;
+	for(int threadIndex = 0; threadIndex < threadsCount; threadIndex++)
+	{
+		threads.push_back(thread([&, threadIndex]()
+		{
+			for(int i = 0; i < 300; i++)
+			{
+				size_t runIndex = (threadIndex + i) % runsCount;
+				int run = runs[runIndex];
+
+				dbkey_t id = provider.GetAssignmentIdShort(run, "/test/test_vars/test_table", 0, "subtest");
+				if(id != expectedIds[runIndex]) errors++;
+
+				unique_ptr<Assignment> byId(provider.GetAssignmentShortById(id, "/test/test_vars/test_table"));
+				if(!byId || byId->GetRawData() != expectedData[runIndex]) errors++;
+
+				unique_ptr<Assignment> assignment(provider.GetAssignmentShort(run, "/test/test_vars/test_table", "subtest"));
+				if(!assignment || assignment->GetId() != expectedIds[runIndex]) errors++;
+
+				//not existing table is an error, but it doesn't break other threads
+				if(i % 50 == 0 && provider.GetAssignmentIdShort(run, "/test/test_vars/no_such_table", 0, "subtest") != 0) errors++;
+			}
+		}));
+	}
+	for(size_t i = 0; i < threads.size(); i++) threads[i].join();
+
+	REQUIRE(errors == 0);
+	REQUIRE(provider.GetPooledConnectionsCount() >= 1);
+	REQUIRE(provider.GetPooledConnectionsCount() <= (size_t)threadsCount);
+
+	provider.Disconnect();
+	REQUIRE(provider.GetPooledConnectionsCount() == 0);
+}
+
+
+/********************************************************************* **
+ * @brief Many threads read constants through one calibration with cache turned off
+ *
+ * @return true if test passed
+ */
+TEST_CASE("CCDB/SQLiteDataProvider/ThreadsUserAPI","Reads of one calibration from many threads")
+{
+	SQLiteCalibration calib(100);
+	calib.EnableCache(false);
+	REQUIRE(calib.Connect(TESTS_SQLITE_STRING));
+
+	vector<vector<double> > expected;
+	REQUIRE(calib.GetCalib(expected, "/test/test_vars/test_table"));
+
+	atomic<int> errors(0);
+	vector<thread> threads;
+	for(int threadIndex = 0; threadIndex < 16; threadIndex++)
+	{
+		threads.push_back(thread([&]()
+		{
+			for(int i = 0; i < 200; i++)
+			{
+				vector<vector<double> > values;
+				if(!calib.GetCalib(values, "/test/test_vars/test_table") || values != expected) errors++;
+			}
+		}));
+	}
+	for(size_t i = 0; i < threads.size(); i++) threads[i].join();
+
+	REQUIRE(errors == 0);
+}
+
+
+/********************************************************************* **
+ * @brief Requests of GetCalibAsync are read by the worker pool
+ *
+ * @return true if test passed
+ */
+TEST_CASE("CCDB/SQLiteDataProvider/GetCalibAsync","Asynchronous reads of constants")
+{
+    SQLiteCalibration calib(100);
+    calib.EnableCache(false);
+    REQUIRE(calib.Connect(TESTS_SQLITE_STRING));
+
+    vector<vector<double> > expected;
+    REQUIRE(calib.GetCalib(expected, "/test/test_vars/test_table"));
+    vector<map<string, string> > expectedRows;
+    REQUIRE(calib.GetCalib(expectedRows, "/test/test_vars/test_table"));
+
+    //many requests in flight
+    vector<CalibRequest<vector<vector<double> > > > requests;
+    for(int i = 0; i < 100; i++)
+    {
+        requests.push_back(calib.GetCalibAsync<vector<vector<double> > >("/test/test_vars/test_table"));
+    }
+    auto rowsRequest = calib.GetCalibAsync<vector<map<string, string> > >("/test/test_vars/test_table");
+    auto viewRequest = calib.GetCalibAsync<ConstantsView>("/test/test_vars/test_table");
+    auto missingRequest = calib.GetCalibAsync<vector<double> >("/test/test_vars/no_such_table");
+
+    for(size_t i = 0; i < requests.size(); i++)
+    {
+        vector<vector<double> > values;
+        REQUIRE(requests[i].Get(values));
+        REQUIRE(values == expected);
+    }
+    vector<map<string, string> > rows;
+    REQUIRE(rowsRequest.Get(rows));
+    REQUIRE(rows == expectedRows);
+    ConstantsView view;
+    REQUIRE(viewRequest.Get(view));
+    REQUIRE(view.GetRowsCount() == expected.size());
+    vector<double> missing;
+    REQUIRE_FALSE(missingRequest.Get(missing));
+
+    //a request that didn't start may be cancelled. Stop cancels queued requests
+    calib.StopAsyncWorkers();
+    calib.SetAsyncWorkersCount(1);
+    REQUIRE(calib.GetAsyncWorkersCount() == 1);
+    requests.clear();
+    for(int i = 0; i < 200; i++)
+    {
+        requests.push_back(calib.GetCalibAsync<vector<vector<double> > >("/test/test_vars/test_table"));
+    }
+    bool isLastCancelled = requests.back().Cancel();
+    REQUIRE_FALSE(requests.back().Cancel());
+    calib.StopAsyncWorkers();
+
+    int doneCount = 0;
+    int cancelledCount = 0;
+    for(size_t i = 0; i < requests.size(); i++)
+    {
+        REQUIRE(requests[i].IsReady());
+        vector<vector<double> > values;
+        bool isFound = false;
+        try
+        {
+            isFound = requests[i].Get(values);
+        }
+        catch(CalibRequestCancelled&)
+        {
+            cancelledCount++;
+            continue;
+        }
+        REQUIRE(isFound);
+        REQUIRE(values == expected);
+        doneCount++;
+    }
+    REQUIRE(doneCount + cancelledCount == 200);
+    REQUIRE(cancelledCount >= (isLastCancelled ? 1 : 0));
+
+    //a request that waited longer than its timeout is not run
+    calib.SetAsyncWorkersCount(1);
+    vector<CalibRequest<vector<vector<double> > > > slowRequests;
+    for(int i = 0; i < 50; i++)
+    {
+        slowRequests.push_back(calib.GetCalibAsync<vector<vector<double> > >("/test/test_vars/test_table"));
+    }
+    auto timedRequest = calib.GetCalibAsync<vector<vector<double> > >("/test/test_vars/test_table", chrono::milliseconds(1));
+    this_thread::sleep_for(chrono::milliseconds(5));
+    vector<vector<double> > values;
+    try
+    {
+        if(timedRequest.Get(values)) REQUIRE(values == expected);  //the pool could be fast enough
+    }
+    catch(CalibRequestTimeout&)
+    {
+        REQUIRE(values.empty());
+    }
+    for(size_t i = 0; i < slowRequests.size(); i++) REQUIRE(slowRequests[i].Get(values));
+}
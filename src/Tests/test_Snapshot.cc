@@ -0,0 +1,212 @@
+#pragma warning(disable:4800)
+#include "Tests/tests.h"
+#include "Tests/catch.hpp"
+
+#include "CCDB/Providers/SQLiteDataProvider.h"
+#include "CCDB/Providers/SnapshotDataProvider.h"
+#include "CCDB/Providers/SnapshotWriter.h"
+#include "CCDB/SQLiteCalibration.h"
+#include "CCDB/CalibrationGenerator.h"
+
+#include <fstream>
+#include <memory>
+#include <stdio.h>
+#include <time.h>
+
+using namespace std;
+using namespace ccdb;
+
+/********************************************************************* **
+ * @brief Snapshot gives the same assignments as the database it was written from
+ */
+TEST_CASE("CCDB/Snapshot/Provider","Snapshot provider serves the same data as SQLite")
+{
+	string snapshotPath = "ccdb_test_snapshot.tmp";
+
+	SQLiteDataProvider sqlite;
+	if(!sqlite.Connect(TESTS_SQLITE_STRING)) return;
+
+	SnapshotWriter writer(&sqlite);
+	writer.SetVariation("test");
+	writer.AddRuns(0, 5000);
+	writer.AddRuns(4000, 10000);    //overlapped intervals are merged
+	REQUIRE(writer.Write(snapshotPath));
+	REQUIRE(writer.GetWrittenTablesCount() == 2);
+	REQUIRE(writer.GetWrittenAssignmentsCount() == 3);   //assignment of runs 0-499 and 3001-10000 is written once
+
+	SnapshotDataProvider snapshot;
+	REQUIRE(snapshot.Connect("snapshot://" + snapshotPath));
+	REQUIRE(snapshot.IsConnected());
+	REQUIRE(snapshot.GetSnapshotFile().GetVariation() == "test");
+
+	//the same ids and data for each run
+	int runs[] = {0, 100, 499, 500, 2000, 3000, 3001, 10000};
+	for(size_t i = 0; i < sizeof(runs)/sizeof(runs[0]); i++)
+	{
+		dbkey_t id = sqlite.GetAssignmentIdShort(runs[i], "/test/test_vars/test_table", 0, "test");
+		REQUIRE(id > 0);
+		REQUIRE(snapshot.GetAssignmentIdShort(runs[i], "/test/test_vars/test_table", 0, "test") == id);
+
+		Assignment *expected = sqlite.GetAssignmentShort(runs[i], "/test/test_vars/test_table", "test");
+		Assignment *assignment = snapshot.GetAssignmentShort(runs[i], "/test/test_vars/test_table", "test");
+		REQUIRE(assignment != NULL);
+		REQUIRE(assignment->GetId() == expected->GetId());
+		REQUIRE(assignment->GetRawData() == expected->GetRawData());
+		REQUIRE(assignment->GetTypeTable()->GetColumnNames() == expected->GetTypeTable()->GetColumnNames());
+		delete assignment;
+		delete expected;
+	}
+	REQUIRE(snapshot.GetAssignmentIdShort(600, "/test/test_vars/test_table2", 0, "test") == 3);
+
+	//runs, variations and times that are not in the snapshot
+	REQUIRE(snapshot.GetAssignmentIdShort(10001, "/test/test_vars/test_table", 0, "test") == 0);
+	REQUIRE(snapshot.GetAssignmentShort(100, "/test/test_vars/test_table", "default") == NULL);
+	REQUIRE(snapshot.GetLastError() == CCDB_ERROR_VARIATION_INVALID);
+	REQUIRE(snapshot.GetAssignmentShort(100, "/test/test_vars/test_table", 12345, "test") == NULL);
+	REQUIRE(snapshot.GetAssignmentShort(100, "/test/test_vars/no_such_table", "test") == NULL);
+	REQUIRE(snapshot.GetLastError() == CCDB_ERROR_NO_TYPETABLE);
+
+	//type tables
+	ConstantsTypeTable *table = snapshot.GetConstantsTypeTable("/test/test_vars/test_table2", true);
+	REQUIRE(table != NULL);
+	REQUIRE(table->GetName() == "test_table2");
+	REQUIRE(table->GetRowsCount() == 1);
+	REQUIRE(table->GetColumns().size() == 3);
+	REQUIRE(table->GetColumns()[0]->GetType() == ConstantsTypeColumn::cIntColumn);
+	delete table;
+
+	vector<ConstantsTypeTable *> tables;
+	REQUIRE(snapshot.SearchConstantsTypeTables(tables, "test_table*"));
+	REQUIRE(tables.size() == 2);
+	for(size_t i = 0; i < tables.size(); i++) delete tables[i];
+
+	//typed columns
+	const SnapshotFile& file = snapshot.GetSnapshotFile();
+	const SnapshotTable *tableRecord = file.FindTable("/test/test_vars/test_table2");
+	REQUIRE(tableRecord != NULL);
+	const SnapshotAssignment *record = file.FindAssignment(tableRecord, 100);
+	REQUIRE(record != NULL);
+	REQUIRE(record->RowsCount == 1);
+	REQUIRE(file.GetDoubleColumn(tableRecord, record, 1) == NULL);
+	const int64_t *ints = file.GetIntColumn(tableRecord, record, 1);
+	REQUIRE(ints != NULL);
+	REQUIRE(ints[0] == 20);
+
+	tableRecord = file.FindTable("/test/test_vars/test_table");
+	record = file.FindAssignment(tableRecord, 1000);
+	REQUIRE(record != NULL);
+	REQUIRE(record->Id == 2);
+	const double *doubles = file.GetDoubleColumn(tableRecord, record, 0);
+	REQUIRE(doubles != NULL);
+	REQUIRE(doubles[0] == 1.0);
+	REQUIRE(doubles[1] == 4.0);
+
+	//cells as numbers are taken from the typed columns
+	Assignment *expected = sqlite.GetAssignmentShort(1000, "/test/test_vars/test_table", "test");
+	Assignment *assignment = snapshot.GetAssignmentShort(1000, "/test/test_vars/test_table", "test");
+	vector<double> typedValues;
+	REQUIRE(snapshot.GetAssignmentValues(*assignment, typedValues));
+	vector<string> cells = expected->GetVectorData();
+	REQUIRE(typedValues.size() == cells.size());
+	for(size_t i = 0; i < cells.size(); i++) REQUIRE(typedValues[i] == StringUtils::ParseDouble(cells[i]));
+	REQUIRE_FALSE(sqlite.GetAssignmentValues(*expected, typedValues));
+	delete assignment;
+	delete expected;
+
+	assignment = snapshot.GetAssignmentShort(100, "/test/test_vars/test_table2", "test");
+	vector<int> typedInts;
+	REQUIRE(snapshot.GetAssignmentValues(*assignment, typedInts));
+	REQUIRE(typedInts.size() == 3);
+	REQUIRE(typedInts[1] == 20);
+	delete assignment;
+
+	snapshot.Disconnect();
+	REQUIRE(!snapshot.IsConnected());
+
+	//user API through CalibrationGenerator
+	REQUIRE(CalibrationGenerator::CheckOpenable("snapshot://" + snapshotPath));
+	{
+		unique_ptr<Calibration> calib(CalibrationGenerator::CreateCalibration("snapshot://" + snapshotPath, 2000, "test"));
+		SQLiteCalibration sqliteCalib(2000, "test");
+		REQUIRE(sqliteCalib.Connect(TESTS_SQLITE_STRING));
+
+		vector<vector<double> > values;
+		vector<vector<double> > expectedValues;
+		REQUIRE(calib->GetCalib(values, "/test/test_vars/test_table"));
+		REQUIRE(sqliteCalib.GetCalib(expectedValues, "/test/test_vars/test_table"));
+		REQUIRE(values == expectedValues);
+
+		vector<vector<double> > run100Values;
+		vector<vector<double> > run100ExpectedValues;
+		REQUIRE(calib->GetCalib(run100Values, "/test/test_vars/test_table:100"));
+		REQUIRE(sqliteCalib.GetCalib(run100ExpectedValues, "/test/test_vars/test_table:100"));
+		REQUIRE(run100Values == run100ExpectedValues);
+		REQUIRE(run100Values != values);
+
+		vector<vector<int> > intValues;
+		vector<vector<int> > expectedIntValues;
+		REQUIRE(calib->GetCalib(intValues, "/test/test_vars/test_table2"));
+		REQUIRE(sqliteCalib.GetCalib(expectedIntValues, "/test/test_vars/test_table2"));
+		REQUIRE(intValues == expectedIntValues);
+
+		ConstantsView view;
+		REQUIRE(calib->GetCalib(view, "/test/test_vars/test_table"));
+		REQUIRE(view.GetRowsCount() == expectedValues.size());
+		REQUIRE(view.GetColumn("y")[1] == expectedValues[1][1]);
+
+		vector<string> namepaths;
+		calib->GetListOfNamepaths(namepaths);
+		REQUIRE(namepaths.size() == 2);
+
+		//the cache and the Calibration keep the assignment, the provider doesn't own it
+		calib->EnableCache(true);
+		Assignment *assignment = calib->GetAssignment("/test/test_vars/test_table");
+		REQUIRE(assignment != NULL);
+		REQUIRE_FALSE(calib->GetProvider()->IsOwner(assignment));
+		REQUIRE(assignment->GetRawData() == calib->GetAssignmentShared("/test/test_vars/test_table")->GetRawData());
+	}
+
+	remove(snapshotPath.c_str());
+}
+
+
+/********************************************************************* **
+ * @brief Corrupted snapshot is found by checksum
+ */
+TEST_CASE("CCDB/Snapshot/Checksum","Corrupted snapshot is not opened")
+{
+	string snapshotPath = "ccdb_test_snapshot_corrupted.tmp";
+
+	SQLiteDataProvider sqlite;
+	if(!sqlite.Connect(TESTS_SQLITE_STRING)) return;
+
+	SnapshotWriter writer(&sqlite);
+	writer.AddRuns(0, 1000);
+	REQUIRE(writer.Write(snapshotPath));
+
+	//change the last byte, it is a value of the last assignment
+	{
+		fstream file(snapshotPath.c_str(), ios::in | ios::out | ios::binary);
+		file.seekg(-1, ios::end);
+		char last = 0;
+		file.read(&last, 1);
+		last ^= 0x55;
+		file.seekp(-1, ios::end);
+		file.write(&last, 1);
+	}
+
+	SnapshotDataProvider snapshot;
+	REQUIRE_FALSE(snapshot.Connect("snapshot://" + snapshotPath));
+	REQUIRE(snapshot.GetLastError() == CCDB_ERROR_SNAPSHOT_INVALID);
+
+	//check can be skipped, the layout is still checked
+	REQUIRE(snapshot.Connect("snapshot://" + snapshotPath + "?verify=0"));
+	REQUIRE(snapshot.GetAssignmentIdShort(100, "/test/test_vars/test_table", 0, "default") == 4);
+	snapshot.Disconnect();
+
+	//not a snapshot at all
+	REQUIRE_FALSE(snapshot.Connect(TESTS_SQLITE_STRING));
+	REQUIRE_FALSE(snapshot.Connect("snapshot://" + string(getenv("CCDB_HOME")) + "/sql/ccdb.sqlite"));
+
+	remove(snapshotPath.c_str());
+}
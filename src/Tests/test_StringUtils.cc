@@ -3,7 +3,11 @@
 
 #include "Tests/catch.hpp"
 
+#include <locale.h>
+#include <limits>
+
 #include "CCDB/Helpers/StringUtils.h"
+#include "CCDB/Helpers/NumberParsers.h"
 
 
 using namespace std;
@@ -72,4 +76,113 @@ TEST_CASE("CCDB/StringUtils/Split", "Test of lexical splittiong string to tokens
 	REQUIRE(outArray[5] == "30e-2");
 }
 
+TEST_CASE("CCDB/StringUtils/NumberParsers", "Numbers conversion with errors detection")
+{
+	double doubleValue;
+	int intValue;
+	long longValue;
+
+	//fast path
+	REQUIRE(NumberParsers::ParseDouble("-12.345", 7, doubleValue));
+	REQUIRE(doubleValue == -12.345);
+	REQUIRE(NumberParsers::ParseDouble("30e-2", 5, doubleValue));
+	REQUIRE(doubleValue == 0.3);
+	REQUIRE(NumberParsers::ParseDouble(" 0.1234567890123 ", 17, doubleValue));
+	REQUIRE(doubleValue == 0.1234567890123);
+	REQUIRE(NumberParsers::ParseDouble("1234567812345678", 16, doubleValue));
+	REQUIRE(doubleValue == 1234567812345678.0);
+	REQUIRE(NumberParsers::ParseDouble(".5", 2, doubleValue));
+	REQUIRE(doubleValue == 0.5);
+
+	//slow path gives the same as strtod
+	REQUIRE(NumberParsers::ParseDouble("1.7976931348623157e308", 22, doubleValue));
+	REQUIRE(doubleValue == std::numeric_limits<double>::max());
+	REQUIRE(NumberParsers::ParseDouble("0.12345678901234567890123", 25, doubleValue));
+	REQUIRE(doubleValue == 0.12345678901234567890123);
+	REQUIRE(NumberParsers::ParseDouble("nan", 3, doubleValue));
+	REQUIRE(doubleValue != doubleValue);
+	REQUIRE(NumberParsers::ParseDouble("-inf", 4, doubleValue));
+	REQUIRE(doubleValue == -std::numeric_limits<double>::infinity());
+
+	//errors
+	REQUIRE_FALSE(NumberParsers::ParseDouble("", 0, doubleValue));
+	REQUIRE_FALSE(NumberParsers::ParseDouble("12abc", 5, doubleValue));
+	REQUIRE(doubleValue == 0);
+	REQUIRE_FALSE(NumberParsers::ParseDouble("1e", 2, doubleValue));
+	REQUIRE_FALSE(NumberParsers::ParseDouble("1,5", 3, doubleValue));
+	REQUIRE_FALSE(NumberParsers::ParseDouble("-", 1, doubleValue));
+
+	//only given length is parsed
+	REQUIRE(NumberParsers::ParseDouble("123|456", 3, doubleValue));
+	REQUIRE(doubleValue == 123);
+
+	//ints
+	REQUIRE(NumberParsers::ParseInt("-2147483648", 11, intValue));
+	REQUIRE(intValue == std::numeric_limits<int>::min());
+	REQUIRE(NumberParsers::ParseInt("000000000042", 12, intValue));
+	REQUIRE(intValue == 42);
+	REQUIRE_FALSE(NumberParsers::ParseInt("2147483648", 10, intValue));
+	REQUIRE_FALSE(NumberParsers::ParseInt("1.5", 3, intValue));
+	REQUIRE(NumberParsers::ParseLong("1234567812345678", 16, longValue));
+	REQUIRE(longValue == 1234567812345678L);
+	//leading zeros are not significant digits, 15 digits value is read exactly
+	REQUIRE(NumberParsers::ParseLong("0000000123456789012345", 22, longValue));
+	REQUIRE(longValue == 123456789012345L);
+	REQUIRE(NumberParsers::ParseDouble("0000000123456789012.345", 23, doubleValue));
+	REQUIRE(doubleValue == 123456789012.345);
+
+	//StringUtils keeps old values but tells about errors
+	bool result = true;
+	REQUIRE(StringUtils::ParseDouble("30e-2", &result) == 0.3);
+	REQUIRE(result);
+	REQUIRE(StringUtils::ParseDouble("12abc", &result) == 12);
+	REQUIRE_FALSE(result);
+	REQUIRE(StringUtils::ParseInt(" 15 ", &result) == 15);
+	REQUIRE(result);
+	REQUIRE(StringUtils::ParseLong("000000000000000000123456789012345", &result) == 123456789012345L);
+	REQUIRE(result);
+}
+
+
+TEST_CASE("CCDB/StringUtils/NumberParsersBulk", "Bulk conversion reports failed cells")
+{
+	string blob = "1.5|x|-3|4e1|7.";
+	vector<string> cellStrings;
+	StringUtils::Split(blob, cellStrings, "|");
+	vector<CharSpan> cells(cellStrings.size());
+	for(size_t i = 0; i < cells.size(); i++)
+	{
+		cells[i].Data = cellStrings[i].data();
+		cells[i].Length = cellStrings[i].size();
+	}
+
+	vector<double> values(cells.size());
+	vector<size_t> failedCells;
+	REQUIRE(NumberParsers::ParseDoubles(&cells[0], cells.size(), &values[0], &failedCells) == 1);
+	REQUIRE(failedCells.size() == 1);
+	REQUIRE(failedCells[0] == 1);
+	REQUIRE(values[0] == 1.5);
+	REQUIRE(values[1] == 0);
+	REQUIRE(values[2] == -3);
+	REQUIRE(values[3] == 40);
+	REQUIRE(values[4] == 7);
+
+	vector<int> intValues(cells.size());
+	failedCells.clear();
+	REQUIRE(NumberParsers::ParseInts(&cells[0], cells.size(), &intValues[0], &failedCells) == 4);
+	REQUIRE(intValues[2] == -3);
+
+	//decimal point does not depend on current locale
+	const char *oldLocale = setlocale(LC_NUMERIC, NULL);
+	string savedLocale = oldLocale ? oldLocale : "C";
+	if(setlocale(LC_NUMERIC, "de_DE.UTF-8") || setlocale(LC_NUMERIC, "fr_FR.UTF-8"))
+	{
+		double value;
+		REQUIRE(NumberParsers::ParseDouble("0.12345678901234567890123", 25, value));
+		REQUIRE(value == 0.12345678901234567890123);
+		REQUIRE_FALSE(NumberParsers::ParseDouble("1,5", 3, value));
+	}
+	setlocale(LC_NUMERIC, savedLocale.c_str());
+}
+
 #endif //test_StringUtils_h
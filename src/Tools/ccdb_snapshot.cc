@@ -0,0 +1,161 @@
+/**
+ * 	ccdb_snapshot writes constants for a set of runs, one variation and one time
+ * 	to a snapshot file that is read by snapshot://<file> connection
+ *
+ * 	Usage:
+ * 	    ccdb_snapshot -c <connection> -o <file> [-r <run>|<min>-<max>]... [-v <variation>] [-t <time>] [-p <table path>]...
+ *
+ * 	    -c  connection string: sqlite://<file> or mysql://... (CCDB_CONNECTION is used if not set)
+ * 	    -o  output snapshot file
+ * 	    -r  run or run range. Might be given many times. All runs if not set
+ * 	    -v  variation. "default" if not set
+ * 	    -t  time as YYYY:MM:DD-hh:mm:ss (or its beginning). The latest constants if not set
+ * 	    -p  type table path. Might be given many times. All type tables if not set
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <memory>
+
+#include "CCDB/Providers/SQLiteDataProvider.h"
+#include "CCDB/Providers/SnapshotWriter.h"
+#include "CCDB/Helpers/PathUtils.h"
+#include "CCDB/Helpers/StringUtils.h"
+#include "CCDB/Log.h"
+#ifdef CCDB_MYSQL
+#include "CCDB/Providers/MySQLDataProvider.h"
+#endif //CCDB_MYSQL
+
+using namespace std;
+using namespace ccdb;
+
+
+//______________________________________________________________________________
+static void print_usage()
+{
+	printf("Usage: ccdb_snapshot -c <connection> -o <file> [-r <run>|<min>-<max>]... [-v <variation>] [-t <time>] [-p <table path>]...\n");
+}
+
+
+//______________________________________________________________________________
+static bool parse_runs(const string& value, int& runMin, int& runMax)
+{
+	//<run> or <min>-<max>
+	size_t dashPos = value.find('-', 1);
+	bool minOk = true, maxOk = true;
+	if(dashPos == string::npos)
+	{
+		runMin = runMax = StringUtils::ParseInt(value, &minOk);
+		return minOk;
+	}
+	runMin = StringUtils::ParseInt(value.substr(0, dashPos), &minOk);
+	runMax = StringUtils::ParseInt(value.substr(dashPos + 1), &maxOk);
+	return minOk && maxOk;
+}
+
+
+//______________________________________________________________________________
+int main(int argc, char *argv[])
+{
+	string connectionString = getenv("CCDB_CONNECTION") ? getenv("CCDB_CONNECTION") : "";
+	string fileName;
+	string variation = "default";
+	time_t time = 0;
+	vector<pair<int, int> > runs;
+	vector<string> paths;
+
+	for(int i = 1; i < argc; i++)
+	{
+		string arg(argv[i]);
+		if(arg == "-h" || arg == "--help")
+		{
+			print_usage();
+			return 0;
+		}
+		if(i + 1 >= argc || arg.size() != 2 || arg[0] != '-')
+		{
+			print_usage();
+			return 1;
+		}
+
+		string value(argv[++i]);
+		switch(arg[1])
+		{
+		case 'c': connectionString = value; break;
+		case 'o': fileName = value; break;
+		case 'v': variation = value; break;
+		case 'p': paths.push_back(value); break;
+		case 't':
+		{
+			bool ok = false;
+			time = PathUtils::ParseTime(value, &ok);
+			if(!ok)
+			{
+				printf("Can't parse time '%s'\n", value.c_str());
+				return 1;
+			}
+			break;
+		}
+		case 'r':
+		{
+			int runMin, runMax;
+			if(!parse_runs(value, runMin, runMax))
+			{
+				printf("Can't parse runs '%s'\n", value.c_str());
+				return 1;
+			}
+			runs.push_back(make_pair(runMin, runMax));
+			break;
+		}
+		default:
+			print_usage();
+			return 1;
+		}
+	}
+
+	if(connectionString.empty() || fileName.empty())
+	{
+		print_usage();
+		return 1;
+	}
+
+	//provider by connection string type
+	unique_ptr<DataProvider> provider;
+	if(connectionString.find("sqlite://") == 0)
+	{
+		provider.reset(new SQLiteDataProvider());
+	}
+#ifdef CCDB_MYSQL
+	else if(connectionString.find("mysql://") == 0)
+	{
+		provider.reset(new MySQLDataProvider());
+	}
+#endif //CCDB_MYSQL
+	else
+	{
+		printf("Unknown connection string type: %s\n", connectionString.c_str());
+		return 1;
+	}
+
+	if(!provider->Connect(connectionString))
+	{
+		printf("Can't connect to %s\n", connectionString.c_str());
+		return 1;
+	}
+
+	SnapshotWriter writer(provider.get());
+	writer.SetVariation(variation);
+	writer.SetTime(time);
+	for(size_t i = 0; i < runs.size(); i++) writer.AddRuns(runs[i].first, runs[i].second);
+	for(size_t i = 0; i < paths.size(); i++) writer.AddTable(paths[i]);
+
+	if(!writer.Write(fileName))
+	{
+		printf("Snapshot was not written\n");
+		return 1;
+	}
+
+	printf("Written %s: %lu tables, %lu assignments\n", fileName.c_str(), (unsigned long)writer.GetWrittenTablesCount(), (unsigned long)writer.GetWrittenAssignmentsCount());
+	return 0;
+}